@@ -0,0 +1,134 @@
+// CME MDP price-level books and the per-security recovery state machine.
+// One iteration is one MDIncrementalRefreshEntry.
+
+#include "message_mix.h"
+#include "src/cme/cme_order_book.h"
+#include "src/cme/recovery_state.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr size_t SCRIPT_ENTRIES = size_t{1} << 20;
+
+void BM_CmeOrderBookApplyUpdate(benchmark::State& state, bench::CmeMixProfile profile) {
+    auto entries = bench::generateCmeEntries(profile, SCRIPT_ENTRIES);
+    std::vector<std::unique_ptr<cme::CmeOrderBook>> books;
+    for (uint32_t id = 1; id <= profile.securities; ++id) {
+        books.push_back(std::make_unique<cme::CmeOrderBook>(id, profile.depth));
+    }
+
+    // Level-addressed updates stay valid when the script wraps
+    size_t next = 0;
+    for (auto _ : state) {
+        const auto& entry = entries[next];
+        books[entry.security_id - 1]->applyUpdate(entry);
+        if (++next == entries.size()) next = 0;
+    }
+    benchmark::DoNotOptimize(books[0]->bids().price[0]);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// In-sequence entries: the common case, every entry applied
+void BM_RecoveryInOrder(benchmark::State& state, bench::CmeMixProfile profile) {
+    auto entries = bench::generateCmeEntries(profile, SCRIPT_ENTRIES);
+    cme::RecoveryManager manager;
+    std::vector<cme::SecurityRecoveryState> states(profile.securities);
+    auto reset = [&]() {
+        for (uint32_t i = 0; i < profile.securities; ++i) {
+            states[i].security_id = i + 1;
+            manager.initSecurity(states[i], 1);
+        }
+    };
+    reset();
+
+    size_t next = 0;
+    uint64_t applied = 0;
+    for (auto _ : state) {
+        const auto& entry = entries[next];
+        applied += manager.onIncrementalMessage(states[entry.security_id - 1], entry, 0);
+        if (++next == entries.size()) {
+            // rpt_seq starts over with the script
+            state.PauseTiming();
+            reset();
+            next = 0;
+            state.ResumeTiming();
+        }
+    }
+    benchmark::DoNotOptimize(applied);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Every security waiting for a snapshot: entries are buffered (the oldest
+// dropped once the buffer is full) until the state is reset
+void BM_RecoveryBuffering(benchmark::State& state, bench::CmeMixProfile profile) {
+    auto entries = bench::generateCmeEntries(profile, SCRIPT_ENTRIES);
+    cme::RecoveryManager manager;
+    std::vector<cme::SecurityRecoveryState> states(profile.securities);
+    auto reset = [&]() {
+        for (uint32_t i = 0; i < profile.securities; ++i) {
+            states[i].security_id = i + 1;
+            // Expecting 0 makes rpt_seq 1 a gap
+            manager.initSecurity(states[i], 0);
+        }
+    };
+    reset();
+
+    size_t next = 0;
+    uint64_t applied = 0;
+    for (auto _ : state) {
+        const auto& entry = entries[next];
+        applied += manager.onIncrementalMessage(states[entry.security_id - 1], entry, 0);
+        if (++next == entries.size()) {
+            state.PauseTiming();
+            reset();
+            next = 0;
+            state.ResumeTiming();
+        }
+    }
+    benchmark::DoNotOptimize(applied);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["buffered"] = static_cast<double>(manager.getStats().messages_buffered);
+}
+
+// Snapshot arrives with a full buffer: replay everything newer than it
+void BM_RecoveryCompleteRecovery(benchmark::State& state) {
+    const size_t buffered = static_cast<size_t>(state.range(0));
+    cme::RecoveryManager manager(buffered);
+    cme::SecurityRecoveryState security;
+    security.security_id = 1;
+
+    cme::MDIncrementalRefreshEntry entry{};
+    entry.security_id = 1;
+    entry.md_entry_type = static_cast<uint8_t>(cme::MDEntryType::Bid);
+    entry.md_update_action = static_cast<uint8_t>(cme::MDUpdateAction::Change);
+    entry.md_price_level = 1;
+
+    uint64_t replayed = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        manager.initSecurity(security, 0);
+        for (size_t i = 0; i < buffered; ++i) {
+            entry.rpt_seq = static_cast<uint32_t>(i + 2);
+            manager.onIncrementalMessage(security, entry, 0);
+        }
+        manager.onSnapshotMessage(security, 1, 0);
+        state.ResumeTiming();
+
+        replayed += manager.completeRecovery(security, 1, 0, [](const cme::MDIncrementalRefreshEntry& e) {
+            benchmark::DoNotOptimize(e.rpt_seq);
+        });
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(replayed));
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_CmeOrderBookApplyUpdate, top_heavy, bench::CME_TOP_HEAVY_MIX);
+BENCHMARK_CAPTURE(BM_CmeOrderBookApplyUpdate, deep, bench::CME_DEEP_MIX);
+BENCHMARK_CAPTURE(BM_RecoveryInOrder, top_heavy, bench::CME_TOP_HEAVY_MIX);
+BENCHMARK_CAPTURE(BM_RecoveryBuffering, top_heavy, bench::CME_TOP_HEAVY_MIX);
+BENCHMARK(BM_RecoveryCompleteRecovery)->Arg(64)->Arg(4096);
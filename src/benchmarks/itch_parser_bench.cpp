@@ -0,0 +1,225 @@
+// ITCH packet parsing, from framing alone up to the full single-shard
+// processing path (decode, order index, book update, conflation capture).
+// One iteration is one packet; items are messages.
+//
+// Besides the synthetic mixes, --itch_capture=<file> (pcap or NASDAQ binary
+// ITCH, see feedhandler::CaptureReader) adds the same benchmarks over a
+// recorded session.
+
+#include "message_mix.h"
+#include "src/feedhandler/feedhandler_config.h"
+#include "src/feedhandler/itch_decoder.h"
+#include "src/feedhandler/itch_shard.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace {
+
+namespace itch = feedhandler::itch;
+
+constexpr size_t SCRIPT_OPS = size_t{1} << 20;
+
+// A synthetic session: directory, warmup, then the steady-state mix. The
+// first `setup_packets` packets build the books and are never timed.
+struct Session {
+    bench::ItchStream stream;
+    size_t setup_packets = 0;
+    size_t peak_orders = 0;
+};
+
+Session makeSession(const bench::MixProfile& profile) {
+    Session session;
+    bench::BookScript script = bench::generateBookScript(profile, SCRIPT_OPS);
+    bench::appendItchDirectory(session.stream, profile.books);
+    bench::appendItchMessages(session.stream, script.warmup);
+    session.setup_packets = session.stream.packets.size();
+    // Mix starts on a fresh packet
+    session.stream.packets.emplace_back(session.stream.data.size(), 0);
+    bench::appendItchMessages(session.stream, script.ops);
+    session.peak_orders = script.peak_orders;
+    return session;
+}
+
+Session loadSession(const std::string& path) {
+    Session session;
+    bench::loadItchCapture(path, session.stream);
+    session.peak_orders = feedhandler::OrderIndex::DEFAULT_CAPACITY;
+    return session;
+}
+
+// Reads every field the handler would, so the decode is not optimized away
+struct FieldReader {
+    uint64_t sum = 0;
+
+    void on(const itch::AddOrderMessage& msg) {
+        sum += msg.getOrderRef() + msg.getPrice() + msg.getShares() + msg.getStockLocate();
+    }
+    void on(const itch::OrderCancelMessage& msg) { sum += msg.getOrderRef() + msg.getCancelledShares(); }
+    void on(const itch::OrderDeleteMessage& msg) { sum += msg.getOrderRef(); }
+    void on(const itch::OrderExecutedMessage& msg) { sum += msg.getOrderRef() + msg.getExecutedShares(); }
+    void on(const itch::OrderReplaceMessage& msg) {
+        sum += msg.getOriginalOrderRef() + msg.getNewOrderRef() + msg.getPrice() + msg.getShares();
+    }
+};
+
+// Cycle over the packets after the setup ones
+class PacketCursor {
+public:
+    explicit PacketCursor(const Session& session)
+        : session_(session), next_(session.setup_packets) {}
+
+    // False once the session has been used up (caller resets its state)
+    bool next(const uint8_t*& data, size_t& length) {
+        if (next_ == session_.stream.packets.size()) return false;
+        const auto& packet = session_.stream.packets[next_++];
+        data = session_.stream.data.data() + packet.first;
+        length = packet.second;
+        return true;
+    }
+
+    void rewind() { next_ = session_.setup_packets; }
+
+private:
+    const Session& session_;
+    size_t next_;
+};
+
+void BM_ItchFraming(benchmark::State& state, const Session* session) {
+    PacketCursor cursor(*session);
+    int64_t messages = 0;
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        const uint8_t* data;
+        size_t length;
+        if (!cursor.next(data, length)) {
+            cursor.rewind();
+            continue;
+        }
+        size_t total = 0;
+        messages += static_cast<int64_t>(itch::forEachMessage(data, length, [&](const uint8_t*, size_t n) {
+            total += n;
+        }));
+        benchmark::DoNotOptimize(total);
+        bytes += static_cast<int64_t>(length);
+    }
+    state.SetItemsProcessed(messages);
+    state.SetBytesProcessed(bytes);
+}
+
+void BM_ItchDecode(benchmark::State& state, const Session* session) {
+    PacketCursor cursor(*session);
+    FieldReader reader;
+    int64_t messages = 0;
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        const uint8_t* data;
+        size_t length;
+        if (!cursor.next(data, length)) {
+            cursor.rewind();
+            continue;
+        }
+        messages += static_cast<int64_t>(itch::forEachMessage(data, length, [&](const uint8_t* msg, size_t n) {
+            itch::Decoder<FieldReader>::dispatch(msg, n, reader);
+        }));
+        bytes += static_cast<int64_t>(length);
+    }
+    benchmark::DoNotOptimize(reader.sum);
+    state.SetItemsProcessed(messages);
+    state.SetBytesProcessed(bytes);
+}
+
+// Full ingest path in conflated mode (nothing is sent on this thread)
+void BM_ItchShard(benchmark::State& state, const Session* session) {
+    feedhandler::FeedHandlerConfig config;
+    config.mode = feedhandler::ProcessingMode::Conflated;
+    config.order_index_capacity = session->peak_orders * 2;
+
+    std::unique_ptr<feedhandler::ItchShard> shard;
+    auto rebuild = [&]() {
+        shard = std::make_unique<feedhandler::ItchShard>(config, 0, 1);
+        for (size_t i = 0; i < session->setup_packets; ++i) {
+            const auto& packet = session->stream.packets[i];
+            itch::forEachMessage(session->stream.data.data() + packet.first, packet.second,
+                                 [&](const uint8_t* msg, size_t n) { shard->processItchMessage(msg, n, 0); });
+            shard->flush();
+        }
+    };
+    rebuild();
+
+    PacketCursor cursor(*session);
+    int64_t messages = 0;
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        const uint8_t* data;
+        size_t length;
+        if (!cursor.next(data, length)) {
+            state.PauseTiming();
+            rebuild();
+            cursor.rewind();
+            state.ResumeTiming();
+            continue;
+        }
+        messages += static_cast<int64_t>(itch::forEachMessage(data, length, [&](const uint8_t* msg, size_t n) {
+            shard->processItchMessage(msg, n, 0);
+        }));
+        shard->flush();
+        bytes += static_cast<int64_t>(length);
+    }
+    state.SetItemsProcessed(messages);
+    state.SetBytesProcessed(bytes);
+}
+
+template <typename Fn>
+void registerSession(const std::string& name, const Session* session, Fn&& bm) {
+    benchmark::RegisterBenchmark(name.c_str(), bm, session);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Our own flag first; benchmark::Initialize rejects unknown ones
+    std::string capture;
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--itch_capture=", 15) == 0) {
+            capture = argv[i] + 15;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    static const bench::MixProfile* const PROFILES[] = {
+        &bench::BALANCED_MIX, &bench::HEAVY_CANCEL_MIX, &bench::DEEP_BOOK_MIX, &bench::MULTI_SYMBOL_MIX,
+    };
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (const auto* profile : PROFILES) {
+        sessions.push_back(std::make_unique<Session>(makeSession(*profile)));
+        std::string suffix = std::string("/") + profile->name;
+        registerSession("BM_ItchFraming" + suffix, sessions.back().get(), BM_ItchFraming);
+        registerSession("BM_ItchDecode" + suffix, sessions.back().get(), BM_ItchDecode);
+        registerSession("BM_ItchShard" + suffix, sessions.back().get(), BM_ItchShard);
+    }
+
+    if (!capture.empty()) {
+        sessions.push_back(std::make_unique<Session>(loadSession(capture)));
+        if (sessions.back()->stream.packets.empty()) return 1;
+        std::cout << capture << ": " << sessions.back()->stream.packets.size() << " packets, "
+                  << sessions.back()->stream.messages << " messages" << std::endl;
+        registerSession("BM_ItchFraming/capture", sessions.back().get(), BM_ItchFraming);
+        registerSession("BM_ItchDecode/capture", sessions.back().get(), BM_ItchDecode);
+        registerSession("BM_ItchShard/capture", sessions.back().get(), BM_ItchShard);
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
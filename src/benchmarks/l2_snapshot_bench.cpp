@@ -0,0 +1,154 @@
+// SBE L2Snapshot encode / decode: the raw l2md encoder and decoder, the
+// OrderBookSnapshot conversion used by the ITCH publisher and receivers, and
+// CmeOrderBook's direct encode from its level arrays. Arguments are levels
+// per side.
+
+#include "message_mix.h"
+#include "src/cme/cme_order_book.h"
+#include "src/cme/l2_sbe_messages.h"
+#include "src/feedhandler/l2_snapshot.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+std::vector<l2md::PriceLevelEntry> makeLevels(size_t levels, int64_t start, int64_t step) {
+    std::vector<l2md::PriceLevelEntry> entries(levels);
+    for (size_t i = 0; i < levels; ++i) {
+        entries[i].level = static_cast<uint8_t>(i + 1);
+        entries[i].price = start + static_cast<int64_t>(i) * step;
+        entries[i].quantity = static_cast<uint32_t>(100 * (i + 1));
+        entries[i].numOrders = static_cast<uint16_t>(i + 1);
+    }
+    return entries;
+}
+
+feedhandler::OrderBookSnapshot makeSnapshot(size_t levels) {
+    feedhandler::OrderBookSnapshot snap{};
+    std::memcpy(snap.symbol, "BENCH   ", sizeof(snap.symbol));
+    snap.bids.count = static_cast<uint8_t>(levels);
+    snap.asks.count = static_cast<uint8_t>(levels);
+    for (size_t i = 0; i < levels; ++i) {
+        snap.bids.levels[i] = {bench::MID_PRICE - static_cast<uint32_t>(i + 1) * bench::PRICE_TICK,
+                               static_cast<uint32_t>(100 * (i + 1)), static_cast<uint32_t>(i + 1)};
+        snap.asks.levels[i] = {bench::MID_PRICE + static_cast<uint32_t>(i + 1) * bench::PRICE_TICK,
+                               static_cast<uint32_t>(100 * (i + 1)), static_cast<uint32_t>(i + 1)};
+    }
+    snap.last_price = bench::MID_PRICE;
+    snap.last_quantity = 100;
+    snap.total_volume = 1000000;
+    return snap;
+}
+
+void BM_L2SnapshotEncoder(benchmark::State& state) {
+    auto levels = static_cast<uint8_t>(state.range(0));
+    auto bids = makeLevels(levels, 10000000000LL, -1000000);
+    auto asks = makeLevels(levels, 10001000000LL, 1000000);
+    uint8_t buffer[l2md::MAX_L2_SNAPSHOT_SIZE];
+
+    uint64_t sequence = 0;
+    for (auto _ : state) {
+        l2md::L2SnapshotEncoder encoder(buffer, sizeof(buffer));
+        encoder.encode("BENCH   ", 0, ++sequence, 10000500000LL, 100, 1000000, levels, levels,
+                       bids.data(), levels, asks.data(), levels);
+        benchmark::DoNotOptimize(buffer);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * l2md::calcL2SnapshotSize(levels, levels)));
+}
+
+void BM_L2SnapshotDecoder(benchmark::State& state) {
+    auto levels = static_cast<uint8_t>(state.range(0));
+    auto bids = makeLevels(levels, 10000000000LL, -1000000);
+    auto asks = makeLevels(levels, 10001000000LL, 1000000);
+    uint8_t buffer[l2md::MAX_L2_SNAPSHOT_SIZE];
+    l2md::L2SnapshotEncoder encoder(buffer, sizeof(buffer));
+    encoder.encode("BENCH   ", 0, 1, 10000500000LL, 100, 1000000, levels, levels,
+                   bids.data(), levels, asks.data(), levels);
+    size_t length = encoder.encodedLength();
+
+    // Parse and walk every level, as a receiver would
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buffer);
+        l2md::L2SnapshotDecoder decoder(buffer, length);
+        int64_t sum = 0;
+        if (decoder.isValid()) {
+            for (uint8_t i = 0; i < decoder.numBids(); ++i) sum += decoder.getBid(i)->price;
+            for (uint8_t i = 0; i < decoder.numAsks(); ++i) sum += decoder.getAsk(i)->quantity;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * length));
+}
+
+void BM_EncodeL2SnapshotFromBook(benchmark::State& state) {
+    auto snap = makeSnapshot(static_cast<size_t>(state.range(0)));
+    uint8_t buffer[feedhandler::MAX_L2_SNAPSHOT_BYTES];
+    size_t total = 0;
+    for (auto _ : state) {
+        snap.sequence++;
+        total += feedhandler::encodeL2Snapshot(snap, buffer, sizeof(buffer));
+        benchmark::DoNotOptimize(buffer);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(total));
+}
+
+void BM_DecodeL2SnapshotToBook(benchmark::State& state) {
+    auto snap = makeSnapshot(static_cast<size_t>(state.range(0)));
+    uint8_t buffer[feedhandler::MAX_L2_SNAPSHOT_BYTES];
+    size_t length = feedhandler::encodeL2Snapshot(snap, buffer, sizeof(buffer));
+
+    feedhandler::OrderBookSnapshot out;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buffer);
+        bool ok = feedhandler::decodeL2Snapshot(buffer, length, out);
+        benchmark::DoNotOptimize(ok);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * length));
+}
+
+void BM_CmeOrderBookEncodeL2Snapshot(benchmark::State& state) {
+    auto depth = static_cast<size_t>(state.range(0));
+    cme::CmeOrderBook book(1, depth);
+    book.setSymbol("BENCH");
+    for (size_t level = 1; level <= depth; ++level) {
+        for (uint8_t side = 0; side < 2; ++side) {
+            cme::MDIncrementalRefreshEntry entry{};
+            entry.security_id = 1;
+            entry.md_entry_type = static_cast<uint8_t>(side == 0 ? cme::MDEntryType::Bid : cme::MDEntryType::Offer);
+            entry.md_update_action = static_cast<uint8_t>(cme::MDUpdateAction::New);
+            entry.md_price_level = static_cast<uint8_t>(level);
+            entry.md_entry_px = 45000000000LL + (side == 0 ? -1 : 1) * static_cast<int64_t>(level) * 2500000;
+            entry.md_entry_size = 10;
+            entry.number_of_orders = 3;
+            book.applyUpdate(entry);
+        }
+    }
+
+    uint8_t buffer[cme::CME_MAX_L2_SNAPSHOT_BYTES];
+    size_t total = 0;
+    for (auto _ : state) {
+        total += book.encodeL2Snapshot(buffer, sizeof(buffer));
+        benchmark::DoNotOptimize(buffer);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(total));
+}
+
+} // namespace
+
+BENCHMARK(BM_L2SnapshotEncoder)->Arg(1)->Arg(5)->Arg(l2md::MAX_LEVELS);
+BENCHMARK(BM_L2SnapshotDecoder)->Arg(1)->Arg(5)->Arg(l2md::MAX_LEVELS);
+BENCHMARK(BM_EncodeL2SnapshotFromBook)->Arg(1)->Arg(5)->Arg(feedhandler::MAX_DEPTH);
+BENCHMARK(BM_DecodeL2SnapshotToBook)->Arg(1)->Arg(5)->Arg(feedhandler::MAX_DEPTH);
+BENCHMARK(BM_CmeOrderBookEncodeL2Snapshot)->Arg(cme::CME_MAX_DEPTH)->Arg(cme::CME_MAX_BOOK_DEPTH);
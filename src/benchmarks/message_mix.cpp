@@ -0,0 +1,351 @@
+#include "message_mix.h"
+
+#include "src/feedhandler/capture_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace bench {
+
+namespace {
+
+struct LiveOrder {
+    uint64_t ref;
+    feedhandler::itch::Side side;
+    uint32_t price;
+    uint32_t qty;
+};
+
+class ScriptBuilder {
+public:
+    ScriptBuilder(const MixProfile& profile, uint32_t seed)
+        : profile_(profile), rng_(seed), live_(profile.books) {}
+
+    BookOp add(uint16_t book) {
+        BookOp op{};
+        op.type = OpType::Add;
+        op.book = book;
+        op.side = coin() ? feedhandler::itch::Side::Buy : feedhandler::itch::Side::Sell;
+        op.order_ref = next_ref_++;
+        op.price = pickPrice(op.side);
+        op.qty = pickQty();
+        live_[book].push_back({op.order_ref, op.side, op.price, op.qty});
+        live_count_++;
+        return op;
+    }
+
+    BookOp next() {
+        uint16_t book = pickBook();
+        auto& orders = live_[book];
+
+        // Adds keep the book at its resting size
+        uint32_t roll = static_cast<uint32_t>(rng_() % 100);
+        if (orders.size() < profile_.resting_orders / 2 || orders.empty()) return add(book);
+
+        uint32_t bound = profile_.cancel_pct;
+        if (roll < bound) return cancel(book);
+        bound += profile_.delete_pct;
+        if (roll < bound) return remove(book, OpType::Delete);
+        bound += profile_.execute_pct;
+        if (roll < bound) return execute(book);
+        bound += profile_.replace_pct;
+        if (roll < bound) return replace(book);
+        if (orders.size() >= profile_.resting_orders * 2 && bound > 0) return remove(book, OpType::Delete);
+        return add(book);
+    }
+
+    size_t liveOrders() const { return live_count_; }
+
+private:
+    BookOp cancel(uint16_t book) {
+        size_t index = pickOrder(book);
+        LiveOrder& order = live_[book][index];
+        if (order.qty < 2) return remove(book, OpType::Delete, index);
+
+        BookOp op = opFor(OpType::Cancel, book, order);
+        op.qty = order.qty / 2;
+        order.qty -= op.qty;
+        return op;
+    }
+
+    BookOp execute(uint16_t book) {
+        size_t index = pickOrder(book);
+        LiveOrder& order = live_[book][index];
+
+        // Half of executions take the whole order
+        if (coin()) return remove(book, OpType::Execute, index);
+
+        BookOp op = opFor(OpType::Execute, book, order);
+        op.qty = std::max<uint32_t>(1, order.qty / 4);
+        if (op.qty >= order.qty) return remove(book, OpType::Execute, index);
+        order.qty -= op.qty;
+        return op;
+    }
+
+    BookOp replace(uint16_t book) {
+        size_t index = pickOrder(book);
+        LiveOrder& order = live_[book][index];
+
+        BookOp op = opFor(OpType::Replace, book, order);
+        op.new_ref = next_ref_++;
+        op.price = pickPrice(order.side);
+        op.qty = pickQty();
+
+        order.ref = op.new_ref;
+        order.price = op.price;
+        order.qty = op.qty;
+        return op;
+    }
+
+    BookOp remove(uint16_t book, OpType type, size_t index = SIZE_MAX) {
+        auto& orders = live_[book];
+        if (index == SIZE_MAX) index = pickOrder(book);
+
+        BookOp op = opFor(type, book, orders[index]);
+        op.qty = orders[index].qty;         // Execute: the whole remainder
+        orders[index] = orders.back();
+        orders.pop_back();
+        live_count_--;
+        return op;
+    }
+
+    static BookOp opFor(OpType type, uint16_t book, const LiveOrder& order) {
+        BookOp op{};
+        op.type = type;
+        op.book = book;
+        op.side = order.side;
+        op.order_ref = order.ref;
+        op.price = order.price;
+        return op;
+    }
+
+    uint16_t pickBook() {
+        return profile_.books > 1 ? static_cast<uint16_t>(rng_() % profile_.books) : 0;
+    }
+
+    size_t pickOrder(uint16_t book) { return rng_() % live_[book].size(); }
+
+    // Levels nearer the touch are busier: the square of a uniform draw
+    // skews offsets towards 1
+    uint32_t pickPrice(feedhandler::itch::Side side) {
+        double u = static_cast<double>(rng_()) / static_cast<double>(std::mt19937::max());
+        uint32_t offset = 1 + static_cast<uint32_t>(u * u * profile_.levels);
+        offset = std::min(offset, profile_.levels);
+        return side == feedhandler::itch::Side::Buy ? MID_PRICE - offset * PRICE_TICK
+                                                    : MID_PRICE + offset * PRICE_TICK;
+    }
+
+    uint32_t pickQty() { return 100 * (1 + static_cast<uint32_t>(rng_() % 10)); }
+
+    bool coin() { return (rng_() & 1) != 0; }
+
+    MixProfile profile_;
+    std::mt19937 rng_;
+    std::vector<std::vector<LiveOrder>> live_;
+    uint64_t next_ref_ = 1;
+    size_t live_count_ = 0;
+};
+
+template <typename Msg>
+void appendMessage(ItchStream& stream, const Msg& msg, size_t packet_bytes) {
+    auto& packets = stream.packets;
+    size_t wire = 2 + sizeof(Msg);
+    if (packets.empty() || packets.back().second + wire > packet_bytes) {
+        packets.emplace_back(stream.data.size(), 0);
+    }
+
+    uint8_t prefix[2] = {static_cast<uint8_t>(sizeof(Msg) >> 8), static_cast<uint8_t>(sizeof(Msg) & 0xFF)};
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&msg);
+    stream.data.insert(stream.data.end(), prefix, prefix + 2);
+    stream.data.insert(stream.data.end(), bytes, bytes + sizeof(Msg));
+    packets.back().second += wire;
+    stream.messages++;
+}
+
+template <typename Msg>
+Msg header(uint16_t book, uint64_t index) {
+    Msg msg{};
+    msg.type = Msg::TYPE;
+    msg.stock_locate = __builtin_bswap16(static_cast<uint16_t>(book + 1));
+    // Trading starts 09:30; one message per microsecond
+    msg.timestamp = feedhandler::itch::encodeTimestamp(34200000000000ULL + index * 1000);
+    return msg;
+}
+
+} // namespace
+
+BookScript generateBookScript(const MixProfile& profile, size_t count, uint32_t seed) {
+    BookScript script;
+    script.profile = profile;
+
+    ScriptBuilder builder(profile, seed);
+    script.warmup.reserve(profile.resting_orders * profile.books);
+    for (size_t i = 0; i < profile.resting_orders; ++i) {
+        for (uint16_t book = 0; book < profile.books; ++book) {
+            script.warmup.push_back(builder.add(book));
+        }
+    }
+
+    script.peak_orders = builder.liveOrders();
+
+    script.ops.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        script.ops.push_back(builder.next());
+        script.peak_orders = std::max(script.peak_orders, builder.liveOrders());
+    }
+    return script;
+}
+
+std::string bookSymbol(uint16_t book) {
+    char symbol[9];
+    std::snprintf(symbol, sizeof(symbol), "S%-7u", static_cast<unsigned>(book));
+    return std::string(symbol, 8);
+}
+
+void appendItchDirectory(ItchStream& stream, uint16_t books, size_t packet_bytes) {
+    namespace itch = feedhandler::itch;
+    for (uint16_t book = 0; book < books; ++book) {
+        auto msg = header<itch::StockDirectoryMessage>(book, 0);
+        std::memcpy(msg.stock, bookSymbol(book).data(), sizeof(msg.stock));
+        msg.market_category = 'Q';
+        msg.financial_status = 'N';
+        msg.lot_size = __builtin_bswap32(100);
+        msg.round_lots_only = 'N';
+        appendMessage(stream, msg, packet_bytes);
+    }
+}
+
+void appendItchMessages(ItchStream& stream, const std::vector<BookOp>& ops, size_t packet_bytes) {
+    namespace itch = feedhandler::itch;
+    stream.data.reserve(stream.data.size() + ops.size() * 40);
+
+    uint64_t index = stream.messages;
+    for (const auto& op : ops) {
+        switch (op.type) {
+            case OpType::Add: {
+                auto msg = header<itch::AddOrderMessage>(op.book, index);
+                msg.order_ref = __builtin_bswap64(op.order_ref);
+                msg.side = op.side;
+                msg.shares = __builtin_bswap32(op.qty);
+                std::memcpy(msg.stock, bookSymbol(op.book).data(), sizeof(msg.stock));
+                msg.price = __builtin_bswap32(op.price);
+                appendMessage(stream, msg, packet_bytes);
+                break;
+            }
+            case OpType::Cancel: {
+                auto msg = header<itch::OrderCancelMessage>(op.book, index);
+                msg.order_ref = __builtin_bswap64(op.order_ref);
+                msg.cancelled_shares = __builtin_bswap32(op.qty);
+                appendMessage(stream, msg, packet_bytes);
+                break;
+            }
+            case OpType::Delete: {
+                auto msg = header<itch::OrderDeleteMessage>(op.book, index);
+                msg.order_ref = __builtin_bswap64(op.order_ref);
+                appendMessage(stream, msg, packet_bytes);
+                break;
+            }
+            case OpType::Execute: {
+                auto msg = header<itch::OrderExecutedMessage>(op.book, index);
+                msg.order_ref = __builtin_bswap64(op.order_ref);
+                msg.executed_shares = __builtin_bswap32(op.qty);
+                msg.match_number = __builtin_bswap64(index);
+                appendMessage(stream, msg, packet_bytes);
+                break;
+            }
+            case OpType::Replace: {
+                auto msg = header<itch::OrderReplaceMessage>(op.book, index);
+                msg.original_order_ref = __builtin_bswap64(op.order_ref);
+                msg.new_order_ref = __builtin_bswap64(op.new_ref);
+                msg.shares = __builtin_bswap32(op.qty);
+                msg.price = __builtin_bswap32(op.price);
+                appendMessage(stream, msg, packet_bytes);
+                break;
+            }
+        }
+        index++;
+    }
+}
+
+bool loadItchCapture(const std::string& path, ItchStream& stream) {
+    feedhandler::CaptureReader reader;
+    if (!reader.open(path)) return false;
+
+    feedhandler::CaptureRecord record;
+    while (reader.next(record)) {
+        stream.packets.emplace_back(stream.data.size(), record.length);
+        stream.data.insert(stream.data.end(), record.data, record.data + record.length);
+        stream.messages += record.messages;
+    }
+    if (stream.packets.empty()) {
+        std::cerr << path << ": no records" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<cme::MDIncrementalRefreshEntry> generateCmeEntries(const CmeMixProfile& profile, size_t count,
+                                                               uint32_t seed) {
+    constexpr int64_t CME_MID = 45000000000LL;     // 4500.00 with the -7 exponent
+    constexpr int64_t CME_TICK = 2500000;          // 0.25
+
+    struct Levels {
+        uint8_t count[2];
+        uint32_t rpt_seq;
+    };
+    std::vector<Levels> securities(profile.securities, Levels{{profile.depth, profile.depth}, 0});
+
+    std::mt19937 rng(seed);
+    std::vector<cme::MDIncrementalRefreshEntry> entries;
+    entries.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t index = static_cast<uint32_t>(rng() % profile.securities);
+        Levels& levels = securities[index];
+
+        cme::MDIncrementalRefreshEntry entry{};
+        entry.security_id = index + 1;
+        entry.rpt_seq = ++levels.rpt_seq;
+        entry.md_entry_size = static_cast<int32_t>(1 + rng() % 50);
+        entry.number_of_orders = static_cast<uint8_t>(1 + rng() % 20);
+
+        uint32_t roll = static_cast<uint32_t>(rng() % 100);
+        if (roll < profile.trade_pct) {
+            entry.md_entry_type = static_cast<uint8_t>(cme::MDEntryType::Trade);
+            entry.md_update_action = static_cast<uint8_t>(cme::MDUpdateAction::New);
+            entry.md_entry_px = CME_MID;
+            entries.push_back(entry);
+            continue;
+        }
+
+        uint8_t side = static_cast<uint8_t>(rng() & 1);
+        uint8_t& populated = levels.count[side];
+        entry.md_entry_type = static_cast<uint8_t>(side == 0 ? cme::MDEntryType::Bid : cme::MDEntryType::Offer);
+
+        // Top of book is busiest: level = 1 + skewed draw over the populated levels
+        uint32_t span = std::max<uint32_t>(populated, 1);
+        uint32_t draw = static_cast<uint32_t>(rng() % span);
+        entry.md_price_level = static_cast<uint8_t>(1 + (draw * draw) / span);
+
+        cme::MDUpdateAction action = cme::MDUpdateAction::Change;
+        if (populated == 0 || (roll < profile.trade_pct + profile.new_pct && populated < profile.depth)) {
+            action = cme::MDUpdateAction::New;
+            entry.md_price_level = static_cast<uint8_t>(std::min<uint32_t>(entry.md_price_level, populated + 1));
+            populated++;
+        } else if (roll < profile.trade_pct + profile.new_pct + profile.delete_pct) {
+            action = cme::MDUpdateAction::Delete;
+            populated--;
+        }
+        entry.md_update_action = static_cast<uint8_t>(action);
+
+        int64_t offset = static_cast<int64_t>(entry.md_price_level) * CME_TICK;
+        entry.md_entry_px = side == 0 ? CME_MID - offset : CME_MID + offset;
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+} // namespace bench
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "src/cme/cme_protocol.h"
+#include "src/feedhandler/itch_protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// Synthetic, deterministic message mixes for the benchmarks. A script is
+// generated once per benchmark (outside the timed region) from a seed and
+// replayed against fresh books, so every run of a binary sees the same
+// operations and results compare across commits.
+
+// ============================================================================
+// Order-level (ITCH) mixes
+// ============================================================================
+
+enum class OpType : uint8_t {
+    Add,
+    Cancel,     // Partial cancel
+    Delete,
+    Execute,    // Partial or full execution
+    Replace,
+};
+
+struct BookOp {
+    OpType type;
+    feedhandler::itch::Side side;
+    uint16_t book;          // Index of the instrument (0 .. MixProfile::books - 1)
+    uint64_t order_ref;
+    uint64_t new_ref;       // Replace only
+    uint32_t price;
+    uint32_t qty;           // Add / Replace: shares; Cancel / Execute: shares removed
+};
+
+struct MixProfile {
+    const char* name;
+    uint16_t books;             // Instruments the orders are spread over
+    uint32_t levels;            // Price levels per side orders are placed on
+    size_t resting_orders;      // Live orders per book once warmed up
+
+    // Share of operations (percent) once warm; adds make up the rest. With
+    // no removals at all the script only adds and the book keeps growing.
+    uint32_t cancel_pct;
+    uint32_t delete_pct;
+    uint32_t execute_pct;
+    uint32_t replace_pct;
+};
+
+// Typical equity day: mostly adds and deletes, a few executions
+constexpr MixProfile BALANCED_MIX{"balanced", 1, 50, 2000, 5, 35, 8, 5};
+
+// Quote-stuffing style churn: almost every add is cancelled again
+constexpr MixProfile HEAVY_CANCEL_MIX{"heavy_cancel", 1, 20, 2000, 10, 42, 2, 4};
+
+// Thousands of levels per side, orders spread across the whole book
+constexpr MixProfile DEEP_BOOK_MIX{"deep_book", 1, 2000, 20000, 5, 35, 5, 5};
+
+// Many instruments, as a whole feed reaches the handler
+constexpr MixProfile MULTI_SYMBOL_MIX{"multi_symbol", 512, 50, 200, 5, 38, 6, 5};
+
+struct BookScript {
+    MixProfile profile;
+    std::vector<BookOp> warmup;     // Adds that build the resting books
+    std::vector<BookOp> ops;        // Steady-state mix, valid after warmup
+    size_t peak_orders = 0;         // Most orders live at once, across all books
+};
+
+// Generate warmup plus count steady-state operations. Every cancel, delete,
+// execute and replace refers to an order live at that point of the script.
+BookScript generateBookScript(const MixProfile& profile, size_t count, uint32_t seed = 1);
+
+// Price every operation uses as the middle of the book (4 decimals)
+constexpr uint32_t MID_PRICE = 1000000;
+constexpr uint32_t PRICE_TICK = 100;
+
+// ============================================================================
+// ITCH encoding
+// ============================================================================
+
+// Length-prefixed ITCH messages packed into datagram-sized packets,
+// as the handler receives them
+struct ItchStream {
+    std::vector<uint8_t> data;
+    std::vector<std::pair<size_t, size_t>> packets;     // (offset, length) into data
+    size_t messages = 0;
+};
+
+// Stock directory messages for books 0 .. books - 1 (locate = book + 1)
+void appendItchDirectory(ItchStream& stream, uint16_t books, size_t packet_bytes = 1400);
+
+// Encode ops as ITCH messages for locate book + 1 / symbol bookSymbol(book)
+void appendItchMessages(ItchStream& stream, const std::vector<BookOp>& ops, size_t packet_bytes = 1400);
+
+// Read a capture (see feedhandler::CaptureReader) into a stream, one packet
+// per record. False if the file could not be opened or held no records.
+bool loadItchCapture(const std::string& path, ItchStream& stream);
+
+// 8-character, space-padded symbol of a synthetic book
+std::string bookSymbol(uint16_t book);
+
+// ============================================================================
+// Price-level (CME MDP) mixes
+// ============================================================================
+
+struct CmeMixProfile {
+    const char* name;
+    uint32_t securities;
+    uint8_t depth;              // Levels per side kept populated
+
+    // Share of entries (percent); level changes make up the rest
+    uint32_t new_pct;           // Insert a level (the bottom one falls off)
+    uint32_t delete_pct;        // Remove a level (refilled by a later New)
+    uint32_t trade_pct;
+};
+
+constexpr CmeMixProfile CME_TOP_HEAVY_MIX{"top_heavy", 64, 10, 15, 15, 5};
+constexpr CmeMixProfile CME_DEEP_MIX{"deep", 64, 32, 20, 20, 2};
+
+// count entries with consecutive rpt_seq per security (security ids 1 .. n)
+std::vector<cme::MDIncrementalRefreshEntry> generateCmeEntries(const CmeMixProfile& profile, size_t count,
+                                                               uint32_t seed = 1);
+
+} // namespace bench
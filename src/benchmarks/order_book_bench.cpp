@@ -0,0 +1,140 @@
+// OrderBook under synthetic ITCH order flow, through the same OrderIndex +
+// external-order path ItchShard uses. One benchmark iteration is one order
+// operation; the book is rebuilt (untimed) whenever the script runs out.
+
+#include "message_mix.h"
+#include "src/feedhandler/order_book.h"
+#include "src/feedhandler/order_index.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+namespace {
+
+using feedhandler::LevelStorage;
+using feedhandler::OrderBook;
+using feedhandler::OrderIndex;
+
+constexpr size_t SCRIPT_OPS = size_t{1} << 18;
+
+// Single-operation mixes: warm book, then (almost) only that operation
+constexpr bench::MixProfile ADD_MIX{"add", 1, 50, 2000, 0, 0, 0, 0};
+constexpr bench::MixProfile CANCEL_MIX{"cancel", 1, 50, 2000, 100, 0, 0, 0};
+constexpr bench::MixProfile DELETE_MIX{"delete", 1, 50, 2000, 0, 100, 0, 0};
+constexpr bench::MixProfile EXECUTE_MIX{"execute", 1, 50, 2000, 0, 0, 100, 0};
+constexpr bench::MixProfile REPLACE_MIX{"replace", 1, 50, 2000, 0, 0, 0, 100};
+
+class Book {
+public:
+    Book(LevelStorage storage, const bench::BookScript& script)
+        : book_("BENCH   ", feedhandler::MAX_DEPTH, storage), index_(script.peak_orders * 2) {
+        for (const auto& op : script.warmup) apply(op);
+    }
+
+    void apply(const bench::BookOp& op) {
+        using bench::OpType;
+        if (op.type == OpType::Add) {
+            feedhandler::Order order{op.order_ref, op.price, op.qty, op.side};
+            index_.insert(order, &book_);
+            book_.addOrder(order);
+            return;
+        }
+
+        auto* entry = index_.find(op.order_ref);
+        if (!entry) return;
+        switch (op.type) {
+            case OpType::Cancel:
+                if (book_.cancelOrder(entry->order, op.qty)) index_.erase(entry);
+                break;
+            case OpType::Delete:
+                book_.deleteOrder(entry->order);
+                index_.erase(entry);
+                break;
+            case OpType::Execute:
+                if (book_.executeOrder(entry->order, op.qty, entry->order.price)) index_.erase(entry);
+                break;
+            case OpType::Replace: {
+                feedhandler::Order old_order = entry->order;
+                feedhandler::Order new_order{op.new_ref, op.price, op.qty, old_order.side};
+                index_.erase(entry);
+                index_.insert(new_order, &book_);
+                book_.replaceOrder(old_order, new_order);
+                break;
+            }
+            case OpType::Add:
+                break;
+        }
+    }
+
+    OrderBook& book() { return book_; }
+
+private:
+    OrderBook book_;
+    OrderIndex index_;
+};
+
+void BM_OrderBookMix(benchmark::State& state, bench::MixProfile profile, LevelStorage storage) {
+    bench::BookScript script = bench::generateBookScript(profile, SCRIPT_OPS);
+    std::unique_ptr<Book> book;
+    size_t next = script.ops.size();
+
+    for (auto _ : state) {
+        if (next == script.ops.size()) {
+            state.PauseTiming();
+            book = std::make_unique<Book>(storage, script);
+            next = 0;
+            state.ResumeTiming();
+        }
+        book->apply(script.ops[next++]);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Snapshot and BBO of a warmed book (depth MAX_DEPTH per side)
+void BM_OrderBookGetSnapshot(benchmark::State& state, bench::MixProfile profile, LevelStorage storage) {
+    Book book(storage, bench::generateBookScript(profile, 0));
+    uint64_t sequence = 0;
+    for (auto _ : state) {
+        auto snapshot = book.book().getSnapshot(0, ++sequence);
+        benchmark::DoNotOptimize(snapshot);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void BM_OrderBookGetBBO(benchmark::State& state, bench::MixProfile profile, LevelStorage storage) {
+    Book book(storage, bench::generateBookScript(profile, 0));
+    uint64_t sequence = 0;
+    for (auto _ : state) {
+        auto quote = book.book().getBBO(0, ++sequence);
+        benchmark::DoNotOptimize(quote);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_OrderBookMix, add_map, ADD_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookMix, add_ladder, ADD_MIX, LevelStorage::Ladder);
+BENCHMARK_CAPTURE(BM_OrderBookMix, cancel_map, CANCEL_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookMix, cancel_ladder, CANCEL_MIX, LevelStorage::Ladder);
+BENCHMARK_CAPTURE(BM_OrderBookMix, delete_map, DELETE_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookMix, delete_ladder, DELETE_MIX, LevelStorage::Ladder);
+BENCHMARK_CAPTURE(BM_OrderBookMix, execute_map, EXECUTE_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookMix, execute_ladder, EXECUTE_MIX, LevelStorage::Ladder);
+BENCHMARK_CAPTURE(BM_OrderBookMix, replace_map, REPLACE_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookMix, replace_ladder, REPLACE_MIX, LevelStorage::Ladder);
+
+BENCHMARK_CAPTURE(BM_OrderBookMix, balanced_map, bench::BALANCED_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookMix, balanced_ladder, bench::BALANCED_MIX, LevelStorage::Ladder);
+BENCHMARK_CAPTURE(BM_OrderBookMix, heavy_cancel_map, bench::HEAVY_CANCEL_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookMix, heavy_cancel_ladder, bench::HEAVY_CANCEL_MIX, LevelStorage::Ladder);
+BENCHMARK_CAPTURE(BM_OrderBookMix, deep_book_map, bench::DEEP_BOOK_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookMix, deep_book_ladder, bench::DEEP_BOOK_MIX, LevelStorage::Ladder);
+
+BENCHMARK_CAPTURE(BM_OrderBookGetSnapshot, balanced_map, bench::BALANCED_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookGetSnapshot, balanced_ladder, bench::BALANCED_MIX, LevelStorage::Ladder);
+BENCHMARK_CAPTURE(BM_OrderBookGetSnapshot, deep_book_map, bench::DEEP_BOOK_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookGetSnapshot, deep_book_ladder, bench::DEEP_BOOK_MIX, LevelStorage::Ladder);
+BENCHMARK_CAPTURE(BM_OrderBookGetBBO, balanced_map, bench::BALANCED_MIX, LevelStorage::Map);
+BENCHMARK_CAPTURE(BM_OrderBookGetBBO, balanced_ladder, bench::BALANCED_MIX, LevelStorage::Ladder);
@@ -0,0 +1,68 @@
+#include "cme_config_loader.h"
+
+#include "src/feedhandler/config_file.h"
+#include "src/feedhandler/config_loader.h"
+
+#include <iostream>
+
+namespace cme {
+
+bool loadConfigFile(const std::string& path, CmeFeedHandler::Config& config) {
+    feedhandler::ConfigFile file;
+    if (!file.load(path)) return false;
+
+    bool ok = true;
+    ok &= file.get("interface", config.interface);
+
+    // Input feeds
+    ok &= file.get("input.incremental_group", config.incremental_group);
+    ok &= file.get("input.incremental_port", config.incremental_port);
+    ok &= file.get("input.dual_feed", config.dual_feed);
+    ok &= file.get("input.incremental_group_b", config.incremental_group_b);
+    ok &= file.get("input.incremental_port_b", config.incremental_port_b);
+    ok &= file.get("input.arbitration_timeout_us", config.arbitration_timeout_us);
+    ok &= file.get("input.snapshot_group", config.snapshot_group);
+    ok &= file.get("input.snapshot_port", config.snapshot_port);
+    ok &= file.get("input.snapshot_on_demand", config.snapshot_on_demand);
+    ok &= file.get("input.recv_batch", config.recv_batch_size);
+    ok &= feedhandler::readReceiveBackend(file, "input.backend", config.input_backend);
+    ok &= file.get("input.capture_file", config.capture_file);
+    ok &= feedhandler::readRunLoop(file, "run_loop", config.run_loop);
+
+    // Output feed
+    ok &= file.get("output.multicast_group", config.output_group);
+    ok &= file.get("output.port", config.output_port);
+    ok &= file.get("output.send_batch", config.send_batch_size);
+
+    // Conflation
+    ok &= file.get("conflation.interval_ms", config.conflation_interval_ms);
+    ok &= file.get("conflation.max_pending", config.conflation_max_pending);
+    ok &= file.get("conflation.max_staleness_ms", config.conflation_max_staleness_ms);
+
+    // Books
+    ok &= file.get("book.expected_securities", config.expected_securities);
+    size_t depth = config.book_depth;
+    if (file.get("book.depth", depth)) {
+        if (depth < 1 || depth > CME_MAX_BOOK_DEPTH) {
+            std::cerr << path << ": book.depth must be 1-" << CME_MAX_BOOK_DEPTH << std::endl;
+            ok = false;
+        } else {
+            config.book_depth = depth;
+        }
+    } else {
+        ok = false;
+    }
+
+    // Recovery
+    ok &= file.get("recovery.timeout_ms", config.recovery_timeout_ms);
+    ok &= file.get("recovery.buffer_entries", config.recovery_buffer_entries);
+
+    ok &= feedhandler::readMetrics(file, "metrics", config.metrics);
+    ok &= feedhandler::readBookCache(file, "book_cache", config.book_cache);
+    ok &= feedhandler::readCheckpoint(file, "checkpoint", config.checkpoint);
+
+    feedhandler::warnUnusedKeys(file);
+    return ok;
+}
+
+} // namespace cme
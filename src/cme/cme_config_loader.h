@@ -0,0 +1,14 @@
+#pragma once
+
+#include "cme_feedhandler.h"
+
+#include <string>
+
+namespace cme {
+
+// Apply a YAML config (config/cme_feedhandler.yaml layout) on top of config.
+// Keys missing from the file keep their current values; unknown keys are
+// warned about and a malformed value fails the load.
+bool loadConfigFile(const std::string& path, CmeFeedHandler::Config& config);
+
+} // namespace cme
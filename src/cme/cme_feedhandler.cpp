@@ -1,16 +1,36 @@
 #include "cme_feedhandler.h"
-#include "l2_sbe_messages.h"
 
+#include <algorithm>
+#include <cinttypes>
 #include <cstring>
 #include <iostream>
 #include <poll.h>
 
 namespace cme {
 
+namespace {
+
+// Checkpoint sections
+constexpr uint32_t CHECKPOINT_SECURITIES = 1;
+constexpr uint32_t CHECKPOINT_LEVELS = 2;
+
+} // namespace
+
 CmeFeedHandler::CmeFeedHandler(const Config& config)
-    : config_(config) {
-    recv_buffer_.resize(65536);
-    send_buffer_.resize(1500);
+    : config_(config)
+    , registry_(config.expected_securities, config.book_depth)
+    , recovery_manager_(config.recovery_buffer_entries)
+    , arbitrator_(LineArbitrator::DEFAULT_WINDOW, config.arbitration_timeout_us * 1000)
+    , scheduler_(static_cast<int>(config.conflation_interval_ms), config.conflation_max_pending,
+                 static_cast<int>(config.conflation_max_staleness_ms))
+    , metrics_(config.metrics) {
+    // CME prices carry 7 decimals
+    if (!config_.book_cache.name.empty()) {
+        book_cache_ = std::make_unique<feedhandler::BookCacheWriter>(config_.book_cache, -7);
+    }
+    metrics_.addCollector([this](feedhandler::MetricsWriter& out) { collectMetrics(out); });
+    metrics_.addEventLog(&events_);
+    metrics_.setReport(STATS_INTERVAL_MS, [this]() { printStats(); });
 }
 
 CmeFeedHandler::~CmeFeedHandler() {
@@ -19,137 +39,416 @@ CmeFeedHandler::~CmeFeedHandler() {
 
 bool CmeFeedHandler::start() {
     // Create receivers
-    incremental_receiver_ = std::make_unique<feedhandler::MulticastReceiver>(
-        config_.incremental_group, config_.incremental_port, config_.interface);
+    incremental_receiver_ = feedhandler::makePacketSource(
+        config_.input_backend, config_.incremental_group, config_.incremental_port, config_.interface);
+    incremental_receiver_->setBatchSize(config_.recv_batch_size, feedhandler::MAX_DATAGRAM_SIZE);
+
+    if (config_.dual_feed) {
+        incremental_receiver_b_ = feedhandler::makePacketSource(
+            config_.input_backend, config_.incremental_group_b, config_.incremental_port_b, config_.interface);
+        incremental_receiver_b_->setBatchSize(config_.recv_batch_size, feedhandler::MAX_DATAGRAM_SIZE);
+    }
 
-    snapshot_receiver_ = std::make_unique<feedhandler::MulticastReceiver>(
-        config_.snapshot_group, config_.snapshot_port, config_.interface);
-
-    // Create sender
-    output_sender_ = std::make_unique<feedhandler::MulticastSender>(
-        config_.output_group, config_.output_port, config_.interface);
+    snapshot_receiver_ = feedhandler::makePacketSource(
+        config_.input_backend, config_.snapshot_group, config_.snapshot_port, config_.interface);
+    snapshot_receiver_->setBatchSize(config_.recv_batch_size, feedhandler::MAX_DATAGRAM_SIZE);
 
     if (!incremental_receiver_->start()) {
         std::cerr << "Failed to start incremental receiver" << std::endl;
         return false;
     }
 
+    if (incremental_receiver_b_ && !incremental_receiver_b_->start()) {
+        std::cerr << "Failed to start incremental line B receiver" << std::endl;
+        return false;
+    }
+
     if (!snapshot_receiver_->start()) {
         std::cerr << "Failed to start snapshot receiver" << std::endl;
         return false;
     }
 
+    // Arrival stamps feed the per-line latency stats and time-to-recover
+    incremental_receiver_->enableRxTimestamps();
+    if (incremental_receiver_b_) incremental_receiver_b_->enableRxTimestamps();
+    snapshot_receiver_->enableRxTimestamps();
+
+    // Snapshots loop over every instrument; nothing needs them until a gap
+    if (config_.snapshot_on_demand) {
+        snapshot_receiver_->leaveGroup();
+    }
+
+    if (config_.run_loop.busy_poll_us > 0) {
+        incremental_receiver_->setBusyPoll(config_.run_loop.busy_poll_us);
+        snapshot_receiver_->setBusyPoll(config_.run_loop.busy_poll_us);
+        if (incremental_receiver_b_) incremental_receiver_b_->setBusyPoll(config_.run_loop.busy_poll_us);
+    }
+
+    if (!config_.capture_file.empty()) {
+        if (!capture_.open(config_.capture_file)) return false;
+        capture_incremental_[0] = capture_.addFeed(config_.incremental_group, config_.incremental_port);
+        if (config_.dual_feed) {
+            capture_incremental_[1] = capture_.addFeed(config_.incremental_group_b, config_.incremental_port_b);
+        }
+        capture_snapshot_ = capture_.addFeed(config_.snapshot_group, config_.snapshot_port);
+    }
+
+    return startOutput();
+}
+
+bool CmeFeedHandler::startOutput() {
+    output_sender_ = std::make_unique<feedhandler::MulticastSender>(
+        config_.output_group, config_.output_port, config_.interface);
+    output_sender_->setBatchSize(config_.send_batch_size, CME_MAX_L2_SNAPSHOT_BYTES);
     if (!output_sender_->start()) {
         std::cerr << "Failed to start output sender" << std::endl;
         return false;
     }
 
+    if (book_cache_ && !book_cache_->open()) {
+        output_sender_->stop();
+        return false;
+    }
+
+    if (!metrics_.start()) {
+        output_sender_->stop();
+        if (book_cache_) book_cache_->close();
+        return false;
+    }
+
+    // Before the first packet, so the arbitrator resumes where the checkpoint left off
+    if (config_.checkpoint.restore && !config_.checkpoint.file.empty()) {
+        restoreCheckpoint();
+    }
+
     running_ = true;
-    last_conflation_time_ = std::chrono::steady_clock::now();
-    last_stats_time_ = std::chrono::steady_clock::now();
+    started_ = true;
+    uint64_t now = feedhandler::TscClock::ticks();
+    next_publish_tick_ = now + clock_.fromMillis(STATS_PUBLISH_INTERVAL_MS);
+    next_recovery_check_tick_ = now;
+    next_checkpoint_tick_ = 0;
+    if (!config_.checkpoint.file.empty() && config_.checkpoint.interval_sec > 0) {
+        next_checkpoint_tick_ = now + clock_.fromMillis(static_cast<uint64_t>(config_.checkpoint.interval_sec) * 1000);
+    }
+
+    publisher_thread_ = feedhandler::startThread(&CmeFeedHandler::runPublisher, this);
 
     return true;
 }
 
 void CmeFeedHandler::stop() {
+    if (!started_) return;
+
+    started_ = false;
     running_ = false;
+    metrics_.stop();  // Before the receivers close under dropCount()
+    stopPublisher();
     if (incremental_receiver_) incremental_receiver_->stop();
+    if (incremental_receiver_b_) incremental_receiver_b_->stop();
     if (snapshot_receiver_) snapshot_receiver_->stop();
     if (output_sender_) output_sender_->stop();
+    if (book_cache_) book_cache_->close();  // After the loop's last endPass()
+    if (capture_.isOpen()) {
+        std::cout << "Recorded " << capture_.datagramsWritten() << " datagrams to " << config_.capture_file
+                  << " (" << capture_.writeErrors() << " write errors)" << std::endl;
+        capture_.close();
+    }
 }
 
 void CmeFeedHandler::run() {
     std::cout << "CME Feed Handler starting..." << std::endl;
     std::cout << "  Incremental: " << config_.incremental_group << ":" << config_.incremental_port << std::endl;
-    std::cout << "  Snapshot: " << config_.snapshot_group << ":" << config_.snapshot_port << std::endl;
-    std::cout << "  Output: " << config_.output_group << ":" << config_.output_port << std::endl;
+    if (config_.dual_feed) {
+        std::cout << "  Incremental B: " << config_.incremental_group_b << ":" << config_.incremental_port_b
+                  << " (A/B arbitration, " << config_.arbitration_timeout_us << "us hole timeout)" << std::endl;
+    }
+    std::cout << "  Snapshot: " << config_.snapshot_group << ":" << config_.snapshot_port
+              << (config_.snapshot_on_demand ? " (joined only while recovering)" : "") << std::endl;
+    std::cout << "  Output: " << config_.output_group << ":" << config_.output_port
+              << " (" << config_.book_depth << " levels per side)" << std::endl;
+    std::cout << "  Conflation: " << config_.conflation_interval_ms << "ms, early at "
+              << config_.conflation_max_pending << " pending books / "
+              << config_.conflation_max_staleness_ms << "ms staleness (0 = off)" << std::endl;
+
+    std::cout << "  Receive loop: " << (config_.run_loop.spin ? "spin" : "poll")
+              << " (" << feedhandler::receiveBackendName(config_.input_backend.type) << ")" << std::endl;
+    if (capture_.isOpen()) {
+        std::cout << "  Recording to " << config_.capture_file << std::endl;
+    }
+    if (!config_.checkpoint.file.empty()) {
+        std::cout << "  Checkpoint: " << config_.checkpoint.file;
+        if (config_.checkpoint.interval_sec > 0) {
+            std::cout << " (every " << config_.checkpoint.interval_sec << "s and on stop)" << std::endl;
+        } else {
+            std::cout << " (on stop)" << std::endl;
+        }
+    }
+
+    feedhandler::tuneCurrentThread(config_.run_loop);
 
-    struct pollfd fds[2];
+    struct pollfd fds[3];
     fds[0].fd = incremental_receiver_->getFd();
     fds[0].events = POLLIN;
     fds[1].fd = snapshot_receiver_->getFd();
     fds[1].events = POLLIN;
-
-    auto conflation_interval = std::chrono::milliseconds(config_.conflation_interval_ms);
+    nfds_t nfds = 2;
+    if (incremental_receiver_b_) {
+        fds[2].fd = incremental_receiver_b_->getFd();
+        fds[2].events = POLLIN;
+        nfds = 3;
+    }
 
     while (running_) {
-        auto now = std::chrono::steady_clock::now();
-
-        // Calculate timeout based on conflation interval
-        auto time_since_last = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - last_conflation_time_);
-        int timeout_ms = std::max(1, static_cast<int>(config_.conflation_interval_ms - time_since_last.count()));
-
-        int ret = poll(fds, 2, timeout_ms);
-
-        if (ret > 0) {
-            // Process incremental feed (priority)
-            if (fds[0].revents & POLLIN) {
-                ssize_t len = incremental_receiver_->read(recv_buffer_.data(), recv_buffer_.size());
-                if (len > 0) {
-                    processIncrementalPacket(recv_buffer_.data(), static_cast<size_t>(len));
-                    stats_.messages_received++;
-                    stats_.bytes_received += len;
-                }
-            }
+        bool incremental_ready = true;
+        bool incremental_b_ready = incremental_receiver_b_ != nullptr;
+        bool snapshot_ready = true;
+
+        if (!config_.run_loop.spin) {
+            // Block until input arrives or the next recovery check is due
+            uint64_t now = feedhandler::TscClock::ticks();
+            uint64_t until = next_recovery_check_tick_ > now ? next_recovery_check_tick_ - now : 0;
+            int timeout_ms = std::max<int>(1, static_cast<int>(until / clock_.ticksPerMs()));
+            if (arbitrator_.holding()) timeout_ms = 1;  // Hole timeout is checked every pass
+
+            int ret = poll(fds, nfds, timeout_ms);
+            incremental_ready = ret > 0 && (fds[0].revents & POLLIN);
+            snapshot_ready = ret > 0 && (fds[1].revents & POLLIN);
+            incremental_b_ready = ret > 0 && nfds > 2 && (fds[2].revents & POLLIN);
+        }
 
-            // Process snapshot feed (only when needed for recovery)
-            if (fds[1].revents & POLLIN) {
-                ssize_t len = snapshot_receiver_->read(recv_buffer_.data(), recv_buffer_.size());
-                if (len > 0) {
-                    if (recovery_manager_.needsRecovery()) {
-                        processSnapshotPacket(recv_buffer_.data(), static_cast<size_t>(len));
-                    }
-                    stats_.messages_received++;
-                    stats_.bytes_received += len;
-                }
+        // Process incremental feed (priority)
+        if (incremental_ready) {
+            feedhandler::DatagramBatch batch = incremental_receiver_->readBatch();
+            noteBatch(batch);
+            for (const auto& dgram : batch) {
+                onIncrementalDatagram(0, dgram);
+                stats_.messages_received++;
+                stats_.bytes_received += dgram.length;
             }
+            incremental_receiver_->releaseBatch();
         }
 
-        // Conflation: publish snapshots at fixed interval
-        now = std::chrono::steady_clock::now();
-        if (now - last_conflation_time_ >= conflation_interval) {
-            publishConflatedSnapshots();
-            last_conflation_time_ = now;
+        if (incremental_b_ready) {
+            feedhandler::DatagramBatch batch = incremental_receiver_b_->readBatch();
+            noteBatch(batch);
+            for (const auto& dgram : batch) {
+                onIncrementalDatagram(1, dgram);
+                stats_.messages_received++;
+                stats_.bytes_received += dgram.length;
+            }
+            incremental_receiver_b_->releaseBatch();
         }
 
-        // Print stats every 10 seconds
-        if (now - last_stats_time_ >= std::chrono::seconds(10)) {
-            printStats();
-            last_stats_time_ = now;
+        checkLines();
+
+        // Process snapshot feed (only when needed for recovery)
+        if (snapshot_ready) {
+            feedhandler::DatagramBatch batch = snapshot_receiver_->readBatch();
+            noteBatch(batch);
+            for (const auto& dgram : batch) {
+                onSnapshotDatagram(dgram);
+            }
+            snapshot_receiver_->releaseBatch();
         }
 
-        // Check recovery timeouts
+        endPass();
+    }
+
+    stop();
+    std::cout << "CME Feed Handler stopped" << std::endl;
+    finalCheckpoint();
+}
+
+bool CmeFeedHandler::replay(const feedhandler::ReplayConfig& replay) {
+    if (started_) return false;
+
+    // No receivers: records are routed by UDP port straight into the same
+    // processing the run loop uses, and the snapshot feed is whatever the
+    // capture holds (membership is not replayed)
+    if (!startOutput()) return false;
+    std::cout << "CME Feed Handler replaying (" << config_.book_depth << " levels per side, output "
+              << config_.output_group << ":" << config_.output_port << ")" << std::endl;
+
+    auto accept = [this](uint16_t port) {
+        return port == config_.incremental_port || port == config_.snapshot_port ||
+               (config_.dual_feed && port == config_.incremental_port_b);
+    };
+
+    // A restored checkpoint already holds the records it was taken after
+    feedhandler::ReplayConfig resumed = replay;
+    if (restored_records_ > 0) {
+        resumed.skip_records = restored_records_;
+        std::cout << "  Resuming replay after record " << restored_records_ << std::endl;
+    }
+
+    feedhandler::ReplayStats result;
+    bool ok = feedhandler::replayCapture(resumed, running_, result, accept,
+        [this](const feedhandler::CaptureRecord& record) {
+            // Stamped as it goes in, like the socket path without RX timestamps
+            feedhandler::Datagram dgram{record.data, record.length, 0};
+            if (record.dst_port == config_.snapshot_port) {
+                onSnapshotDatagram(dgram);
+            } else {
+                onIncrementalDatagram(record.dst_port == config_.incremental_port ? 0 : 1, dgram);
+                stats_.messages_received++;
+                stats_.bytes_received += dgram.length;
+            }
+            checkLines();
+            endPass();
+        });
+
+    // Whatever the last records changed goes out before the publisher stops
+    captureDirtyBooks();
+    stop();
+    publishStats();
+    printStats();
+    finalCheckpoint();
+    if (ok) result.print(std::cout);
+    return ok;
+}
+
+void CmeFeedHandler::onSnapshotDatagram(const feedhandler::Datagram& dgram) {
+    if (capture_snapshot_ >= 0) capture_.write(capture_snapshot_, dgram);
+
+    if (recovery_manager_.needsRecovery()) {
+        packet_rx_ns_ = dgram.rx_timestamp_ns ? dgram.rx_timestamp_ns : feedhandler::wallClockNs();
+        processSnapshotPacket(dgram.data, dgram.length);
+    }
+    snapshot_feed_stats_.packets++;
+    stats_.messages_received++;
+    stats_.bytes_received += dgram.length;
+}
+
+void CmeFeedHandler::checkLines() {
+    // A line that went quiet cannot hold packets behind a hole forever
+    if (arbitrator_.holding()) {
+        packet_rx_ns_ = feedhandler::wallClockNs();
+        arbitrator_.checkTimeout(
+            packet_rx_ns_,
+            [this](const uint8_t* data, size_t len) { processIncrementalPacket(data, len); },
+            [this](uint32_t first_seq, uint32_t count) { onPacketGap(first_seq, count); });
+    }
+
+    // A gap found this pass: start reading snapshots right away
+    if (snapshot_receiver_ && config_.snapshot_on_demand &&
+        recovery_manager_.needsRecovery() && !snapshot_receiver_->isJoined()) {
+        joinSnapshotFeed(feedhandler::wallClockNs());
+    }
+}
+
+void CmeFeedHandler::endPass() {
+    // Hand books changed by this pass to the publisher thread
+    captureDirtyBooks();
+
+    // Timers: one TSC read per pass, cheap enough to do while spinning
+    uint64_t now = feedhandler::TscClock::ticks();
+
+    // Hand counters to the metrics thread
+    if (now >= next_publish_tick_) {
+        publishStats();
+        next_publish_tick_ = now + clock_.fromMillis(STATS_PUBLISH_INTERVAL_MS);
+    }
+
+    // Check recovery timeouts
+    if (now >= next_recovery_check_tick_) {
+        next_recovery_check_tick_ = now + clock_.fromMillis(RECOVERY_CHECK_INTERVAL_MS);
         auto timeout_ns = config_.recovery_timeout_ms * 1000000ULL;
         auto timed_out = recovery_manager_.checkTimeouts(getCurrentTimeNs(), timeout_ns);
         for (auto security_id : timed_out) {
-            std::cout << "Recovery timeout for " << getSymbolName(security_id)
-                      << " - will retry with next snapshot" << std::endl;
+            events_.post("Recovery timeout for %s - will retry with next snapshot", registry_.symbolOf(security_id));
+        }
+
+        if (channel_recovery_.active && !recovery_manager_.needsRecovery()) {
+            finishChannelRecovery(feedhandler::wallClockNs());
+        }
+
+        // Everything recovered: stop paying for the snapshot loop
+        if (snapshot_receiver_ && config_.snapshot_on_demand && !recovery_manager_.needsRecovery() &&
+            snapshot_receiver_->isJoined()) {
+            leaveSnapshotFeed(feedhandler::wallClockNs());
         }
     }
 
-    std::cout << "CME Feed Handler stopped" << std::endl;
+    // Warm-start checkpoint: holds this thread up for as long as it takes
+    if (next_checkpoint_tick_ != 0 && now >= next_checkpoint_tick_) {
+        writeCheckpoint();
+        next_checkpoint_tick_ = feedhandler::TscClock::ticks() +
+                                clock_.fromMillis(static_cast<uint64_t>(config_.checkpoint.interval_sec) * 1000);
+    }
 }
 
-void CmeFeedHandler::processIncrementalPacket(const uint8_t* data, size_t len) {
-    if (len < sizeof(PacketHeader)) {
+void CmeFeedHandler::noteBatch(const feedhandler::DatagramBatch& batch) {
+    if (batch.empty()) return;
+    stats_.recv_batches++;
+    if (batch.count > stats_.recv_batch_max) stats_.recv_batch_max = batch.count;
+}
+
+void CmeFeedHandler::joinSnapshotFeed(uint64_t now_ns) {
+    if (!snapshot_receiver_->joinGroup()) {
         stats_.errors++;
         return;
     }
+    snapshot_joined_at_ns_ = now_ns;
+    snapshot_feed_stats_.joins++;
+    events_.post("Joined snapshot feed: %zu securities recovering", recovery_manager_.recoveringCount());
+}
 
-    const auto* pkt = reinterpret_cast<const PacketHeader*>(data);
+void CmeFeedHandler::leaveSnapshotFeed(uint64_t now_ns) {
+    if (!snapshot_receiver_->leaveGroup()) {
+        stats_.errors++;
+        return;
+    }
+    uint64_t joined_ns = now_ns > snapshot_joined_at_ns_ ? now_ns - snapshot_joined_at_ns_ : 0;
+    snapshot_feed_stats_.joined_ns += joined_ns;
+    snapshot_feed_stats_.leaves++;
+    events_.post("Left snapshot feed after %" PRIu64 "ms", joined_ns / 1000000);
+}
 
-    // Check packet sequence
-    if (!first_packet_) {
-        if (pkt->msg_seq_num != last_packet_seq_ + 1) {
-            std::cout << "Packet gap detected: expected " << (last_packet_seq_ + 1)
-                      << ", got " << pkt->msg_seq_num << std::endl;
-            // Note: packet-level gaps affect all symbols, but we handle per-symbol via rpt_seq
-        }
+void CmeFeedHandler::onIncrementalDatagram(size_t line, const feedhandler::Datagram& dgram) {
+    if (dgram.length < sizeof(PacketHeader)) {
+        stats_.errors++;
+        return;
+    }
+
+    if (capture_incremental_[line] >= 0) capture_.write(capture_incremental_[line], dgram);
+
+    const auto* pkt = reinterpret_cast<const PacketHeader*>(dgram.data);
+    uint64_t rx_ns = dgram.rx_timestamp_ns ? dgram.rx_timestamp_ns : feedhandler::wallClockNs();
+    packet_rx_ns_ = rx_ns;
+    arbitrator_.onPacket(
+        line, pkt->msg_seq_num, dgram.data, dgram.length, rx_ns, pkt->sending_time,
+        [this](const uint8_t* data, size_t len) { processIncrementalPacket(data, len); },
+        [this](uint32_t first_seq, uint32_t count) { onPacketGap(first_seq, count); });
+}
+
+void CmeFeedHandler::onPacketGap(uint32_t first_seq, uint32_t count) {
+    // Lost on every line. We cannot tell whose updates were in the lost
+    // packets, so suspect every security at once rather than waiting for
+    // each one to trip over its own rpt_seq (quiet ones never would)
+    const auto& rec_stats = recovery_manager_.getStats();
+    if (!channel_recovery_.active) {
+        channel_recovery_.active = true;
+        channel_recovery_.started_ns = packet_rx_ns_;
+        channel_recovery_.recoveries_at_start = rec_stats.recoveries_completed;
+        channel_recovery_.cleared_at_start = rec_stats.suspects_cleared;
     }
-    first_packet_ = false;
-    last_packet_seq_ = pkt->msg_seq_num;
+    size_t marked = recovery_manager_.onChannelGap(packet_rx_ns_);
+
+    events_.post("Packet gap detected: lost %u packet(s) from seq %u%s, %zu securities suspect",
+                 count, first_seq, config_.dual_feed ? " on both lines" : "", marked);
+}
 
+void CmeFeedHandler::finishChannelRecovery(uint64_t now_ns) {
+    const auto& rec_stats = recovery_manager_.getStats();
+    uint64_t elapsed = now_ns > channel_recovery_.started_ns ? now_ns - channel_recovery_.started_ns : 0;
+    events_.post("Channel recovered after %" PRIu64 "ms: %" PRIu64 " from snapshots, %" PRIu64
+                 " confirmed in sequence",
+                 elapsed / 1000000, rec_stats.recoveries_completed - channel_recovery_.recoveries_at_start,
+                 rec_stats.suspects_cleared - channel_recovery_.cleared_at_start);
+    channel_recovery_ = ChannelRecovery{};
+}
+
+void CmeFeedHandler::processIncrementalPacket(const uint8_t* data, size_t len) {
     // Process messages in packet
     size_t offset = sizeof(PacketHeader);
     while (offset + sizeof(SBEMessageHeader) <= len) {
@@ -230,67 +529,96 @@ void CmeFeedHandler::processSnapshotPacket(const uint8_t* data, size_t len) {
 }
 
 void CmeFeedHandler::handleSecurityDefinition(const SecurityDefinition* msg) {
-    std::cout << "Received SecurityDefinition: " << msg->symbol
-              << " (id=" << msg->security_id << ")" << std::endl;
-
     // Initialize book and recovery state
-    book_manager_.getBook(msg->security_id);
-    recovery_manager_.initSecurity(msg->security_id, 1);
+    SecurityRecord& record = registry_.define(*msg);
+    recovery_manager_.initSecurity(record.recovery, 1);
+
+    // A full channel defines thousands of instruments; the stats show the count
+    if (registry_.size() <= 16) {
+        events_.post("Received SecurityDefinition: %s (id=%u, index %u)", record.book.getSymbol(),
+                     msg->security_id, static_cast<unsigned>(record.index));
+    }
 }
 
 void CmeFeedHandler::handleIncrementalRefresh(const MDIncrementalRefreshBook* msg) {
     const auto* entries = msg->getEntries();
     uint8_t num_entries = msg->entries_header.num_in_group;
+    transact_time_ns_ = msg->transact_time;
 
     for (uint8_t i = 0; i < num_entries; ++i) {
         const auto& entry = entries[i];
 
-        // Check recovery state for this security
-        if (recovery_manager_.onIncrementalMessage(entry.security_id, entry.rpt_seq)) {
-            // Apply update to book
-            book_manager_.applyIncremental(entry);
-
-            // Track stats by type
-            auto action = static_cast<MDUpdateAction>(entry.md_update_action);
-            if (action == MDUpdateAction::New) {
-                stats_.add_orders++;
-            } else if (action == MDUpdateAction::Delete) {
-                stats_.delete_orders++;
-            }
-
-            auto type = static_cast<MDEntryType>(entry.md_entry_type);
-            if (type == MDEntryType::Trade) {
-                stats_.trades++;
-            }
+        // One lookup per entry (usually the cached record); everything else
+        // is in the record. The recovery check buffers it while recovering.
+        SecurityRecord& record = registry_.findOrAdd(entry.security_id);
+        if (recovery_manager_.onIncrementalMessage(record.recovery, entry, packet_rx_ns_)) {
+            applyIncrementalEntry(record, entry);
         }
     }
 }
 
+void CmeFeedHandler::applyIncrementalEntry(SecurityRecord& record, const MDIncrementalRefreshEntry& entry) {
+    // Apply update to book
+    record.book.applyUpdate(entry);
+    registry_.markDirty(record);
+
+    // Track stats by type
+    auto action = static_cast<MDUpdateAction>(entry.md_update_action);
+    if (action == MDUpdateAction::New) {
+        stats_.add_orders++;
+    } else if (action == MDUpdateAction::Delete) {
+        stats_.delete_orders++;
+    }
+
+    auto type = static_cast<MDEntryType>(entry.md_entry_type);
+    if (type == MDEntryType::Trade) {
+        stats_.trades++;
+    }
+}
+
 void CmeFeedHandler::handleSnapshotFullRefresh(const MDSnapshotFullRefresh* msg) {
     // Check if we need this snapshot for recovery
-    if (recovery_manager_.onSnapshotMessage(msg->security_id, msg->rpt_seq, msg->last_msg_seq_num_processed)) {
-        std::cout << "Applying snapshot for " << getSymbolName(msg->security_id)
-                  << " at rpt_seq=" << msg->rpt_seq << std::endl;
+    SecurityRecord& record = registry_.findOrAdd(msg->security_id);
+    transact_time_ns_ = msg->transact_time;
+    if (recovery_manager_.onSnapshotMessage(record.recovery, msg->rpt_seq, msg->last_msg_seq_num_processed)) {
+        // During a channel recovery the summary replaces per-security lines
+        bool verbose = !channel_recovery_.active;
+        if (verbose) {
+            events_.post("Applying snapshot for %s at rpt_seq=%u", registry_.symbolOf(msg->security_id),
+                         msg->rpt_seq);
+        }
 
         // Apply snapshot to book
-        book_manager_.applySnapshot(msg->security_id, msg->getEntries(),
-                                    msg->entries_header.num_in_group, msg->rpt_seq);
-
-        // Complete recovery
-        recovery_manager_.completeRecovery(msg->security_id, msg->rpt_seq);
-
-        std::cout << "Recovery complete for " << getSymbolName(msg->security_id) << std::endl;
+        record.book.applySnapshot(msg->getEntries(), msg->entries_header.num_in_group);
+        record.book.setLastRptSeq(msg->rpt_seq);
+        registry_.markDirty(record);
+
+        // Complete recovery, catching up on what arrived since the gap
+        size_t replayed = recovery_manager_.completeRecovery(
+            record.recovery, msg->rpt_seq, packet_rx_ns_,
+            [this, &record](const MDIncrementalRefreshEntry& entry) { applyIncrementalEntry(record, entry); });
+
+        if (record.recovery.state == RecoveryState::Normal) {
+            if (verbose) {
+                events_.post("Recovery complete for %s (replayed %zu buffered)",
+                             registry_.symbolOf(msg->security_id), replayed);
+            }
+        } else {
+            events_.post("Buffered incrementals for %s have a gap after replaying %zu - waiting for next snapshot",
+                         registry_.symbolOf(msg->security_id), replayed);
+        }
     }
 }
 
 void CmeFeedHandler::handleChannelReset(const ChannelReset* msg) {
-    std::cout << "Received ChannelReset at time " << msg->transact_time << std::endl;
-
-    // Reset all books and recovery state
-    book_manager_.clear();
-    for (auto security_id : book_manager_.getAllSecurityIds()) {
-        recovery_manager_.resetExpectedSeq(security_id, 1);
-    }
+    events_.post("Received ChannelReset at time %" PRIu64, static_cast<uint64_t>(msg->transact_time));
+
+    // Reset all books and recovery state; instruments stay defined
+    registry_.forEach([this](SecurityRecord& record) {
+        record.book.reset();
+        recovery_manager_.resetExpectedSeq(record.recovery, 1);
+    });
+    registry_.clearDirty();
 }
 
 void CmeFeedHandler::handleHeartbeat(const Heartbeat* msg) {
@@ -298,65 +626,241 @@ void CmeFeedHandler::handleHeartbeat(const Heartbeat* msg) {
     (void)msg;
 }
 
-void CmeFeedHandler::publishConflatedSnapshots() {
-    auto dirty = book_manager_.getDirtySecurities();
-
-    for (auto security_id : dirty) {
+void CmeFeedHandler::captureDirtyBooks() {
+    size_t pending = 0;
+    registry_.drainDirty([this, &pending](SecurityRecord& record) {
         // Only publish if not in recovery
-        if (recovery_manager_.getState(security_id) == RecoveryState::Normal) {
-            auto& book = book_manager_.getBook(security_id);
-            auto snap = book.getSnapshot();
-            snap.timestamp = getCurrentTimeNs();
-            snap.sequence = ++output_seq_;
-            publishSnapshot(snap);
+        if (record.recovery.state != RecoveryState::Normal) return;
+        if (book_cache_) updateCache(record);
+
+        if (record.conflation_slot == SecurityRecord::NO_SLOT) {
+            uint32_t slot = conflation_.addSlot();
+            if (slot == feedhandler::ConflationTable::NO_SLOT) {
+                stats_.errors++;
+                return;
+            }
+            record.conflation_slot = slot;
         }
+        pending += conflation_.publishWith(record.conflation_slot, [&record](EncodedL2Snapshot& out) {
+            out.length = static_cast<uint16_t>(record.book.encodeL2Snapshot(out.data, sizeof(out.data)));
+        });
+    });
+    scheduler_.addPending(pending);
+}
+
+void CmeFeedHandler::updateCache(SecurityRecord& record) {
+    if (record.cache_slot == SecurityRecord::NO_SLOT) {
+        if (!record.defined) return;
+        const char* symbol = record.book.getSymbol();
+        record.cache_slot = book_cache_->addSlot(symbol, std::strlen(symbol), record.security_id);
+        if (record.cache_slot == SecurityRecord::NO_SLOT) return;
     }
+
+    using Levels = std::array<feedhandler::CachedLevel, feedhandler::BOOK_CACHE_DEPTH>;
+    const CmeOrderBook& book = record.book;
+    book_cache_->update(record.cache_slot, transact_time_ns_, packet_rx_ns_, [&book](feedhandler::CachedBook& out) {
+        auto copySide = [](const CmeBookSide& side, Levels& levels) {
+            uint8_t count = static_cast<uint8_t>(std::min<size_t>(side.count, feedhandler::BOOK_CACHE_DEPTH));
+            for (size_t i = 0; i < count; ++i) {
+                levels[i] = feedhandler::CachedLevel{side.price[i], side.qty[i], side.orders[i]};
+            }
+            return count;
+        };
+        out.bid_count = copySide(book.bids(), out.bids);
+        out.ask_count = copySide(book.asks(), out.asks);
+        out.last_price = book.getLastTradePrice();
+        out.last_quantity = book.getLastTradeQty();
+        out.total_volume = book.getTotalVolume();
+    });
 }
 
-void CmeFeedHandler::publishSnapshot(const feedhandler::OrderBookSnapshot& snap) {
-    // Build SBE-encoded output message
-    l2md::PriceLevelEntry bids[l2md::MAX_LEVELS];
-    l2md::PriceLevelEntry asks[l2md::MAX_LEVELS];
+void CmeFeedHandler::restoreCheckpoint() {
+    const std::string& file = config_.checkpoint.file;
+    feedhandler::CheckpointReader reader;
+    if (!reader.open(file, feedhandler::CheckpointKind::Cme)) {
+        std::cout << "  Checkpoint: nothing restored, starting cold" << std::endl;
+        return;
+    }
 
-    uint8_t numBids = std::min(static_cast<uint8_t>(snap.bids.count), l2md::MAX_LEVELS);
-    uint8_t numAsks = std::min(static_cast<uint8_t>(snap.asks.count), l2md::MAX_LEVELS);
+    size_t security_count = 0;
+    size_t level_count = 0;
+    const auto* securities = reader.records<CmeCheckpointSecurity>(CHECKPOINT_SECURITIES, security_count);
+    const auto* levels = reader.records<MDSnapshotEntry>(CHECKPOINT_LEVELS, level_count);
+    if (!securities || !levels) {
+        std::cerr << "Checkpoint " << file << " has no CME security sections" << std::endl;
+        std::cout << "  Checkpoint: nothing restored, starting cold" << std::endl;
+        return;
+    }
 
-    // Convert bids to SBE format
-    for (uint8_t i = 0; i < numBids; ++i) {
-        bids[i].level = i + 1;  // 1-based
-        bids[i].price = l2md::priceToSbe(snap.bids.levels[i].price);
-        bids[i].quantity = snap.bids.levels[i].quantity;
-        bids[i].numOrders = snap.bids.levels[i].order_count;
+    uint64_t now_ns = feedhandler::wallClockNs();
+    size_t restored = 0;
+    size_t next_level = 0;
+    for (size_t i = 0; i < security_count; ++i) {
+        const CmeCheckpointSecurity& saved = securities[i];
+        if (saved.levels > level_count - next_level) break;
+
+        SecurityRecord& record = registry_.findOrAdd(saved.security_id);
+        if (saved.defined) {
+            SecurityDefinition def{};
+            def.security_id = saved.security_id;
+            std::memcpy(def.symbol, saved.symbol, sizeof(def.symbol));
+            def.min_price_increment = saved.min_price_increment;
+            registry_.define(def);
+        }
+        record.book.applySnapshot(levels + next_level, saved.levels);
+        next_level += saved.levels;
+        record.book.setLastRptSeq(saved.book_rpt_seq);
+        record.book.restoreTrade(saved.last_trade_price, saved.last_trade_qty, saved.total_volume);
+
+        if (saved.tracked) {
+            auto state = saved.state <= static_cast<uint8_t>(RecoveryState::Suspect)
+                             ? static_cast<RecoveryState>(saved.state) : RecoveryState::GapDetected;
+            recovery_manager_.restoreSecurity(record.recovery, saved.last_good_rpt_seq, state, now_ns);
+        }
+        registry_.markDirty(record);
+        restored++;
     }
 
-    // Convert asks to SBE format
-    for (uint8_t i = 0; i < numAsks; ++i) {
-        asks[i].level = i + 1;  // 1-based
-        asks[i].price = l2md::priceToSbe(snap.asks.levels[i].price);
-        asks[i].quantity = snap.asks.levels[i].quantity;
-        asks[i].numOrders = snap.asks.levels[i].order_count;
+    // Packets up to the checkpoint are duplicates now; the first one after
+    // the outage reports it as a gap, which puts every restored security
+    // on suspect until its next entry or snapshot confirms it
+    const feedhandler::CheckpointHeader& header = reader.header();
+    if (header.position != 0) {
+        arbitrator_.resume(static_cast<uint32_t>(header.position), config_.dual_feed ? 2 : 1);
     }
+    restored_records_ = header.records;
 
-    l2md::L2SnapshotEncoder encoder(send_buffer_.data(), send_buffer_.size());
-    if (!encoder.encode(
-            snap.symbol,
-            snap.timestamp,
-            snap.sequence,
-            l2md::priceToSbe(snap.last_price),
-            snap.last_quantity,
-            snap.total_volume,
-            numBids,
-            numAsks,
-            bids, numBids,
-            asks, numAsks)) {
-        stats_.errors++;
+    uint64_t age_ms = now_ns > header.created_ns ? (now_ns - header.created_ns) / 1000000 : 0;
+    std::cout << "  Checkpoint: restored " << restored << " securities (" << recovery_manager_.recoveringCount()
+              << " waiting for a snapshot) from " << file << " (taken " << age_ms / 1000.0
+              << "s ago, resuming at msg_seq_num " << header.position << ")" << std::endl;
+}
+
+bool CmeFeedHandler::writeCheckpoint() {
+    uint64_t started = feedhandler::TscClock::ticks();
+
+    size_t level_count = 0;
+    registry_.forEach([&level_count](const SecurityRecord& record) {
+        level_count += record.book.bids().count + record.book.asks().count;
+    });
+
+    uint64_t position = arbitrator_.started() ? arbitrator_.nextSeq() : 0;
+    feedhandler::CheckpointWriter writer(feedhandler::CheckpointKind::Cme, position,
+                                         restored_records_ + stats_.messages_received);
+    writer.addSection(CHECKPOINT_SECURITIES, sizeof(CmeCheckpointSecurity), registry_.size());
+    writer.addSection(CHECKPOINT_LEVELS, sizeof(MDSnapshotEntry), level_count);
+    bool ok = writer.open(config_.checkpoint.file);
+    if (ok) {
+        auto* saved = writer.records<CmeCheckpointSecurity>(CHECKPOINT_SECURITIES);
+        auto* level = writer.records<MDSnapshotEntry>(CHECKPOINT_LEVELS);
+        auto saveSide = [&level](const CmeBookSide& side, MDEntryType type) {
+            for (size_t i = 0; i < side.count; ++i) {
+                MDSnapshotEntry& entry = *level++;
+                entry = MDSnapshotEntry{};
+                entry.md_entry_px = side.price[i];
+                entry.md_entry_size = side.qty[i];
+                entry.md_entry_type = static_cast<uint8_t>(type);
+                entry.md_price_level = static_cast<uint8_t>(i + 1);
+                entry.number_of_orders = side.orders[i];
+            }
+        };
+
+        registry_.forEach([&](const SecurityRecord& record) {
+            CmeCheckpointSecurity& out = *saved++;
+            const CmeOrderBook& book = record.book;
+            out = CmeCheckpointSecurity{};
+            out.security_id = record.security_id;
+            out.last_good_rpt_seq = record.recovery.last_good_rpt_seq;
+            out.book_rpt_seq = book.getLastRptSeq();
+            out.last_trade_qty = book.getLastTradeQty();
+            out.min_price_increment = record.min_price_increment;
+            out.last_trade_price = book.getLastTradePrice();
+            out.total_volume = book.getTotalVolume();
+            out.defined = record.defined;
+            out.tracked = record.recovery.tracked;
+            out.state = static_cast<uint8_t>(record.recovery.state);
+            out.levels = static_cast<uint8_t>(book.bids().count + book.asks().count);
+            std::strncpy(out.symbol, book.getSymbol(), sizeof(out.symbol));
+
+            saveSide(book.bids(), MDEntryType::Bid);
+            saveSide(book.asks(), MDEntryType::Offer);
+        });
+        ok = writer.commit();
+    }
+
+    if (ok) {
+        checkpoint_stats_.written++;
+        checkpoint_stats_.last_ns = clock_.toNanos(feedhandler::TscClock::ticks() - started);
+        checkpoint_stats_.last_bytes = writer.size();
+        checkpoint_stats_.last_securities = registry_.size();
+    } else {
+        checkpoint_stats_.failed++;
+    }
+    published_checkpoint_.store(checkpoint_stats_);
+    return ok;
+}
+
+void CmeFeedHandler::finalCheckpoint() {
+    if (config_.checkpoint.file.empty()) return;
+
+    if (writeCheckpoint()) {
+        std::cout << "Checkpoint written to " << config_.checkpoint.file << ": "
+                  << checkpoint_stats_.last_securities << " securities, " << checkpoint_stats_.last_bytes / 1024
+                  << " KB, resume at msg_seq_num " << (arbitrator_.started() ? arbitrator_.nextSeq() : 0)
+                  << std::endl;
+    }
+}
+
+void CmeFeedHandler::runPublisher() {
+    while (scheduler_.wait() != feedhandler::ConflationScheduler::Trigger::Stop) {
+        publishConflatedSnapshots();
+    }
+    // Books changed since the last drain go out before the sender closes
+    publishConflatedSnapshots();
+}
+
+void CmeFeedHandler::publishConflatedSnapshots() {
+    uint64_t now_ns = getCurrentTimeNs();
+    conflation_.drain([this, now_ns](uint32_t, EncodedL2Snapshot snap) {
+        publishSnapshot(snap, now_ns);
+    });
+
+    // One sendmmsg per batch_size snapshots instead of a sendto each
+    output_sender_->flush();
+
+    const auto& send_stats = output_sender_->getBatchStats();
+    publisher_stats_.send_batches = send_stats.flushes;
+    publisher_stats_.send_batch_max = send_stats.max_batch;
+
+    published_stats_.store(publisher_stats_);
+}
+
+void CmeFeedHandler::stopPublisher() {
+    scheduler_.stop();
+    if (publisher_thread_.joinable()) {
+        publisher_thread_.join();
+    }
+}
+
+void CmeFeedHandler::publishSnapshot(EncodedL2Snapshot& snap, uint64_t now_ns) {
+    size_t len = snap.length;
+    if (len == 0) {
+        publisher_stats_.errors++;
         return;
     }
 
-    output_sender_->send(send_buffer_.data(), encoder.encodedLength());
+    // Encoded at capture; only the publish-time fields are left
+    auto* root = reinterpret_cast<l2md::L2SnapshotRoot*>(snap.data + sizeof(l2md::MessageHeader));
+    root->timestamp = now_ns;
+    root->sequenceNumber = ++output_seq_;
+
+    if (!output_sender_->queue(snap.data, len)) {
+        publisher_stats_.errors++;
+        return;
+    }
 
-    stats_.messages_sent++;
-    stats_.bytes_sent += encoder.encodedLength();
+    publisher_stats_.messages_sent++;
+    publisher_stats_.bytes_sent += len;
 }
 
 uint64_t CmeFeedHandler::getCurrentTimeNs() {
@@ -366,31 +870,244 @@ uint64_t CmeFeedHandler::getCurrentTimeNs() {
     return static_cast<uint64_t>(ns);
 }
 
+void CmeFeedHandler::publishStats() {
+    published_processing_.write([this](ProcessingStats& out) {
+        out.feed = stats_;
+        out.arbitration = arbitrator_.getStats();
+        out.lines[0] = arbitrator_.lineStats(0);
+        out.lines[1] = arbitrator_.lineStats(1);
+        out.recovery = recovery_manager_.getStats();
+        out.snapshot_feed = snapshot_feed_stats_;
+        out.snapshot_joined = snapshot_receiver_ && snapshot_receiver_->isJoined();
+        out.snapshot_joined_now_ns = out.snapshot_joined ? feedhandler::wallClockNs() - snapshot_joined_at_ns_ : 0;
+
+        out.securities = registry_.size();
+        out.defined = 0;
+        registry_.forEach([&out](const SecurityRecord& record) { out.defined += record.defined; });
+
+        out.recovering = recovery_manager_.recoveringCount();
+        out.listed = 0;
+        if (out.recovering > 0) {
+            for (auto security_id : recovery_manager_.getRecoveringSecurities()) {
+                if (out.listed == ProcessingStats::MAX_LISTED) break;
+                char* symbol = out.recovering_symbols[out.listed++];
+                std::strncpy(symbol, registry_.symbolOf(security_id), sizeof(out.recovering_symbols[0]) - 1);
+                symbol[sizeof(out.recovering_symbols[0]) - 1] = '\0';
+            }
+        }
+    });
+}
+
+uint64_t CmeFeedHandler::receiveDrops() const {
+    uint64_t drops = 0;
+    if (incremental_receiver_) drops += incremental_receiver_->dropCount();
+    if (incremental_receiver_b_) drops += incremental_receiver_b_->dropCount();
+    if (snapshot_receiver_) drops += snapshot_receiver_->dropCount();
+    return drops;
+}
+
+void CmeFeedHandler::collectMetrics(feedhandler::MetricsWriter& out) const {
+    ProcessingStats processing = published_processing_.load();
+    feedhandler::FeedStats published = published_stats_.load();
+    const feedhandler::FeedStats& stats = processing.feed;
+
+    out.counter("cme_datagrams_received_total", "Datagrams received on every feed", stats.messages_received);
+    out.counter("cme_bytes_received_total", "Bytes received on every feed", stats.bytes_received);
+    out.counter("cme_receive_batches_total", "Non-empty receive batches", stats.recv_batches);
+    out.gauge("cme_receive_batch_max", "Most datagrams in one receive batch", static_cast<double>(stats.recv_batch_max));
+    out.family("cme_receive_drops_total", "counter",
+               "Datagrams lost before the handler (socket buffer overflow, ring overrun, truncation)");
+    if (incremental_receiver_) {
+        out.sample("cme_receive_drops_total", "feed=\"incremental_a\"", incremental_receiver_->dropCount());
+    }
+    if (incremental_receiver_b_) {
+        out.sample("cme_receive_drops_total", "feed=\"incremental_b\"", incremental_receiver_b_->dropCount());
+    }
+    if (snapshot_receiver_) {
+        out.sample("cme_receive_drops_total", "feed=\"snapshot\"", snapshot_receiver_->dropCount());
+    }
+
+    out.counter("cme_messages_sent_total", "L2 snapshots sent", published.messages_sent);
+    out.counter("cme_bytes_sent_total", "Output bytes sent", published.bytes_sent);
+    out.counter("cme_send_batches_total", "sendmmsg calls", published.send_batches);
+    out.gauge("cme_send_batch_max", "Most datagrams sent by one sendmmsg", static_cast<double>(published.send_batch_max));
+    auto flushes = scheduler_.getStats();
+    out.family("cme_conflation_drains_total", "counter", "Conflation drains by trigger");
+    out.sample("cme_conflation_drains_total", "trigger=\"interval\"", flushes.interval_flushes);
+    out.sample("cme_conflation_drains_total", "trigger=\"max_pending\"", flushes.pending_flushes);
+    out.sample("cme_conflation_drains_total", "trigger=\"staleness\"", flushes.staleness_flushes);
+
+    out.counter("cme_add_orders_total", "Book entries added", stats.add_orders);
+    out.counter("cme_delete_orders_total", "Book entries deleted", stats.delete_orders);
+    out.counter("cme_trades_total", "Trades", stats.trades);
+    out.counter("cme_errors_total", "Malformed packets and failed sends or joins", stats.errors + published.errors);
+
+    const auto& arb = processing.arbitration;
+    out.counter("cme_packet_gaps_total", "Sequence holes neither line filled", arb.gaps);
+    out.counter("cme_packet_gap_packets_total", "Packets lost in those holes", arb.gap_packets);
+    out.counter("cme_packets_held_total", "Packets held across a hole for reordering", arb.held);
+    size_t lines = config_.dual_feed ? 2 : 1;
+    struct LineCounter {
+        const char* name;
+        const char* help;
+        uint64_t LineArbitrator::LineStats::*field;
+    };
+    static const LineCounter LINE_COUNTERS[] = {
+        {"cme_line_packets_total", "Packets received per incremental line", &LineArbitrator::LineStats::packets},
+        {"cme_line_first_total", "Packets delivered from this line (arrived first)", &LineArbitrator::LineStats::won},
+        {"cme_line_duplicates_total", "Packets the other line already delivered", &LineArbitrator::LineStats::duplicates},
+        {"cme_line_missed_total", "Sequence numbers this line skipped", &LineArbitrator::LineStats::missed},
+    };
+    for (const auto& counter : LINE_COUNTERS) {
+        out.family(counter.name, "counter", counter.help);
+        for (size_t line = 0; line < lines; ++line) {
+            out.sample(counter.name, std::string("line=\"") + static_cast<char>('A' + line) + "\"",
+                       processing.lines[line].*counter.field);
+        }
+    }
+    out.family("cme_line_latency_max_seconds", "gauge", "Largest arrival - sending_time per line");
+    for (size_t line = 0; line < lines; ++line) {
+        out.sample("cme_line_latency_max_seconds", std::string("line=\"") + static_cast<char>('A' + line) + "\"",
+                   static_cast<double>(processing.lines[line].latency_max_ns) / 1e9);
+    }
+    out.family("cme_line_latency_seconds_total", "counter", "Sum of arrival - sending_time per line");
+    for (size_t line = 0; line < lines; ++line) {
+        out.sample("cme_line_latency_seconds_total", std::string("line=\"") + static_cast<char>('A' + line) + "\"",
+                   static_cast<double>(processing.lines[line].latency_sum_ns) / 1e9);
+    }
+    out.family("cme_line_latency_samples_total", "counter", "Packets with a usable sending_time per line");
+    for (size_t line = 0; line < lines; ++line) {
+        out.sample("cme_line_latency_samples_total", std::string("line=\"") + static_cast<char>('A' + line) + "\"",
+                   processing.lines[line].latency_count);
+    }
+
+    out.gauge("cme_securities", "Instruments seen", static_cast<double>(processing.securities));
+    out.gauge("cme_securities_defined", "Instruments with a SecurityDefinition", static_cast<double>(processing.defined));
+    out.gauge("cme_securities_recovering", "Instruments waiting for a snapshot", static_cast<double>(processing.recovering));
+    if (!config_.checkpoint.file.empty()) {
+        CheckpointStats checkpoint = published_checkpoint_.load();
+        out.family("cme_checkpoints_total", "counter", "Warm-start checkpoints by result");
+        out.sample("cme_checkpoints_total", "result=\"written\"", checkpoint.written);
+        out.sample("cme_checkpoints_total", "result=\"failed\"", checkpoint.failed);
+        out.gauge("cme_checkpoint_last_seconds", "Time the last checkpoint held processing up",
+                  static_cast<double>(checkpoint.last_ns) / 1e9);
+        out.gauge("cme_checkpoint_last_bytes", "Size of the last checkpoint", static_cast<double>(checkpoint.last_bytes));
+    }
+    if (book_cache_) {
+        out.gauge("cme_book_cache_instruments", "Instruments in the shared-memory book cache",
+                  static_cast<double>(book_cache_->used()));
+        out.counter("cme_book_cache_refused_total", "Instruments left out of the full book cache",
+                    book_cache_->refused());
+    }
+
+    const auto& rec = processing.recovery;
+    out.counter("cme_recovery_gaps_total", "rpt_seq gaps detected", rec.gaps_detected);
+    out.counter("cme_recovery_channel_gaps_total", "Packet gaps that marked the channel suspect", rec.channel_gaps);
+    out.counter("cme_recovery_suspects_cleared_total", "Suspect securities confirmed without a snapshot",
+                rec.suspects_cleared);
+    out.counter("cme_recoveries_total", "Recoveries completed from a snapshot", rec.recoveries_completed);
+    out.counter("cme_recovery_timed_total", "Recoveries with a measured time to recover", rec.recoveries_timed);
+    out.family("cme_recovery_seconds_total", "counter", "Time to recover, summed over timed recoveries");
+    out.sample("cme_recovery_seconds_total", std::string(), static_cast<double>(rec.recovery_time_total_ns) / 1e9);
+    out.gauge("cme_recovery_max_seconds", "Longest time to recover", static_cast<double>(rec.recovery_time_max_ns) / 1e9);
+    out.counter("cme_incrementals_buffered_total", "Incrementals buffered while recovering", rec.messages_buffered);
+    out.counter("cme_incrementals_replayed_total", "Buffered incrementals applied after a snapshot", rec.messages_replayed);
+    out.counter("cme_recovery_buffer_overflows_total", "Buffered incrementals lost to a full buffer", rec.buffer_overflows);
+
+    out.counter("cme_snapshot_feed_packets_total", "Snapshot datagrams read", processing.snapshot_feed.packets);
+    out.counter("cme_snapshot_feed_joins_total", "Snapshot feed joins", processing.snapshot_feed.joins);
+    out.family("cme_snapshot_feed_joined_seconds_total", "counter", "Time spent joined to the snapshot feed");
+    out.sample("cme_snapshot_feed_joined_seconds_total", std::string(),
+               static_cast<double>(processing.snapshot_feed.joined_ns + processing.snapshot_joined_now_ns) / 1e9);
+    out.gauge("cme_snapshot_feed_joined", "1 while joined to the snapshot feed", processing.snapshot_joined ? 1.0 : 0.0);
+}
+
 void CmeFeedHandler::printStats() {
+    ProcessingStats processing = published_processing_.load();
+    feedhandler::FeedStats published = published_stats_.load();
+    const feedhandler::FeedStats& stats = processing.feed;
+
     std::cout << "\n=== Feed Handler Stats ===" << std::endl;
-    std::cout << "Messages received: " << stats_.messages_received << std::endl;
-    std::cout << "Messages sent: " << stats_.messages_sent << std::endl;
-    std::cout << "Bytes received: " << stats_.bytes_received << std::endl;
-    std::cout << "Bytes sent: " << stats_.bytes_sent << std::endl;
-    std::cout << "Add orders: " << stats_.add_orders << std::endl;
-    std::cout << "Delete orders: " << stats_.delete_orders << std::endl;
-    std::cout << "Trades: " << stats_.trades << std::endl;
-    std::cout << "Errors: " << stats_.errors << std::endl;
-
-    auto& rec_stats = recovery_manager_.getStats();
-    std::cout << "Gaps detected: " << rec_stats.gaps_detected << std::endl;
-    std::cout << "Recoveries completed: " << rec_stats.recoveries_completed << std::endl;
+    std::cout << "Messages received: " << stats.messages_received << std::endl;
+    std::cout << "Messages sent: " << published.messages_sent << std::endl;
+    std::cout << "Bytes received: " << stats.bytes_received << std::endl;
+    std::cout << "Receive batches: " << stats.recv_batches
+              << " (max " << stats.recv_batch_max << ")" << std::endl;
+    std::cout << "Receive drops: " << receiveDrops() << std::endl;
+    std::cout << "Send batches: " << published.send_batches
+              << " (max " << published.send_batch_max << ")" << std::endl;
+    std::cout << "Bytes sent: " << published.bytes_sent << std::endl;
+    auto flushes = scheduler_.getStats();
+    std::cout << "Conflation drains: " << flushes.interval_flushes << " interval, "
+              << flushes.pending_flushes << " max_pending, "
+              << flushes.staleness_flushes << " staleness" << std::endl;
+    std::cout << "Add orders: " << stats.add_orders << std::endl;
+    std::cout << "Delete orders: " << stats.delete_orders << std::endl;
+    std::cout << "Trades: " << stats.trades << std::endl;
+    std::cout << "Errors: " << stats.errors + published.errors << std::endl;
+
+    const auto& arb = processing.arbitration;
+    std::cout << "Packet gaps: " << arb.gaps << " (" << arb.gap_packets << " packets"
+              << ", " << arb.held << " held for reordering)" << std::endl;
+    size_t lines = config_.dual_feed ? 2 : 1;
+    for (size_t line = 0; line < lines; ++line) {
+        const auto& ls = processing.lines[line];
+        std::cout << "Line " << static_cast<char>('A' + line) << ": " << ls.packets << " packets, "
+                  << ls.won << " first, " << ls.duplicates << " duplicate, "
+                  << ls.missed << " missed";
+        if (ls.latency_count > 0) {
+            std::cout << ", latency avg " << ls.latency_sum_ns / ls.latency_count / 1000
+                      << "us max " << ls.latency_max_ns / 1000 << "us";
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "Securities: " << processing.securities << " (" << processing.defined << " defined)" << std::endl;
+
+    const auto& rec_stats = processing.recovery;
+    std::cout << "Gaps detected: " << rec_stats.gaps_detected
+              << " (channel " << rec_stats.channel_gaps << ", suspects cleared in sequence "
+              << rec_stats.suspects_cleared << ")" << std::endl;
+    std::cout << "Recoveries completed: " << rec_stats.recoveries_completed;
+    if (rec_stats.recoveries_timed > 0) {
+        std::cout << " (time to recover avg "
+                  << rec_stats.recovery_time_total_ns / rec_stats.recoveries_timed / 1000000
+                  << "ms max " << rec_stats.recovery_time_max_ns / 1000000 << "ms)";
+    }
+    std::cout << std::endl;
+    std::cout << "Incrementals buffered: " << rec_stats.messages_buffered
+              << " (replayed " << rec_stats.messages_replayed
+              << ", overflowed " << rec_stats.buffer_overflows << ")" << std::endl;
+
+    const auto& feed = processing.snapshot_feed;
+    if (config_.snapshot_on_demand) {
+        uint64_t joined_ns = feed.joined_ns + processing.snapshot_joined_now_ns;
+        std::cout << "Snapshot feed: joined " << feed.joins << " times for "
+                  << joined_ns / 1000000 << "ms, " << feed.packets << " packets read"
+                  << (processing.snapshot_joined ? " (joined now)" : "") << std::endl;
+    } else {
+        std::cout << "Snapshot feed: " << feed.packets << " packets read" << std::endl;
+    }
 
     // Print recovering securities
-    auto recovering = recovery_manager_.getRecoveringSecurities();
-    if (!recovering.empty()) {
+    if (processing.recovering > 0) {
         std::cout << "Securities in recovery:";
-        for (auto id : recovering) {
-            std::cout << " " << getSymbolName(id);
+        for (size_t i = 0; i < processing.listed; ++i) {
+            std::cout << " " << processing.recovering_symbols[i];
+        }
+        if (processing.recovering > processing.listed) {
+            std::cout << " ... (" << processing.recovering << " total)";
         }
         std::cout << std::endl;
     }
 
+    if (!config_.checkpoint.file.empty()) {
+        CheckpointStats checkpoint = published_checkpoint_.load();
+        std::cout << "Checkpoints: " << checkpoint.written << " written, " << checkpoint.failed
+                  << " failed (last: " << checkpoint.last_securities << " securities, "
+                  << checkpoint.last_ns / 1000 << "us)" << std::endl;
+    }
+
     std::cout << "=========================\n" << std::endl;
 }
 
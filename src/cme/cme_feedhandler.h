@@ -2,100 +2,285 @@
 
 #include "cme_order_book.h"
 #include "cme_protocol.h"
+#include "line_arbitrator.h"
 #include "recovery_state.h"
+#include "security_registry.h"
+#include "src/feedhandler/book_cache.h"
+#include "src/feedhandler/capture_file.h"
+#include "src/feedhandler/checkpoint_file.h"
+#include "src/feedhandler/conflation.h"
+#include "src/feedhandler/conflation_scheduler.h"
 #include "src/feedhandler/market_data.h"
+#include "src/feedhandler/metrics.h"
 #include "src/feedhandler/multicast.h"
+#include "src/feedhandler/receive_backend.h"
+#include "src/feedhandler/replay.h"
+#include "src/feedhandler/seqlock.h"
+#include "src/feedhandler/thread_tuning.h"
+#include "src/feedhandler/tsc_clock.h"
 
 #include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <thread>
 #include <vector>
 
 namespace cme {
 
+// Warm-start checkpoint record (see feedhandler::CheckpointWriter), one per
+// registry record in index order. Its book levels follow in the levels
+// section as MDSnapshotEntry, bids then asks, so restoring a book is
+// applySnapshot().
+struct CmeCheckpointSecurity {
+    uint32_t security_id;
+    uint32_t last_good_rpt_seq;         // Recovery state's, the resume point
+    uint32_t book_rpt_seq;              // Last rpt_seq applied to the book
+    int32_t last_trade_qty;
+    int64_t min_price_increment;
+    int64_t last_trade_price;
+    uint64_t total_volume;
+    uint8_t defined;
+    uint8_t tracked;                    // Known to the RecoveryManager
+    uint8_t state;                      // RecoveryState
+    uint8_t levels;                     // Entries in the levels section
+    char symbol[sizeof(SecurityDefinition::symbol)];
+};
+
 class CmeFeedHandler {
 public:
     struct Config {
         // Input feeds
         std::string incremental_group = CME_INCREMENTAL_GROUP;
         uint16_t incremental_port = CME_INCREMENTAL_PORT;
+        bool dual_feed = false;       // Also receive line B and arbitrate A/B
+        std::string incremental_group_b = CME_INCREMENTAL_GROUP_B;
+        uint16_t incremental_port_b = CME_INCREMENTAL_PORT_B;
+        uint64_t arbitration_timeout_us = 2000;  // Wait for the other line to fill a hole
         std::string snapshot_group = CME_SNAPSHOT_GROUP;
         uint16_t snapshot_port = CME_SNAPSHOT_PORT;
+        bool snapshot_on_demand = true;  // Join the snapshot group only while recovering
 
         // Output feed
         std::string output_group = CME_OUTPUT_GROUP;
         uint16_t output_port = CME_OUTPUT_PORT;
 
         std::string interface = "0.0.0.0";
+        size_t recv_batch_size = 64;  // Datagrams drained per recvmmsg
+        feedhandler::ReceiveBackendConfig input_backend;  // Kernel socket or zero-copy packet ring
+        size_t send_batch_size = 64;  // Datagrams per sendmmsg
+        feedhandler::RunLoopConfig run_loop;  // Spin / busy-poll / pinning for run()
+        std::string capture_file;     // Record every received datagram as pcap (empty = off)
+        feedhandler::BookCacheConfig book_cache;  // Latest books in shared memory for local readers
 
         // Conflation settings
         uint32_t conflation_interval_ms = 100;  // 10 Hz output rate
+        size_t conflation_max_pending = 10000;  // Publish early once this many books are waiting (0 = off)
+        uint32_t conflation_max_staleness_ms = 0;  // Publish early once an update has waited this long (0 = off)
+
+        // Instruments expected on the channel (sizes the registry, which grows past it)
+        size_t expected_securities = SecurityRegistry::DEFAULT_CAPACITY;
+        size_t book_depth = CME_MAX_DEPTH;  // Levels kept and published per side (max CME_MAX_BOOK_DEPTH)
 
         // Recovery settings
         uint64_t recovery_timeout_ms = 5000;  // 5 seconds
+        size_t recovery_buffer_entries = RecoveryManager::DEFAULT_BUFFER_ENTRIES;  // Per security
+
+        // Monitoring: Prometheus /metrics endpoint, served off the processing thread
+        feedhandler::MetricsConfig metrics;
+
+        // Warm start: books, rpt_seqs and recovery state saved to checkpoint.file, loaded on startup
+        feedhandler::CheckpointConfig checkpoint;
     };
 
     explicit CmeFeedHandler(const Config& config);
     ~CmeFeedHandler();
 
     bool start();
+
+    // Tear everything down; run() and replay() call it on their way out.
+    // Not from a signal handler: use requestStop().
     void stop();
-    void run();
+
+    void run();  // Blocking run loop, stops the handler when it returns
+
+    // Async-signal-safe: make run() / replay() return at the end of the
+    // current pass, which then stop() on their own thread
+    void requestStop() { running_.store(false, std::memory_order_relaxed); }
+
+    // Feed a capture (see feedhandler::CaptureReader) through the handler
+    // instead of the sockets: records are routed by UDP port to the
+    // incremental lines or the snapshot feed, output goes to the configured
+    // sender as usual. Call instead of start() / run(); returns once the
+    // capture ends. False if the capture or the sender could not be opened.
+    bool replay(const feedhandler::ReplayConfig& replay);
 
     // Stats
     const feedhandler::FeedStats& getStats() const { return stats_; }
 
 private:
-    // Message processing
+    // Message processing: datagrams from either line go through the
+    // arbitrator, which hands processIncrementalPacket one copy of each
+    // msg_seq_num in order
+    void onIncrementalDatagram(size_t line, const feedhandler::Datagram& dgram);
+    void onPacketGap(uint32_t first_seq, uint32_t count);
     void processIncrementalPacket(const uint8_t* data, size_t len);
     void processSnapshotPacket(const uint8_t* data, size_t len);
+    void onSnapshotDatagram(const feedhandler::Datagram& dgram);
+    void noteBatch(const feedhandler::DatagramBatch& batch);
+
+    // Shared by run() and replay(): output sender and publisher thread;
+    // per-pass arbitration / snapshot join checks; end-of-pass hand-off and timers
+    bool startOutput();
+    void checkLines();
+    void endPass();
+
+    // Snapshot feed membership: joined while any security is recovering
+    void joinSnapshotFeed(uint64_t now_ns);
+    void leaveSnapshotFeed(uint64_t now_ns);
 
     void handleSecurityDefinition(const SecurityDefinition* msg);
     void handleIncrementalRefresh(const MDIncrementalRefreshBook* msg);
     void handleSnapshotFullRefresh(const MDSnapshotFullRefresh* msg);
     void handleChannelReset(const ChannelReset* msg);
     void handleHeartbeat(const Heartbeat* msg);
+    void applyIncrementalEntry(SecurityRecord& record, const MDIncrementalRefreshEntry& entry);
 
-    // Output
+    // Conflation: the loop encodes books changed by each pass straight into
+    // their conflation_ slots as SBE; a publisher thread drains them every
+    // interval (or early, when scheduler_ sees too many books waiting or one
+    // waiting too long), stamps time and sequence and sends, so sendmmsg
+    // never holds up incremental processing. The same pass writes the
+    // books to the shared-memory cache, if configured.
+    void captureDirtyBooks();
+    void updateCache(SecurityRecord& record);
+    void runPublisher();
     void publishConflatedSnapshots();
-    void publishSnapshot(const feedhandler::OrderBookSnapshot& snap);
+    void publishSnapshot(EncodedL2Snapshot& snap, uint64_t now_ns);
+    void stopPublisher();
+
+    // Warm start (checkpoint.file): startOutput() loads the checkpoint and
+    // resumes the arbitrator after its msg_seq_num before the first packet;
+    // the processing thread writes one on a timer (endPass) and when run()
+    // or replay() finishes
+    struct CheckpointStats {
+        uint64_t written = 0;
+        uint64_t failed = 0;
+        uint64_t last_ns = 0;           // Time the last one held processing up
+        uint64_t last_bytes = 0;
+        uint64_t last_securities = 0;
+    };
+    void restoreCheckpoint();
+    bool writeCheckpoint();
+    void finalCheckpoint();
+    uint64_t restored_records_ = 0;     // Input records the restored checkpoint covers
+    uint64_t next_checkpoint_tick_ = 0;
+    CheckpointStats checkpoint_stats_;  // Processing thread
+    feedhandler::SeqLock<CheckpointStats> published_checkpoint_;
 
     // Utility
     uint64_t getCurrentTimeNs();
-    void printStats();
 
     Config config_;
 
     // Receivers and sender
-    std::unique_ptr<feedhandler::MulticastReceiver> incremental_receiver_;
-    std::unique_ptr<feedhandler::MulticastReceiver> snapshot_receiver_;
+    std::unique_ptr<feedhandler::PacketSource> incremental_receiver_;
+    std::unique_ptr<feedhandler::PacketSource> incremental_receiver_b_;  // dual_feed only
+    std::unique_ptr<feedhandler::PacketSource> snapshot_receiver_;
     std::unique_ptr<feedhandler::MulticastSender> output_sender_;
 
-    // State
-    CmeOrderBookManager book_manager_;
+    // Recording (capture_file): feed ids per incremental line and snapshot
+    feedhandler::CaptureWriter capture_;
+    int capture_incremental_[2] = {-1, -1};
+    int capture_snapshot_ = -1;
+
+    // State: one record per instrument (book + recovery state)
+    SecurityRegistry registry_;
     RecoveryManager recovery_manager_;
 
-    // Packet sequence tracking
-    uint32_t last_packet_seq_ = 0;
-    bool first_packet_ = true;
+    // Packet sequence tracking across lines A and B
+    LineArbitrator arbitrator_;
+    uint64_t packet_rx_ns_ = 0;     // Arrival of the packet being processed (CLOCK_REALTIME)
+    uint64_t transact_time_ns_ = 0; // Of the last book message applied
+
+    // Channel-level recovery after a packet gap: per-security snapshot logging
+    // is folded into one summary when the last security settles
+    struct ChannelRecovery {
+        bool active = false;
+        uint64_t started_ns = 0;
+        uint64_t recoveries_at_start = 0;
+        uint64_t cleared_at_start = 0;
+    };
+    ChannelRecovery channel_recovery_;
+    void finishChannelRecovery(uint64_t now_ns);
+
+    // Snapshot feed membership (snapshot_on_demand)
+    struct SnapshotFeedStats {
+        uint64_t joins = 0;
+        uint64_t leaves = 0;
+        uint64_t packets = 0;       // Snapshot datagrams read
+        uint64_t joined_ns = 0;     // Total time spent joined (completed memberships)
+    };
+    SnapshotFeedStats snapshot_feed_stats_;
+    uint64_t snapshot_joined_at_ns_ = 0;
+
+    // Conflation hand-off (each record keeps its slot)
+    feedhandler::BasicConflationTable<EncodedL2Snapshot> conflation_;
+    feedhandler::ConflationScheduler scheduler_;
 
-    // Output sequence
+    // Shared-memory last-value cache (book_cache.name), written on the
+    // processing thread; defined securities only, so readers can look
+    // them up by symbol
+    std::unique_ptr<feedhandler::BookCacheWriter> book_cache_;
+
+    // Publisher thread state
+    std::thread publisher_thread_;
     uint64_t output_seq_ = 0;
+    feedhandler::FeedStats publisher_stats_;    // Publisher thread only
+    feedhandler::SeqLock<feedhandler::FeedStats> published_stats_;  // Copy for the metrics thread
 
-    // Timing
-    std::chrono::steady_clock::time_point last_conflation_time_;
-    std::chrono::steady_clock::time_point last_stats_time_;
+    // Timing: TSC deadlines, checked once per loop pass
+    static constexpr uint64_t RECOVERY_CHECK_INTERVAL_MS = 10;
+    static constexpr uint64_t STATS_PUBLISH_INTERVAL_MS = 500;
+    static constexpr uint64_t STATS_INTERVAL_MS = 10000;
+    feedhandler::TscClock clock_;
+    uint64_t next_publish_tick_ = 0;
+    uint64_t next_recovery_check_tick_ = 0;
 
     // Stats
     feedhandler::FeedStats stats_;
 
-    // Running state
-    std::atomic<bool> running_{false};
+    // Monitoring: the processing thread copies its figures into a seqlock on
+    // a timer and posts recovery events to a ring; the metrics thread serves
+    // /metrics, prints the periodic report and writes the events out, so
+    // nothing on the processing thread formats or touches stdout
+    struct ProcessingStats {
+        static constexpr size_t MAX_LISTED = 16;
+
+        feedhandler::FeedStats feed;
+        LineArbitrator::Stats arbitration;
+        LineArbitrator::LineStats lines[2];
+        RecoveryManager::Stats recovery;
+        SnapshotFeedStats snapshot_feed;
+        uint64_t snapshot_joined_now_ns = 0;    // Current membership so far
+        bool snapshot_joined = false;
+        uint64_t securities = 0;
+        uint64_t defined = 0;
+        uint64_t recovering = 0;
+        size_t listed = 0;                      // Recovering securities named below
+        char recovering_symbols[MAX_LISTED][sizeof(SecurityDefinition::symbol) + 1];
+    };
+    void publishStats();
+    uint64_t receiveDrops() const;
+    void collectMetrics(feedhandler::MetricsWriter& out) const;
+    void printStats();
+    feedhandler::SeqLock<ProcessingStats> published_processing_;
+    feedhandler::EventLog events_;
+    feedhandler::MetricsServer metrics_;
 
-    // Buffers
-    std::vector<uint8_t> recv_buffer_;
-    std::vector<uint8_t> send_buffer_;
+    // Running state
+    std::atomic<bool> running_{false};      // Processing loop keeps going
+    bool started_ = false;                  // Output up, stop() has work to do
 };
 
 } // namespace cme
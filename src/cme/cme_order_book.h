@@ -1,34 +1,48 @@
 #pragma once
 
 #include "cme_protocol.h"
-#include "src/feedhandler/market_data.h"
+#include "l2_sbe_messages.h"
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
-#include <unordered_map>
-#include <unordered_set>
-#include <vector>
 
 namespace cme {
 
-// Price level in CME order book
-struct CmePriceLevel {
-    int64_t price;          // CME price format (mantissa, -7 exponent)
-    int32_t quantity;
-    uint8_t order_count;
+// Default book depth (CME MBP books are published 10 deep)
+constexpr size_t CME_MAX_DEPTH = 10;
 
-    CmePriceLevel() : price(0), quantity(0), order_count(0) {}
-    CmePriceLevel(int64_t p, int32_t q, uint8_t oc)
-        : price(p), quantity(q), order_count(oc) {}
+// Deepest book a CmeOrderBook can be configured for
+constexpr size_t CME_MAX_BOOK_DEPTH = 32;
+
+// Largest L2Snapshot a CmeOrderBook encodes (both sides CME_MAX_BOOK_DEPTH deep)
+constexpr size_t CME_MAX_L2_SNAPSHOT_BYTES =
+    sizeof(l2md::MessageHeader) + sizeof(l2md::L2SnapshotRoot) +
+    2 * (sizeof(l2md::GroupHeader) + CME_MAX_BOOK_DEPTH * sizeof(l2md::PriceLevelEntry));
+
+// One side of the book, structure-of-arrays: level i is
+// (price[i], qty[i], orders[i]). Only the configured depth is ever touched,
+// a Change is three plain stores, and the encoder reads each column
+// sequentially.
+struct CmeBookSide {
+    alignas(64) std::array<int64_t, CME_MAX_BOOK_DEPTH> price;  // CME price format (mantissa, -7 exponent)
+    alignas(64) std::array<int32_t, CME_MAX_BOOK_DEPTH> qty;
+    std::array<uint8_t, CME_MAX_BOOK_DEPTH> orders;
+    uint8_t count;                                              // Number of valid levels
 };
 
-constexpr size_t CME_MAX_DEPTH = 10;
+// Conflation payload: a ready-to-send L2Snapshot
+struct EncodedL2Snapshot {
+    uint16_t length;
+    uint8_t data[CME_MAX_L2_SNAPSHOT_BYTES];
+};
 
 // CME L2 Order Book for a single security
 class CmeOrderBook {
 public:
-    explicit CmeOrderBook(uint32_t security_id);
+    // depth is clamped to [1, CME_MAX_BOOK_DEPTH]; levels past it are ignored
+    explicit CmeOrderBook(uint32_t security_id, size_t depth = CME_MAX_DEPTH);
 
     // Apply an incremental update entry
     void applyUpdate(const MDIncrementalRefreshEntry& entry);
@@ -39,31 +53,62 @@ public:
     // Clear the book
     void clear();
 
-    // Get snapshot in common output format
-    feedhandler::OrderBookSnapshot getSnapshot() const;
+    // Clear the book, rpt_seq and trade stats (channel reset)
+    void reset();
+
+    // Encode the book as an SBE L2Snapshot straight from the level arrays
+    // (CME prices already use the SBE 7-decimal format). timestamp and
+    // sequenceNumber are left 0 for the publisher to stamp. Returns the
+    // encoded length, 0 if it does not fit.
+    size_t encodeL2Snapshot(uint8_t* buffer, size_t size) const;
 
     // Get last applied rpt_seq
     uint32_t getLastRptSeq() const { return last_rpt_seq_; }
     void setLastRptSeq(uint32_t seq) { last_rpt_seq_ = seq; }
 
     uint32_t getSecurityId() const { return security_id_; }
-    const char* getSymbol() const { return getSymbolName(security_id_); }
+    size_t getDepth() const { return depth_; }
+
+    const CmeBookSide& bids() const { return bids_; }
+    const CmeBookSide& asks() const { return asks_; }
+
+    // From the SecurityDefinition (the security_id until one arrives)
+    const char* getSymbol() const { return symbol_; }
+    void setSymbol(const char* symbol);
 
     // Trade tracking
     void recordTrade(int64_t price, int32_t quantity);
+    int64_t getLastTradePrice() const { return last_trade_price_; }
+    int32_t getLastTradeQty() const { return last_trade_qty_; }
     uint64_t getTotalVolume() const { return total_volume_; }
 
+    // Warm start: trade stats as of a checkpoint
+    void restoreTrade(int64_t price, int32_t quantity, uint64_t total_volume);
+
 private:
-    void applyBid(uint8_t level, MDUpdateAction action, int64_t price, int32_t qty, uint8_t orders);
-    void applyAsk(uint8_t level, MDUpdateAction action, int64_t price, int32_t qty, uint8_t orders);
+    void applyLevel(CmeBookSide& side, uint8_t level, MDUpdateAction action,
+                    int64_t price, int32_t qty, uint8_t orders);
+
+    // Open a hole at idx (New) / close the hole at idx (Delete)
+    void insertAt(CmeBookSide& side, size_t idx);
+    void eraseAt(CmeBookSide& side, size_t idx);
+
+    // Zero levels [from, to)
+    static void clearLevels(CmeBookSide& side, size_t from, size_t to);
+
+    static void setLevel(CmeBookSide& side, size_t idx, int64_t price, int32_t qty, uint8_t orders) {
+        side.price[idx] = price;
+        side.qty[idx] = qty;
+        side.orders[idx] = orders;
+    }
 
     uint32_t security_id_;
+    size_t depth_;
     uint32_t last_rpt_seq_ = 0;
+    char symbol_[sizeof(SecurityDefinition::symbol) + 1] = {};
 
-    std::array<CmePriceLevel, CME_MAX_DEPTH> bids_;
-    std::array<CmePriceLevel, CME_MAX_DEPTH> asks_;
-    uint8_t bid_count_ = 0;
-    uint8_t ask_count_ = 0;
+    CmeBookSide bids_;
+    CmeBookSide asks_;
 
     // Trade info
     int64_t last_trade_price_ = 0;
@@ -71,38 +116,4 @@ private:
     uint64_t total_volume_ = 0;
 };
 
-// Manages order books for multiple securities
-class CmeOrderBookManager {
-public:
-    CmeOrderBookManager() = default;
-
-    // Get or create book for security
-    CmeOrderBook& getBook(uint32_t security_id);
-
-    // Check if book exists
-    bool hasBook(uint32_t security_id) const;
-
-    // Apply incremental update, returns affected security_id
-    uint32_t applyIncremental(const MDIncrementalRefreshEntry& entry);
-
-    // Apply snapshot to specific security
-    void applySnapshot(uint32_t security_id, const MDSnapshotEntry* entries, uint8_t count, uint32_t rpt_seq);
-
-    // Mark a security as dirty (needs conflation)
-    void markDirty(uint32_t security_id);
-
-    // Get and clear dirty securities
-    std::vector<uint32_t> getDirtySecurities();
-
-    // Clear all books
-    void clear();
-
-    // Get all security IDs
-    std::vector<uint32_t> getAllSecurityIds() const;
-
-private:
-    std::unordered_map<uint32_t, CmeOrderBook> books_;
-    std::unordered_set<uint32_t> dirty_securities_;
-};
-
 } // namespace cme
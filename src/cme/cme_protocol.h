@@ -9,10 +9,12 @@ namespace cme {
 constexpr uint16_t CME_INCREMENTAL_PORT = 40001;
 constexpr uint16_t CME_SNAPSHOT_PORT = 40002;
 constexpr uint16_t CME_OUTPUT_PORT = 40003;
+constexpr uint16_t CME_INCREMENTAL_PORT_B = 40004;
 
 constexpr const char* CME_INCREMENTAL_GROUP = "239.2.1.1";
 constexpr const char* CME_SNAPSHOT_GROUP = "239.2.1.2";
 constexpr const char* CME_OUTPUT_GROUP = "239.2.1.3";
+constexpr const char* CME_INCREMENTAL_GROUP_B = "239.2.1.4";  // Incremental line B
 
 // SBE Template IDs
 constexpr uint16_t TEMPLATE_CHANNEL_RESET = 4;
@@ -40,30 +42,13 @@ enum class MDUpdateAction : uint8_t {
     Overlay = 5,
 };
 
-// Predefined security IDs for CME futures
+// Security IDs of the simulator's named instruments. The feed handler learns
+// instruments (and their symbols) from SecurityDefinition messages instead.
 constexpr uint32_t SECURITY_ID_ESH26 = 1001;  // E-mini S&P 500 Mar 2026
 constexpr uint32_t SECURITY_ID_NQM26 = 1002;  // E-mini NASDAQ Jun 2026
 constexpr uint32_t SECURITY_ID_CLK26 = 1003;  // Crude Oil May 2026
 constexpr uint32_t SECURITY_ID_GCZ26 = 1004;  // Gold Dec 2026
 
-inline const char* getSymbolName(uint32_t security_id) {
-    switch (security_id) {
-        case SECURITY_ID_ESH26: return "ESH26";
-        case SECURITY_ID_NQM26: return "NQM26";
-        case SECURITY_ID_CLK26: return "CLK26";
-        case SECURITY_ID_GCZ26: return "GCZ26";
-        default: return "UNKNOWN";
-    }
-}
-
-inline uint32_t getSecurityIdFromSymbol(const char* symbol) {
-    if (std::strncmp(symbol, "ESH26", 5) == 0) return SECURITY_ID_ESH26;
-    if (std::strncmp(symbol, "NQM26", 5) == 0) return SECURITY_ID_NQM26;
-    if (std::strncmp(symbol, "CLK26", 5) == 0) return SECURITY_ID_CLK26;
-    if (std::strncmp(symbol, "GCZ26", 5) == 0) return SECURITY_ID_GCZ26;
-    return 0;
-}
-
 #pragma pack(push, 1)
 
 // Packet header (appears once per UDP packet)
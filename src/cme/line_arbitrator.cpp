@@ -0,0 +1,113 @@
+#include "line_arbitrator.h"
+
+#include <cstring>
+
+namespace cme {
+
+LineArbitrator::LineArbitrator(size_t window, uint64_t timeout_ns)
+    : timeout_ns_(timeout_ns) {
+    size_t slots = 16;
+    while (slots < window) slots <<= 1;
+    slots_.resize(slots);
+    mask_ = static_cast<uint32_t>(slots - 1);
+}
+
+void LineArbitrator::resume(uint32_t next_seq, size_t line_count) {
+    for (auto& slot : slots_) slot.valid = false;
+    held_count_ = 0;
+    started_ = true;
+    next_seq_ = next_seq;
+    for (size_t i = 0; i < MAX_LINES; ++i) {
+        line_state_[i].highest = next_seq - 1;
+        line_state_[i].active = i < line_count;
+    }
+}
+
+void LineArbitrator::noteLatency(size_t line, uint64_t rx_ns, uint64_t sending_ns) {
+    LineStats& stats = lines_[line];
+    stats.packets++;
+    if (sending_ns == 0 || rx_ns < sending_ns) return;
+
+    uint64_t latency = rx_ns - sending_ns;
+    stats.latency_count++;
+    stats.latency_sum_ns += latency;
+    if (latency > stats.latency_max_ns) stats.latency_max_ns = latency;
+}
+
+LineArbitrator::Verdict LineArbitrator::classify(size_t line, uint32_t seq, const uint8_t* data,
+                                                 size_t len, uint64_t rx_ns) {
+    Line& state = line_state_[line];
+
+    // A line jumping far backwards is a publisher restart, not reordering
+    if (state.active && static_cast<uint64_t>(seq) + slots_.size() < state.highest) {
+        for (auto& slot : slots_) slot.valid = false;
+        for (auto& other : line_state_) other = Line{};
+        held_count_ = 0;
+        started_ = false;
+        stats_.resets++;
+    }
+
+    if (state.active && seq > state.highest + 1) {
+        lines_[line].missed += seq - state.highest - 1;
+    }
+    if (!state.active || seq > state.highest) {
+        state.highest = seq;
+    }
+    state.active = true;
+
+    if (!started_) {
+        started_ = true;
+        next_seq_ = seq;
+    }
+
+    if (seq < next_seq_) {
+        lines_[line].duplicates++;
+        return Verdict::Duplicate;
+    }
+    if (seq == next_seq_) {
+        return Verdict::Deliver;
+    }
+    if (seq - next_seq_ >= slots_.size()) {
+        return Verdict::Overflow;
+    }
+
+    Slot& slot = slotFor(seq);
+    if (slot.valid && slot.seq == seq) {
+        lines_[line].duplicates++;
+        return Verdict::Duplicate;
+    }
+
+    // Ahead of a hole: copy it out of the receive buffer until the hole fills
+    slot.data.resize(len);
+    std::memcpy(slot.data.data(), data, len);
+    slot.length = len;
+    slot.seq = seq;
+    slot.valid = true;
+    if (held_count_ == 0) hole_since_ns_ = rx_ns;
+    held_count_++;
+    lines_[line].won++;
+    stats_.held++;
+    return Verdict::Held;
+}
+
+bool LineArbitrator::holeAbandoned(uint64_t now_ns) const {
+    if (now_ns >= hole_since_ns_ && now_ns - hole_since_ns_ >= timeout_ns_) {
+        return true;
+    }
+
+    // Lines deliver in order, so a line past the hole will never fill it
+    for (const auto& line : line_state_) {
+        if (line.active && line.highest <= next_seq_) return false;
+    }
+    return true;
+}
+
+uint32_t LineArbitrator::lowestHeld() const {
+    uint32_t lowest = next_seq_ + mask_;
+    for (const auto& slot : slots_) {
+        if (slot.valid && slot.seq < lowest) lowest = slot.seq;
+    }
+    return lowest;
+}
+
+} // namespace cme
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cme {
+
+// A/B line arbitration for the incremental channel.
+//
+// CME publishes every incremental packet on two lines with the same
+// msg_seq_num. The arbitrator delivers each sequence number once, in order,
+// from whichever line has it first. A packet that arrives ahead of a hole is
+// held (copied into a preallocated window slot) until the other line fills
+// the hole. A gap is declared only when every line that has delivered data
+// has moved past the hole, or when the hole outlives the timeout (a line
+// that went silent). With a single line this reduces to plain in-order
+// delivery with gaps reported as soon as they are seen.
+class LineArbitrator {
+public:
+    static constexpr size_t MAX_LINES = 2;
+    static constexpr size_t DEFAULT_WINDOW = 1024;              // Packets held across a hole
+    static constexpr uint64_t DEFAULT_TIMEOUT_NS = 2000000;     // 2ms
+
+    struct LineStats {
+        uint64_t packets = 0;           // Received on this line
+        uint64_t won = 0;               // Delivered from this line (arrived first)
+        uint64_t duplicates = 0;        // Already delivered or held from the other line
+        uint64_t missed = 0;            // Sequence numbers this line skipped
+        uint64_t latency_count = 0;     // Packets with a usable sending_time
+        uint64_t latency_sum_ns = 0;    // Arrival - sending_time
+        uint64_t latency_max_ns = 0;
+    };
+
+    struct Stats {
+        uint64_t delivered = 0;
+        uint64_t gaps = 0;              // Holes neither line filled
+        uint64_t gap_packets = 0;       // Sequence numbers lost in those holes
+        uint64_t held = 0;              // Packets held across a hole
+        uint64_t resets = 0;            // Sequence restarts
+    };
+
+    explicit LineArbitrator(size_t window = DEFAULT_WINDOW, uint64_t timeout_ns = DEFAULT_TIMEOUT_NS);
+
+    // Feed a packet from line (0 = A, 1 = B). deliver(data, len) is called for
+    // every packet that becomes next in sequence, gap(first_seq, count) for
+    // every hole given up on. rx_ns and sending_ns share CLOCK_REALTIME.
+    template <typename Deliver, typename OnGap>
+    void onPacket(size_t line, uint32_t seq, const uint8_t* data, size_t len,
+                  uint64_t rx_ns, uint64_t sending_ns, Deliver&& deliver, OnGap&& gap);
+
+    // Give up on a hole held for longer than the timeout. Call periodically
+    // while holding().
+    template <typename Deliver, typename OnGap>
+    void checkTimeout(uint64_t now_ns, Deliver&& deliver, OnGap&& gap);
+
+    bool holding() const { return held_count_ > 0; }
+
+    // Next msg_seq_num due, once the first packet set it
+    bool started() const { return started_; }
+    uint32_t nextSeq() const { return next_seq_; }
+
+    // Warm start: expect next_seq on the first line_count lines, as if each
+    // had delivered the packet before it. Older packets are duplicates; a
+    // line that starts further on reports the hole as a gap, and one far
+    // behind is a publisher restart as usual.
+    void resume(uint32_t next_seq, size_t line_count);
+
+    const LineStats& lineStats(size_t line) const { return lines_[line]; }
+    const Stats& getStats() const { return stats_; }
+
+private:
+    enum class Verdict { Deliver, Held, Duplicate, Overflow };
+
+    struct Slot {
+        std::vector<uint8_t> data;      // Keeps its capacity, so holding is allocation-free once warm
+        size_t length = 0;
+        uint32_t seq = 0;
+        bool valid = false;
+    };
+
+    struct Line {
+        uint32_t highest = 0;
+        bool active = false;            // Has delivered at least one packet
+    };
+
+    // Sequence bookkeeping and holding; the caller delivers on Deliver
+    Verdict classify(size_t line, uint32_t seq, const uint8_t* data, size_t len, uint64_t rx_ns);
+    void noteLatency(size_t line, uint64_t rx_ns, uint64_t sending_ns);
+
+    // Every active line is past the hole, or it has been open too long
+    bool holeAbandoned(uint64_t now_ns) const;
+
+    // Lowest held sequence number (requires holding())
+    uint32_t lowestHeld() const;
+
+    Slot& slotFor(uint32_t seq) { return slots_[seq & mask_]; }
+
+    // Deliver held packets in order, skipping holes that are abandoned
+    // (or every hole when force is set)
+    template <typename Deliver, typename OnGap>
+    void release(uint64_t now_ns, bool force, Deliver& deliver, OnGap& gap);
+
+    std::vector<Slot> slots_;
+    uint32_t mask_ = 0;
+    uint64_t timeout_ns_;
+
+    bool started_ = false;
+    uint32_t next_seq_ = 0;
+    size_t held_count_ = 0;
+    uint64_t hole_since_ns_ = 0;        // When the current hole was first seen
+
+    Line line_state_[MAX_LINES];
+    LineStats lines_[MAX_LINES];
+    Stats stats_;
+};
+
+template <typename Deliver, typename OnGap>
+void LineArbitrator::onPacket(size_t line, uint32_t seq, const uint8_t* data, size_t len,
+                              uint64_t rx_ns, uint64_t sending_ns, Deliver&& deliver, OnGap&& gap) {
+    noteLatency(line, rx_ns, sending_ns);
+
+    switch (classify(line, seq, data, len, rx_ns)) {
+        case Verdict::Deliver:
+            // Fast path: in sequence, processed straight from the receive buffer
+            lines_[line].won++;
+            stats_.delivered++;
+            next_seq_++;
+            deliver(data, len);
+            break;
+
+        case Verdict::Overflow:
+            // Too far ahead to hold: give up on every hole before it
+            release(rx_ns, true, deliver, gap);
+            if (seq != next_seq_) {
+                gap(next_seq_, seq - next_seq_);
+                stats_.gaps++;
+                stats_.gap_packets += seq - next_seq_;
+                next_seq_ = seq;
+            }
+            lines_[line].won++;
+            stats_.delivered++;
+            next_seq_++;
+            deliver(data, len);
+            break;
+
+        case Verdict::Held:
+        case Verdict::Duplicate:
+            break;
+    }
+
+    if (held_count_ > 0) {
+        release(rx_ns, false, deliver, gap);
+    }
+}
+
+template <typename Deliver, typename OnGap>
+void LineArbitrator::checkTimeout(uint64_t now_ns, Deliver&& deliver, OnGap&& gap) {
+    if (held_count_ > 0) {
+        release(now_ns, false, deliver, gap);
+    }
+}
+
+template <typename Deliver, typename OnGap>
+void LineArbitrator::release(uint64_t now_ns, bool force, Deliver& deliver, OnGap& gap) {
+    while (held_count_ > 0) {
+        Slot& slot = slotFor(next_seq_);
+        if (slot.valid && slot.seq == next_seq_) {
+            slot.valid = false;
+            held_count_--;
+            stats_.delivered++;
+            next_seq_++;
+            deliver(slot.data.data(), slot.length);
+            if (held_count_ > 0) hole_since_ns_ = now_ns;
+            continue;
+        }
+
+        if (!force && !holeAbandoned(now_ns)) break;
+
+        uint32_t resume = lowestHeld();
+        gap(next_seq_, resume - next_seq_);
+        stats_.gaps++;
+        stats_.gap_packets += resume - next_seq_;
+        next_seq_ = resume;
+    }
+}
+
+} // namespace cme
@@ -1,39 +1,131 @@
+#include "cme_config_loader.h"
 #include "cme_feedhandler.h"
 
 #include <csignal>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <unistd.h>
 
 static cme::CmeFeedHandler* g_handler = nullptr;
 
-void signalHandler(int signal) {
-    std::cout << "\nReceived signal " << signal << ", stopping feed handler..." << std::endl;
+// Async-signal-safe only: run() notices and shuts down on the main thread
+// (every other thread has SIGINT / SIGTERM blocked)
+void signalHandler(int) {
+    static const char message[] = "\nReceived signal, stopping feed handler...\n";
+    ssize_t written = write(STDOUT_FILENO, message, sizeof(message) - 1);
+    (void)written;
     if (g_handler) {
-        g_handler->stop();
+        g_handler->requestStop();
     }
 }
 
 void printUsage(const char* program) {
     std::cout << "Usage: " << program << " [options]\n"
               << "\nOptions:\n"
+              << "  --config <file>           YAML config (layout of config/cme_feedhandler.yaml); flags override it\n"
               << "  --interface <ip>          Network interface (default: 0.0.0.0)\n"
               << "  --conflation-interval <ms> Conflation interval in ms (default: 100)\n"
+              << "  --max-pending <n>         Publish early once n books are waiting (default: 10000, 0 = off)\n"
+              << "  --max-staleness-ms <ms>   Publish early once an update has waited this long (default: 0 = off)\n"
+              << "  --book-depth <n>          Levels kept and published per side, 1-32 (default: 10)\n"
               << "  --recovery-timeout <ms>   Recovery timeout in ms (default: 5000)\n"
+              << "  --recovery-buffer <n>     Incrementals buffered per security during recovery (default: 4096)\n"
+              << "  --dual-feed               Also receive incremental line B and arbitrate A/B\n"
+              << "  --arb-timeout <us>        Wait for the other line to fill a hole (default: 2000)\n"
+              << "  --snapshot-always         Stay joined to the snapshot feed (default: join only while recovering)\n"
+              << "  --recv-batch <n>          Datagrams drained per recvmmsg (default: 64)\n"
+              << "  --send-batch <n>          Datagrams per sendmmsg (default: 64)\n"
+              << "  --rx-backend <socket|ring> Input path: UDP socket or zero-copy packet ring (default: socket)\n"
+              << "  --spin                    Spin on non-blocking receive instead of poll()\n"
+              << "  --busy-poll <us>          SO_BUSY_POLL budget on input sockets (default: 0 = off)\n"
+              << "  --cpu <n>                 Pin the receive thread to CPU n\n"
+              << "  --fifo-priority <n>       Run the receive thread SCHED_FIFO at priority n\n"
+              << "  --capture <file>          Record every received datagram to a pcap file\n"
+              << "  --metrics-port <port>     Serve Prometheus metrics on :port/metrics (default: 0 = off)\n"
+              << "  --book-cache <name>       Publish latest books to shared memory segment <name> (e.g. /cme_books)\n"
+              << "  --checkpoint <file>       Save books, rpt_seqs and recovery state to <file> on stop (warm start)\n"
+              << "  --checkpoint-interval <s> Also save a checkpoint every <s> seconds (default: 0 = on stop only)\n"
+              << "  --restore                 Load the checkpoint on startup and resume after its msg_seq_num\n"
+              << "  --replay <file>           Process a pcap capture instead of the live feeds\n"
+              << "  --replay-speed <x>        Replay pace: 1 = as captured, 10 = ten times faster (default: 0 = max)\n"
               << "  -h, --help                Show this help\n"
               << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     cme::CmeFeedHandler::Config config;
+    feedhandler::ReplayConfig replay;
+
+    // A config file is applied first, so flags override it wherever they appear
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--config") == 0 && !cme::loadConfigFile(argv[i + 1], config)) {
+            std::cerr << "Failed to load config " << argv[i + 1] << std::endl;
+            return 1;
+        }
+    }
 
     for (int i = 1; i < argc; ++i) {
-        if (std::strcmp(argv[i], "--interface") == 0 && i + 1 < argc) {
+        if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            ++i;  // Loaded above
+        } else if (std::strcmp(argv[i], "--interface") == 0 && i + 1 < argc) {
             config.interface = argv[++i];
         } else if (std::strcmp(argv[i], "--conflation-interval") == 0 && i + 1 < argc) {
             config.conflation_interval_ms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--max-pending") == 0 && i + 1 < argc) {
+            config.conflation_max_pending = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--max-staleness-ms") == 0 && i + 1 < argc) {
+            config.conflation_max_staleness_ms = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--book-depth") == 0 && i + 1 < argc) {
+            int depth = std::atoi(argv[++i]);
+            if (depth < 1 || depth > static_cast<int>(cme::CME_MAX_BOOK_DEPTH)) {
+                std::cerr << "Book depth must be 1-" << cme::CME_MAX_BOOK_DEPTH << std::endl;
+                return 1;
+            }
+            config.book_depth = static_cast<size_t>(depth);
         } else if (std::strcmp(argv[i], "--recovery-timeout") == 0 && i + 1 < argc) {
             config.recovery_timeout_ms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--recovery-buffer") == 0 && i + 1 < argc) {
+            config.recovery_buffer_entries = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--dual-feed") == 0) {
+            config.dual_feed = true;
+        } else if (std::strcmp(argv[i], "--arb-timeout") == 0 && i + 1 < argc) {
+            config.arbitration_timeout_us = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--snapshot-always") == 0) {
+            config.snapshot_on_demand = false;
+        } else if (std::strcmp(argv[i], "--recv-batch") == 0 && i + 1 < argc) {
+            config.recv_batch_size = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--send-batch") == 0 && i + 1 < argc) {
+            config.send_batch_size = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--rx-backend") == 0 && i + 1 < argc) {
+            if (!feedhandler::parseReceiveBackend(argv[++i], config.input_backend.type)) {
+                std::cerr << "Unknown receive backend: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--spin") == 0) {
+            config.run_loop.spin = true;
+        } else if (std::strcmp(argv[i], "--busy-poll") == 0 && i + 1 < argc) {
+            config.run_loop.busy_poll_us = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+            config.run_loop.cpu = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--fifo-priority") == 0 && i + 1 < argc) {
+            config.run_loop.fifo_priority = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            config.capture_file = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            config.metrics.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--book-cache") == 0 && i + 1 < argc) {
+            config.book_cache.name = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            config.checkpoint.file = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint-interval") == 0 && i + 1 < argc) {
+            config.checkpoint.interval_sec = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--restore") == 0) {
+            config.checkpoint.restore = true;
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay.file = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) {
+            replay.speed = std::atof(argv[++i]);
         } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
             printUsage(argv[0]);
             return 0;
@@ -50,6 +142,10 @@ int main(int argc, char* argv[]) {
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
 
+    if (!replay.file.empty()) {
+        return handler.replay(replay) ? 0 : 1;
+    }
+
     if (!handler.start()) {
         std::cerr << "Failed to start feed handler" << std::endl;
         return 1;
@@ -2,69 +2,203 @@
 
 namespace cme {
 
-void RecoveryManager::initSecurity(uint32_t security_id, uint32_t initial_seq) {
-    auto& state = states_[security_id];
+void IncrementalBuffer::reserve(size_t capacity) {
+    size_t slots = 0;
+    if (capacity > 0) {
+        slots = 1;
+        while (slots < capacity) slots <<= 1;
+    }
+    if (slots != entries_.size()) {
+        entries_.assign(slots, MDIncrementalRefreshEntry{});
+        mask_ = slots > 0 ? slots - 1 : 0;
+    }
+    clear();
+}
+
+bool IncrementalBuffer::push(const MDIncrementalRefreshEntry& entry) {
+    if (entries_.empty()) return false;
+
+    bool dropped = false;
+    if (size() == entries_.size()) {
+        head_++;  // Overwrite the oldest
+        dropped = true;
+    }
+    entries_[tail_ & mask_] = entry;
+    tail_++;
+    return !dropped;
+}
+
+void RecoveryManager::initSecurity(SecurityRecoveryState& state, uint32_t initial_seq) {
+    if (!state.tracked) {
+        state.tracked = true;
+        tracked_.push_back(&state);
+    }
     state.expected_rpt_seq = initial_seq;
     state.last_good_rpt_seq = initial_seq > 0 ? initial_seq - 1 : 0;
-    state.state = RecoveryState::Normal;
+    setState(state, RecoveryState::Normal);
+    state.recovery_started_ns = 0;
+    state.buffered_updates.clear();
 }
 
-bool RecoveryManager::onIncrementalMessage(uint32_t security_id, uint32_t rpt_seq) {
-    auto it = states_.find(security_id);
-    if (it == states_.end()) {
-        // First time seeing this security
-        initSecurity(security_id, rpt_seq + 1);
-        return true;
+void RecoveryManager::restoreSecurity(SecurityRecoveryState& state, uint32_t last_good_rpt_seq,
+                                      RecoveryState saved, uint64_t now_ns) {
+    initSecurity(state, last_good_rpt_seq + 1);
+
+    switch (saved) {
+        case RecoveryState::Normal:
+            break;
+        case RecoveryState::Suspect:
+            setState(state, RecoveryState::Suspect);
+            state.recovery_started_ns = now_ns;
+            break;
+        case RecoveryState::GapDetected:
+        case RecoveryState::Recovering:
+            enterGap(state, now_ns);
+            break;
     }
+}
 
-    auto& state = it->second;
+void RecoveryManager::setState(SecurityRecoveryState& state, RecoveryState next) {
+    bool was_normal = state.state == RecoveryState::Normal;
+    bool is_normal = next == RecoveryState::Normal;
+    if (was_normal && !is_normal) recovering_++;
+    if (!was_normal && is_normal) recovering_--;
+    state.state = next;
+}
+
+RecoveryManager::SeqCheck RecoveryManager::checkSequence(SecurityRecoveryState& state, uint32_t rpt_seq) {
+    // Multiple entries can share the same rpt_seq, so accept >= last_good
+    if (rpt_seq >= state.last_good_rpt_seq && rpt_seq <= state.expected_rpt_seq) {
+        // Valid sequence (same as last or expected next)
+        if (rpt_seq > state.last_good_rpt_seq) {
+            state.expected_rpt_seq = rpt_seq + 1;
+            state.last_good_rpt_seq = rpt_seq;
+        }
+        return SeqCheck::InOrder;
+    }
+    if (rpt_seq < state.last_good_rpt_seq) {
+        return SeqCheck::Stale;
+    }
+    return SeqCheck::Gap;  // rpt_seq > expected
+}
+
+void RecoveryManager::enterGap(SecurityRecoveryState& state, uint64_t now_ns) {
+    if (state.buffered_updates.capacity() == 0 && buffer_entries_ > 0) {
+        state.buffered_updates.reserve(buffer_entries_);  // First gap for this security
+    }
+    setState(state, RecoveryState::GapDetected);
+    state.gap_detected_time = 0;  // Will be set by caller with current time
+    if (state.recovery_started_ns == 0) {
+        state.recovery_started_ns = now_ns;  // A hole found during replay continues the outage
+    }
+    state.recovery_attempts++;
+    stats_.gaps_detected++;
+}
+
+void RecoveryManager::noteRecovered(SecurityRecoveryState& state, uint64_t now_ns) {
+    stats_.recoveries_completed++;
+    if (state.recovery_started_ns != 0 && now_ns >= state.recovery_started_ns) {
+        uint64_t elapsed = now_ns - state.recovery_started_ns;
+        stats_.recovery_time_total_ns += elapsed;
+        if (elapsed > stats_.recovery_time_max_ns) stats_.recovery_time_max_ns = elapsed;
+        stats_.recoveries_timed++;
+    }
+    state.recovery_started_ns = 0;
+}
+
+void RecoveryManager::buffer(SecurityRecoveryState& state, const MDIncrementalRefreshEntry& entry) {
+    if (state.buffered_updates.push(entry)) {
+        stats_.messages_buffered++;
+    } else {
+        stats_.buffer_overflows++;
+        stats_.messages_dropped++;
+    }
+}
+
+size_t RecoveryManager::onChannelGap(uint64_t now_ns) {
+    stats_.channel_gaps++;
+
+    size_t marked = 0;
+    for (auto* tracked : tracked_) {
+        auto& state = *tracked;
+        if (state.state != RecoveryState::Normal) continue;
+        setState(state, RecoveryState::Suspect);
+        state.gap_detected_time = 0;
+        state.recovery_started_ns = now_ns;
+        marked++;
+    }
+    return marked;
+}
+
+bool RecoveryManager::onIncrementalMessage(SecurityRecoveryState& state, const MDIncrementalRefreshEntry& entry,
+                                           uint64_t now_ns) {
+    if (!state.tracked) {
+        // First time seeing this security
+        if (entry.rpt_seq <= 1) {
+            initSecurity(state, entry.rpt_seq + 1);
+            return true;
+        }
+
+        // Joined mid-stream: earlier updates are missing, wait for a snapshot
+        initSecurity(state, entry.rpt_seq);
+        enterGap(state, now_ns);
+        buffer(state, entry);
+        return false;
+    }
 
     switch (state.state) {
         case RecoveryState::Normal:
-            // Multiple entries can share the same rpt_seq, so accept >= last_good
-            if (rpt_seq >= state.last_good_rpt_seq && rpt_seq <= state.expected_rpt_seq) {
-                // Valid sequence (same as last or expected next)
-                if (rpt_seq > state.last_good_rpt_seq) {
-                    state.expected_rpt_seq = rpt_seq + 1;
-                    state.last_good_rpt_seq = rpt_seq;
-                }
-                return true;
-            } else if (rpt_seq < state.last_good_rpt_seq) {
-                // Old message - discard
-                stats_.messages_dropped++;
-                return false;
-            } else {
-                // Gap detected: rpt_seq > expected
-                state.state = RecoveryState::GapDetected;
-                state.gap_detected_time = 0;  // Will be set by caller with current time
-                state.recovery_attempts++;
-                stats_.gaps_detected++;
-                return false;
+            switch (checkSequence(state, entry.rpt_seq)) {
+                case SeqCheck::InOrder:
+                    return true;
+                case SeqCheck::Stale:
+                    // Old message - discard
+                    stats_.messages_dropped++;
+                    return false;
+                case SeqCheck::Gap:
+                    // Keep the entry that exposed the gap, it is the first to replay
+                    enterGap(state, now_ns);
+                    buffer(state, entry);
+                    return false;
             }
+            return false;
+
+        case RecoveryState::Suspect:
+            switch (checkSequence(state, entry.rpt_seq)) {
+                case SeqCheck::InOrder:
+                    // rpt_seq is per security: contiguous means the lost packet was not ours
+                    setState(state, RecoveryState::Normal);
+                    state.recovery_started_ns = 0;
+                    stats_.suspects_cleared++;
+                    return true;
+                case SeqCheck::Stale:
+                    stats_.messages_dropped++;
+                    return false;
+                case SeqCheck::Gap:
+                    enterGap(state, now_ns);
+                    buffer(state, entry);
+                    return false;
+            }
+            return false;
 
         case RecoveryState::GapDetected:
         case RecoveryState::Recovering:
-            // Buffer messages during recovery
-            // In a full implementation, we'd store these
-            // For now, just drop them - snapshot will resync us
-            stats_.messages_dropped++;
+            // Held until the snapshot lands, then replayed on top of it
+            buffer(state, entry);
             return false;
     }
 
     return false;
 }
 
-bool RecoveryManager::onSnapshotMessage(uint32_t security_id, uint32_t snapshot_rpt_seq,
+bool RecoveryManager::onSnapshotMessage(SecurityRecoveryState& state, uint32_t snapshot_rpt_seq,
                                         uint32_t last_incr_seq) {
-    auto it = states_.find(security_id);
-    if (it == states_.end()) {
+    if (!state.tracked) {
         // Security not tracked - initialize from snapshot
-        initSecurity(security_id, snapshot_rpt_seq + 1);
+        initSecurity(state, snapshot_rpt_seq + 1);
         return true;
     }
 
-    auto& state = it->second;
-
     switch (state.state) {
         case RecoveryState::Normal:
             // Not in recovery - we might use snapshot to refresh anyway
@@ -74,10 +208,22 @@ bool RecoveryManager::onSnapshotMessage(uint32_t security_id, uint32_t snapshot_
             }
             return false;
 
+        case RecoveryState::Suspect:
+            // Quiet since the packet gap: the snapshot tells us whether we missed anything
+            if (snapshot_rpt_seq <= state.last_good_rpt_seq) {
+                setState(state, RecoveryState::Normal);
+                state.recovery_started_ns = 0;
+                stats_.suspects_cleared++;
+                return false;
+            }
+            setState(state, RecoveryState::Recovering);
+            state.snapshot_rpt_seq = snapshot_rpt_seq;
+            return true;
+
         case RecoveryState::GapDetected:
             // We were waiting for a snapshot
             // Accept it and transition to Recovering
-            state.state = RecoveryState::Recovering;
+            setState(state, RecoveryState::Recovering);
             state.snapshot_rpt_seq = snapshot_rpt_seq;
             return true;
 
@@ -93,75 +239,33 @@ bool RecoveryManager::onSnapshotMessage(uint32_t security_id, uint32_t snapshot_
     return false;
 }
 
-void RecoveryManager::completeRecovery(uint32_t security_id, uint32_t rpt_seq) {
-    auto it = states_.find(security_id);
-    if (it == states_.end()) {
-        return;
-    }
-
-    auto& state = it->second;
-    state.state = RecoveryState::Normal;
-    state.expected_rpt_seq = rpt_seq + 1;
-    state.last_good_rpt_seq = rpt_seq;
-    state.buffered_updates.clear();
-    stats_.recoveries_completed++;
-}
-
-void RecoveryManager::resetExpectedSeq(uint32_t security_id, uint32_t seq) {
-    auto& state = states_[security_id];
-    state.expected_rpt_seq = seq;
-    state.last_good_rpt_seq = seq > 0 ? seq - 1 : 0;
-    state.state = RecoveryState::Normal;
-    state.buffered_updates.clear();
-}
-
-bool RecoveryManager::needsRecovery() const {
-    for (const auto& pair : states_) {
-        if (pair.second.state != RecoveryState::Normal) {
-            return true;
-        }
-    }
-    return false;
+void RecoveryManager::resetExpectedSeq(SecurityRecoveryState& state, uint32_t seq) {
+    // Same as a fresh start: Normal at seq with the buffer emptied
+    initSecurity(state, seq);
 }
 
 std::vector<uint32_t> RecoveryManager::getRecoveringSecurities() const {
     std::vector<uint32_t> result;
-    for (const auto& pair : states_) {
-        if (pair.second.state != RecoveryState::Normal) {
-            result.push_back(pair.first);
+    for (const auto* state : tracked_) {
+        if (state->state != RecoveryState::Normal) {
+            result.push_back(state->security_id);
         }
     }
     return result;
 }
 
-RecoveryState RecoveryManager::getState(uint32_t security_id) const {
-    auto it = states_.find(security_id);
-    if (it == states_.end()) {
-        return RecoveryState::Normal;
-    }
-    return it->second.state;
-}
-
-uint32_t RecoveryManager::getExpectedRptSeq(uint32_t security_id) const {
-    auto it = states_.find(security_id);
-    if (it == states_.end()) {
-        return 1;
-    }
-    return it->second.expected_rpt_seq;
-}
-
 std::vector<uint32_t> RecoveryManager::checkTimeouts(uint64_t current_time, uint64_t timeout_ns) {
     std::vector<uint32_t> timed_out;
 
-    for (auto& pair : states_) {
-        auto& state = pair.second;
+    for (auto* tracked : tracked_) {
+        auto& state = *tracked;
         if (state.state != RecoveryState::Normal) {
             if (state.gap_detected_time == 0) {
                 // First time checking - record the time
                 state.gap_detected_time = current_time;
             } else if (current_time - state.gap_detected_time > timeout_ns) {
                 // Timeout - reset and wait for fresh snapshot
-                timed_out.push_back(pair.first);
+                timed_out.push_back(state.security_id);
                 state.recovery_attempts++;
                 state.gap_detected_time = current_time;  // Reset timeout
             }
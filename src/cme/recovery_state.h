@@ -1,7 +1,9 @@
 #pragma once
 
+#include "cme_protocol.h"
+
+#include <cstddef>
 #include <cstdint>
-#include <unordered_map>
 #include <vector>
 
 namespace cme {
@@ -11,60 +13,113 @@ enum class RecoveryState {
     Normal,         // Processing incrementals normally
     GapDetected,    // Gap detected, waiting for snapshot
     Recovering,     // Processing snapshot, buffering incrementals
+    Suspect,        // Packet lost channel-wide; unconfirmed until the next entry or snapshot
+};
+
+// Fixed-capacity FIFO of incrementals that arrived while a security was
+// recovering. Storage is allocated the first time the security gaps and kept,
+// so a channel of thousands of mostly quiet instruments does not pay for
+// thousands of buffers, and later gaps never touch the heap; when full the
+// oldest entry is dropped and replay sees the hole as a fresh gap.
+class IncrementalBuffer {
+public:
+    // Capacity is rounded up to a power of two (0 disables buffering)
+    void reserve(size_t capacity);
+
+    // Returns false if an entry had to be dropped to make room
+    bool push(const MDIncrementalRefreshEntry& entry);
+
+    size_t capacity() const { return entries_.size(); }
+    bool empty() const { return head_ == tail_; }
+    size_t size() const { return static_cast<size_t>(tail_ - head_); }
+    const MDIncrementalRefreshEntry& front() const { return entries_[head_ & mask_]; }
+    void pop() { head_++; }
+    void clear() { head_ = tail_ = 0; }
+
+private:
+    std::vector<MDIncrementalRefreshEntry> entries_;
+    uint64_t mask_ = 0;
+    uint64_t head_ = 0;
+    uint64_t tail_ = 0;
 };
 
-// Tracks recovery state for a single security
+// Tracks recovery state for a single security. Lives in the security's
+// registry record next to its book; the RecoveryManager keeps a pointer to
+// it from the first initSecurity(), so it must not move.
 struct SecurityRecoveryState {
+    uint32_t security_id = 0;
+    bool tracked = false;                   // Known to the RecoveryManager
     RecoveryState state = RecoveryState::Normal;
     uint32_t expected_rpt_seq = 1;          // Next expected rpt_seq
     uint32_t last_good_rpt_seq = 0;         // Last successfully processed
     uint32_t snapshot_rpt_seq = 0;          // rpt_seq from snapshot to sync to
     uint64_t gap_detected_time = 0;         // When gap was detected (for timeout)
+    uint64_t recovery_started_ns = 0;       // First gap of the current outage (time-to-recover)
     uint32_t recovery_attempts = 0;
 
-    // Buffered incrementals during recovery
-    struct BufferedUpdate {
-        uint32_t rpt_seq;
-        std::vector<uint8_t> data;
-    };
-    std::vector<BufferedUpdate> buffered_updates;
+    // Incrementals received since the gap, replayed over the snapshot
+    IncrementalBuffer buffered_updates;
 };
 
-// Manages recovery state for all securities
+// Runs the per-security recovery state machine. The states themselves are
+// owned by the caller (the SecurityRegistry), which resolves the security
+// once per entry and passes its state in, so no lookup happens here.
 class RecoveryManager {
 public:
-    RecoveryManager() = default;
-
-    // Called when incremental message arrives
-    // Returns true if message should be applied to book
-    // If false, message should be discarded or buffered
-    bool onIncrementalMessage(uint32_t security_id, uint32_t rpt_seq);
+    // Entries buffered per security while it waits for a snapshot
+    static constexpr size_t DEFAULT_BUFFER_ENTRIES = 4096;
+
+    explicit RecoveryManager(size_t buffer_entries = DEFAULT_BUFFER_ENTRIES)
+        : buffer_entries_(buffer_entries) {}
+
+    // Called when incremental entry arrives (now_ns: its arrival, CLOCK_REALTIME)
+    // Returns true if entry should be applied to book now
+    // If false, it was stale (discarded) or has been buffered for replay.
+    // A security first seen mid-stream (rpt_seq > 1, e.g. after a late join)
+    // starts in GapDetected: its book needs a snapshot before incrementals.
+    bool onIncrementalMessage(SecurityRecoveryState& state, const MDIncrementalRefreshEntry& entry,
+                              uint64_t now_ns);
+
+    // Packet lost on every line: any Normal security may have missed an
+    // update, including ones that will not trade again for a while. Marks
+    // them all Suspect in one pass. A suspect security whose next entry is
+    // in sequence lost nothing and returns to Normal; one whose next entry
+    // skips ahead enters GapDetected; one that stays quiet is settled by its
+    // snapshot. Returns the securities marked.
+    size_t onChannelGap(uint64_t now_ns);
 
     // Called when snapshot message arrives
     // Returns true if snapshot should be applied (we were waiting for it)
-    bool onSnapshotMessage(uint32_t security_id, uint32_t snapshot_rpt_seq, uint32_t last_incr_seq);
+    bool onSnapshotMessage(SecurityRecoveryState& state, uint32_t snapshot_rpt_seq, uint32_t last_incr_seq);
 
-    // Called after snapshot is applied, resumes incremental processing
-    void completeRecovery(uint32_t security_id, uint32_t rpt_seq);
+    // Called after snapshot is applied: resumes at the snapshot's rpt_seq and
+    // passes the buffered entries newer than it to apply, in order. Stops at
+    // the first hole in the buffer, which puts the security back in
+    // GapDetected with the rest still buffered. now_ns is the snapshot's
+    // arrival, for time-to-recover. Returns the entries replayed.
+    template <typename Fn>
+    size_t completeRecovery(SecurityRecoveryState& state, uint32_t rpt_seq, uint64_t now_ns, Fn&& apply);
 
     // Reset expected sequence (e.g., after channel reset)
-    void resetExpectedSeq(uint32_t security_id, uint32_t seq);
+    void resetExpectedSeq(SecurityRecoveryState& state, uint32_t seq);
 
-    // Initialize security with starting sequence
-    void initSecurity(uint32_t security_id, uint32_t initial_seq = 1);
+    // Initialize security with starting sequence (starts tracking it)
+    void initSecurity(SecurityRecoveryState& state, uint32_t initial_seq = 1);
 
-    // Check if any security needs recovery
-    bool needsRecovery() const;
+    // Warm start: track a security from a checkpoint taken at
+    // last_good_rpt_seq in the saved state. One that was waiting for a
+    // snapshot waits again (buffered entries are not checkpointed); a
+    // suspect one stays suspect.
+    void restoreSecurity(SecurityRecoveryState& state, uint32_t last_good_rpt_seq, RecoveryState saved,
+                         uint64_t now_ns);
+
+    // Check if any security needs recovery (O(1))
+    bool needsRecovery() const { return recovering_ > 0; }
+    size_t recoveringCount() const { return recovering_; }
 
     // Get list of securities currently in recovery
     std::vector<uint32_t> getRecoveringSecurities() const;
 
-    // Get state for a security
-    RecoveryState getState(uint32_t security_id) const;
-
-    // Get expected rpt_seq for security
-    uint32_t getExpectedRptSeq(uint32_t security_id) const;
-
     // Check and handle recovery timeout (returns securities that timed out)
     std::vector<uint32_t> checkTimeouts(uint64_t current_time, uint64_t timeout_ns = 5000000000ULL);
 
@@ -74,12 +129,71 @@ public:
         uint64_t recoveries_completed = 0;
         uint64_t messages_dropped = 0;
         uint64_t messages_buffered = 0;
+        uint64_t messages_replayed = 0;     // Buffered entries applied after a snapshot
+        uint64_t buffer_overflows = 0;      // Buffered entries lost to a full buffer
+
+        // Time to recover: first gap of an outage until the book is back in Normal
+        uint64_t recovery_time_total_ns = 0;
+        uint64_t recovery_time_max_ns = 0;
+        uint64_t recoveries_timed = 0;
+
+        uint64_t channel_gaps = 0;          // Packet gaps that marked the channel suspect
+        uint64_t suspects_cleared = 0;      // Suspect securities confirmed without a snapshot
     };
     const Stats& getStats() const { return stats_; }
 
 private:
-    std::unordered_map<uint32_t, SecurityRecoveryState> states_;
+    enum class SeqCheck { InOrder, Stale, Gap };
+
+    // Normal-state sequence check, advances the expected rpt_seq when in order
+    SeqCheck checkSequence(SecurityRecoveryState& state, uint32_t rpt_seq);
+    void setState(SecurityRecoveryState& state, RecoveryState next);
+    void enterGap(SecurityRecoveryState& state, uint64_t now_ns);
+    void noteRecovered(SecurityRecoveryState& state, uint64_t now_ns);
+    void buffer(SecurityRecoveryState& state, const MDIncrementalRefreshEntry& entry);
+
+    std::vector<SecurityRecoveryState*> tracked_;  // For the channel-wide passes
+    size_t buffer_entries_;
+    size_t recovering_ = 0;     // Securities not in Normal
     Stats stats_;
 };
 
+template <typename Fn>
+size_t RecoveryManager::completeRecovery(SecurityRecoveryState& state, uint32_t rpt_seq, uint64_t now_ns,
+                                         Fn&& apply) {
+    if (!state.tracked) {
+        return 0;
+    }
+
+    setState(state, RecoveryState::Normal);
+    state.expected_rpt_seq = rpt_seq + 1;
+    state.last_good_rpt_seq = rpt_seq;
+
+    // Catch up from the buffer: entries the snapshot already covers are
+    // skipped, the rest go through the same check as live incrementals
+    size_t replayed = 0;
+    auto& buffered = state.buffered_updates;
+    while (!buffered.empty()) {
+        const auto& entry = buffered.front();
+        if (entry.rpt_seq > rpt_seq) {
+            SeqCheck check = checkSequence(state, entry.rpt_seq);
+            if (check == SeqCheck::Gap) {
+                enterGap(state, now_ns);
+                break;
+            }
+            if (check == SeqCheck::InOrder) {
+                apply(entry);
+                replayed++;
+            }
+        }
+        buffered.pop();
+    }
+
+    stats_.messages_replayed += replayed;
+    if (state.state == RecoveryState::Normal) {
+        noteRecovered(state, now_ns);
+    }
+    return replayed;
+}
+
 } // namespace cme
@@ -0,0 +1,99 @@
+#include "security_registry.h"
+
+namespace cme {
+
+namespace {
+
+size_t roundUpPow2(size_t n) {
+    size_t p = 16;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+unsigned log2Pow2(size_t n) {
+    unsigned bits = 0;
+    while ((size_t{1} << bits) < n) bits++;
+    return bits;
+}
+
+} // namespace
+
+SecurityRegistry::SecurityRegistry(size_t capacity, size_t book_depth)
+    : book_depth_(book_depth) {
+    // Keep the table under its grow threshold at the expected instrument count
+    size_t slots = roundUpPow2(capacity + capacity / 4);
+    slots_.assign(slots, Slot{0, 0});
+    mask_ = slots - 1;
+    shift_ = 64 - log2Pow2(slots);
+    max_size_ = slots - slots / 8;
+}
+
+uint32_t SecurityRegistry::lookup(uint32_t security_id) const {
+    if (security_id == 0) return zero_index_;
+
+    size_t i = slotFor(security_id);
+    while (true) {
+        const Slot& slot = slots_[i];
+        if (slot.security_id == security_id) return slot.index;
+        if (slot.security_id == 0) return NOT_FOUND;
+        i = (i + 1) & mask_;
+    }
+}
+
+void SecurityRegistry::insertSlot(uint32_t security_id, uint32_t index) {
+    if (security_id == 0) {
+        zero_index_ = index;
+        return;
+    }
+
+    size_t i = slotFor(security_id);
+    while (slots_[i].security_id != 0) {
+        i = (i + 1) & mask_;
+    }
+    slots_[i] = Slot{security_id, index};
+}
+
+void SecurityRegistry::grow() {
+    size_t slots = slots_.size() * 2;
+    slots_.assign(slots, Slot{0, 0});
+    mask_ = slots - 1;
+    shift_ = 64 - log2Pow2(slots);
+    max_size_ = slots - slots / 8;
+
+    for (const auto& record : records_) {
+        insertSlot(record.security_id, record.index);
+    }
+}
+
+SecurityRecord& SecurityRegistry::findOrAdd(uint32_t security_id) {
+    if (SecurityRecord* found = find(security_id)) {
+        return *found;
+    }
+
+    if (records_.size() + 1 > max_size_) {
+        grow();
+    }
+
+    uint32_t index = static_cast<uint32_t>(records_.size());
+    records_.emplace_back(security_id, index, book_depth_);
+    insertSlot(security_id, index);
+
+    cached_id_ = security_id;
+    cached_ = &records_.back();
+    return records_.back();
+}
+
+SecurityRecord& SecurityRegistry::define(const SecurityDefinition& def) {
+    SecurityRecord& record = findOrAdd(def.security_id);
+    record.defined = true;
+    record.min_price_increment = def.min_price_increment;
+    record.book.setSymbol(def.symbol);
+    return record;
+}
+
+const char* SecurityRegistry::symbolOf(uint32_t security_id) {
+    SecurityRecord* record = find(security_id);
+    return record ? record->book.getSymbol() : "UNKNOWN";
+}
+
+} // namespace cme
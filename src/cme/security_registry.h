@@ -0,0 +1,123 @@
+#pragma once
+
+#include "cme_order_book.h"
+#include "cme_protocol.h"
+#include "recovery_state.h"
+#include "src/feedhandler/dirty_set.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace cme {
+
+// Everything the handler keeps per instrument, in one cache-line-aligned
+// record: an incremental entry resolves its security once and then touches
+// only this record for the sequence check, the book update and conflation.
+struct alignas(64) SecurityRecord {
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    SecurityRecord(uint32_t id, uint32_t dense_index, size_t book_depth)
+        : security_id(id), index(dense_index), book(id, book_depth) {
+        recovery.security_id = id;
+    }
+
+    uint32_t security_id;
+    uint32_t index;                     // Dense, in order of first sight
+    uint32_t conflation_slot = NO_SLOT; // ConflationTable slot, assigned on first publish
+    uint32_t cache_slot = NO_SLOT;      // BookCacheWriter slot, assigned once defined
+    bool defined = false;               // SecurityDefinition received
+    int64_t min_price_increment = 0;
+
+    SecurityRecoveryState recovery;
+    CmeOrderBook book;
+};
+
+// Instruments on the channel, built from SecurityDefinition messages (or
+// from the first entry that mentions an unknown security_id).
+//
+// Records are stored in first-sight order and never move, so dense indexes
+// and record pointers stay valid for the life of the registry. security_id
+// maps to its index through an open-addressing table (Fibonacci hashing,
+// linear probing, 7/8 load) with a one-entry cache in front, since the entries
+// of one message are normally for the same instrument. Single-threaded:
+// owned by the receive thread.
+class SecurityRegistry {
+public:
+    // A busy CME channel carries a few thousand instruments
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    // Every book is book_depth levels deep (see CmeOrderBook)
+    explicit SecurityRegistry(size_t capacity = DEFAULT_CAPACITY, size_t book_depth = CME_MAX_DEPTH);
+
+    // Record for security_id, nullptr if never seen
+    SecurityRecord* find(uint32_t security_id) {
+        if (security_id == cached_id_ && cached_) return cached_;
+        uint32_t index = lookup(security_id);
+        if (index == NOT_FOUND) return nullptr;
+        cached_id_ = security_id;
+        cached_ = &records_[index];
+        return cached_;
+    }
+
+    // Record for security_id, created (undefined) if never seen
+    SecurityRecord& findOrAdd(uint32_t security_id);
+
+    // Create or update the record from a SecurityDefinition
+    SecurityRecord& define(const SecurityDefinition& def);
+
+    // Symbol for logging ("UNKNOWN" if never seen)
+    const char* symbolOf(uint32_t security_id);
+
+    SecurityRecord& at(uint32_t index) { return records_[index]; }
+    size_t size() const { return records_.size(); }
+
+    // fn(SecurityRecord&) for every record, in index order
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        for (auto& record : records_) fn(record);
+    }
+
+    // Books changed since the last drain (conflation)
+    void markDirty(const SecurityRecord& record) { dirty_.mark(record.index); }
+
+    // fn(SecurityRecord&) for every record marked since the last drain, O(dirty)
+    template <typename Fn>
+    void drainDirty(Fn&& fn) {
+        dirty_.drain([&](uint32_t index) { fn(records_[index]); });
+    }
+
+    void clearDirty() { dirty_.clear(); }
+
+private:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    struct Slot {
+        uint32_t security_id;   // 0 = empty
+        uint32_t index;
+    };
+
+    size_t slotFor(uint32_t security_id) const {
+        return static_cast<size_t>((security_id * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+
+    uint32_t lookup(uint32_t security_id) const;
+    void insertSlot(uint32_t security_id, uint32_t index);
+    void grow();
+
+    std::deque<SecurityRecord> records_;
+    size_t book_depth_;
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    unsigned shift_ = 0;
+    size_t max_size_ = 0;   // Grow threshold (7/8 load)
+    uint32_t zero_index_ = NOT_FOUND;  // security_id 0 can't use the table
+
+    uint32_t cached_id_ = 0;
+    SecurityRecord* cached_ = nullptr;
+
+    feedhandler::DirtySet dirty_;
+};
+
+} // namespace cme
@@ -1,5 +1,6 @@
 #include "src/cme/cme_protocol.h"
 #include "src/cme/l2_sbe_messages.h"
+#include "src/feedhandler/book_cache.h"
 #include "src/feedhandler/multicast.h"
 
 #include <atomic>
@@ -10,6 +11,8 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 static std::atomic<bool> g_running{true};
 
@@ -89,6 +92,61 @@ void printOrderBook(const l2md::L2SnapshotDecoder& snap) {
     }
 }
 
+// Read the feed handler's shared-memory book cache instead of the feed:
+// once a second, the top of book of every instrument that changed
+int watchCache(const std::string& name, const std::string& filter_symbol) {
+    feedhandler::BookCacheReader cache(name);
+    while (g_running && !cache.open()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!g_running) return 0;
+
+    std::cout << "CME Consumer reading book cache " << name << std::endl;
+    if (!filter_symbol.empty()) {
+        std::cout << "Filtering for symbol: " << filter_symbol << std::endl;
+    }
+
+    std::vector<uint64_t> seen;
+    uint64_t reads = 0;
+    uint64_t read_ns = 0;
+    while (g_running) {
+        cache.refresh();
+        seen.resize(cache.size(), 0);
+        for (uint32_t slot = 0; slot < cache.size(); ++slot) {
+            if (cache.version(slot) == seen[slot]) continue;
+            if (!filter_symbol.empty() && filter_symbol != cache.symbol(slot)) continue;
+
+            feedhandler::CachedQuote quote;
+            auto start = std::chrono::steady_clock::now();
+            bool ok = cache.readQuote(slot, quote);
+            read_ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            reads++;
+            if (!ok) continue;
+            seen[slot] = quote.updates;
+
+            std::cout << cache.symbol(slot) << " @ " << formatTimestamp(quote.receive_ns)
+                      << "  " << std::setw(5) << quote.bid_quantity << " @ " << std::setw(10)
+                      << formatSbePrice(quote.bid_price) << "    " << std::setw(5) << quote.ask_quantity
+                      << " @ " << std::setw(10) << formatSbePrice(quote.ask_price)
+                      << "  (updates=" << quote.updates << ")" << std::endl;
+        }
+
+        if (!cache.writerRunning()) {
+            std::cout << "Feed handler closed the cache" << std::endl;
+            break;
+        }
+        for (int i = 0; i < 10 && g_running; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+    std::cout << "\nInstruments: " << cache.size() << ", quote reads: " << reads;
+    if (reads > 0) std::cout << " (" << read_ns / reads << " ns avg, timer included)";
+    std::cout << std::endl;
+    return 0;
+}
+
 void printUsage(const char* program) {
     std::cout << "Usage: " << program << " [options]\n"
               << "\nOptions:\n"
@@ -97,6 +155,7 @@ void printUsage(const char* program) {
               << "  --interface <ip>    Network interface (default: 0.0.0.0)\n"
               << "  --filter <symbol>   Only show this symbol\n"
               << "  --raw               Show raw SBE message details\n"
+              << "  --cache <name>      Read the handler's shared-memory book cache instead\n"
               << "  -h, --help          Show this help\n"
               << "\nSBE Schema: ID=" << l2md::SCHEMA_ID << ", Version=" << l2md::SCHEMA_VERSION << "\n"
               << std::endl;
@@ -133,6 +192,7 @@ int main(int argc, char* argv[]) {
     std::string interface = "0.0.0.0";
     std::string filter_symbol;
     bool show_raw = false;
+    std::string cache_name;
 
     for (int i = 1; i < argc; ++i) {
         if (std::strcmp(argv[i], "--group") == 0 && i + 1 < argc) {
@@ -145,6 +205,8 @@ int main(int argc, char* argv[]) {
             filter_symbol = argv[++i];
         } else if (std::strcmp(argv[i], "--raw") == 0) {
             show_raw = true;
+        } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_name = argv[++i];
         } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
             printUsage(argv[0]);
             return 0;
@@ -158,6 +220,10 @@ int main(int argc, char* argv[]) {
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
 
+    if (!cache_name.empty()) {
+        return watchCache(cache_name, filter_symbol);
+    }
+
     feedhandler::MulticastReceiver receiver(group, port, interface);
 
     if (!receiver.start()) {
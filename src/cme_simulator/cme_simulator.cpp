@@ -1,6 +1,8 @@
 #include "cme_simulator.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <thread>
@@ -70,6 +72,15 @@ bool CmeSimulator::start() {
     incremental_sender_ = std::make_unique<feedhandler::MulticastSender>(
         config_.incremental_group, config_.incremental_port, config_.interface);
 
+    if (config_.dual_feed) {
+        incremental_sender_b_ = std::make_unique<feedhandler::MulticastSender>(
+            config_.incremental_group_b, config_.incremental_port_b, config_.interface);
+        if (!incremental_sender_b_->start()) {
+            std::cerr << "Failed to start incremental line B sender" << std::endl;
+            return false;
+        }
+    }
+
     snapshot_sender_ = std::make_unique<feedhandler::MulticastSender>(
         config_.snapshot_group, config_.snapshot_port, config_.interface);
 
@@ -93,37 +104,61 @@ void CmeSimulator::stop() {
     if (incremental_sender_) {
         incremental_sender_->stop();
     }
+    if (incremental_sender_b_) {
+        incremental_sender_b_->stop();
+    }
     if (snapshot_sender_) {
         snapshot_sender_->stop();
     }
 }
 
 void CmeSimulator::initializeBooks() {
+    books_.resize(std::max<uint32_t>(config_.instruments, 1));
+
     // ESH26 - E-mini S&P 500
     books_[0].security_id = cme::SECURITY_ID_ESH26;
     books_[0].symbol = "ESH26";
     books_[0].initialize(45000000000LL, 2500000LL);  // $4500.00, $0.25 tick
+    if (books_.size() < 2) return;
 
     // NQM26 - E-mini NASDAQ
     books_[1].security_id = cme::SECURITY_ID_NQM26;
     books_[1].symbol = "NQM26";
     books_[1].initialize(180000000000LL, 2500000LL);  // $18000.00, $0.25 tick
+    if (books_.size() < 3) return;
 
     // CLK26 - Crude Oil
     books_[2].security_id = cme::SECURITY_ID_CLK26;
     books_[2].symbol = "CLK26";
     books_[2].initialize(750000000LL, 10000000LL);  // $75.00, $0.01 tick
+    if (books_.size() < 4) return;
 
     // GCZ26 - Gold
     books_[3].security_id = cme::SECURITY_ID_GCZ26;
     books_[3].symbol = "GCZ26";
     books_[3].initialize(20000000000LL, 1000000LL);  // $2000.00, $0.10 tick
+
+    // Synthetic instruments to fill out a full-size channel
+    for (size_t i = 4; i < books_.size(); ++i) {
+        char symbol[24];
+        std::snprintf(symbol, sizeof(symbol), "SIM%05zu", i);
+        books_[i].security_id = 2000 + static_cast<uint32_t>(i);
+        books_[i].symbol = symbol;
+        books_[i].initialize(1000000000LL + static_cast<int64_t>(i % 100) * 100000000LL, 2500000LL);
+    }
 }
 
 void CmeSimulator::run() {
     std::cout << "CME Simulator starting..." << std::endl;
     std::cout << "  Incremental: " << config_.incremental_group << ":" << config_.incremental_port << std::endl;
+    if (config_.dual_feed) {
+        std::cout << "  Incremental B: " << config_.incremental_group_b << ":" << config_.incremental_port_b << std::endl;
+    }
+    if (config_.line_loss_pct > 0.0) {
+        std::cout << "  Line loss: " << config_.line_loss_pct << "% per line" << std::endl;
+    }
     std::cout << "  Snapshot: " << config_.snapshot_group << ":" << config_.snapshot_port << std::endl;
+    std::cout << "  Instruments: " << books_.size() << std::endl;
 
     sendSecurityDefinitions();
 
@@ -158,11 +193,20 @@ void CmeSimulator::run() {
         std::this_thread::sleep_for(update_interval);
     }
 
+    if (config_.line_loss_pct > 0.0) {
+        std::cout << "Line drops: A=" << line_drops_[0] << " B=" << line_drops_[1] << std::endl;
+    }
     std::cout << "CME Simulator stopped" << std::endl;
 }
 
 void CmeSimulator::sendSecurityDefinitions() {
+    size_t sent = 0;
     for (auto& book : books_) {
+        // Pace a large channel's definitions so receivers don't overrun
+        if (++sent % 256 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
         std::memset(send_buffer_.data(), 0, send_buffer_.size());
 
         auto* pkt = reinterpret_cast<cme::PacketHeader*>(send_buffer_.data());
@@ -178,24 +222,37 @@ void CmeSimulator::sendSecurityDefinitions() {
         msg->security_trading_status = 17;  // Trading
 
         size_t packet_size = sizeof(cme::PacketHeader) + sizeof(cme::SecurityDefinition);
-        incremental_sender_->send(send_buffer_.data(), packet_size);
+        sendIncremental(send_buffer_.data(), packet_size);
 
-        std::cout << "Sent SecurityDefinition for " << book.symbol
-                  << " (id=" << book.security_id << ")" << std::endl;
+        if (books_.size() <= 16) {
+            std::cout << "Sent SecurityDefinition for " << book.symbol
+                      << " (id=" << book.security_id << ")" << std::endl;
+        }
     }
 }
 
 void CmeSimulator::sendIncrementalUpdate() {
     // Pick a random book and update it
-    std::uniform_int_distribution<int> book_dist(0, 3);
-    int book_idx = book_dist(rng_);
+    std::uniform_int_distribution<size_t> book_dist(0, books_.size() - 1);
+    size_t book_idx = book_dist(rng_);
     auto& book = books_[book_idx];
 
     book.randomUpdate(rng_);
 
     // Build incremental entries for updated levels
     std::vector<cme::MDIncrementalRefreshEntry> entries;
+    appendTopOfBook(book, entries);
+
+    // Simulate gap if configured
+    if (config_.simulate_gaps && (incr_packet_seq_ % config_.gap_frequency) == 0) {
+        incr_packet_seq_++;  // Skip a sequence number
+        std::cout << "SIMULATED GAP at incr_seq=" << incr_packet_seq_ << std::endl;
+    }
 
+    sendIncrementalPacket(entries);
+}
+
+void CmeSimulator::appendTopOfBook(const SimulatedBook& book, std::vector<cme::MDIncrementalRefreshEntry>& entries) {
     // Send top 3 levels for both sides
     for (int i = 0; i < 3; ++i) {
         cme::MDIncrementalRefreshEntry bid_entry = {};
@@ -220,14 +277,6 @@ void CmeSimulator::sendIncrementalUpdate() {
         ask_entry.number_of_orders = book.asks[i].order_count;
         entries.push_back(ask_entry);
     }
-
-    // Simulate gap if configured
-    if (config_.simulate_gaps && (incr_packet_seq_ % config_.gap_frequency) == 0) {
-        incr_packet_seq_++;  // Skip a sequence number
-        std::cout << "SIMULATED GAP at incr_seq=" << incr_packet_seq_ << std::endl;
-    }
-
-    sendIncrementalPacket(entries);
 }
 
 void CmeSimulator::sendIncrementalPacket(const std::vector<cme::MDIncrementalRefreshEntry>& entries) {
@@ -251,7 +300,21 @@ void CmeSimulator::sendIncrementalPacket(const std::vector<cme::MDIncrementalRef
     }
 
     size_t packet_size = sizeof(cme::PacketHeader) + cme::calcIncrementalSize(entries.size());
-    incremental_sender_->send(send_buffer_.data(), packet_size);
+    sendIncremental(send_buffer_.data(), packet_size);
+}
+
+void CmeSimulator::sendIncremental(const uint8_t* data, size_t len) {
+    std::uniform_real_distribution<double> loss(0.0, 100.0);
+    feedhandler::MulticastSender* lines[2] = {incremental_sender_.get(), incremental_sender_b_.get()};
+
+    for (size_t line = 0; line < 2; ++line) {
+        if (!lines[line]) continue;
+        if (config_.line_loss_pct > 0.0 && loss(rng_) < config_.line_loss_pct) {
+            line_drops_[line]++;
+            continue;
+        }
+        lines[line]->send(data, len);
+    }
 }
 
 void CmeSimulator::sendSnapshots() {
@@ -261,17 +324,17 @@ void CmeSimulator::sendSnapshots() {
 }
 
 void CmeSimulator::sendSnapshotPacket(const SimulatedBook& book) {
-    std::memset(send_buffer_.data(), 0, send_buffer_.size());
+    // Own buffer: the load-test sender thread publishes snapshots too
+    uint8_t buffer[sizeof(cme::PacketHeader) + sizeof(cme::MDSnapshotFullRefresh) + 10 * sizeof(cme::MDSnapshotEntry)] = {};
 
     // Packet header
-    auto* pkt = reinterpret_cast<cme::PacketHeader*>(send_buffer_.data());
+    auto* pkt = reinterpret_cast<cme::PacketHeader*>(buffer);
     pkt->msg_seq_num = ++snap_packet_seq_;
     pkt->sending_time = getCurrentTimeNs();
 
     // Snapshot message
     uint8_t num_entries = 10;  // 5 bids + 5 asks
-    auto* msg = reinterpret_cast<cme::MDSnapshotFullRefresh*>(
-        send_buffer_.data() + sizeof(cme::PacketHeader));
+    auto* msg = reinterpret_cast<cme::MDSnapshotFullRefresh*>(buffer + sizeof(cme::PacketHeader));
     msg->init(num_entries);
     msg->last_msg_seq_num_processed = incr_packet_seq_;  // Reference incremental sequence
     msg->security_id = book.security_id;
@@ -297,7 +360,124 @@ void CmeSimulator::sendSnapshotPacket(const SimulatedBook& book) {
     }
 
     size_t packet_size = sizeof(cme::PacketHeader) + cme::calcSnapshotSize(num_entries);
-    snapshot_sender_->send(send_buffer_.data(), packet_size);
+    snapshot_sender_->send(buffer, packet_size);
+}
+
+void CmeSimulator::runLoad(const simulator::LoadConfig& load) {
+    std::cout << "CME Simulator load test starting..." << std::endl;
+    std::cout << "  Incremental: " << config_.incremental_group << ":" << config_.incremental_port << std::endl;
+    if (config_.dual_feed) {
+        std::cout << "  Incremental B: " << config_.incremental_group_b << ":" << config_.incremental_port_b << std::endl;
+    }
+    std::cout << "  Snapshot: " << config_.snapshot_group << ":" << config_.snapshot_port << std::endl;
+    std::cout << "  Instruments: " << books_.size() << std::endl;
+    if (config_.simulate_gaps || config_.line_loss_pct > 0.0) {
+        std::cout << "  (gap and line loss simulation do not apply to load tests)" << std::endl;
+    }
+
+    sendSecurityDefinitions();
+
+    // One sender thread for every instrument, on both lines with dual feed.
+    // Threads with their own sockets would interleave a line's packets out of
+    // msg_seq_num order, and the handler reports every such hole as a gap.
+    load_shards_.assign(1, LoadShard{});
+    for (size_t i = 0; i < books_.size(); ++i) {
+        load_shards_[0].books.push_back(i);
+    }
+
+    auto gen_start = std::chrono::steady_clock::now();
+    std::vector<simulator::LoadStream> streams(1, simulator::LoadStream(load.datagram_bytes));
+    generateLoadStream(load_shards_[0], streams[0], load.stream_messages, load.datagram_bytes);
+
+    size_t datagrams = streams[0].size();
+    size_t bytes = streams[0].bytes();
+    uint64_t entries = streams[0].messages();
+    auto gen_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - gen_start).count();
+    std::cout << "Pre-generated " << entries << " MD entries in " << datagrams << " packets ("
+              << bytes / (1024 * 1024) << " MB) in " << gen_ms << " ms" << std::endl;
+
+    std::vector<simulator::LoadTarget> targets;
+    targets.push_back({config_.incremental_group, config_.incremental_port, config_.interface, 1});
+    if (config_.dual_feed) {
+        targets.push_back({config_.incremental_group_b, config_.incremental_port_b, config_.interface, 1});
+    }
+
+    simulator::LoadConfig run_config = load;
+    run_config.threads = 1;
+    simulator::LoadGenerator generator(run_config, targets);
+    generator.run(streams, running_, [this](size_t thread, uint8_t* data, size_t len, uint64_t pass) {
+        prepareLoadDatagram(thread, data, len, pass);
+    });
+
+    std::cout << "CME Simulator stopped, incr_seq=" << incr_packet_seq_ << ", snap_seq=" << snap_packet_seq_
+              << std::endl;
+}
+
+void CmeSimulator::generateLoadStream(LoadShard& shard, simulator::LoadStream& stream, size_t entries,
+                                      size_t datagram_bytes) {
+    // As many whole updates as fit one MDIncrementalRefreshBook in a datagram
+    constexpr size_t ENTRIES_PER_UPDATE = 6;
+    size_t header = sizeof(cme::PacketHeader) + sizeof(cme::MDIncrementalRefreshBook);
+    size_t room = datagram_bytes > header ? (datagram_bytes - header) / sizeof(cme::MDIncrementalRefreshEntry) : 0;
+    size_t updates_per_packet = std::max<size_t>(std::min<size_t>(room, 255) / ENTRIES_PER_UPDATE, 1);
+
+    std::uniform_int_distribution<size_t> book_dist(0, shard.books.size() - 1);
+    std::vector<cme::MDIncrementalRefreshEntry> packet_entries;
+    size_t generated = 0;
+    while (generated < entries) {
+        packet_entries.clear();
+        for (size_t u = 0; u < updates_per_packet; ++u) {
+            auto& book = books_[shard.books[book_dist(rng_)]];
+            book.randomUpdate(rng_);
+            appendTopOfBook(book, packet_entries);
+        }
+
+        // Header fields are stamped at send time
+        auto count = static_cast<uint8_t>(packet_entries.size());
+        size_t packet_size = sizeof(cme::PacketHeader) + cme::calcIncrementalSize(count);
+        uint8_t* out = stream.appendDatagram(packet_size, count);
+        std::memset(out, 0, packet_size);
+        auto* msg = reinterpret_cast<cme::MDIncrementalRefreshBook*>(out + sizeof(cme::PacketHeader));
+        msg->init(count);
+        std::memcpy(msg->getEntries(), packet_entries.data(), count * sizeof(cme::MDIncrementalRefreshEntry));
+        generated += count;
+    }
+
+    // Books started at rpt_seq 0, so one pass advances each by its current rpt_seq
+    for (size_t idx : shard.books) {
+        shard.cycle[books_[idx].security_id] = books_[idx].rpt_seq;
+    }
+}
+
+void CmeSimulator::prepareLoadDatagram(size_t thread, uint8_t* data, size_t len, uint64_t pass) {
+    LoadShard& shard = load_shards_[thread];
+
+    if (pass != shard.pass) {
+        // Stream wrapped: the books are back in their end-of-stream state.
+        // Publish it so a handler that fell behind can recover.
+        shard.pass = pass;
+        for (size_t idx : shard.books) {
+            SimulatedBook book = books_[idx];
+            book.rpt_seq = shard.cycle[book.security_id] * static_cast<uint32_t>(pass);
+            sendSnapshotPacket(book);
+        }
+    }
+
+    auto* pkt = reinterpret_cast<cme::PacketHeader*>(data);
+    pkt->msg_seq_num = ++incr_packet_seq_;
+    pkt->sending_time = getCurrentTimeNs();
+
+    auto* msg = reinterpret_cast<cme::MDIncrementalRefreshBook*>(data + sizeof(cme::PacketHeader));
+    msg->transact_time = pkt->sending_time;
+    if (pass == 0 || len < sizeof(cme::PacketHeader) + sizeof(cme::MDIncrementalRefreshBook)) return;
+
+    // Each pass was stamped once already; advance rpt_seq by one more cycle
+    auto* entries = msg->getEntries();
+    for (uint8_t i = 0; i < msg->entries_header.num_in_group; ++i) {
+        auto it = shard.cycle.find(entries[i].security_id);
+        if (it != shard.cycle.end()) entries[i].rpt_seq += it->second;
+    }
 }
 
 uint64_t CmeSimulator::getCurrentTimeNs() {
@@ -2,6 +2,7 @@
 
 #include "src/cme/cme_protocol.h"
 #include "src/feedhandler/multicast.h"
+#include "src/simulator/load_generator.h"
 
 #include <array>
 #include <atomic>
@@ -9,6 +10,7 @@
 #include <memory>
 #include <random>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace cme_simulator {
@@ -42,6 +44,9 @@ public:
     struct Config {
         std::string incremental_group = cme::CME_INCREMENTAL_GROUP;
         uint16_t incremental_port = cme::CME_INCREMENTAL_PORT;
+        bool dual_feed = false;             // Also publish incrementals on line B
+        std::string incremental_group_b = cme::CME_INCREMENTAL_GROUP_B;
+        uint16_t incremental_port_b = cme::CME_INCREMENTAL_PORT_B;
         std::string snapshot_group = cme::CME_SNAPSHOT_GROUP;
         uint16_t snapshot_port = cme::CME_SNAPSHOT_PORT;
         std::string interface = "0.0.0.0";
@@ -51,6 +56,8 @@ public:
 
         bool simulate_gaps = false;         // Simulate packet gaps for testing
         uint32_t gap_frequency = 100;       // Every N packets, simulate a gap
+        double line_loss_pct = 0.0;         // Drop this share of incrementals, independently per line
+        uint32_t instruments = 4;           // Named futures first, then synthetic SIMnnnnn books
     };
 
     explicit CmeSimulator(const Config& config);
@@ -60,6 +67,12 @@ public:
     void stop();
     void run();
 
+    // Saturating load test: pre-generate load.stream_messages MD entries and
+    // send them in a loop at the load profile's rates, from one thread so
+    // msg_seq_num stays in order on each line (load.threads is ignored).
+    // Call after start(). Blocking.
+    void runLoad(const simulator::LoadConfig& load);
+
     uint32_t getIncrPacketSeq() const { return incr_packet_seq_; }
     uint32_t getSnapPacketSeq() const { return snap_packet_seq_; }
 
@@ -69,25 +82,46 @@ private:
     void sendIncrementalUpdate();
     void sendSnapshots();
 
+    // Overlays for the top 3 levels of both sides, as one update
+    static void appendTopOfBook(const SimulatedBook& book, std::vector<cme::MDIncrementalRefreshEntry>& entries);
+
+    // Send an incremental-channel packet on every line, applying line loss
+    void sendIncremental(const uint8_t* data, size_t len);
+
     // Build and send packet
     void sendIncrementalPacket(const std::vector<cme::MDIncrementalRefreshEntry>& entries);
     void sendSnapshotPacket(const SimulatedBook& book);
 
     uint64_t getCurrentTimeNs();
 
+    // Load test: the instruments one sender thread owns
+    struct LoadShard {
+        std::vector<size_t> books;                       // Indexes into books_
+        std::unordered_map<uint32_t, uint32_t> cycle;    // security_id -> rpt_seq advance per stream pass
+        uint64_t pass = 0;
+    };
+
+    void generateLoadStream(LoadShard& shard, simulator::LoadStream& stream, size_t entries, size_t datagram_bytes);
+
+    // Stamp sequence numbers and times, carry rpt_seq over stream wraps
+    void prepareLoadDatagram(size_t thread, uint8_t* data, size_t len, uint64_t pass);
+
     Config config_;
 
     std::unique_ptr<feedhandler::MulticastSender> incremental_sender_;
+    std::unique_ptr<feedhandler::MulticastSender> incremental_sender_b_;
     std::unique_ptr<feedhandler::MulticastSender> snapshot_sender_;
 
-    std::array<SimulatedBook, 4> books_;
+    std::vector<SimulatedBook> books_;
 
-    uint32_t incr_packet_seq_ = 0;   // Incremental feed sequence
-    uint32_t snap_packet_seq_ = 0;   // Snapshot feed sequence
+    std::atomic<uint32_t> incr_packet_seq_{0};   // Incremental feed sequence
+    std::atomic<uint32_t> snap_packet_seq_{0};   // Snapshot feed sequence
+    uint64_t line_drops_[2] = {0, 0};
     std::atomic<bool> running_{false};
 
     std::mt19937 rng_;
     std::vector<uint8_t> send_buffer_;
+    std::vector<LoadShard> load_shards_;
 };
 
 } // namespace cme_simulator
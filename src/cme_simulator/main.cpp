@@ -22,12 +22,26 @@ void printUsage(const char* program) {
               << "  --snapshot-interval <ms>  Snapshot interval in ms (default: 1000)\n"
               << "  --simulate-gaps       Simulate packet gaps for testing recovery\n"
               << "  --gap-frequency <n>   Gap every N packets (default: 100)\n"
+              << "  --dual-feed           Also publish incrementals on line B\n"
+              << "  --line-loss <pct>     Drop this % of incrementals, independently per line\n"
+              << "  --instruments <n>     Instruments on the channel (default: 4)\n"
+              << "\nLoad test (pre-generated packets, many entries per packet, sendmmsg):\n"
+              << "  --load                Run a saturating load test instead of the paced feed\n"
+              << "  --load-profile <spec> max | steady | open | <ms>:<rate>[,...] (default: max;\n"
+              << "                        rates are MD entries/s, steady/open scale from --rate)\n"
+              << "  --duration <s>        Stop after s seconds (default: until interrupted)\n"
+              << "  --load-messages <n>   MD entries pre-generated before sending (default: 2097152)\n"
+              << "  --packet-bytes <n>    Pack entries into packets up to n bytes (default: 1400)\n"
+              << "  --batch <n>           Packets per sendmmsg call (default: 64)\n"
               << "  -h, --help            Show this help\n"
               << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     cme_simulator::CmeSimulator::Config config;
+    simulator::LoadConfig load;
+    bool load_mode = false;
+    const char* load_profile = "max";
 
     for (int i = 1; i < argc; ++i) {
         if (std::strcmp(argv[i], "--interface") == 0 && i + 1 < argc) {
@@ -40,6 +54,24 @@ int main(int argc, char* argv[]) {
             config.simulate_gaps = true;
         } else if (std::strcmp(argv[i], "--gap-frequency") == 0 && i + 1 < argc) {
             config.gap_frequency = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--dual-feed") == 0) {
+            config.dual_feed = true;
+        } else if (std::strcmp(argv[i], "--line-loss") == 0 && i + 1 < argc) {
+            config.line_loss_pct = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--instruments") == 0 && i + 1 < argc) {
+            config.instruments = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--load") == 0) {
+            load_mode = true;
+        } else if (std::strcmp(argv[i], "--load-profile") == 0 && i + 1 < argc) {
+            load_profile = argv[++i];
+        } else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            load.duration_s = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--load-messages") == 0 && i + 1 < argc) {
+            load.stream_messages = static_cast<size_t>(std::atoll(argv[++i]));
+        } else if (std::strcmp(argv[i], "--packet-bytes") == 0 && i + 1 < argc) {
+            load.datagram_bytes = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            load.batch = static_cast<size_t>(std::atoi(argv[++i]));
         } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
             printUsage(argv[0]);
             return 0;
@@ -50,6 +82,14 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (load_mode && !simulator::parseLoadProfile(load_profile, config.updates_per_second, load.profile)) {
+        return 1;
+    }
+    if (!load_mode && config.updates_per_second == 0) {
+        std::cerr << "--rate must be positive" << std::endl;
+        return 1;
+    }
+
     cme_simulator::CmeSimulator simulator(config);
     g_simulator = &simulator;
 
@@ -61,7 +101,11 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    simulator.run();
+    if (load_mode) {
+        simulator.runLoad(load);
+    } else {
+        simulator.run();
+    }
 
     return 0;
 }
@@ -0,0 +1,253 @@
+#include "book_cache.h"
+
+#include "tsc_clock.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace feedhandler {
+
+namespace {
+
+// Slots start on their own cache line after the header
+constexpr size_t SLOTS_OFFSET = 64;
+static_assert(sizeof(BookCacheHeader) <= SLOTS_OFFSET, "BookCacheHeader outgrew its cache line");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared-memory seqlocks need lock-free atomics");
+
+size_t segmentSize(size_t capacity) {
+    return SLOTS_OFFSET + capacity * sizeof(BookCacheSlot);
+}
+
+} // namespace
+
+// ============================================================================
+// BookCacheWriter
+// ============================================================================
+
+BookCacheWriter::BookCacheWriter(const BookCacheConfig& config, int32_t price_exponent)
+    : config_(config), price_exponent_(price_exponent) {
+}
+
+BookCacheWriter::~BookCacheWriter() {
+    close();
+}
+
+bool BookCacheWriter::open() {
+    if (isOpen()) return true;
+    if (config_.capacity == 0 || config_.capacity > UINT32_MAX) {
+        std::cerr << "Bad book cache capacity " << config_.capacity << std::endl;
+        return false;
+    }
+    
+    // A segment left by an earlier run stays with the readers still mapping
+    // it; new readers find this one
+    shm_unlink(config_.name.c_str());
+    int fd = shm_open(config_.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create book cache " << config_.name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    // ftruncate zero-fills: every slot starts unclaimed
+    size_t size = segmentSize(config_.capacity);
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        std::cerr << "Failed to size book cache " << config_.name << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(config_.name.c_str());
+        return false;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Failed to map book cache " << config_.name << ": " << strerror(errno) << std::endl;
+        shm_unlink(config_.name.c_str());
+        return false;
+    }
+    
+    size_ = size;
+    header_ = new (base) BookCacheHeader();
+    slots_ = reinterpret_cast<BookCacheSlot*>(static_cast<uint8_t*>(base) + SLOTS_OFFSET);
+    header_->version = BOOK_CACHE_VERSION;
+    header_->capacity = static_cast<uint32_t>(config_.capacity);
+    header_->slot_size = sizeof(BookCacheSlot);
+    header_->price_exponent = price_exponent_;
+    header_->writer_pid = static_cast<uint32_t>(getpid());
+    header_->created_ns = wallClockNs();
+    header_->state.store(static_cast<uint32_t>(BookCacheState::Running), std::memory_order_relaxed);
+    header_->claimed.store(0, std::memory_order_relaxed);
+    header_->magic.store(BOOK_CACHE_MAGIC, std::memory_order_release);
+    refused_ = 0;
+    
+    std::cout << "  Book cache: " << config_.name << " (" << config_.capacity << " instruments, "
+              << size / (1024 * 1024) << " MB)" << std::endl;
+    return true;
+}
+
+void BookCacheWriter::close() {
+    if (!isOpen()) return;
+    
+    header_->state.store(static_cast<uint32_t>(BookCacheState::Stopped), std::memory_order_release);
+    munmap(header_, size_);
+    shm_unlink(config_.name.c_str());
+    header_ = nullptr;
+    slots_ = nullptr;
+    size_ = 0;
+}
+
+uint32_t BookCacheWriter::addSlot(const char* symbol, size_t length, uint32_t instrument_id) {
+    uint32_t slot = header_->claimed.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= header_->capacity) {
+        refused_.fetch_add(1, std::memory_order_relaxed);
+        return NO_SLOT;
+    }
+    
+    BookCacheSlot* entry = new (&slots_[slot]) BookCacheSlot();
+    entry->instrument_id = instrument_id;
+    std::memcpy(entry->symbol, symbol, std::min(length, BOOK_CACHE_SYMBOL_SIZE - 1));
+    entry->ready.store(1, std::memory_order_release);
+    return slot;
+}
+
+void BookCacheWriter::update(uint32_t slot, const OrderBookSnapshot& snap, uint64_t receive_ns) {
+    update(slot, snap.timestamp, receive_ns, [&snap](CachedBook& book) {
+        auto copySide = [](const BookSide& side, std::array<CachedLevel, BOOK_CACHE_DEPTH>& out) {
+            uint8_t count = static_cast<uint8_t>(std::min<size_t>(side.count, BOOK_CACHE_DEPTH));
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = CachedLevel{side.levels[i].price, static_cast<int32_t>(side.levels[i].quantity),
+                                     side.levels[i].order_count};
+            }
+            return count;
+        };
+        book.bid_count = copySide(snap.bids, book.bids);
+        book.ask_count = copySide(snap.asks, book.asks);
+        book.last_price = snap.last_price;
+        book.last_quantity = static_cast<int32_t>(snap.last_quantity);
+        book.total_volume = snap.total_volume;
+    });
+}
+
+size_t BookCacheWriter::used() const {
+    if (!isOpen()) return 0;
+    return std::min<size_t>(header_->claimed.load(std::memory_order_relaxed), header_->capacity);
+}
+
+void BookCacheWriter::quoteOf(const CachedBook& book, CachedQuote& quote) {
+    if (book.bid_count > 0) {
+        quote.bid_price = book.bids[0].price;
+        quote.bid_quantity = book.bids[0].quantity;
+    }
+    if (book.ask_count > 0) {
+        quote.ask_price = book.asks[0].price;
+        quote.ask_quantity = book.asks[0].quantity;
+    }
+    quote.exchange_ns = book.exchange_ns;
+    quote.receive_ns = book.receive_ns;
+    quote.updates = book.updates;
+}
+
+// ============================================================================
+// BookCacheReader
+// ============================================================================
+
+BookCacheReader::BookCacheReader(const std::string& name)
+    : name_(name) {
+}
+
+BookCacheReader::~BookCacheReader() {
+    close();
+}
+
+bool BookCacheReader::open() {
+    if (isOpen()) return true;
+    
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    
+    struct stat st{};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < SLOTS_OFFSET) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+    
+    const auto* header = static_cast<const BookCacheHeader*>(base);
+    if (header->magic.load(std::memory_order_acquire) != BOOK_CACHE_MAGIC ||
+        header->version != BOOK_CACHE_VERSION || header->slot_size != sizeof(BookCacheSlot) ||
+        size < segmentSize(header->capacity)) {
+        std::cerr << "Book cache " << name_ << " is not initialised or has another layout" << std::endl;
+        munmap(base, size);
+        return false;
+    }
+    
+    size_ = size;
+    header_ = header;
+    slots_ = reinterpret_cast<const BookCacheSlot*>(static_cast<const uint8_t*>(base) + SLOTS_OFFSET);
+    scale_ = std::pow(10.0, header_->price_exponent);
+    refresh();
+    return true;
+}
+
+void BookCacheReader::close() {
+    if (!isOpen()) return;
+    
+    munmap(const_cast<BookCacheHeader*>(header_), size_);
+    header_ = nullptr;
+    slots_ = nullptr;
+    size_ = 0;
+    known_ = 0;
+    symbols_.clear();
+    index_.clear();
+}
+
+bool BookCacheReader::writerRunning() const {
+    return header_->state.load(std::memory_order_acquire) == static_cast<uint32_t>(BookCacheState::Running);
+}
+
+size_t BookCacheReader::refresh() {
+    size_t claimed = std::min<size_t>(header_->claimed.load(std::memory_order_acquire), header_->capacity);
+    
+    // Slots become ready in claim order per writer; stop at the first one
+    // still being keyed and pick it up next time
+    size_t added = 0;
+    while (known_ < claimed && slots_[known_].ready.load(std::memory_order_acquire) != 0) {
+        const BookCacheSlot& slot = slots_[known_];
+        symbols_.emplace_back(slot.symbol, strnlen(slot.symbol, BOOK_CACHE_SYMBOL_SIZE));
+        index_.emplace(symbols_.back(), static_cast<uint32_t>(known_));
+        known_++;
+        added++;
+    }
+    return added;
+}
+
+uint32_t BookCacheReader::find(const std::string& symbol) {
+    auto it = index_.find(symbol);
+    if (it != index_.end()) return it->second;
+    if (refresh() == 0) return NO_SLOT;
+    it = index_.find(symbol);
+    return it != index_.end() ? it->second : NO_SLOT;
+}
+
+bool BookCacheReader::readQuote(uint32_t slot, CachedQuote& out) const {
+    const auto& quote = slots_[slot].quote;
+    if (quote.version() == 0) return false;
+    return quote.tryLoad(out, READ_ATTEMPTS);
+}
+
+bool BookCacheReader::readBook(uint32_t slot, CachedBook& out) const {
+    const auto& book = slots_[slot].book;
+    if (book.version() == 0) return false;
+    return book.tryLoad(out, READ_ATTEMPTS);
+}
+
+} // namespace feedhandler
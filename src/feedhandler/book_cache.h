@@ -0,0 +1,212 @@
+#pragma once
+
+#include "market_data.h"
+#include "seqlock.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace feedhandler {
+
+// Last-value cache in shared memory: the latest book and top of book of
+// every instrument, for co-located readers that would otherwise join the
+// output group and decode every message.
+//
+// The segment (shm_open name) is a BookCacheHeader followed by capacity
+// BookCacheSlots. A slot is claimed once per instrument, its key written,
+// then marked ready; after that its owning thread rewrites two seqlocks on
+// every change, the quote (one cache line, the common read) and the book to
+// BOOK_CACHE_DEPTH levels. Several writer threads may share a segment as
+// long as each slot has one. Writers never wait for a reader; readers retry
+// a read that overlapped a write and give up after a bounded number of
+// attempts, so a writer dying mid-update cannot hang them.
+//
+// Prices are the feed's integer mantissas; BookCacheHeader::price_exponent
+// says where the decimal point goes (-4 for ITCH, -7 for CME).
+
+constexpr uint32_t BOOK_CACHE_MAGIC = 0x3143564c;   // "LVC1"
+constexpr uint32_t BOOK_CACHE_VERSION = 1;
+constexpr size_t BOOK_CACHE_DEPTH = 10;
+constexpr size_t BOOK_CACHE_SYMBOL_SIZE = 24;
+
+struct BookCacheConfig {
+    std::string name;           // Segment name, e.g. "/itch_books" (empty = off)
+    size_t capacity = 16384;    // Instruments; more are counted and left out
+};
+
+struct CachedLevel {
+    int64_t price;
+    int32_t quantity;
+    uint32_t order_count;
+};
+
+struct CachedQuote {
+    int64_t bid_price;          // 0 with bid_quantity 0: side empty
+    int64_t ask_price;
+    int32_t bid_quantity;
+    int32_t ask_quantity;
+    uint64_t exchange_ns;       // Exchange timestamp of the last change
+    uint64_t receive_ns;        // Arrival of the packet that made it (CLOCK_REALTIME)
+    uint64_t updates;           // Changes written to this slot so far
+};
+
+struct CachedBook {
+    uint64_t exchange_ns;
+    uint64_t receive_ns;
+    uint64_t updates;
+    int64_t last_price;
+    int32_t last_quantity;
+    uint8_t bid_count;
+    uint8_t ask_count;
+    uint64_t total_volume;
+    std::array<CachedLevel, BOOK_CACHE_DEPTH> bids;
+    std::array<CachedLevel, BOOK_CACHE_DEPTH> asks;
+};
+
+enum class BookCacheState : uint32_t {
+    Running = 1,
+    Stopped = 2,                // Writer closed the segment; data is final
+};
+
+struct BookCacheHeader {
+    std::atomic<uint32_t> magic;        // Stored last: the rest is initialised
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slot_size;                 // sizeof(BookCacheSlot), a layout check
+    int32_t price_exponent;
+    uint32_t writer_pid;
+    uint64_t created_ns;                // CLOCK_REALTIME
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> claimed;      // Slots handed out (may pass capacity)
+};
+
+struct alignas(64) BookCacheSlot {
+    std::atomic<uint32_t> ready;        // Key below is written
+    uint32_t instrument_id;             // stock_locate / security_id
+    char symbol[BOOK_CACHE_SYMBOL_SIZE];
+    alignas(64) SeqLock<CachedQuote> quote;
+    alignas(64) SeqLock<CachedBook> book;
+};
+
+class BookCacheWriter {
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    
+    BookCacheWriter(const BookCacheConfig& config, int32_t price_exponent);
+    ~BookCacheWriter();
+    
+    // Non-copyable
+    BookCacheWriter(const BookCacheWriter&) = delete;
+    BookCacheWriter& operator=(const BookCacheWriter&) = delete;
+    
+    // Create the segment, replacing one left by an earlier run
+    bool open();
+    
+    // Mark the segment stopped and remove it; readers still attached keep
+    // the last values. Unmaps the slots: only once every writer thread has
+    // made its last addSlot() / update(), never from under a running loop.
+    void close();
+    
+    bool isOpen() const { return header_ != nullptr; }
+    
+    // Any writer thread: slot for a new instrument, NO_SLOT once the cache
+    // is full
+    uint32_t addSlot(const char* symbol, size_t length, uint32_t instrument_id);
+    
+    // Slot's owning thread: fill(CachedBook&) rewrites the book in place
+    // (levels, counts, trade fields); the quote is derived from its top
+    template <typename Fn>
+    void update(uint32_t slot, uint64_t exchange_ns, uint64_t receive_ns, Fn&& fill) {
+        BookCacheSlot& entry = slots_[slot];
+        CachedQuote quote{};
+        entry.book.write([&](CachedBook& book) {
+            fill(book);
+            book.exchange_ns = exchange_ns;
+            book.receive_ns = receive_ns;
+            book.updates++;
+            quoteOf(book, quote);
+        });
+        entry.quote.store(quote);
+    }
+    
+    // ITCH book snapshot (4-decimal prices)
+    void update(uint32_t slot, const OrderBookSnapshot& snap, uint64_t receive_ns);
+    
+    size_t used() const;
+    uint64_t refused() const { return refused_.load(std::memory_order_relaxed); }
+
+private:
+    static void quoteOf(const CachedBook& book, CachedQuote& quote);
+    
+    BookCacheConfig config_;
+    int32_t price_exponent_;
+    size_t size_ = 0;                   // Mapped bytes
+    BookCacheHeader* header_ = nullptr;
+    BookCacheSlot* slots_ = nullptr;
+    std::atomic<uint64_t> refused_{0};  // Instruments past capacity
+};
+
+// Reader side, for consumers in other processes. Not thread-safe: one per
+// reading thread (they are cheap, the segment is mapped once per reader).
+class BookCacheReader {
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    
+    // Overlapped reads retried before readQuote() / readBook() give up
+    static constexpr unsigned READ_ATTEMPTS = 64;
+    
+    explicit BookCacheReader(const std::string& name);
+    ~BookCacheReader();
+    
+    // Non-copyable
+    BookCacheReader(const BookCacheReader&) = delete;
+    BookCacheReader& operator=(const BookCacheReader&) = delete;
+    
+    // Map the segment read-only. False if it does not exist (yet) or was
+    // written by an incompatible build.
+    bool open();
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+    
+    // The writer has not closed the segment. After a writer restart the
+    // old segment stays stopped; close() and open() again to follow it.
+    bool writerRunning() const;
+    int32_t priceExponent() const { return header_->price_exponent; }
+    double toDouble(int64_t price) const { return static_cast<double>(price) * scale_; }
+    
+    // Slot for symbol, NO_SLOT if it is not in the cache (yet). Picks up
+    // instruments added since the last call.
+    uint32_t find(const std::string& symbol);
+    
+    // Slots known so far (refresh() to pick up new ones), in claim order
+    size_t size() const { return known_; }
+    size_t refresh();
+    const char* symbol(uint32_t slot) const { return symbols_[slot].c_str(); }
+    uint32_t instrumentId(uint32_t slot) const { return slots_[slot].instrument_id; }
+    
+    // Latest values of a known slot. False if nothing was written to it yet
+    // or a write kept it busy for READ_ATTEMPTS tries.
+    bool readQuote(uint32_t slot, CachedQuote& out) const;
+    bool readBook(uint32_t slot, CachedBook& out) const;
+    
+    // Changes written to a slot so far, without copying it
+    uint64_t version(uint32_t slot) const { return slots_[slot].quote.version(); }
+
+private:
+    std::string name_;
+    size_t size_ = 0;
+    const BookCacheHeader* header_ = nullptr;
+    const BookCacheSlot* slots_ = nullptr;
+    double scale_ = 1.0;
+    
+    size_t known_ = 0;
+    std::vector<std::string> symbols_;
+    std::unordered_map<std::string, uint32_t> index_;
+};
+
+} // namespace feedhandler
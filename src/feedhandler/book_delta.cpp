@@ -0,0 +1,123 @@
+#include "book_delta.h"
+
+#include <cstring>
+
+namespace feedhandler {
+
+namespace {
+
+const PriceLevel* findPrice(const BookSide& side, uint32_t price) {
+    for (uint8_t i = 0; i < side.count; ++i) {
+        if (side.levels[i].price == price) return &side.levels[i];
+    }
+    return nullptr;
+}
+
+size_t diffRemovals(const BookSide& prev, const BookSide& cur, char side, LevelUpdate* out) {
+    size_t n = 0;
+    for (uint8_t i = 0; i < prev.count; ++i) {
+        if (!findPrice(cur, prev.levels[i].price)) {
+            out[n++] = LevelUpdate{prev.levels[i].price, 0, 0, side};
+        }
+    }
+    return n;
+}
+
+size_t diffChanges(const BookSide& prev, const BookSide& cur, char side, LevelUpdate* out) {
+    size_t n = 0;
+    for (uint8_t i = 0; i < cur.count; ++i) {
+        const PriceLevel& level = cur.levels[i];
+        const PriceLevel* old = findPrice(prev, level.price);
+        if (!old || old->quantity != level.quantity || old->order_count != level.order_count) {
+            out[n++] = LevelUpdate{level.price, level.quantity, level.order_count, side};
+        }
+    }
+    return n;
+}
+
+void applyUpdate(BookSide& side, const LevelUpdate& update, bool descending) {
+    uint8_t count = side.count;
+    uint8_t pos = 0;
+    while (pos < count && side.levels[pos].price != update.price) ++pos;
+    
+    if (update.quantity == 0) {
+        if (pos == count) return;
+        for (uint8_t i = pos; i + 1 < count; ++i) side.levels[i] = side.levels[i + 1];
+        side.count--;
+        return;
+    }
+    
+    PriceLevel level{update.price, update.quantity, update.order_count};
+    if (pos < count) {
+        side.levels[pos] = level;
+        return;
+    }
+    
+    // New price: insert in priority order, dropping whatever falls off the end
+    pos = 0;
+    while (pos < count && (descending ? side.levels[pos].price > update.price
+                                      : side.levels[pos].price < update.price)) {
+        ++pos;
+    }
+    if (pos >= MAX_DEPTH) return;
+    
+    uint8_t last = count < MAX_DEPTH ? count : MAX_DEPTH - 1;
+    for (uint8_t i = last; i > pos; --i) side.levels[i] = side.levels[i - 1];
+    side.levels[pos] = level;
+    if (count < MAX_DEPTH) side.count++;
+}
+
+} // namespace
+
+size_t diffBooks(const OrderBookSnapshot& prev, const OrderBookSnapshot& cur, LevelUpdate* out) {
+    size_t n = 0;
+    n += diffRemovals(prev.bids, cur.bids, 'B', out + n);
+    n += diffRemovals(prev.asks, cur.asks, 'S', out + n);
+    n += diffChanges(prev.bids, cur.bids, 'B', out + n);
+    n += diffChanges(prev.asks, cur.asks, 'S', out + n);
+    return n;
+}
+
+size_t encodeBookDelta(const OrderBookSnapshot& prev, const OrderBookSnapshot& cur,
+                       uint64_t prev_sequence, uint8_t* buffer) {
+    LevelUpdate updates[MAX_LEVEL_UPDATES];
+    size_t count = diffBooks(prev, cur, updates);
+    
+    bool trade_changed = cur.last_price != prev.last_price ||
+                         cur.last_quantity != prev.last_quantity ||
+                         cur.total_volume != prev.total_volume;
+    if (count == 0 && !trade_changed) return 0;
+    
+    BookDelta delta{};
+    std::memcpy(delta.symbol, cur.symbol, sizeof(delta.symbol));
+    delta.timestamp = cur.timestamp;
+    delta.sequence = cur.sequence;
+    delta.prev_sequence = prev_sequence;
+    delta.last_price = cur.last_price;
+    delta.last_quantity = cur.last_quantity;
+    delta.total_volume = cur.total_volume;
+    delta.update_count = static_cast<uint8_t>(count);
+    
+    std::memcpy(buffer, &delta, sizeof(delta));
+    std::memcpy(buffer + sizeof(delta), updates, count * sizeof(LevelUpdate));
+    return sizeof(delta) + count * sizeof(LevelUpdate);
+}
+
+void applyBookDelta(OrderBookSnapshot& book, const BookDelta& delta, const LevelUpdate* updates) {
+    for (uint8_t i = 0; i < delta.update_count; ++i) {
+        const LevelUpdate& update = updates[i];
+        if (update.side == 'B') {
+            applyUpdate(book.bids, update, true);
+        } else {
+            applyUpdate(book.asks, update, false);
+        }
+    }
+    
+    book.timestamp = delta.timestamp;
+    book.sequence = delta.sequence;
+    book.last_price = delta.last_price;
+    book.last_quantity = delta.last_quantity;
+    book.total_volume = delta.total_volume;
+}
+
+} // namespace feedhandler
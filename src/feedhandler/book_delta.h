@@ -0,0 +1,34 @@
+#pragma once
+
+#include "market_data.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace feedhandler {
+
+// Conflated delta encoding, shared by the publisher and receivers.
+//
+// Deltas are keyed by price rather than level position, so a new best level
+// costs one update instead of shifting every level below it.
+
+// Each side can lose every old level and gain every new one
+constexpr size_t MAX_LEVEL_UPDATES = 4 * MAX_DEPTH;
+
+// Largest encoded BookDelta payload
+constexpr size_t MAX_BOOK_DELTA_SIZE = sizeof(BookDelta) + MAX_LEVEL_UPDATES * sizeof(LevelUpdate);
+
+// Level updates turning prev into cur, removals first. out needs
+// MAX_LEVEL_UPDATES entries. Returns the number written.
+size_t diffBooks(const OrderBookSnapshot& prev, const OrderBookSnapshot& cur, LevelUpdate* out);
+
+// Encode cur as a delta against prev into buffer (MAX_BOOK_DELTA_SIZE bytes).
+// Returns the payload length, or 0 when nothing changed.
+size_t encodeBookDelta(const OrderBookSnapshot& prev, const OrderBookSnapshot& cur,
+                       uint64_t prev_sequence, uint8_t* buffer);
+
+// Apply updates to book, keeping each side in priority order and at most
+// MAX_DEPTH levels. Copies sequence and trade fields from the delta.
+void applyBookDelta(OrderBookSnapshot& book, const BookDelta& delta, const LevelUpdate* updates);
+
+} // namespace feedhandler
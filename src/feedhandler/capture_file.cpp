@@ -0,0 +1,409 @@
+#include "capture_file.h"
+
+#include "itch_protocol.h"
+#include "tsc_clock.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace feedhandler {
+
+namespace {
+
+// Record-side pcap magics (the writer always uses PCAP_MAGIC_NS in host order)
+constexpr uint32_t PCAP_MAGIC_US = 0xa1b2c3d4;
+constexpr uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+constexpr uint32_t PCAPNG_MAGIC = 0x0a0d0d0a;
+
+constexpr uint32_t LINKTYPE_ETHERNET = 1;
+constexpr uint32_t LINKTYPE_RAW = 101;
+constexpr uint32_t LINKTYPE_LINUX_SLL = 113;
+constexpr uint32_t LINKTYPE_IPV4 = 228;
+constexpr uint32_t LINKTYPE_LINUX_SLL2 = 276;
+
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+constexpr uint16_t ETHERTYPE_QINQ = 0x88a8;
+constexpr uint8_t IPPROTO_UDP_NUMBER = 17;
+
+constexpr uint32_t PCAP_SNAPLEN = 65535;
+constexpr size_t WRITE_BUFFER_BYTES = size_t{1} << 20;
+
+#pragma pack(push, 1)
+struct PcapFileHeader {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t network;
+};
+
+struct PcapRecordHeader {
+    uint32_t ts_sec;
+    uint32_t ts_frac;           // Microseconds or nanoseconds, per magic
+    uint32_t incl_len;
+    uint32_t orig_len;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(PcapFileHeader) == 24, "pcap file header is 24 bytes");
+static_assert(sizeof(PcapRecordHeader) == 16, "pcap record header is 16 bytes");
+
+uint16_t readBe16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+void writeBe16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+uint16_t ipChecksum(const uint8_t* header, size_t length) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < length; i += 2) sum += readBe16(header + i);
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return static_cast<uint16_t>(~sum);
+}
+
+} // namespace
+
+// ============================================================================
+// CaptureWriter
+// ============================================================================
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+bool CaptureWriter::open(const std::string& path) {
+    close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Failed to open capture file " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    buffer_.resize(WRITE_BUFFER_BYTES);
+    std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+    
+    PcapFileHeader header{};
+    header.magic = PCAP_MAGIC_NS;
+    header.version_major = 2;
+    header.version_minor = 4;
+    header.snaplen = PCAP_SNAPLEN;
+    header.network = LINKTYPE_ETHERNET;
+    if (std::fwrite(&header, sizeof(header), 1, file_) != 1) {
+        std::cerr << "Failed to write capture file " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CaptureWriter::close() {
+    if (!file_) return;
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+int CaptureWriter::addFeed(const std::string& group, uint16_t port) {
+    in_addr addr{};
+    if (inet_pton(AF_INET, group.c_str(), &addr) != 1) addr.s_addr = 0;
+    uint32_t ip = ntohl(addr.s_addr);
+    
+    Feed feed{};
+    uint8_t* eth = feed.headers;
+    // Multicast MAC for the group (01:00:5e + low 23 bits), locally administered source
+    const uint8_t dst_mac[6] = {0x01, 0x00, 0x5e, static_cast<uint8_t>((ip >> 16) & 0x7f),
+                                static_cast<uint8_t>(ip >> 8), static_cast<uint8_t>(ip)};
+    const uint8_t src_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+    std::memcpy(eth, dst_mac, 6);
+    std::memcpy(eth + 6, src_mac, 6);
+    writeBe16(eth + 12, ETHERTYPE_IPV4);
+    
+    // Source address is not known to the receiver, so it is left 0.0.0.0
+    uint8_t* ip_header = eth + 14;
+    ip_header[0] = 0x45;            // IPv4, 20-byte header
+    ip_header[8] = 1;               // TTL
+    ip_header[9] = IPPROTO_UDP_NUMBER;
+    std::memcpy(ip_header + 16, &addr.s_addr, 4);
+    
+    uint8_t* udp = ip_header + 20;
+    writeBe16(udp, port);
+    writeBe16(udp + 2, port);
+    
+    feeds_.push_back(feed);
+    return static_cast<int>(feeds_.size() - 1);
+}
+
+void CaptureWriter::write(int feed, const Datagram& dgram) {
+    if (!file_ || feed < 0 || static_cast<size_t>(feed) >= feeds_.size()) return;
+    
+    size_t length = std::min<size_t>(dgram.length, PCAP_SNAPLEN - HEADERS);
+    uint64_t ts = dgram.rx_timestamp_ns ? dgram.rx_timestamp_ns : wallClockNs();
+    
+    PcapRecordHeader record;
+    record.ts_sec = static_cast<uint32_t>(ts / 1000000000ULL);
+    record.ts_frac = static_cast<uint32_t>(ts % 1000000000ULL);
+    record.incl_len = static_cast<uint32_t>(HEADERS + length);
+    record.orig_len = static_cast<uint32_t>(HEADERS + dgram.length);
+    
+    uint8_t headers[HEADERS];
+    std::memcpy(headers, feeds_[feed].headers, HEADERS);
+    uint8_t* ip_header = headers + 14;
+    writeBe16(ip_header + 2, static_cast<uint16_t>(20 + 8 + length));
+    writeBe16(ip_header + 4, ip_id_++);
+    writeBe16(ip_header + 10, ipChecksum(ip_header, 20));
+    writeBe16(ip_header + 20 + 4, static_cast<uint16_t>(8 + length));
+    
+    if (std::fwrite(&record, sizeof(record), 1, file_) != 1 ||
+        std::fwrite(headers, HEADERS, 1, file_) != 1 ||
+        (length > 0 && std::fwrite(dgram.data, length, 1, file_) != 1)) {
+        errors_++;
+        return;
+    }
+    datagrams_++;
+}
+
+// ============================================================================
+// CaptureReader
+// ============================================================================
+
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+bool CaptureReader::open(const std::string& path) {
+    close();
+    stats_ = Stats{};
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open capture " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        std::cerr << "Capture " << path << " is empty or unreadable" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Failed to mmap capture " << path << ": " << std::strerror(errno) << std::endl;
+        size_ = 0;
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(map);
+    madvise(map, size_, MADV_SEQUENTIAL);
+    
+    uint32_t magic = 0;
+    if (size_ >= 4) std::memcpy(&magic, data_, 4);
+    if (magic == PCAPNG_MAGIC) {
+        std::cerr << path << " is pcapng; convert it with: editcap -F pcap <in> <out>" << std::endl;
+        close();
+        return false;
+    }
+    if (size_ >= 2 && data_[0] == 0x1f && data_[1] == 0x8b) {
+        std::cerr << path << " is gzip-compressed; decompress it first" << std::endl;
+        close();
+        return false;
+    }
+    if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS ||
+        magic == __builtin_bswap32(PCAP_MAGIC_US) || magic == __builtin_bswap32(PCAP_MAGIC_NS)) {
+        return openPcap(path);
+    }
+    
+    // Binary ITCH: the first length prefix must match its message type's size
+    if (size_ >= 3) {
+        size_t first = static_cast<size_t>(readBe16(data_)) + 2;
+        if (first == itch::getMessageSize(static_cast<itch::MessageType>(data_[2]))) {
+            format_ = Format::ItchBinary;
+            return true;
+        }
+    }
+    
+    std::cerr << path << " is neither a pcap capture nor a binary ITCH file" << std::endl;
+    close();
+    return false;
+}
+
+bool CaptureReader::openPcap(const std::string& path) {
+    if (size_ < sizeof(PcapFileHeader)) {
+        std::cerr << path << ": truncated pcap header" << std::endl;
+        close();
+        return false;
+    }
+    uint32_t magic;
+    std::memcpy(&magic, data_, 4);
+    swapped_ = magic == __builtin_bswap32(PCAP_MAGIC_US) || magic == __builtin_bswap32(PCAP_MAGIC_NS);
+    nanosecond_ = magic == PCAP_MAGIC_NS || magic == __builtin_bswap32(PCAP_MAGIC_NS);
+    link_type_ = read32(data_ + offsetof(PcapFileHeader, network)) & 0xffff;
+    
+    switch (link_type_) {
+        case LINKTYPE_ETHERNET:
+        case LINKTYPE_RAW:
+        case LINKTYPE_LINUX_SLL:
+        case LINKTYPE_IPV4:
+        case LINKTYPE_LINUX_SLL2:
+            break;
+        default:
+            std::cerr << path << ": unsupported pcap link type " << link_type_ << std::endl;
+            close();
+            return false;
+    }
+    
+    format_ = Format::Pcap;
+    offset_ = sizeof(PcapFileHeader);
+    return true;
+}
+
+void CaptureReader::close() {
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    offset_ = 0;
+}
+
+const char* CaptureReader::formatName() const {
+    if (format_ == Format::ItchBinary) return "binary ITCH";
+    return nanosecond_ ? "pcap (ns)" : "pcap (us)";
+}
+
+uint32_t CaptureReader::read32(const uint8_t* p) const {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return swapped_ ? __builtin_bswap32(v) : v;
+}
+
+bool CaptureReader::next(CaptureRecord& record) {
+    if (!data_) return false;
+    bool found = format_ == Format::Pcap ? nextPcap(record) : nextItch(record);
+    if (found) {
+        stats_.records++;
+        stats_.bytes += record.length;
+    }
+    return found;
+}
+
+bool CaptureReader::nextPcap(CaptureRecord& record) {
+    while (offset_ + sizeof(PcapRecordHeader) <= size_) {
+        const uint8_t* header = data_ + offset_;
+        uint32_t ts_sec = read32(header);
+        uint32_t ts_frac = read32(header + 4);
+        uint32_t incl_len = read32(header + 8);
+        uint32_t orig_len = read32(header + 12);
+        
+        const uint8_t* frame = header + sizeof(PcapRecordHeader);
+        if (offset_ + sizeof(PcapRecordHeader) + incl_len > size_) {
+            stats_.skipped++;   // Capture cut off mid-record
+            offset_ = size_;
+            return false;
+        }
+        offset_ += sizeof(PcapRecordHeader) + incl_len;
+        
+        if (incl_len < orig_len || !udpPayload(frame, incl_len, record)) {
+            stats_.skipped++;
+            continue;
+        }
+        record.timestamp_ns = static_cast<uint64_t>(ts_sec) * 1000000000ULL +
+                              (nanosecond_ ? ts_frac : static_cast<uint64_t>(ts_frac) * 1000);
+        record.messages = 1;
+        return true;
+    }
+    return false;
+}
+
+bool CaptureReader::udpPayload(const uint8_t* frame, size_t length, CaptureRecord& record) const {
+    size_t offset = 0;
+    uint16_t ethertype = ETHERTYPE_IPV4;
+    
+    switch (link_type_) {
+        case LINKTYPE_ETHERNET:
+            if (length < 14) return false;
+            ethertype = readBe16(frame + 12);
+            offset = 14;
+            while ((ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ) && offset + 4 <= length) {
+                ethertype = readBe16(frame + offset + 2);
+                offset += 4;
+            }
+            break;
+        case LINKTYPE_LINUX_SLL:
+            if (length < 16) return false;
+            ethertype = readBe16(frame + 14);
+            offset = 16;
+            break;
+        case LINKTYPE_LINUX_SLL2:
+            if (length < 20) return false;
+            ethertype = readBe16(frame);
+            offset = 20;
+            break;
+        default:    // Raw IPv4
+            break;
+    }
+    if (ethertype != ETHERTYPE_IPV4 || offset + 20 > length) return false;
+    
+    const uint8_t* ip = frame + offset;
+    size_t ihl = static_cast<size_t>(ip[0] & 0x0f) * 4;
+    if ((ip[0] >> 4) != 4 || ihl < 20 || ip[9] != IPPROTO_UDP_NUMBER) return false;
+    // Fragments (MF set or non-zero offset) cannot be reassembled here
+    if ((readBe16(ip + 6) & 0x3fff) != 0) return false;
+    
+    size_t ip_len = std::min<size_t>(readBe16(ip + 2), length - offset);
+    if (ihl + 8 > ip_len) return false;
+    
+    const uint8_t* udp = ip + ihl;
+    size_t udp_len = std::min<size_t>(readBe16(udp + 4), ip_len - ihl);
+    if (udp_len < 8) return false;
+    
+    record.data = udp + 8;
+    record.length = udp_len - 8;
+    record.dst_port = readBe16(udp + 2);
+    return true;
+}
+
+bool CaptureReader::nextItch(CaptureRecord& record) {
+    size_t start = offset_;
+    uint32_t messages = 0;
+    uint64_t timestamp = 0;
+    
+    // Whole messages up to ITCH_RECORD_BYTES (at least one)
+    while (offset_ + 2 <= size_) {
+        size_t msg_len = readBe16(data_ + offset_);
+        if (msg_len == 0 || offset_ + 2 + msg_len > size_) {
+            stats_.skipped++;   // Corrupt or truncated tail
+            offset_ = size_;
+            break;
+        }
+        if (messages > 0 && offset_ + 2 + msg_len - start > ITCH_RECORD_BYTES) break;
+        
+        // Header: type(1) locate(2) tracking(2) timestamp(6, big-endian ns since midnight)
+        if (messages == 0 && msg_len >= 11) {
+            const uint8_t* ts = data_ + offset_ + 2 + 5;
+            for (int i = 0; i < 6; ++i) timestamp = (timestamp << 8) | ts[i];
+        }
+        offset_ += 2 + msg_len;
+        messages++;
+    }
+    if (messages == 0) return false;
+    
+    record.data = data_ + start;
+    record.length = offset_ - start;
+    record.timestamp_ns = timestamp;
+    record.dst_port = 0;
+    record.messages = messages;
+    return true;
+}
+
+} // namespace feedhandler
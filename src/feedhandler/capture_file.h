@@ -0,0 +1,133 @@
+#pragma once
+
+#include "packet_source.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace feedhandler {
+
+// Records received datagrams to a pcap file (nanosecond timestamps,
+// Ethernet link type), so captures open in tcpdump / Wireshark and replay
+// through CaptureReader. Each datagram is wrapped in synthesized Ethernet,
+// IPv4 and UDP headers addressed to its feed's multicast group and port,
+// which is how a replay tells the feeds of a multi-feed handler apart.
+//
+// Writes go through a large stdio buffer on the receive thread: a syscall
+// per buffer-full, not per datagram.
+class CaptureWriter {
+public:
+    CaptureWriter() = default;
+    ~CaptureWriter();
+    
+    // Non-copyable
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+    
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return file_ != nullptr; }
+    
+    // Register a destination; returns the feed id write() takes
+    int addFeed(const std::string& group, uint16_t port);
+    
+    // Datagrams without an RX timestamp are stamped with the current time
+    void write(int feed, const Datagram& dgram);
+    
+    uint64_t datagramsWritten() const { return datagrams_; }
+    uint64_t writeErrors() const { return errors_; }
+
+private:
+    static constexpr size_t HEADERS = 14 + 20 + 8;   // Ethernet + IPv4 + UDP
+    
+    struct Feed {
+        uint8_t headers[HEADERS];
+    };
+    
+    std::FILE* file_ = nullptr;
+    std::vector<char> buffer_;
+    std::vector<Feed> feeds_;
+    uint16_t ip_id_ = 0;
+    uint64_t datagrams_ = 0;
+    uint64_t errors_ = 0;
+};
+
+// One datagram (pcap) or run of messages (binary ITCH) from a capture
+struct CaptureRecord {
+    const uint8_t* data;
+    size_t length;
+    uint64_t timestamp_ns;      // pcap: capture time; binary ITCH: first message's ns since midnight
+    uint16_t dst_port;          // pcap only (0 for binary ITCH)
+    uint32_t messages;          // ITCH messages in the record (1 for a pcap datagram)
+};
+
+// Sequential reader over an mmap'd capture. Formats, detected from the
+// first bytes:
+//   - pcap, microsecond or nanosecond, either byte order, with Ethernet
+//     (VLAN tags skipped), Linux cooked (v1 / v2) or raw IPv4 link types.
+//     Yields the UDP payload of every unfragmented IPv4/UDP packet.
+//   - NASDAQ binary ITCH 5.0 (the daily BinaryFILE: 2-byte big-endian
+//     length + message, back to back). Yields about a datagram's worth of
+//     whole messages at a time in the same length-prefixed form the
+//     handler receives on the wire.
+// pcapng and gzip'd files are rejected with a hint to convert them first.
+class CaptureReader {
+public:
+    enum class Format : uint8_t { Pcap, ItchBinary };
+    
+    struct Stats {
+        uint64_t records = 0;
+        uint64_t bytes = 0;         // Payload bytes handed out
+        uint64_t skipped = 0;       // Frames that were not IPv4/UDP, fragments, truncated
+    };
+    
+    CaptureReader() = default;
+    ~CaptureReader();
+    
+    // Non-copyable
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+    
+    // False (reported on std::cerr) if the file cannot be mapped or is not
+    // a supported format
+    bool open(const std::string& path);
+    void close();
+    
+    // Next record; false at the end of the file. Data stays valid until close().
+    bool next(CaptureRecord& record);
+    
+    Format format() const { return format_; }
+    const char* formatName() const;
+    size_t fileSize() const { return size_; }
+    const Stats& getStats() const { return stats_; }
+    
+    // Payload bytes per binary ITCH record (about one MoldUDP64 datagram)
+    static constexpr size_t ITCH_RECORD_BYTES = 1400;
+
+private:
+    bool openPcap(const std::string& path);
+    bool nextPcap(CaptureRecord& record);
+    bool nextItch(CaptureRecord& record);
+    
+    // Link-layer frame -> UDP payload; false if not IPv4/UDP
+    bool udpPayload(const uint8_t* frame, size_t length, CaptureRecord& record) const;
+    
+    uint32_t read32(const uint8_t* p) const;
+    
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t offset_ = 0;
+    Format format_ = Format::Pcap;
+    
+    // pcap
+    bool swapped_ = false;
+    bool nanosecond_ = false;
+    uint32_t link_type_ = 0;
+    
+    Stats stats_;
+};
+
+} // namespace feedhandler
@@ -0,0 +1,196 @@
+#include "checkpoint_file.h"
+
+#include "tsc_clock.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace feedhandler {
+
+namespace {
+
+constexpr size_t SECTION_ALIGN = 64;
+
+size_t alignUp(size_t n) {
+    return (n + SECTION_ALIGN - 1) & ~(SECTION_ALIGN - 1);
+}
+
+} // namespace
+
+// ============================================================================
+// CheckpointWriter
+// ============================================================================
+
+CheckpointWriter::CheckpointWriter(CheckpointKind kind, uint64_t position, uint64_t records) {
+    header_.magic = CHECKPOINT_MAGIC;
+    header_.version = CHECKPOINT_VERSION;
+    header_.kind = static_cast<uint32_t>(kind);
+    header_.position = position;
+    header_.records = records;
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    discard();
+}
+
+void CheckpointWriter::addSection(uint32_t type, uint32_t record_size, uint64_t count) {
+    sections_.push_back(CheckpointSection{type, record_size, count, 0});
+}
+
+bool CheckpointWriter::open(const std::string& path) {
+    discard();
+    
+    size_t offset = alignUp(sizeof(CheckpointHeader) + sections_.size() * sizeof(CheckpointSection));
+    for (auto& section : sections_) {
+        section.offset = offset;
+        offset = alignUp(offset + section.record_size * section.count);
+    }
+    
+    path_ = path;
+    temp_path_ = path + ".tmp";
+    int fd = ::open(temp_path_.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create checkpoint " << temp_path_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    // Blocks reserved up front, not a sparse file: a full disk or quota is a
+    // failed checkpoint here rather than SIGBUS on a store into the mapping
+    int err = posix_fallocate(fd, 0, static_cast<off_t>(offset));
+    if (err != 0) {
+        std::cerr << "Failed to size checkpoint " << temp_path_ << ": " << strerror(err) << std::endl;
+        ::close(fd);
+        unlink(temp_path_.c_str());
+        return false;
+    }
+    void* base = mmap(nullptr, offset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Failed to map checkpoint " << temp_path_ << ": " << strerror(errno) << std::endl;
+        unlink(temp_path_.c_str());
+        return false;
+    }
+    
+    base_ = static_cast<uint8_t*>(base);
+    size_ = offset;
+    header_.section_count = static_cast<uint32_t>(sections_.size());
+    header_.file_size = size_;
+    header_.created_ns = wallClockNs();
+    return true;
+}
+
+void* CheckpointWriter::section(uint32_t type, size_t record_size) {
+    for (const auto& section : sections_) {
+        if (section.type == type && section.record_size == record_size) {
+            return base_ + section.offset;
+        }
+    }
+    return nullptr;
+}
+
+bool CheckpointWriter::commit() {
+    if (!base_) return false;
+    
+    // Header last: a file cut short before the rename never validates
+    std::memcpy(base_ + sizeof(CheckpointHeader), sections_.data(), sections_.size() * sizeof(CheckpointSection));
+    std::memcpy(base_, &header_, sizeof(header_));
+    munmap(base_, size_);
+    base_ = nullptr;
+    
+    if (std::rename(temp_path_.c_str(), path_.c_str()) < 0) {
+        std::cerr << "Failed to replace checkpoint " << path_ << ": " << strerror(errno) << std::endl;
+        unlink(temp_path_.c_str());
+        return false;
+    }
+    return true;
+}
+
+void CheckpointWriter::discard() {
+    if (!base_) return;
+    
+    munmap(base_, size_);
+    base_ = nullptr;
+    unlink(temp_path_.c_str());
+}
+
+// ============================================================================
+// CheckpointReader
+// ============================================================================
+
+CheckpointReader::~CheckpointReader() {
+    close();
+}
+
+bool CheckpointReader::open(const std::string& path, CheckpointKind kind) {
+    close();
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open checkpoint " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(CheckpointHeader)) {
+        std::cerr << "Checkpoint " << path << " is empty or unreadable" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Failed to map checkpoint " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    const auto* header = static_cast<const CheckpointHeader*>(base);
+    bool valid = header->magic == CHECKPOINT_MAGIC && header->version == CHECKPOINT_VERSION &&
+                 header->kind == static_cast<uint32_t>(kind) && header->file_size == size &&
+                 sizeof(CheckpointHeader) + header->section_count * sizeof(CheckpointSection) <= size;
+    const auto* sections = reinterpret_cast<const CheckpointSection*>(header + 1);
+    for (uint32_t i = 0; valid && i < header->section_count; ++i) {
+        const auto& section = sections[i];
+        valid = section.offset <= size && section.record_size != 0 &&
+                section.count <= (size - section.offset) / section.record_size;
+    }
+    if (!valid) {
+        std::cerr << "Checkpoint " << path << " is damaged or was written by another handler or build" << std::endl;
+        munmap(base, size);
+        return false;
+    }
+    
+    base_ = static_cast<const uint8_t*>(base);
+    size_ = size;
+    header_ = header;
+    sections_ = sections;
+    return true;
+}
+
+void CheckpointReader::close() {
+    if (!base_) return;
+    
+    munmap(const_cast<uint8_t*>(base_), size_);
+    base_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+    sections_ = nullptr;
+}
+
+const void* CheckpointReader::section(uint32_t type, size_t record_size, size_t& count) const {
+    count = 0;
+    for (uint32_t i = 0; i < header_->section_count; ++i) {
+        const auto& section = sections_[i];
+        if (section.type != type) continue;
+        if (section.record_size != record_size) return nullptr;
+        count = static_cast<size_t>(section.count);
+        return base_ + section.offset;
+    }
+    return nullptr;
+}
+
+} // namespace feedhandler
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace feedhandler {
+
+// Warm-start checkpoint: a handler's book state written to a file, so a
+// restart loads it instead of rebuilding every book from the feed.
+//
+// The file is a CheckpointHeader, a table of CheckpointSections and the
+// sections' records (fixed-size structs, each section 64-byte aligned),
+// written through a mapping of a temporary file that is renamed over the
+// previous checkpoint once complete: a reader sees the old checkpoint or
+// the new one, never a torn one. The rename does not wait for the disk, so
+// a checkpoint survives the process dying, not the machine.
+//
+// Records are the writer's native layout: a checkpoint is read back by the
+// same build on the same machine, which the header's record sizes check.
+
+constexpr uint32_t CHECKPOINT_MAGIC = 0x31504b43;   // "CKP1"
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+struct CheckpointConfig {
+    std::string file;           // Checkpoint path (empty = off)
+    int interval_sec = 0;       // Also checkpoint this often while running (0 = on stop only)
+    bool restore = false;       // Load file on startup
+};
+
+// Which handler wrote the file
+enum class CheckpointKind : uint32_t {
+    Itch = 1,
+    Cme = 2,
+};
+
+struct CheckpointHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t kind;              // CheckpointKind
+    uint32_t section_count;
+    uint64_t file_size;
+    uint64_t created_ns;        // CLOCK_REALTIME
+    uint64_t position;          // Feed sequence to resume from (0 = none)
+    uint64_t records;           // Input records applied, what a resumed replay skips
+};
+
+struct CheckpointSection {
+    uint32_t type;              // Handler-defined
+    uint32_t record_size;
+    uint64_t count;
+    uint64_t offset;            // From the start of the file
+};
+
+// Sections are declared with their sizes first, then open() maps the whole
+// file and records() hands out each section's array to fill in place.
+class CheckpointWriter {
+public:
+    CheckpointWriter(CheckpointKind kind, uint64_t position, uint64_t records);
+    ~CheckpointWriter();
+    
+    // Non-copyable
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    
+    // Before open(): a section of count records of record_size bytes
+    void addSection(uint32_t type, uint32_t record_size, uint64_t count);
+    
+    // Create path's temporary file at its final size, its blocks allocated,
+    // and map it. False (and no file) if the space is not there.
+    bool open(const std::string& path);
+    
+    // Section type's records, nullptr if it was not declared
+    template <typename T>
+    T* records(uint32_t type) { return static_cast<T*>(section(type, sizeof(T))); }
+    
+    // Unmap and rename over path. False (and the old checkpoint kept) if
+    // the file could not be completed.
+    bool commit();
+    
+    size_t size() const { return size_; }
+
+private:
+    void* section(uint32_t type, size_t record_size);
+    void discard();
+    
+    CheckpointHeader header_{};
+    std::vector<CheckpointSection> sections_;
+    std::string path_;
+    std::string temp_path_;
+    uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Read-only mapping of a checkpoint, validated on open()
+class CheckpointReader {
+public:
+    CheckpointReader() = default;
+    ~CheckpointReader();
+    
+    // Non-copyable
+    CheckpointReader(const CheckpointReader&) = delete;
+    CheckpointReader& operator=(const CheckpointReader&) = delete;
+    
+    // False if path is missing, truncated, from another build or written by
+    // another kind of handler
+    bool open(const std::string& path, CheckpointKind kind);
+    void close();
+    
+    const CheckpointHeader& header() const { return *header_; }
+    
+    // Section type's records and their count; nullptr (count 0) if the
+    // file has no such section or its records are not sizeof(T)
+    template <typename T>
+    const T* records(uint32_t type, size_t& count) const {
+        return static_cast<const T*>(section(type, sizeof(T), count));
+    }
+
+private:
+    const void* section(uint32_t type, size_t record_size, size_t& count) const;
+    
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    const CheckpointHeader* header_ = nullptr;
+    const CheckpointSection* sections_ = nullptr;
+};
+
+} // namespace feedhandler
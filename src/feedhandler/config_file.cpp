@@ -0,0 +1,251 @@
+#include "config_file.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace feedhandler {
+
+namespace {
+
+std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+// Drop a # comment: only at line start or after whitespace, outside quotes
+std::string stripComment(const std::string& line) {
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quote) {
+            if (c == '\\' && quote == '"') ++i;
+            else if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '#' && (i == 0 || line[i - 1] == ' ' || line[i - 1] == '\t')) {
+            return line.substr(0, i);
+        }
+    }
+    return line;
+}
+
+// First position of c outside quotes, npos if none
+size_t findUnquoted(const std::string& s, char c, size_t from = 0) {
+    char quote = 0;
+    for (size_t i = from; i < s.size(); ++i) {
+        if (quote) {
+            if (s[i] == '\\' && quote == '"') ++i;
+            else if (s[i] == quote) quote = 0;
+        } else if (s[i] == '"' || s[i] == '\'') {
+            quote = s[i];
+        } else if (s[i] == c) {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+// Plain or quoted scalar to its value; false on an unterminated quote
+bool unquote(const std::string& text, std::string& out) {
+    out.clear();
+    if (text.empty() || (text[0] != '"' && text[0] != '\'')) {
+        out = text;
+        return true;
+    }
+    
+    char quote = text[0];
+    for (size_t i = 1; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == quote) {
+            // 'it''s' is the single-quote escape
+            if (quote == '\'' && i + 1 < text.size() && text[i + 1] == '\'') {
+                out += '\'';
+                ++i;
+                continue;
+            }
+            return trim(text.substr(i + 1)).empty();
+        }
+        if (c == '\\' && quote == '"' && i + 1 < text.size()) {
+            char next = text[++i];
+            out += next == 'n' ? '\n' : next == 't' ? '\t' : next;
+            continue;
+        }
+        out += c;
+    }
+    return false;
+}
+
+} // namespace
+
+bool ConfigFile::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open config file " << path << std::endl;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), path);
+}
+
+bool ConfigFile::parse(const std::string& text, const std::string& name) {
+    name_ = name;
+    values_.clear();
+    
+    // Enclosing mapping keys: (indent, dotted prefix ending in '.')
+    std::vector<std::pair<size_t, std::string>> parents;
+    std::string open_key;           // Last "key:" with no value, owner of "- item" lines
+    size_t open_indent = 0;
+    
+    std::istringstream lines(text);
+    std::string raw;
+    int line_no = 0;
+    while (std::getline(lines, raw)) {
+        line_no++;
+        std::string line = stripComment(raw);
+        if (trim(line).empty()) continue;
+        
+        size_t indent = line.find_first_not_of(' ');
+        if (line[indent] == '\t') return syntaxError(line_no, "tabs are not allowed for indentation");
+        std::string content = trim(line);
+        
+        // Block list item under the open key
+        if (content[0] == '-' && (content.size() == 1 || content[1] == ' ')) {
+            if (open_key.empty() || indent < open_indent) {
+                return syntaxError(line_no, "list item outside a list");
+            }
+            std::string item;
+            if (!unquote(trim(content.substr(1)), item)) return syntaxError(line_no, "unterminated quote");
+            Value& value = values_[open_key];
+            value.list = true;
+            value.items.push_back(item);
+            continue;
+        }
+        
+        size_t colon = findUnquoted(content, ':');
+        while (colon != std::string::npos && colon + 1 < content.size() && content[colon + 1] != ' ') {
+            colon = findUnquoted(content, ':', colon + 1);
+        }
+        if (colon == std::string::npos || colon == 0) {
+            return syntaxError(line_no, "expected \"key: value\"");
+        }
+        
+        while (!parents.empty() && indent <= parents.back().first) parents.pop_back();
+        std::string key;
+        if (!unquote(trim(content.substr(0, colon)), key) || key.empty()) {
+            return syntaxError(line_no, "bad key");
+        }
+        std::string full_key = (parents.empty() ? "" : parents.back().second) + key;
+        if (values_.count(full_key)) return syntaxError(line_no, "duplicate key " + full_key);
+        
+        Value& value = values_[full_key];
+        value.line = line_no;
+        std::string rest = trim(content.substr(colon + 1));
+        open_key.clear();
+        
+        if (rest.empty()) {
+            // Nested mapping or block list follows (or nothing: an empty value)
+            value.section = true;
+            parents.emplace_back(indent, full_key + ".");
+            open_key = full_key;
+            open_indent = indent;
+        } else if (rest[0] == '[') {
+            if (rest.back() != ']') return syntaxError(line_no, "flow list must close on the same line");
+            value.list = true;
+            std::string body = trim(rest.substr(1, rest.size() - 2));
+            size_t start = 0;
+            while (!body.empty() && start <= body.size()) {
+                size_t comma = findUnquoted(body, ',', start);
+                if (comma == std::string::npos) comma = body.size();
+                std::string item;
+                if (!unquote(trim(body.substr(start, comma - start)), item)) {
+                    return syntaxError(line_no, "unterminated quote");
+                }
+                value.items.push_back(item);
+                start = comma + 1;
+            }
+        } else if (rest[0] == '{' || rest[0] == '&' || rest[0] == '*' || rest[0] == '|' || rest[0] == '>') {
+            return syntaxError(line_no, "unsupported YAML construct");
+        } else {
+            std::string item;
+            if (!unquote(rest, item)) return syntaxError(line_no, "unterminated quote");
+            value.items.push_back(item);
+        }
+    }
+    return true;
+}
+
+const std::string* ConfigFile::scalar(const std::string& key) const {
+    static const std::string empty;
+    auto it = values_.find(key);
+    if (it == values_.end()) return nullptr;
+    
+    const Value& value = it->second;
+    value.used = true;
+    if (value.list) {
+        fail(key, "expected a single value, not a list");
+        return nullptr;
+    }
+    return value.items.empty() ? &empty : &value.items[0];
+}
+
+bool ConfigFile::get(const std::string& key, std::string& out) const {
+    const std::string* text = scalar(key);
+    if (!text) return !has(key);
+    out = *text;
+    return true;
+}
+
+bool ConfigFile::get(const std::string& key, bool& out) const {
+    const std::string* text = scalar(key);
+    if (!text) return !has(key);
+    if (*text == "true" || *text == "yes" || *text == "on") {
+        out = true;
+    } else if (*text == "false" || *text == "no" || *text == "off") {
+        out = false;
+    } else {
+        return fail(key, "expected true or false");
+    }
+    return true;
+}
+
+bool ConfigFile::get(const std::string& key, std::vector<std::string>& out) const {
+    auto it = values_.find(key);
+    if (it == values_.end()) return true;
+    
+    const Value& value = it->second;
+    value.used = true;
+    out.clear();
+    for (const auto& item : value.items) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return true;
+}
+
+std::vector<std::string> ConfigFile::unusedKeys() const {
+    std::vector<std::string> keys;
+    for (const auto& entry : values_) {
+        const Value& value = entry.second;
+        // A section is used through its children
+        if (value.used || (value.section && !value.list && value.items.empty())) continue;
+        keys.push_back(entry.first);
+    }
+    return keys;
+}
+
+bool ConfigFile::fail(const std::string& key, const std::string& what) const {
+    auto it = values_.find(key);
+    std::cerr << name_ << ":" << (it != values_.end() ? it->second.line : 0)
+              << ": " << key << ": " << what << std::endl;
+    return false;
+}
+
+bool ConfigFile::syntaxError(int line, const std::string& what) const {
+    std::cerr << name_ << ":" << line << ": " << what << std::endl;
+    return false;
+}
+
+} // namespace feedhandler
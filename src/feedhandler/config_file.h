@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <limits>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace feedhandler {
+
+// Reader for the YAML subset the handler configs are written in: block
+// mappings nested by indentation, plain / "double" / 'single' quoted
+// scalars, flow lists ([a, b]) and block lists (- item), # comments.
+// Anchors, multi-line scalars and flow mappings are rejected.
+//
+// Keys are flattened to dotted paths ("processing.conflation.interval_ms").
+// The get() overloads leave out untouched when a key is absent and return
+// false (after printing file:line and the key) when the value does not
+// parse, so a loader can apply every key and fail once at the end. Keys no
+// get() asked for are listed by unusedKeys() to catch typos.
+class ConfigFile {
+public:
+    // False (reported on std::cerr) if the file cannot be read or parsed
+    bool load(const std::string& path);
+    bool parse(const std::string& text, const std::string& name);
+    
+    bool has(const std::string& key) const { return values_.count(key) != 0; }
+    
+    bool get(const std::string& key, std::string& out) const;
+    bool get(const std::string& key, bool& out) const;
+    bool get(const std::string& key, std::vector<std::string>& out) const;
+    
+    template <typename Int>
+    bool get(const std::string& key, Int& out) const {
+        static_assert(std::is_integral<Int>::value, "ConfigFile::get: unsupported type");
+        const std::string* text = scalar(key);
+        if (!text) return !has(key);
+        
+        errno = 0;
+        char* end = nullptr;
+        if (std::is_signed<Int>::value) {
+            long long value = std::strtoll(text->c_str(), &end, 10);
+            if (errno != 0 || end == text->c_str() || *end != '\0' ||
+                value < static_cast<long long>(std::numeric_limits<Int>::min()) ||
+                value > static_cast<long long>(std::numeric_limits<Int>::max())) {
+                return fail(key, "expected an integer in range");
+            }
+            out = static_cast<Int>(value);
+        } else {
+            unsigned long long value = std::strtoull(text->c_str(), &end, 10);
+            if (errno != 0 || end == text->c_str() || *end != '\0' || (*text)[0] == '-' ||
+                value > static_cast<unsigned long long>(std::numeric_limits<Int>::max())) {
+                return fail(key, "expected a non-negative integer in range");
+            }
+            out = static_cast<Int>(value);
+        }
+        return true;
+    }
+    
+    // One of a fixed set of names, e.g. {{"tick", Mode::Tick}, {"conflated", Mode::Conflated}}
+    template <typename E>
+    bool getChoice(const std::string& key, std::initializer_list<std::pair<const char*, E>> choices,
+                   E& out) const {
+        std::string name;
+        if (!has(key)) return true;
+        if (!get(key, name)) return false;
+        for (const auto& choice : choices) {
+            if (name == choice.first) {
+                out = choice.second;
+                return true;
+            }
+        }
+        return fail(key, "unknown value \"" + name + "\"");
+    }
+    
+    // Keys present in the file that no get() asked for
+    std::vector<std::string> unusedKeys() const;
+    
+    const std::string& name() const { return name_; }
+
+private:
+    struct Value {
+        std::vector<std::string> items;     // One item for a scalar
+        bool list = false;
+        bool section = false;               // "key:" with nested keys or list items below
+        int line = 0;
+        mutable bool used = false;
+    };
+    
+    // Scalar text of a key; nullptr if absent, or (reported) if it is a list
+    const std::string* scalar(const std::string& key) const;
+    
+    bool fail(const std::string& key, const std::string& what) const;
+    bool syntaxError(int line, const std::string& what) const;
+    
+    std::map<std::string, Value> values_;
+    std::string name_;
+};
+
+} // namespace feedhandler
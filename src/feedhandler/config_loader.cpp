@@ -0,0 +1,117 @@
+#include "config_loader.h"
+
+#include <iostream>
+
+namespace feedhandler {
+
+bool readRunLoop(const ConfigFile& file, const std::string& section, RunLoopConfig& run_loop) {
+    bool ok = true;
+    ok &= file.get(section + ".spin", run_loop.spin);
+    ok &= file.get(section + ".busy_poll_us", run_loop.busy_poll_us);
+    ok &= file.get(section + ".cpu", run_loop.cpu);
+    ok &= file.get(section + ".fifo_priority", run_loop.fifo_priority);
+    return ok;
+}
+
+bool readReceiveBackend(const ConfigFile& file, const std::string& key, ReceiveBackendConfig& backend) {
+    std::string name;
+    if (!file.has(key)) return true;
+    if (!file.get(key, name)) return false;
+    if (!parseReceiveBackend(name, backend.type)) {
+        std::cerr << file.name() << ": " << key << ": unknown receive backend \"" << name << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool readMetrics(const ConfigFile& file, const std::string& section, MetricsConfig& metrics) {
+    bool ok = true;
+    ok &= file.get(section + ".port", metrics.port);
+    ok &= file.get(section + ".bind_address", metrics.bind_address);
+    return ok;
+}
+
+bool readBookCache(const ConfigFile& file, const std::string& section, BookCacheConfig& cache) {
+    bool ok = true;
+    ok &= file.get(section + ".name", cache.name);
+    ok &= file.get(section + ".capacity", cache.capacity);
+    return ok;
+}
+
+bool readCheckpoint(const ConfigFile& file, const std::string& section, CheckpointConfig& checkpoint) {
+    bool ok = true;
+    ok &= file.get(section + ".file", checkpoint.file);
+    ok &= file.get(section + ".interval_sec", checkpoint.interval_sec);
+    ok &= file.get(section + ".restore", checkpoint.restore);
+    return ok;
+}
+
+void warnUnusedKeys(const ConfigFile& file) {
+    for (const auto& key : file.unusedKeys()) {
+        std::cerr << file.name() << ": ignoring unknown key " << key << std::endl;
+    }
+}
+
+bool loadConfigFile(const std::string& path, FeedHandlerConfig& config) {
+    ConfigFile file;
+    if (!file.load(path)) return false;
+    
+    bool ok = true;
+    
+    // Input
+    ok &= file.get("input.multicast_group", config.input_group);
+    ok &= file.get("input.port", config.input_port);
+    ok &= file.get("input.interface", config.input_interface);
+    ok &= file.get("input.buffer_size", config.input_buffer_size);
+    ok &= file.get("input.max_datagram", config.input_max_datagram);
+    ok &= file.get("input.recv_batch", config.recv_batch_size);
+    ok &= readReceiveBackend(file, "input.backend", config.input_backend);
+    ok &= file.get("input.capture_file", config.capture_file);
+    ok &= readRunLoop(file, "run_loop", config.run_loop);
+    
+    // Output
+    ok &= file.get("output.multicast_group", config.output_group);
+    ok &= file.get("output.port", config.output_port);
+    ok &= file.get("output.interface", config.output_interface);
+    ok &= file.get("output.ttl", config.output_ttl);
+    ok &= file.get("output.mtu", config.output_mtu);
+    ok &= file.get("output.send_batch", config.send_batch_size);
+    
+    // Processing
+    ok &= file.getChoice("processing.mode", {{"tick", ProcessingMode::TickByTick},
+                                             {"conflated", ProcessingMode::Conflated}}, config.mode);
+    ok &= file.get("processing.conflation.interval_ms", config.conflation_interval_ms);
+    ok &= file.get("processing.conflation.max_pending", config.conflation_max_pending);
+    ok &= file.get("processing.conflation.max_staleness_ms", config.conflation_max_staleness_ms);
+    ok &= file.getChoice("processing.conflation.output", {{"snapshot", ConflationOutput::Snapshot},
+                                                          {"delta", ConflationOutput::Delta}},
+                         config.conflation_output);
+    ok &= file.get("processing.conflation.refresh_ms", config.snapshot_refresh_ms);
+    ok &= file.getChoice("processing.conflation.snapshot_format", {{"sbe", SnapshotEncoding::Sbe},
+                                                                   {"raw", SnapshotEncoding::Raw}},
+                         config.snapshot_encoding);
+    
+    ok &= file.get("processing.book.depth", config.book_depth);
+    ok &= file.get("processing.book.symbols", config.symbols);
+    ok &= file.getChoice("processing.book.storage", {{"map", LevelStorage::Map},
+                                                     {"ladder", LevelStorage::Ladder}},
+                         config.book_storage);
+    ok &= file.get("processing.book.ladder_tick", config.ladder.tick_size);
+    ok &= file.get("processing.book.order_index_capacity", config.order_index_capacity);
+    
+    ok &= file.get("processing.workers", config.worker_threads);
+    ok &= file.get("processing.worker_ring_size", config.worker_ring_size);
+    ok &= readCheckpoint(file, "checkpoint", config.checkpoint);
+    
+    // Stats
+    ok &= file.get("logging.stats_interval_sec", config.stats_interval_sec);
+    ok &= file.get("logging.rx_timestamps", config.rx_timestamps);
+    ok &= file.get("logging.latency_log", config.latency_log);
+    ok &= readMetrics(file, "metrics", config.metrics);
+    ok &= readBookCache(file, "book_cache", config.book_cache);
+    
+    warnUnusedKeys(file);
+    return ok;
+}
+
+} // namespace feedhandler
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "book_cache.h"
+#include "checkpoint_file.h"
+#include "config_file.h"
+#include "feedhandler_config.h"
+#include "metrics.h"
+#include "receive_backend.h"
+#include "thread_tuning.h"
+
+#include <string>
+
+namespace feedhandler {
+
+// Apply a YAML config (config/feedhandler.yaml layout) on top of config.
+// Keys missing from the file keep their current values, so defaults and
+// command-line flags parsed afterwards compose with it. Unknown keys are
+// warned about; a malformed value fails the whole load.
+bool loadConfigFile(const std::string& path, FeedHandlerConfig& config);
+
+// Sections shared by the ITCH and CME layouts
+bool readRunLoop(const ConfigFile& file, const std::string& section, RunLoopConfig& run_loop);
+bool readReceiveBackend(const ConfigFile& file, const std::string& key, ReceiveBackendConfig& backend);
+bool readMetrics(const ConfigFile& file, const std::string& section, MetricsConfig& metrics);
+bool readBookCache(const ConfigFile& file, const std::string& section, BookCacheConfig& cache);
+bool readCheckpoint(const ConfigFile& file, const std::string& section, CheckpointConfig& checkpoint);
+
+// Warn about keys no reader asked for
+void warnUnusedKeys(const ConfigFile& file);
+
+} // namespace feedhandler
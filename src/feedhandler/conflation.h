@@ -0,0 +1,136 @@
+#pragma once
+
+#include "market_data.h"
+#include "seqlock.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace feedhandler {
+
+// Hand-off between an ingest thread and a conflation publisher thread.
+//
+// Each book owns a slot holding its latest snapshot (any trivially copyable
+// T: the ITCH handler stores OrderBookSnapshot, the CME handler stores the
+// encoded SBE message) behind a
+// seqlock plus a bit in an atomic dirty bitmap. The ingest thread overwrites
+// the slot once per input packet for every book the packet changed and sets
+// the bit; the publisher swaps bitmap words to zero whenever its
+// ConflationScheduler says a drain is due and
+// reads only the slots whose bits were set, without ever taking a lock the
+// ingest thread could block on. Updates between two drains overwrite each
+// other, which is the conflation.
+//
+// Slots are added by the ingest thread only and never move, so the publisher
+// can walk them while new books appear.
+template <typename T>
+class BasicConflationTable {
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    static constexpr size_t CHUNK_BITS = 8;
+    static constexpr size_t CHUNK_SLOTS = size_t{1} << CHUNK_BITS;
+    static constexpr size_t MAX_CHUNKS = 1024;  // 262144 books
+    
+    BasicConflationTable() = default;
+    
+    // Non-copyable
+    BasicConflationTable(const BasicConflationTable&) = delete;
+    BasicConflationTable& operator=(const BasicConflationTable&) = delete;
+    
+    // Ingest thread: new slot for a book, NO_SLOT once the table is full
+    uint32_t addSlot() {
+        uint32_t slot = size_.load(std::memory_order_relaxed);
+        size_t chunk = slot >> CHUNK_BITS;
+        if (chunk >= MAX_CHUNKS) return NO_SLOT;
+        
+        if (!owned_[chunk]) {
+            owned_[chunk] = std::make_unique<Chunk>();
+            chunks_[chunk].store(owned_[chunk].get(), std::memory_order_release);
+        }
+        
+        // Publish the count last so the publisher never sees an unbacked slot
+        size_.store(slot + 1, std::memory_order_release);
+        return slot;
+    }
+    
+    // Ingest thread: replace a slot's snapshot and mark it for publishing.
+    // True if the slot was clean, i.e. one more book is now pending.
+    bool publish(uint32_t slot, const T& snap) {
+        return publishWith(slot, [&snap](T& out) { out = snap; });
+    }
+    
+    // Ingest thread: fn(T&) writes the snapshot straight into the slot,
+    // saving the copy through a temporary when T is large
+    template <typename Fn>
+    bool publishWith(uint32_t slot, Fn&& fn) {
+        Chunk& chunk = chunkAt(slot);
+        uint32_t i = slot & (CHUNK_SLOTS - 1);
+        chunk.slots[i].book.write(fn);
+        
+        // Always an RMW: skipping it when the bit looks set could race with
+        // the publisher clearing the word and lose this snapshot
+        uint64_t bit = uint64_t{1} << (i & 63);
+        return (chunk.dirty[i >> 6].fetch_or(bit, std::memory_order_release) & bit) == 0;
+    }
+    
+    // Publisher thread: fn(slot, snapshot) for every slot published since the
+    // last drain. Costs one load per 64 slots plus one per dirty slot. Returns
+    // the number of snapshots handed out.
+    template <typename Fn>
+    size_t drain(Fn&& fn) {
+        size_t drained = 0;
+        uint32_t count = size_.load(std::memory_order_acquire);
+        size_t chunks = (count + CHUNK_SLOTS - 1) >> CHUNK_BITS;
+        for (size_t c = 0; c < chunks; ++c) {
+            Chunk& chunk = *chunks_[c].load(std::memory_order_acquire);
+            for (size_t w = 0; w < WORDS_PER_CHUNK; ++w) {
+                if (chunk.dirty[w].load(std::memory_order_relaxed) == 0) continue;
+                uint64_t bits = chunk.dirty[w].exchange(0, std::memory_order_acquire);
+                while (bits) {
+                    size_t i = (w << 6) + static_cast<size_t>(__builtin_ctzll(bits));
+                    bits &= bits - 1;
+                    fn(static_cast<uint32_t>((c << CHUNK_BITS) + i), chunk.slots[i].book.load());
+                    drained++;
+                }
+            }
+        }
+        return drained;
+    }
+    
+    // Any thread: latest snapshot of a slot below size(), dirty or not.
+    // False if the slot was added but nothing was published to it yet.
+    bool read(uint32_t slot, T& out) {
+        const auto& book = chunkAt(slot).slots[slot & (CHUNK_SLOTS - 1)].book;
+        if (book.version() == 0) return false;
+        out = book.load();
+        return true;
+    }
+    
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+    
+private:
+    static constexpr size_t WORDS_PER_CHUNK = CHUNK_SLOTS / 64;
+    
+    struct alignas(64) Slot {
+        SeqLock<T> book;
+    };
+    struct Chunk {
+        std::array<std::atomic<uint64_t>, WORDS_PER_CHUNK> dirty{};
+        std::array<Slot, CHUNK_SLOTS> slots;
+    };
+    
+    Chunk& chunkAt(uint32_t slot) {
+        return *chunks_[slot >> CHUNK_BITS].load(std::memory_order_acquire);
+    }
+    
+    std::array<std::atomic<Chunk*>, MAX_CHUNKS> chunks_{};
+    std::array<std::unique_ptr<Chunk>, MAX_CHUNKS> owned_;
+    std::atomic<uint32_t> size_{0};
+};
+
+using ConflationTable = BasicConflationTable<OrderBookSnapshot>;
+
+} // namespace feedhandler
@@ -0,0 +1,93 @@
+#include "conflation_scheduler.h"
+
+#include <algorithm>
+
+namespace feedhandler {
+
+ConflationScheduler::ConflationScheduler(int interval_ms, size_t max_pending, int max_staleness_ms)
+    : interval_(std::chrono::milliseconds(std::max(1, interval_ms)))
+    , max_pending_(max_pending)
+    , staleness_ns_(static_cast<uint64_t>(std::max(0, max_staleness_ms)) * 1000000ULL)
+    , next_tick_(Clock::now() + interval_) {}
+
+void ConflationScheduler::notify() {
+    // Taking the mutex orders this against the publisher's check-then-wait,
+    // so the wake-up cannot fall between the two
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    cv_.notify_one();
+}
+
+bool ConflationScheduler::due(Clock::time_point now, Trigger& trigger) {
+    if (stopped_) {
+        trigger = Trigger::Stop;
+        return true;
+    }
+    if (max_pending_ != 0 && pending_.load(std::memory_order_relaxed) >= max_pending_) {
+        trigger = Trigger::MaxPending;
+        stats_.pending_flushes++;
+        return true;
+    }
+    if (staleness_ns_ != 0) {
+        uint64_t first = first_pending_ns_.load(std::memory_order_relaxed);
+        uint64_t now_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now.time_since_epoch()).count());
+        if (first != 0 && now_ns - first >= staleness_ns_) {
+            trigger = Trigger::Staleness;
+            stats_.staleness_flushes++;
+            return true;
+        }
+    }
+    if (now >= next_tick_) {
+        // Early flushes leave the tick cadence alone; a slow cycle skips
+        // ticks rather than bunching them up
+        next_tick_ += interval_;
+        if (next_tick_ < now) next_tick_ = now + interval_;
+        trigger = Trigger::Interval;
+        stats_.interval_flushes++;
+        return true;
+    }
+    return false;
+}
+
+void ConflationScheduler::resetPending() {
+    // Clear the timestamp first: an ingest thread that then sees the count
+    // go from 0 stamps a fresh one, and anything counted in between is
+    // already dirty and goes out with this drain
+    first_pending_ns_.store(0, std::memory_order_relaxed);
+    pending_.store(0, std::memory_order_relaxed);
+}
+
+ConflationScheduler::Trigger ConflationScheduler::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Trigger trigger;
+    for (;;) {
+        auto now = Clock::now();
+        if (due(now, trigger)) break;
+        
+        auto deadline = next_tick_;
+        uint64_t first = first_pending_ns_.load(std::memory_order_relaxed);
+        if (staleness_ns_ != 0 && first != 0) {
+            auto stale_at = Clock::time_point(std::chrono::nanoseconds(first + staleness_ns_));
+            deadline = std::min(deadline, std::chrono::time_point_cast<Clock::duration>(stale_at));
+        }
+        cv_.wait_until(lock, deadline);
+    }
+    
+    if (trigger != Trigger::Stop) resetPending();
+    return trigger;
+}
+
+void ConflationScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_one();
+}
+
+ConflationScheduler::Stats ConflationScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace feedhandler
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace feedhandler {
+
+// Decides when a conflation publisher drains its tables.
+//
+// Besides the fixed interval tick, ingest threads report books that became
+// pending (clean -> dirty in a ConflationTable) and the publisher is woken
+// early when
+//   - more than max_pending books are waiting, bounding the burst a single
+//     drain has to send, or
+//   - the oldest waiting update is max_staleness_ms old, bounding how late
+//     any one book's change goes out when the interval is long.
+// Either bound can be 0 (off), which leaves the plain timer.
+//
+// The ingest side is one relaxed fetch_add per capture pass; it only takes
+// the publisher's mutex on the pass that crosses a bound (or, with a
+// staleness bound, the first pass after a drain), so a burst costs one
+// wake-up, not one per packet.
+class ConflationScheduler {
+public:
+    enum class Trigger : uint8_t {
+        Interval,       // Regular tick
+        MaxPending,     // Too many books waiting
+        Staleness,      // Oldest waiting update hit the bound
+        Stop,
+    };
+    
+    struct Stats {
+        uint64_t interval_flushes = 0;
+        uint64_t pending_flushes = 0;
+        uint64_t staleness_flushes = 0;
+    };
+    
+    ConflationScheduler(int interval_ms, size_t max_pending, int max_staleness_ms);
+    
+    // Non-copyable
+    ConflationScheduler(const ConflationScheduler&) = delete;
+    ConflationScheduler& operator=(const ConflationScheduler&) = delete;
+    
+    // Ingest threads: books newly marked dirty by a capture pass
+    void addPending(size_t books) {
+        if (books == 0) return;
+        size_t before = pending_.fetch_add(books, std::memory_order_relaxed);
+        
+        bool wake = false;
+        if (before == 0 && staleness_ns_ != 0) {
+            first_pending_ns_.store(nowNs(), std::memory_order_relaxed);
+            wake = true;    // Publisher may be sleeping past the new deadline
+        }
+        if (max_pending_ != 0 && before < max_pending_ && before + books >= max_pending_) {
+            wake = true;
+        }
+        if (wake) notify();
+    }
+    
+    // Publisher: block until the next drain is due. The pending count is
+    // reset before returning, so books dirtied while the drain runs count
+    // towards the next one.
+    Trigger wait();
+    
+    // Any thread: wake the publisher with Trigger::Stop from now on
+    void stop();
+    
+    // Any thread
+    Stats getStats() const;
+    size_t maxPending() const { return max_pending_; }
+    int maxStalenessMs() const { return static_cast<int>(staleness_ns_ / 1000000); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    static uint64_t nowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count());
+    }
+    
+    void notify();
+    
+    // Under mutex_: the reason a drain is due now, if any
+    bool due(Clock::time_point now, Trigger& trigger);
+    void resetPending();
+    
+    const Clock::duration interval_;
+    const size_t max_pending_;
+    const uint64_t staleness_ns_;
+    
+    std::atomic<size_t> pending_{0};
+    std::atomic<uint64_t> first_pending_ns_{0};     // 0 = nothing waiting
+    
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    Clock::time_point next_tick_;
+    bool stopped_ = false;
+    Stats stats_;
+};
+
+} // namespace feedhandler
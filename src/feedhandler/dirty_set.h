@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace feedhandler {
+
+// Dense ids (book indexes) changed since the last drain.
+//
+// mark() is O(1) and idempotent; drain() visits only the marked ids, in the
+// order they were first marked, so a conflation tick costs O(dirty books)
+// rather than O(all books). Single-threaded: owned by the book-building
+// thread.
+class DirtySet {
+public:
+    void mark(uint32_t id) {
+        if (id >= marked_.size()) marked_.resize(id + 1, 0);
+        if (marked_[id]) return;
+        marked_[id] = 1;
+        list_.push_back(id);
+    }
+    
+    bool contains(uint32_t id) const { return id < marked_.size() && marked_[id]; }
+    
+    // fn(id) for every marked id, then empty the set. fn must not mark.
+    template <typename Fn>
+    void drain(Fn&& fn) {
+        for (uint32_t id : list_) {
+            marked_[id] = 0;
+            fn(id);
+        }
+        list_.clear();
+    }
+    
+    void clear() {
+        for (uint32_t id : list_) marked_[id] = 0;
+        list_.clear();
+    }
+    
+    size_t size() const { return list_.size(); }
+    bool empty() const { return list_.empty(); }
+    
+private:
+    std::vector<uint8_t> marked_;
+    std::vector<uint32_t> list_;  // Marked ids in first-mark order
+};
+
+} // namespace feedhandler
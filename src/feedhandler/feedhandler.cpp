@@ -1,22 +1,85 @@
 #include "feedhandler.h"
 
+#include "book_delta.h"
+#include "itch_decoder.h"
+#include "l2_snapshot.h"
+#include "thread_tuning.h"
+
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
 
 namespace feedhandler {
 
+namespace {
+
+// Messages a worker applies before flushing its output under sustained load
+constexpr size_t WORKER_FLUSH_BATCH = 64;
+
+// How often the receive thread and workers hand their counters to the metrics thread
+constexpr uint64_t STATS_PUBLISH_INTERVAL_MS = 500;
+
+// Idle passes a non-spinning worker yields before it starts sleeping
+constexpr unsigned WORKER_IDLE_YIELDS = 64;
+
+// Checkpoint sections
+constexpr uint32_t CHECKPOINT_BOOKS = 1;
+constexpr uint32_t CHECKPOINT_ORDERS = 2;
+
+} // namespace
+
 FeedHandler::FeedHandler(const FeedHandlerConfig& config)
-    : config_(config) {
-    receiver_ = std::make_unique<MulticastReceiver>(
-        config_.input_group, config_.input_port,
+    : config_(config)
+    , filter_(config.symbols)
+    , metrics_(config.metrics) {
+    receiver_ = makePacketSource(
+        config_.input_backend, config_.input_group, config_.input_port,
         config_.input_interface, config_.input_buffer_size);
+    receiver_->setBatchSize(config_.recv_batch_size, config_.input_max_datagram);
+    
+    if (config_.mode == ProcessingMode::Conflated) {
+        scheduler_ = std::make_unique<ConflationScheduler>(
+            config_.conflation_interval_ms, config_.conflation_max_pending,
+            config_.conflation_max_staleness_ms);
+    }
+    
+    // ITCH prices carry 4 decimals
+    if (!config_.book_cache.name.empty()) {
+        book_cache_ = std::make_unique<BookCacheWriter>(config_.book_cache, -4);
+    }
     
-    sender_ = std::make_unique<MulticastSender>(
-        config_.output_group, config_.output_port,
-        config_.output_interface, config_.output_ttl);
+    // OutputHeader::flags carries the shard id, so at most 255 workers
+    size_t shard_count = std::min<size_t>(std::max<size_t>(config_.worker_threads, 1), 255);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<ItchShard>(
+            config_, static_cast<uint8_t>(i), shard_count, scheduler_.get(), book_cache_.get()));
+    }
+    if (config_.worker_threads > 0) {
+        for (size_t i = 0; i < shard_count; ++i) {
+            workers_.push_back(std::make_unique<Worker>(config_.worker_ring_size));
+        }
+    }
+    if (config_.mode == ProcessingMode::Conflated) {
+        publisher_output_ = std::make_unique<OutputWriter>(config_, 0);
+        published_books_.resize(shards_.size());
+        refresh_cursor_.assign(shards_.size(), 0);
+        refresh_credit_.assign(shards_.size(), 0);
+        delta_buffer_.resize(MAX_BOOK_DELTA_SIZE);
+        snapshot_buffer_.resize(MAX_L2_SNAPSHOT_BYTES);
+    }
+    
+    if (!config_.latency_log.empty()) {
+        latency_log_.open(config_.latency_log, std::ios::app);
+        if (!latency_log_) {
+            std::cerr << "Failed to open latency log " << config_.latency_log << std::endl;
+        }
+    }
     
-    book_manager_ = std::make_unique<OrderBookManager>(config_.book_depth);
+    metrics_.addCollector([this](MetricsWriter& out) { collectMetrics(out); });
+    if (config_.stats_interval_sec > 0) {
+        metrics_.setReport(static_cast<uint64_t>(config_.stats_interval_sec) * 1000, [this]() { printStats(); });
+    }
 }
 
 FeedHandler::~FeedHandler() {
@@ -24,276 +87,787 @@ FeedHandler::~FeedHandler() {
 }
 
 bool FeedHandler::start() {
-    if (running_) return true;
+    if (started_) return true;
     
     if (!receiver_->start()) {
         std::cerr << "Failed to start receiver" << std::endl;
         return false;
     }
+    if (config_.run_loop.busy_poll_us > 0) {
+        receiver_->setBusyPoll(config_.run_loop.busy_poll_us);
+    }
+    if (config_.rx_timestamps) {
+        receiver_->enableRxTimestamps();
+    }
+    if (!config_.capture_file.empty()) {
+        if (!capture_.open(config_.capture_file)) {
+            receiver_->stop();
+            return false;
+        }
+        capture_feed_ = capture_.addFeed(config_.input_group, config_.input_port);
+    }
     
-    if (!sender_->start()) {
-        std::cerr << "Failed to start sender" << std::endl;
+    if (!startPipeline()) {
         receiver_->stop();
+        capture_.close();
+        return false;
+    }
+    
+    std::cout << "  Receive loop: " << (config_.run_loop.spin ? "spin" : "poll")
+              << " (" << receiveBackendName(config_.input_backend.type) << ")" << std::endl;
+    if (capture_.isOpen()) {
+        std::cout << "  Recording to " << config_.capture_file << std::endl;
+    }
+    return true;
+}
+
+bool FeedHandler::startPipeline() {
+    if (book_cache_ && !book_cache_->open()) return false;
+    
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!shards_[i]->start()) {
+            for (size_t j = 0; j < i; ++j) shards_[j]->stop();
+            if (book_cache_) book_cache_->close();
+            return false;
+        }
+    }
+    if (publisher_output_ && !publisher_output_->start()) {
+        std::cerr << "Failed to start conflation sender" << std::endl;
+        for (auto& shard : shards_) shard->stop();
+        if (book_cache_) book_cache_->close();
         return false;
     }
     
+    if (!metrics_.start()) {
+        for (auto& shard : shards_) shard->stop();
+        if (publisher_output_) publisher_output_->stop();
+        if (book_cache_) book_cache_->close();
+        return false;
+    }
+    
+    // Before any worker runs, so the shards are still this thread's
+    if (config_.checkpoint.restore && !config_.checkpoint.file.empty()) {
+        restoreCheckpoint();
+    }
+    
     running_ = true;
-    last_conflation_time_ = std::chrono::steady_clock::now();
-    last_stats_time_ = std::chrono::steady_clock::now();
+    started_ = true;
+    next_publish_tick_ = TscClock::ticks() + clock_.fromMillis(STATS_PUBLISH_INTERVAL_MS);
+    next_checkpoint_tick_ = 0;
+    if (!config_.checkpoint.file.empty() && config_.checkpoint.interval_sec > 0) {
+        next_checkpoint_tick_ = TscClock::ticks() +
+                                clock_.fromMillis(static_cast<uint64_t>(config_.checkpoint.interval_sec) * 1000);
+    }
+    
+    workers_running_ = true;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = startThread(&FeedHandler::runWorker, this, i);
+    }
+    if (publisher_output_) {
+        publisher_thread_ = startThread(&FeedHandler::runPublisher, this);
+    }
     
     std::cout << "Feed handler started" << std::endl;
     std::cout << "  Mode: " << (config_.mode == ProcessingMode::TickByTick ? "tick-by-tick" : "conflated") << std::endl;
     if (config_.mode == ProcessingMode::Conflated) {
-        std::cout << "  Conflation interval: " << config_.conflation_interval_ms << "ms" << std::endl;
+        std::cout << "  Conflation interval: " << config_.conflation_interval_ms << "ms (publisher thread)" << std::endl;
+        if (scheduler_->maxPending() != 0 || scheduler_->maxStalenessMs() != 0) {
+            std::cout << "  Early flush: " << scheduler_->maxPending() << " pending books, "
+                      << scheduler_->maxStalenessMs() << "ms staleness (0 = off)" << std::endl;
+        }
+        std::cout << "  Snapshot encoding: "
+                  << (config_.snapshot_encoding == SnapshotEncoding::Sbe ? "sbe" : "raw") << std::endl;
+        if (config_.conflation_output == ConflationOutput::Delta) {
+            std::cout << "  Conflation output: delta (full refresh every "
+                      << config_.snapshot_refresh_ms << "ms)" << std::endl;
+        }
+    }
+    if (!workers_.empty()) {
+        std::cout << "  Book workers: " << workers_.size() << std::endl;
+    }
+    if (filter_.active()) {
+        std::cout << "  Symbol filter: " << filter_.symbolCount() << " symbols" << std::endl;
+    }
+    if (!config_.checkpoint.file.empty()) {
+        std::cout << "  Checkpoint: " << config_.checkpoint.file;
+        if (config_.checkpoint.interval_sec > 0) {
+            std::cout << " (every " << config_.checkpoint.interval_sec << "s and on stop)" << std::endl;
+        } else {
+            std::cout << " (on stop)" << std::endl;
+        }
     }
     
     return true;
 }
 
 void FeedHandler::stop() {
-    if (!running_) return;
+    if (!started_) return;
     
+    started_ = false;
     running_ = false;
+    metrics_.stop();  // Before the receiver closes under dropCount()
+    stopWorkers();
     receiver_->stop();
-    sender_->stop();
+    for (auto& shard : shards_) {
+        shard->stop();  // Captures the last touched books in conflated mode
+    }
+    stopPublisher();
+    if (book_cache_) book_cache_->close();  // After the shards' last writes
+    if (capture_.isOpen()) {
+        std::cout << "Recorded " << capture_.datagramsWritten() << " datagrams to " << config_.capture_file
+                  << " (" << capture_.writeErrors() << " write errors)" << std::endl;
+        capture_.close();
+    }
     
     std::cout << "Feed handler stopped" << std::endl;
+    
+    // Every other thread has stopped: the last checkpoint needs no pause,
+    // and the final figures come from this one
+    finalCheckpoint();
+    publishStats();
     printStats();
 }
 
 void FeedHandler::run() {
-    if (!running_) {
+    if (!started_) {
         if (!start()) return;
     }
     
-    std::vector<uint8_t> buffer(config_.input_buffer_size);
+    tuneCurrentThread(config_.run_loop);
     
     while (running_) {
-        // Poll with timeout for stats printing
-        int ret = receiver_->poll(100);
-        
-        if (ret > 0) {
-            ssize_t len = receiver_->read(buffer.data(), buffer.size());
-            if (len > 0) {
-                processMessage(buffer.data(), static_cast<size_t>(len));
+        if (config_.run_loop.spin) {
+            // Non-blocking recvmmsg straight back to back, no wakeup latency
+            processBatch(receiver_->readBatch());
+        } else {
+            // Block until input arrives or the next timer is due
+            int ret = receiver_->poll(pollTimeoutMs(TscClock::ticks()));
+            if (ret > 0) {
+                processBatch(receiver_->readBatch());
             }
         }
         
-        // Check conflation timer
-        if (config_.mode == ProcessingMode::Conflated) {
-            checkConflation();
-        }
+        uint64_t now = TscClock::ticks();
         
-        // Print stats periodically
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_stats_time_).count();
-        if (elapsed >= config_.stats_interval_sec) {
-            printStats();
-            last_stats_time_ = now;
+        // Hand counters to the metrics thread
+        if (now >= next_publish_tick_) {
+            publishStats();
+            next_publish_tick_ = now + clock_.fromMillis(STATS_PUBLISH_INTERVAL_MS);
+        }
+        checkpointIfDue(now);
+    }
+    
+    stop();
+}
+
+bool FeedHandler::replay(const ReplayConfig& replay) {
+    if (started_) return false;
+    
+    // Everything start() sets up except the receiver: records go straight
+    // to processMessage(), with no socket in the path
+    if (!startPipeline()) return false;
+    
+    // A restored checkpoint already holds the records it was taken after
+    ReplayConfig resumed = replay;
+    if (restored_records_ > 0) {
+        resumed.skip_records = restored_records_;
+        std::cout << "  Resuming replay after record " << restored_records_ << std::endl;
+    }
+    
+    ReplayStats result;
+    bool ok = replayCapture(
+        resumed, running_, result,
+        [this](uint16_t port) { return port == config_.input_port; },
+        [this](const CaptureRecord& record) {
+            // Stamped as it goes in, so latency measures the handler and not the capture's age
+            processMessage(record.data, record.length, wallClockNs());
+            
+            uint64_t now = TscClock::ticks();
+            if (now >= next_publish_tick_) {
+                publishStats();
+                next_publish_tick_ = now + clock_.fromMillis(STATS_PUBLISH_INTERVAL_MS);
+            }
+            checkpointIfDue(now);
+        });
+    
+    stop();
+    if (ok) result.print(std::cout);
+    return ok;
+}
+
+// ============================================================================
+// Message processing
+// ============================================================================
+
+void FeedHandler::processBatch(const DatagramBatch& batch) {
+    if (batch.empty()) return;
+    
+    stats_.recv_batches++;
+    if (batch.count > stats_.recv_batch_max) stats_.recv_batch_max = batch.count;
+    
+    // Without an RX timestamp, latency counts from when the batch was pulled
+    uint64_t pulled_ns = 0;
+    
+    for (const Datagram& dgram : batch) {
+        uint64_t rx_ns = dgram.rx_timestamp_ns;
+        if (rx_ns == 0) {
+            if (pulled_ns == 0) pulled_ns = wallClockNs();
+            rx_ns = pulled_ns;
+        }
+        if (capture_feed_ >= 0) {
+            capture_.write(capture_feed_, Datagram{dgram.data, dgram.length, rx_ns});
         }
+        processMessage(dgram.data, dgram.length, rx_ns);
     }
 }
 
-void FeedHandler::processMessage(const uint8_t* data, size_t length) {
+void FeedHandler::processMessage(const uint8_t* data, size_t length, uint64_t rx_timestamp_ns) {
     stats_.messages_received++;
     stats_.bytes_received += length;
     
     // ITCH packets may contain multiple messages
-    size_t offset = 0;
-    while (offset + 2 < length) {
-        // Get message length (big-endian 16-bit)
-        uint16_t msg_len = (static_cast<uint16_t>(data[offset]) << 8) | data[offset + 1];
+    itch::forEachMessage(data, length, [&](const uint8_t* msg, size_t msg_len) {
+        if (!filter_.admit(msg, msg_len)) return;
         
-        if (msg_len == 0 || offset + 2 + msg_len > length) break;
-        
-        processItchMessage(data + offset + 2, msg_len);
-        offset += 2 + msg_len;
+        if (workers_.empty()) {
+            shards_[0]->processItchMessage(msg, msg_len, rx_timestamp_ns);
+        } else {
+            dispatchMessage(msg, msg_len, rx_timestamp_ns);
+        }
+    });
+    
+    // Everything produced by one input packet goes out together
+    if (workers_.empty()) {
+        shards_[0]->flush();
     }
 }
 
-void FeedHandler::processItchMessage(const uint8_t* data, size_t length) {
-    if (length < 1) return;
+void FeedHandler::dispatchMessage(const uint8_t* data, size_t length, uint64_t rx_timestamp_ns) {
+    if (length > sizeof(WorkItem::data)) {
+        stats_.dispatch_drops++;
+        return;
+    }
     
-    auto type = static_cast<itch::MessageType>(data[0]);
+    // stock_locate is bytes 1-2 of every ITCH message; 0 (system events) lands on worker 0
+    uint16_t locate = length >= 3 ? static_cast<uint16_t>((data[1] << 8) | data[2]) : 0;
+    Worker& worker = *workers_[locate % workers_.size()];
     
-    switch (type) {
-        case itch::MessageType::AddOrder: {
-            if (length < sizeof(itch::AddOrderMessage)) break;
-            auto* msg = reinterpret_cast<const itch::AddOrderMessage*>(data);
-            
-            std::string symbol = msg->getStock();
-            // Trim trailing spaces
-            symbol.erase(symbol.find_last_not_of(' ') + 1);
-            
-            auto& book = book_manager_->getBook(symbol);
-            book.addOrder(msg->getOrderRef(), msg->side, msg->getPrice(), msg->getShares());
-            stats_.add_orders++;
-            
-            if (config_.mode == ProcessingMode::TickByTick) {
-                auto quote = book.getBBO(0, ++sequence_);
-                sendQuote(quote);
-            }
-            break;
+    WorkItem* item = worker.ring.claim();
+    if (!item) {
+        // Backpressure: the socket / ring buffer absorbs the burst meanwhile
+        stats_.dispatch_stalls++;
+        do {
+            std::this_thread::yield();
+            item = worker.ring.claim();
+        } while (!item);
+    }
+    
+    item->rx_timestamp_ns = rx_timestamp_ns;
+    item->length = static_cast<uint16_t>(length);
+    std::memcpy(item->data, data, length);
+    worker.ring.publish();
+}
+
+// ============================================================================
+// Book workers
+// ============================================================================
+
+void FeedHandler::runWorker(size_t index) {
+    Worker& worker = *workers_[index];
+    ItchShard& shard = *shards_[index];
+    
+    // Workers take the CPUs after the receive thread's
+    RunLoopConfig tuning = config_.run_loop;
+    tuning.busy_poll_us = 0;
+    tuning.cpu = config_.run_loop.cpu >= 0 ? config_.run_loop.cpu + 1 + static_cast<int>(index) : -1;
+    tuneCurrentThread(tuning);
+    
+    uint64_t next_publish = TscClock::ticks() + clock_.fromMillis(STATS_PUBLISH_INTERVAL_MS);
+    unsigned idle_passes = 0;
+    
+    while (true) {
+        size_t processed = 0;
+        while (processed < WORKER_FLUSH_BATCH) {
+            const WorkItem* item = worker.ring.peek();
+            if (!item) break;
+            shard.processItchMessage(item->data, item->length, item->rx_timestamp_ns);
+            worker.ring.release();
+            processed++;
         }
         
-        case itch::MessageType::AddOrderMpid: {
-            if (length < sizeof(itch::AddOrderMpidMessage)) break;
-            auto* msg = reinterpret_cast<const itch::AddOrderMpidMessage*>(data);
-            
-            std::string symbol(msg->stock, 8);
-            symbol.erase(symbol.find_last_not_of(' ') + 1);
-            
-            auto& book = book_manager_->getBook(symbol);
-            book.addOrder(msg->getOrderRef(), msg->side, msg->getPrice(), msg->getShares());
-            stats_.add_orders++;
-            
-            if (config_.mode == ProcessingMode::TickByTick) {
-                auto quote = book.getBBO(0, ++sequence_);
-                sendQuote(quote);
+        if (processed > 0) {
+            shard.flush();
+            idle_passes = 0;
+        } else if (!workers_running_.load(std::memory_order_acquire)) {
+            break;  // Stopped and drained
+        } else if (workers_paused_.load(std::memory_order_acquire) && !worker.ring.peek()) {
+            // Drained and the receive thread is holding input back: the
+            // shard is its to read until it lets go
+            worker.parked.store(true, std::memory_order_release);
+            while (workers_paused_.load(std::memory_order_acquire) &&
+                   workers_running_.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
             }
-            break;
+            worker.parked.store(false, std::memory_order_release);
+            continue;
         }
         
-        case itch::MessageType::OrderDelete: {
-            if (length < sizeof(itch::OrderDeleteMessage)) break;
-            // Note: In production, maintain order_ref -> symbol mapping
-            // to properly route deletes to the correct book
-            (void)data;  // Suppress unused warning
-            stats_.delete_orders++;
-            break;
+        uint64_t now = TscClock::ticks();
+        if (now >= next_publish) {
+            shard.publishStats();
+            next_publish = now + clock_.fromMillis(STATS_PUBLISH_INTERVAL_MS);
         }
         
-        case itch::MessageType::OrderCancel: {
-            if (length < sizeof(itch::OrderCancelMessage)) break;
-            stats_.delete_orders++;
-            break;
+        if (processed == 0 && !config_.run_loop.spin) {
+            if (++idle_passes < WORKER_IDLE_YIELDS) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
         }
-        
-        case itch::MessageType::OrderExecuted: {
-            if (length < sizeof(itch::OrderExecutedMessage)) break;
-            stats_.executions++;
-            break;
+    }
+    
+    shard.flush();
+    shard.publishStats();
+}
+
+void FeedHandler::stopWorkers() {
+    workers_running_.store(false, std::memory_order_release);
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
         }
-        
-        case itch::MessageType::OrderExecutedWithPrice: {
-            if (length < sizeof(itch::OrderExecutedWithPriceMessage)) break;
-            stats_.executions++;
-            break;
+    }
+}
+
+void FeedHandler::pauseWorkers() {
+    workers_paused_.store(true, std::memory_order_release);
+    for (auto& worker : workers_) {
+        while (!worker->parked.load(std::memory_order_acquire) &&
+               workers_running_.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
         }
-        
-        case itch::MessageType::Trade: {
-            if (length < sizeof(itch::TradeMessage)) break;
-            auto* msg = reinterpret_cast<const itch::TradeMessage*>(data);
-            
-            TradeTick trade{};
-            std::memcpy(trade.symbol, msg->stock, 8);
-            trade.timestamp = 0; // TODO: extract from message
-            trade.sequence = ++sequence_;
-            trade.price = msg->getPrice();
-            trade.quantity = msg->getShares();
-            trade.side = static_cast<char>(msg->side);
-            
-            stats_.trades++;
-            
-            if (config_.mode == ProcessingMode::TickByTick) {
-                sendTrade(trade);
-            }
-            break;
+    }
+}
+
+void FeedHandler::resumeWorkers() {
+    workers_paused_.store(false, std::memory_order_release);
+    
+    // Wait for them to leave, so the next pause does not take a worker
+    // still parked from this one as drained
+    for (auto& worker : workers_) {
+        while (worker->parked.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
         }
-        
-        default:
-            // Ignore other message types
-            break;
     }
 }
 
-void FeedHandler::sendSnapshot(const OrderBookSnapshot& snap) {
-    std::vector<uint8_t> buffer;
-    buffer.resize(sizeof(OutputHeader) + sizeof(OrderBookSnapshot));
+// ============================================================================
+// Checkpoint
+// ============================================================================
+
+void FeedHandler::restoreCheckpoint() {
+    const std::string& file = config_.checkpoint.file;
+    CheckpointReader reader;
+    if (!reader.open(file, CheckpointKind::Itch)) {
+        std::cout << "  Checkpoint: nothing restored, starting cold" << std::endl;
+        return;
+    }
     
-    auto* header = reinterpret_cast<OutputHeader*>(buffer.data());
-    header->length = static_cast<uint16_t>(buffer.size());
-    header->type = OutputMessageType::OrderBookSnapshot;
-    header->flags = 0;
-    header->timestamp = snap.timestamp;
+    size_t book_count = 0;
+    size_t order_count = 0;
+    const auto* books = reader.records<ItchCheckpointBook>(CHECKPOINT_BOOKS, book_count);
+    const auto* orders = reader.records<ItchCheckpointOrder>(CHECKPOINT_ORDERS, order_count);
+    if (!books || !orders) {
+        std::cerr << "Checkpoint " << file << " has no ITCH book sections" << std::endl;
+        std::cout << "  Checkpoint: nothing restored, starting cold" << std::endl;
+        return;
+    }
     
-    std::memcpy(buffer.data() + sizeof(OutputHeader), &snap, sizeof(snap));
+    // Each book goes to the shard its locate dispatches to; books the
+    // symbol filter no longer subscribes to are left out with their orders
+    std::vector<OrderBook*> restored(book_count, nullptr);
+    std::vector<uint8_t> owner(book_count, 0);
+    size_t kept = 0;
+    for (size_t i = 0; i < book_count; ++i) {
+        if (!filter_.restoreLocate(books[i].locate, books[i].symbol)) continue;
+        size_t shard = books[i].locate % shards_.size();
+        restored[i] = &shards_[shard]->restoreBook(books[i]);
+        owner[i] = static_cast<uint8_t>(shard);
+        kept++;
+    }
+    size_t live = 0;
+    for (size_t i = 0; i < order_count; ++i) {
+        const ItchCheckpointOrder& order = orders[i];
+        if (order.book >= book_count || !restored[order.book]) continue;
+        shards_[owner[order.book]]->restoreOrder(order, *restored[order.book]);
+        live++;
+    }
     
-    if (sender_->send(buffer)) {
-        stats_.messages_sent++;
-        stats_.bytes_sent += buffer.size();
+    // Restored books reach the cache and the conflation table before the first packet
+    for (auto& shard : shards_) {
+        shard->flush();
     }
+    
+    const CheckpointHeader& header = reader.header();
+    restored_records_ = header.records;
+    uint64_t now = wallClockNs();
+    uint64_t age_ms = now > header.created_ns ? (now - header.created_ns) / 1000000 : 0;
+    std::cout << "  Checkpoint: restored " << kept << " books, " << live << " orders from " << file
+              << " (taken " << age_ms / 1000.0 << "s ago after " << header.records << " records)" << std::endl;
 }
 
-void FeedHandler::sendQuote(const QuoteUpdate& quote) {
-    std::vector<uint8_t> buffer;
-    buffer.resize(sizeof(OutputHeader) + sizeof(QuoteUpdate));
+bool FeedHandler::writeCheckpoint() {
+    uint64_t started = TscClock::ticks();
+    bool pause = !workers_.empty() && workers_running_.load(std::memory_order_acquire);
+    if (pause) pauseWorkers();
+    
+    size_t books = 0;
+    size_t orders = 0;
+    for (const auto& shard : shards_) {
+        books += shard->bookCount();
+        orders += shard->orderCount();
+    }
     
-    auto* header = reinterpret_cast<OutputHeader*>(buffer.data());
-    header->length = static_cast<uint16_t>(buffer.size());
-    header->type = OutputMessageType::QuoteUpdate;
-    header->flags = 0;
-    header->timestamp = quote.timestamp;
+    // ITCH carries no feed sequence here: the position is the input records applied
+    uint64_t records = restored_records_ + stats_.messages_received;
+    CheckpointWriter writer(CheckpointKind::Itch, records, records);
+    writer.addSection(CHECKPOINT_BOOKS, sizeof(ItchCheckpointBook), books);
+    writer.addSection(CHECKPOINT_ORDERS, sizeof(ItchCheckpointOrder), orders);
+    bool ok = writer.open(config_.checkpoint.file);
+    if (ok) {
+        auto* book_out = writer.records<ItchCheckpointBook>(CHECKPOINT_BOOKS);
+        auto* order_out = writer.records<ItchCheckpointOrder>(CHECKPOINT_ORDERS);
+        size_t book_base = 0;
+        size_t order_base = 0;
+        for (auto& shard : shards_) {
+            shard->saveCheckpoint(book_out + book_base, order_out + order_base, static_cast<uint32_t>(book_base));
+            book_base += shard->bookCount();
+            order_base += shard->orderCount();
+        }
+        ok = writer.commit();
+    }
     
-    std::memcpy(buffer.data() + sizeof(OutputHeader), &quote, sizeof(quote));
+    if (pause) resumeWorkers();
     
-    if (sender_->send(buffer)) {
-        stats_.messages_sent++;
-        stats_.bytes_sent += buffer.size();
+    if (ok) {
+        checkpoint_stats_.written++;
+        checkpoint_stats_.last_ns = clock_.toNanos(TscClock::ticks() - started);
+        checkpoint_stats_.last_bytes = writer.size();
+        checkpoint_stats_.last_books = books;
+        checkpoint_stats_.last_orders = orders;
+    } else {
+        checkpoint_stats_.failed++;
     }
+    published_checkpoint_.store(checkpoint_stats_);
+    return ok;
 }
 
-void FeedHandler::sendTrade(const TradeTick& trade) {
-    std::vector<uint8_t> buffer;
-    buffer.resize(sizeof(OutputHeader) + sizeof(TradeTick));
+void FeedHandler::finalCheckpoint() {
+    if (config_.checkpoint.file.empty()) return;
     
-    auto* header = reinterpret_cast<OutputHeader*>(buffer.data());
-    header->length = static_cast<uint16_t>(buffer.size());
-    header->type = OutputMessageType::TradeTick;
-    header->flags = 0;
-    header->timestamp = trade.timestamp;
+    if (writeCheckpoint()) {
+        std::cout << "Checkpoint written to " << config_.checkpoint.file << ": " << checkpoint_stats_.last_books
+                  << " books, " << checkpoint_stats_.last_orders << " orders, "
+                  << checkpoint_stats_.last_bytes / 1024 << " KB" << std::endl;
+    }
+}
+
+void FeedHandler::checkpointIfDue(uint64_t now) {
+    if (next_checkpoint_tick_ == 0 || now < next_checkpoint_tick_) return;
     
-    std::memcpy(buffer.data() + sizeof(OutputHeader), &trade, sizeof(trade));
+    writeCheckpoint();
+    next_checkpoint_tick_ = TscClock::ticks() +
+                            clock_.fromMillis(static_cast<uint64_t>(config_.checkpoint.interval_sec) * 1000);
+}
+
+// ============================================================================
+// Conflation publisher
+// ============================================================================
+
+void FeedHandler::runPublisher() {
+    using Trigger = ConflationScheduler::Trigger;
     
-    if (sender_->send(buffer)) {
-        stats_.messages_sent++;
-        stats_.bytes_sent += buffer.size();
+    Trigger trigger;
+    while ((trigger = scheduler_->wait()) != Trigger::Stop) {
+        publishConflated(trigger == Trigger::Interval);
     }
+    
+    // Whatever ingest captured before it stopped
+    publishConflated(false);
 }
 
-void FeedHandler::checkConflation() {
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now - last_conflation_time_).count();
+void FeedHandler::publishConflated(bool tick) {
+    bool delta = config_.conflation_output == ConflationOutput::Delta;
     
-    if (elapsed >= config_.conflation_interval_ms) {
-        sendConflatedSnapshots();
-        last_conflation_time_ = now;
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        auto& books = published_books_[s];
+        // Early flushes only send what is pending; the refresh period is in ticks
+        if (delta && tick) {
+            refreshSlice(s);
+        }
+        
+        shards_[s]->conflation().drain([&](uint32_t slot, const OrderBookSnapshot& snap) {
+            if (slot >= books.size()) books.resize(slot + 1);
+            publishBook(books[slot], snap, !delta);
+        });
     }
+    publisher_output_->flush();
+    
+    publisher_stats_.write([this](FeedStats& stats) { publisher_output_->fillStats(stats); });
 }
 
-void FeedHandler::sendConflatedSnapshots() {
-    auto dirty_symbols = book_manager_->getDirtySymbols();
+void FeedHandler::publishBook(PublishedBook& book, OrderBookSnapshot snap, bool full) {
+    uint64_t sequence = publisher_sequence_ + 1;
+    snap.sequence = sequence;
     
-    for (const auto& symbol : dirty_symbols) {
-        auto snap = book_manager_->getSnapshot(symbol, 0, ++sequence_);
-        sendSnapshot(snap);
+    if (!full && book.sent) {
+        size_t len = encodeBookDelta(book.last, snap, book.last.sequence, delta_buffer_.data());
+        if (len == 0) return;  // Changed and changed back within the tick
+        
+        // A delta touching most levels can outgrow the snapshot it replaces
+        size_t snapshot_len = config_.snapshot_encoding == SnapshotEncoding::Sbe
+                                  ? l2SnapshotSize(snap) : sizeof(OrderBookSnapshot);
+        if (len < snapshot_len) {
+            publisher_output_->append(OutputMessageType::BookDelta, snap.timestamp,
+                                      delta_buffer_.data(), len);
+            book.last = snap;
+            publisher_sequence_ = sequence;
+            return;
+        }
     }
     
-    book_manager_->clearAllDirty();
+    appendSnapshot(snap);
+    book.last = snap;
+    book.sent = true;
+    publisher_sequence_ = sequence;
+}
+
+void FeedHandler::appendSnapshot(const OrderBookSnapshot& snap) {
+    if (config_.snapshot_encoding == SnapshotEncoding::Raw) {
+        publisher_output_->append(OutputMessageType::OrderBookSnapshot,
+                                  snap.timestamp, &snap, sizeof(snap));
+        return;
+    }
+    
+    size_t len = encodeL2Snapshot(snap, snapshot_buffer_.data(), snapshot_buffer_.size());
+    publisher_output_->append(OutputMessageType::L2Snapshot, snap.timestamp,
+                              snapshot_buffer_.data(), len);
+}
+
+void FeedHandler::refreshSlice(size_t shard) {
+    // Re-send a slice of books in full each tick so every book is refreshed
+    // once per snapshot_refresh_ms for late joiners and receivers that lost a delta
+    ConflationTable& table = shards_[shard]->conflation();
+    auto& books = published_books_[shard];
+    size_t count = table.size();
+    if (count == 0) return;
+    if (books.size() < count) books.resize(count);
+    
+    size_t ticks = static_cast<size_t>(std::max(
+        1, config_.snapshot_refresh_ms / std::max(1, config_.conflation_interval_ms)));
+    
+    // count / ticks books per tick, carrying the remainder so small book
+    // counts still come round once per period
+    size_t& credit = refresh_credit_[shard];
+    credit += count;
+    size_t due = credit / ticks;
+    credit %= ticks;
+    
+    size_t& cursor = refresh_cursor_[shard];
+    OrderBookSnapshot snap;
+    for (size_t i = 0; i < due; ++i) {
+        if (cursor >= count) cursor = 0;
+        uint32_t slot = static_cast<uint32_t>(cursor++);
+        if (table.read(slot, snap)) {
+            publishBook(books[slot], snap, true);
+        }
+    }
+}
+
+void FeedHandler::stopPublisher() {
+    if (!publisher_output_) return;
+    
+    scheduler_->stop();
+    if (publisher_thread_.joinable()) {
+        publisher_thread_.join();
+    }
+    publisher_output_->stop();
+}
+
+int FeedHandler::pollTimeoutMs(uint64_t now) const {
+    // Wake to publish stats at least every 100ms
+    uint64_t deadline = now + clock_.fromMillis(100);
+    if (deadline <= now) return 0;
+    return static_cast<int>((deadline - now + clock_.ticksPerMs() - 1) / clock_.ticksPerMs());
+}
+
+// ============================================================================
+// Stats
+// ============================================================================
+
+void FeedHandler::publishStats() {
+    // Inline shard runs on this thread; workers publish on their own timer
+    if (workers_.empty()) {
+        shards_[0]->publishStats();
+    }
+    published_receive_.store(stats_);
+    if (filter_.active()) {
+        published_filter_.store(filter_.getStats());
+    }
+}
+
+void FeedHandler::collectTotals(FeedStats& total, LatencyRecorder& latency) const {
+    total = published_receive_.load();
+    total.recv_drops = receiver_->dropCount();
+    for (const auto& shard : shards_) {
+        shard->collectStats(total, latency);
+    }
+    if (publisher_output_) {
+        accumulateStats(total, publisher_stats_.load());
+    }
+}
+
+void FeedHandler::collectMetrics(MetricsWriter& out) const {
+    FeedStats stats;
+    LatencyRecorder latency;
+    collectTotals(stats, latency);
+    
+    out.counter("itch_datagrams_received_total", "Datagrams received from the feed", stats.messages_received);
+    out.counter("itch_bytes_received_total", "Bytes received from the feed", stats.bytes_received);
+    out.counter("itch_receive_batches_total", "Non-empty receive batches", stats.recv_batches);
+    out.gauge("itch_receive_batch_max", "Most datagrams in one receive batch",
+              static_cast<double>(stats.recv_batch_max));
+    out.counter("itch_receive_drops_total",
+                "Datagrams lost before the handler (socket buffer overflow, ring overrun, truncation)",
+                stats.recv_drops);
+    out.counter("itch_messages_sent_total", "Output messages sent", stats.messages_sent);
+    out.counter("itch_datagrams_sent_total", "Output datagrams sent", stats.datagrams_sent);
+    out.counter("itch_bytes_sent_total", "Output bytes sent", stats.bytes_sent);
+    out.counter("itch_send_batches_total", "sendmmsg calls", stats.send_batches);
+    out.gauge("itch_send_batch_max", "Most datagrams sent by one sendmmsg",
+              static_cast<double>(stats.send_batch_max));
+    out.counter("itch_add_orders_total", "Orders added", stats.add_orders);
+    out.counter("itch_delete_orders_total", "Orders deleted", stats.delete_orders);
+    out.counter("itch_executions_total", "Order executions", stats.executions);
+    out.counter("itch_trades_total", "Trades", stats.trades);
+    out.counter("itch_errors_total", "Messages or sends that failed", stats.errors);
+    out.gauge("itch_live_orders_peak", "Most orders live at once", static_cast<double>(stats.order_index_high_water));
+    out.counter("itch_order_index_grows_total", "Order index growths past its capacity",
+                stats.order_index_fallback_allocs);
+    
+    if (!workers_.empty()) {
+        out.counter("itch_dispatch_stalls_total", "Dispatches that waited on a full worker ring", stats.dispatch_stalls);
+        out.counter("itch_dispatch_drops_total", "Messages too large for a worker ring slot", stats.dispatch_drops);
+        out.family("itch_worker_queue_depth", "gauge", "Messages waiting in each book worker's ring");
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            out.sample("itch_worker_queue_depth", "worker=\"" + std::to_string(i) + "\"",
+                       static_cast<uint64_t>(workers_[i]->ring.size()));
+        }
+        out.gauge("itch_worker_queue_capacity", "Slots in each book worker's ring",
+                  static_cast<double>(workers_[0]->ring.capacity()));
+    }
+    
+    if (scheduler_) {
+        auto flushes = scheduler_->getStats();
+        out.family("itch_conflation_drains_total", "counter", "Conflation drains by trigger");
+        out.sample("itch_conflation_drains_total", "trigger=\"interval\"", flushes.interval_flushes);
+        out.sample("itch_conflation_drains_total", "trigger=\"max_pending\"", flushes.pending_flushes);
+        out.sample("itch_conflation_drains_total", "trigger=\"staleness\"", flushes.staleness_flushes);
+    }
+    
+    if (filter_.active()) {
+        SymbolFilter::Stats filter = published_filter_.load();
+        out.family("itch_symbol_filter_messages_total", "counter", "Book messages by symbol filter result");
+        out.sample("itch_symbol_filter_messages_total", "result=\"admitted\"", filter.admitted);
+        out.sample("itch_symbol_filter_messages_total", "result=\"dropped\"", filter.dropped);
+        out.sample("itch_symbol_filter_messages_total", "result=\"unresolved\"", filter.unresolved);
+        out.family("itch_symbol_filter_locates", "gauge", "stock_locates classified by the symbol filter");
+        out.sample("itch_symbol_filter_locates", "state=\"subscribed\"", filter.locates_subscribed);
+        out.sample("itch_symbol_filter_locates", "state=\"rejected\"", filter.locates_rejected);
+    }
+    
+    if (!config_.checkpoint.file.empty()) {
+        CheckpointStats checkpoint = published_checkpoint_.load();
+        out.family("itch_checkpoints_total", "counter", "Warm-start checkpoints by result");
+        out.sample("itch_checkpoints_total", "result=\"written\"", checkpoint.written);
+        out.sample("itch_checkpoints_total", "result=\"failed\"", checkpoint.failed);
+        out.gauge("itch_checkpoint_last_seconds", "Time the last checkpoint held ingest up",
+                  static_cast<double>(checkpoint.last_ns) / 1e9);
+        out.gauge("itch_checkpoint_last_bytes", "Size of the last checkpoint",
+                  static_cast<double>(checkpoint.last_bytes));
+        out.gauge("itch_checkpoint_last_orders", "Live orders in the last checkpoint",
+                  static_cast<double>(checkpoint.last_orders));
+    }
+    
+    if (book_cache_) {
+        out.gauge("itch_book_cache_instruments", "Instruments in the shared-memory book cache",
+                  static_cast<double>(book_cache_->used()));
+        out.counter("itch_book_cache_refused_total", "Instruments left out of the full book cache",
+                    book_cache_->refused());
+    }
+    
+    out.family("itch_wire_to_send_latency_seconds", "summary", "Wire-to-send latency by ITCH message type");
+    for (size_t type = 0; type < 256; ++type) {
+        const LatencyHistogram* hist = latency.get(static_cast<uint8_t>(type));
+        if (!hist || hist->count() == 0) continue;
+        out.summary("itch_wire_to_send_latency_seconds",
+                    std::string("type=\"") + static_cast<char>(type) + "\"", *hist);
+    }
 }
 
 void FeedHandler::printStats() {
+    total_latency_.reset();
+    collectTotals(total_stats_, total_latency_);
+    const FeedStats& stats = total_stats_;
+    
     std::cout << "\n=== Feed Handler Stats ===" << std::endl;
-    std::cout << "Messages received: " << stats_.messages_received << std::endl;
-    std::cout << "Messages sent:     " << stats_.messages_sent << std::endl;
-    std::cout << "Bytes received:    " << stats_.bytes_received << std::endl;
-    std::cout << "Bytes sent:        " << stats_.bytes_sent << std::endl;
-    std::cout << "Add orders:        " << stats_.add_orders << std::endl;
-    std::cout << "Delete orders:     " << stats_.delete_orders << std::endl;
-    std::cout << "Executions:        " << stats_.executions << std::endl;
-    std::cout << "Trades:            " << stats_.trades << std::endl;
+    std::cout << "Messages received: " << stats.messages_received << std::endl;
+    std::cout << "Messages sent:     " << stats.messages_sent << std::endl;
+    std::cout << "Datagrams sent:    " << stats.datagrams_sent << std::endl;
+    std::cout << "Send batches:      " << stats.send_batches
+              << " (max " << stats.send_batch_max << ")" << std::endl;
+    std::cout << "Bytes received:    " << stats.bytes_received << std::endl;
+    std::cout << "Receive batches:   " << stats.recv_batches
+              << " (max " << stats.recv_batch_max << ")" << std::endl;
+    std::cout << "Receive drops:     " << stats.recv_drops << std::endl;
+    if (!workers_.empty()) {
+        std::cout << "Dispatch stalls:   " << stats.dispatch_stalls
+                  << " (oversized drops: " << stats.dispatch_drops << ")" << std::endl;
+    }
+    std::cout << "Bytes sent:        " << stats.bytes_sent << std::endl;
+    std::cout << "Add orders:        " << stats.add_orders << std::endl;
+    std::cout << "Delete orders:     " << stats.delete_orders << std::endl;
+    std::cout << "Executions:        " << stats.executions << std::endl;
+    std::cout << "Trades:            " << stats.trades << std::endl;
+    if (scheduler_) {
+        auto flushes = scheduler_->getStats();
+        std::cout << "Conflation drains: " << flushes.interval_flushes << " interval, "
+                  << flushes.pending_flushes << " max_pending, "
+                  << flushes.staleness_flushes << " staleness" << std::endl;
+    }
+    if (filter_.active()) {
+        SymbolFilter::Stats filter = published_filter_.load();
+        std::cout << "Symbol filter:     " << filter.admitted << " admitted, " << filter.dropped
+                  << " dropped, " << filter.unresolved << " unresolved ("
+                  << filter.locates_subscribed << " locates subscribed, "
+                  << filter.locates_rejected << " rejected)" << std::endl;
+    }
+    std::cout << "Live orders peak:  " << stats.order_index_high_water
+              << " (index grows: " << stats.order_index_fallback_allocs << ")" << std::endl;
+    if (!config_.checkpoint.file.empty()) {
+        CheckpointStats checkpoint = published_checkpoint_.load();
+        std::cout << "Checkpoints:       " << checkpoint.written << " written, " << checkpoint.failed
+                  << " failed (last: " << checkpoint.last_books << " books, " << checkpoint.last_orders
+                  << " orders, " << checkpoint.last_ns / 1000 << "us)" << std::endl;
+    }
+    std::cout << "Wire-to-send latency by message type:" << std::endl;
+    total_latency_.print(std::cout);
     std::cout << "==========================\n" << std::endl;
+    
+    if (latency_log_.is_open()) {
+        total_latency_.writeCsv(latency_log_, wallClockNs());
+    }
 }
 
 } // namespace feedhandler
@@ -1,45 +1,32 @@
 #pragma once
 
-#include "itch_protocol.h"
+#include "book_cache.h"
+#include "capture_file.h"
+#include "checkpoint_file.h"
+#include "conflation_scheduler.h"
+#include "feedhandler_config.h"
+#include "itch_shard.h"
+#include "latency_histogram.h"
 #include "market_data.h"
-#include "multicast.h"
-#include "order_book.h"
+#include "metrics.h"
+#include "output_writer.h"
+#include "packet_source.h"
+#include "replay.h"
+#include "seqlock.h"
+#include "spsc_ring.h"
+#include "symbol_filter.h"
+#include "tsc_clock.h"
 
 #include <atomic>
 #include <chrono>
+#include <fstream>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace feedhandler {
 
-enum class ProcessingMode {
-    TickByTick,     // Forward processed data immediately
-    Conflated,      // Batch updates and send at intervals
-};
-
-struct FeedHandlerConfig {
-    // Input
-    std::string input_group = "239.1.1.1";
-    uint16_t input_port = 30001;
-    std::string input_interface = "0.0.0.0";
-    size_t input_buffer_size = 65536;
-    
-    // Output
-    std::string output_group = "239.1.1.2";
-    uint16_t output_port = 30002;
-    std::string output_interface = "0.0.0.0";
-    int output_ttl = 1;
-    
-    // Processing
-    ProcessingMode mode = ProcessingMode::TickByTick;
-    int conflation_interval_ms = 100;
-    size_t book_depth = 10;
-    
-    // Stats
-    int stats_interval_sec = 10;
-};
-
 class FeedHandler {
 public:
     explicit FeedHandler(const FeedHandlerConfig& config);
@@ -50,42 +37,158 @@ public:
     FeedHandler& operator=(const FeedHandler&) = delete;
     
     bool start();
+    
+    // Tear everything down; run() and replay() call it on their way out.
+    // Not from a signal handler: use requestStop().
     void stop();
-    void run();  // Blocking run loop
     
-    const FeedStats& getStats() const { return stats_; }
-    bool isRunning() const { return running_; }
+    void run();  // Blocking run loop, stops the handler when it returns
     
+    // Async-signal-safe: make run() / replay() return at the end of the
+    // current batch, which then stop() on their own thread
+    void requestStop() { running_.store(false, std::memory_order_relaxed); }
+    
+    // Instead of start() / run(): feed a recorded capture through the same
+    // processing, paced or flat out, then stop. False if the capture could
+    // not be opened or the handler is already running.
+    bool replay(const ReplayConfig& replay);
+    
+    // Totals across shards as of the last stats report (read after stop(),
+    // or from the metrics thread's report)
+    const FeedStats& getStats() const { return total_stats_; }
+    const LatencyRecorder& getLatency() const { return total_latency_; }
+    bool isRunning() const { return running_; }
+
 private:
     FeedHandlerConfig config_;
-    std::atomic<bool> running_{false};
+    std::atomic<bool> running_{false};      // Processing loop keeps going
+    bool started_ = false;                  // Pipeline up, stop() has work to do
+    
+    std::unique_ptr<PacketSource> receiver_;
+    
+    // Recording (capture_file): every received datagram, before filtering
+    CaptureWriter capture_;
+    int capture_feed_ = -1;
     
-    std::unique_ptr<MulticastReceiver> receiver_;
-    std::unique_ptr<MulticastSender> sender_;
-    std::unique_ptr<OrderBookManager> book_manager_;
+    // Subscribed symbols: everything else is dropped before reaching a shard
+    SymbolFilter filter_;
     
-    FeedStats stats_;
-    uint64_t sequence_ = 0;
+    // Conflated mode: when the publisher drains (declared before the shards
+    // that report to it)
+    std::unique_ptr<ConflationScheduler> scheduler_;
     
-    // Conflation timer
-    std::chrono::steady_clock::time_point last_conflation_time_;
+    // Shared-memory last-value cache (book_cache.name), written by the shards
+    std::unique_ptr<BookCacheWriter> book_cache_;
+    
+    // One shard inline, or one per book worker
+    std::vector<std::unique_ptr<ItchShard>> shards_;
+    
+    FeedStats stats_;                   // Receive-side counters
+    
+    // Timers run off TSC deadlines so the spin loop can check them every pass
+    TscClock clock_;
+    uint64_t next_publish_tick_ = 0;
+    
+    // Shards, workers and publisher: the part of start() replay() shares
+    bool startPipeline();
     
     // Message processing
-    void processMessage(const uint8_t* data, size_t length);
-    void processItchMessage(const uint8_t* data, size_t length);
+    void processBatch(const DatagramBatch& batch);
+    void processMessage(const uint8_t* data, size_t length, uint64_t rx_timestamp_ns = 0);
+    
+    // Pipelined mode: the receive thread splits packets and routes each
+    // message by stock_locate, so a symbol is always handled by one worker
+    // and keeps its order
+    struct WorkItem {
+        uint64_t rx_timestamp_ns;
+        uint16_t length;
+        uint8_t data[54];               // Largest book-relevant ITCH message is 50
+    };
+    static_assert(sizeof(WorkItem) == 64, "WorkItem should fill one cache line");
+    
+    struct Worker {
+        explicit Worker(size_t ring_size) : ring(ring_size) {}
+        SpscRing<WorkItem> ring;
+        std::thread thread;
+        std::atomic<bool> parked{false};    // Drained and waiting out a pause
+    };
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> workers_running_{false};
+    std::atomic<bool> workers_paused_{false};
     
-    // Output
-    void sendSnapshot(const OrderBookSnapshot& snap);
-    void sendQuote(const QuoteUpdate& quote);
-    void sendTrade(const TradeTick& trade);
+    void dispatchMessage(const uint8_t* data, size_t length, uint64_t rx_timestamp_ns);
+    void runWorker(size_t index);
+    void stopWorkers();
     
-    // Conflation
-    void checkConflation();
-    void sendConflatedSnapshots();
+    // Receive thread: hold every worker once its ring is drained, so the
+    // shards can be read from this thread, and let them go again
+    void pauseWorkers();
+    void resumeWorkers();
     
-    // Stats
+    // Warm start (checkpoint.file): startPipeline() loads the checkpoint
+    // before any thread starts, the receive thread writes one on a timer
+    // (workers paused meanwhile) and when run() or replay() finishes
+    struct CheckpointStats {
+        uint64_t written = 0;
+        uint64_t failed = 0;
+        uint64_t last_ns = 0;           // Time the last one held ingest up
+        uint64_t last_bytes = 0;
+        uint64_t last_books = 0;
+        uint64_t last_orders = 0;
+    };
+    void restoreCheckpoint();
+    bool writeCheckpoint();
+    void finalCheckpoint();
+    void checkpointIfDue(uint64_t now);
+    uint64_t restored_records_ = 0;     // Input records the restored checkpoint covers
+    uint64_t next_checkpoint_tick_ = 0;
+    CheckpointStats checkpoint_stats_;  // Receive thread
+    SeqLock<CheckpointStats> published_checkpoint_;
+    
+    int pollTimeoutMs(uint64_t now) const;
+    
+    // Conflated mode: a publisher thread drains every shard's ConflationTable
+    // each interval (or early, see ConflationScheduler) and sends the
+    // snapshots, so ingest never waits on output. tick = a regular interval
+    // tick, which also advances the delta refresh cycle.
+    void runPublisher();
+    void publishConflated(bool tick);
+    void stopPublisher();
+    
+    // Delta output: what each book last looked like on the wire
+    struct PublishedBook {
+        OrderBookSnapshot last;         // Base for the next delta
+        bool sent = false;
+    };
+    void publishBook(PublishedBook& book, OrderBookSnapshot snap, bool full);
+    void appendSnapshot(const OrderBookSnapshot& snap);
+    void refreshSlice(size_t shard);
+    std::vector<std::vector<PublishedBook>> published_books_;  // [shard][slot]
+    std::vector<size_t> refresh_cursor_;                       // [shard]
+    std::vector<size_t> refresh_credit_;                       // [shard] books owed x ticks
+    std::vector<uint8_t> delta_buffer_;
+    std::vector<uint8_t> snapshot_buffer_;                     // SBE encoding
+    
+    std::unique_ptr<OutputWriter> publisher_output_;
+    std::thread publisher_thread_;
+    uint64_t publisher_sequence_ = 0;
+    SeqLock<FeedStats> publisher_stats_;    // Send-side counters
+    
+    // Stats: the receive thread (and each worker) publishes its counters on
+    // a timer; the metrics thread reads them for /metrics and the periodic
+    // report, so neither formatting nor stdout ever lands on the hot path
+    void publishStats();
+    void collectTotals(FeedStats& total, LatencyRecorder& latency) const;
+    void collectMetrics(MetricsWriter& out) const;
     void printStats();
-    std::chrono::steady_clock::time_point last_stats_time_;
+    SeqLock<FeedStats> published_receive_;
+    SeqLock<SymbolFilter::Stats> published_filter_;
+    MetricsServer metrics_;
+    
+    // Metrics thread only (and stop(), once it has been joined)
+    FeedStats total_stats_;
+    LatencyRecorder total_latency_;
+    std::ofstream latency_log_;
 };
 
 } // namespace feedhandler
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "book_cache.h"
+#include "checkpoint_file.h"
+#include "metrics.h"
+#include "order_book.h"
+#include "order_index.h"
+#include "price_ladder.h"
+#include "receive_backend.h"
+#include "thread_tuning.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace feedhandler {
+
+enum class ProcessingMode {
+    TickByTick,     // Forward processed data immediately
+    Conflated,      // Batch updates and send at intervals
+};
+
+// What a conflation tick sends for each dirty book
+enum class ConflationOutput {
+    Snapshot,       // Full book snapshot
+    Delta,          // BookDelta of changed levels, full snapshots on a refresh cycle
+};
+
+// Wire form of conflated snapshots
+enum class SnapshotEncoding {
+    Raw,            // Fixed-size OrderBookSnapshot struct, all MAX_DEPTH levels
+    Sbe,            // SBE L2Snapshot, populated levels only
+};
+
+struct FeedHandlerConfig {
+    // Input
+    std::string input_group = "239.1.1.1";
+    uint16_t input_port = 30001;
+    std::string input_interface = "0.0.0.0";
+    size_t input_buffer_size = 65536;   // SO_RCVBUF
+    size_t input_max_datagram = MAX_DATAGRAM_SIZE;  // recvmmsg buffer per datagram
+    size_t recv_batch_size = 64;        // Datagrams drained per recvmmsg
+    ReceiveBackendConfig input_backend; // Kernel socket or zero-copy packet ring
+    std::string capture_file;           // Record received datagrams as pcap (empty = off)
+    RunLoopConfig run_loop;             // Spin / busy-poll / pinning for run()
+    
+    // Output
+    std::string output_group = "239.1.1.2";
+    uint16_t output_port = 30002;
+    std::string output_interface = "0.0.0.0";
+    int output_ttl = 1;
+    size_t output_mtu = 0;      // Pack messages per datagram up to this size (0 = one per datagram)
+    size_t send_batch_size = 64;        // Datagrams per sendmmsg
+    BookCacheConfig book_cache;         // Latest books in shared memory for local readers
+    
+    // Processing
+    ProcessingMode mode = ProcessingMode::TickByTick;
+    int conflation_interval_ms = 100;
+    size_t conflation_max_pending = 10000;  // Drain early once this many books are waiting (0 = off)
+    int conflation_max_staleness_ms = 0;    // Drain early once an update has waited this long (0 = off)
+    ConflationOutput conflation_output = ConflationOutput::Snapshot;
+    SnapshotEncoding snapshot_encoding = SnapshotEncoding::Sbe;
+    int snapshot_refresh_ms = 1000;     // Delta output: every book re-sent in full over this period
+    size_t book_depth = 10;
+    std::vector<std::string> symbols;   // Subscribed symbols (empty = all)
+    LevelStorage book_storage = LevelStorage::Map;
+    LadderConfig ladder;                // Used when book_storage == Ladder
+    size_t order_index_capacity = OrderIndex::DEFAULT_CAPACITY;  // Peak live orders
+    
+    // Pipelining: a receive thread dispatching by stock_locate to book workers
+    size_t worker_threads = 0;          // Book worker threads (0 = everything on run()'s thread)
+    size_t worker_ring_size = 65536;    // Messages buffered per worker
+    
+    // Warm start: books and live orders saved to checkpoint.file, loaded on startup
+    CheckpointConfig checkpoint;
+    
+    // Stats
+    int stats_interval_sec = 10;        // Report to stdout, from the metrics thread (0 = off)
+    MetricsConfig metrics;              // Prometheus /metrics endpoint
+    bool rx_timestamps = true;          // SO_TIMESTAMPING for wire-to-send latency
+    std::string latency_log;            // Append latency percentiles as CSV (empty = off)
+};
+
+} // namespace feedhandler
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "itch_protocol.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace feedhandler {
+namespace itch {
+
+// Compile-time ITCH dispatch.
+//
+// A handler is any class with on(const XxxMessage&) overloads for the
+// message types it cares about. Decoder<Handler> builds, at compile time, a
+// 256-entry jump table indexed by the type byte from itch::Messages: a type
+// the handler has an overload for gets a thunk that checks the length
+// against sizeof the struct and calls the overload; every other byte gets a
+// no-op. Types a handler does not handle generate no code, and no switch
+// over message types is written by hand. Handlers may keep their on()
+// overloads private and befriend Decoder<Handler>.
+//
+//     struct Counter {
+//         size_t adds = 0;
+//         void on(const itch::AddOrderMessage&) { adds++; }
+//     };
+//     Counter counter;
+//     itch::forEachMessage(packet, len, [&](const uint8_t* msg, size_t n) {
+//         itch::Decoder<Counter>::dispatch(msg, n, counter);
+//     });
+template <typename Handler>
+class Decoder {
+public:
+    // Decode one message (without its length prefix) and call the handler.
+    // False if the type is not handled or the message is truncated.
+    static bool dispatch(const uint8_t* data, size_t length, Handler& handler) {
+        if (length == 0) return false;
+        return TABLE[data[0]](data, length, handler);
+    }
+    
+    // Whether Handler has an overload for this type
+    static constexpr bool handles(MessageType type) {
+        return TABLE[static_cast<uint8_t>(type)] != &ignore;
+    }
+
+private:
+    using Thunk = bool (*)(const uint8_t*, size_t, Handler&);
+    
+    static bool ignore(const uint8_t*, size_t, Handler&) { return false; }
+    
+    template <typename Msg>
+    static bool invoke(const uint8_t* data, size_t length, Handler& handler) {
+        if (length < sizeof(Msg)) return false;
+        handler.on(*reinterpret_cast<const Msg*>(data));
+        return true;
+    }
+    
+    // Overload detection, evaluated here so a friend Decoder sees private on()s
+    template <typename Msg>
+    static constexpr auto hasHandler(int)
+        -> decltype(std::declval<Handler&>().on(std::declval<const Msg&>()), true) {
+        return true;
+    }
+    template <typename Msg>
+    static constexpr bool hasHandler(...) { return false; }
+    
+    // Only handled types instantiate a thunk
+    template <typename Msg>
+    static constexpr void addHandler(std::array<Thunk, 256>& table) {
+        if constexpr (hasHandler<Msg>(0)) {
+            table[static_cast<uint8_t>(Msg::TYPE)] = &invoke<Msg>;
+        }
+    }
+    
+    template <typename... Msgs>
+    static constexpr std::array<Thunk, 256> makeTable(MessageList<Msgs...>) {
+        std::array<Thunk, 256> table{};
+        for (auto& entry : table) entry = &ignore;
+        (addHandler<Msgs>(table), ...);
+        return table;
+    }
+    
+    static constexpr std::array<Thunk, 256> TABLE = makeTable(Messages{});
+};
+
+// Walk a packet of length-prefixed ITCH messages, calling fn(data, length)
+// for each message (without its prefix). Stops at a zero length or a message
+// that runs past the end. Returns the number of messages visited.
+template <typename Fn>
+size_t forEachMessage(const uint8_t* packet, size_t length, Fn&& fn) {
+    size_t count = 0;
+    size_t offset = 0;
+    while (offset + 2 < length) {
+        // Big-endian 16-bit length
+        size_t msg_len = (static_cast<size_t>(packet[offset]) << 8) | packet[offset + 1];
+        if (msg_len == 0 || offset + 2 + msg_len > length) break;
+    
+        fn(packet + offset + 2, msg_len);
+        offset += 2 + msg_len;
+        count++;
+    }
+    return count;
+}
+
+} // namespace itch
+} // namespace feedhandler
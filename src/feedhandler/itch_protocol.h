@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <string>
@@ -54,6 +56,8 @@ struct MessageHeader {
 
 // System Event Message (S)
 struct SystemEventMessage {
+    static constexpr MessageType TYPE = MessageType::SystemEvent;
+    
     MessageType type;       // 'S'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -67,6 +71,8 @@ struct SystemEventMessage {
 
 // Stock Directory Message (R)
 struct StockDirectoryMessage {
+    static constexpr MessageType TYPE = MessageType::StockDirectory;
+    
     MessageType type;       // 'R'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -86,6 +92,10 @@ struct StockDirectoryMessage {
     uint32_t etp_leverage_factor;
     char inverse_indicator;
     
+    uint16_t getStockLocate() const {
+        return __builtin_bswap16(stock_locate);
+    }
+    
     std::string getStock() const {
         return std::string(stock, 8);
     }
@@ -93,6 +103,8 @@ struct StockDirectoryMessage {
 
 // Add Order Message (A)
 struct AddOrderMessage {
+    static constexpr MessageType TYPE = MessageType::AddOrder;
+    
     MessageType type;       // 'A'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -103,6 +115,10 @@ struct AddOrderMessage {
     char stock[8];
     uint32_t price;         // Price in fixed-point (4 decimal places)
     
+    uint16_t getStockLocate() const {
+        return __builtin_bswap16(stock_locate);
+    }
+    
     uint64_t getOrderRef() const {
         return __builtin_bswap64(order_ref);
     }
@@ -126,6 +142,8 @@ struct AddOrderMessage {
 
 // Add Order with MPID Message (F)
 struct AddOrderMpidMessage {
+    static constexpr MessageType TYPE = MessageType::AddOrderMpid;
+    
     MessageType type;       // 'F'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -137,6 +155,10 @@ struct AddOrderMpidMessage {
     uint32_t price;
     char mpid[4];
     
+    uint16_t getStockLocate() const {
+        return __builtin_bswap16(stock_locate);
+    }
+    
     uint64_t getOrderRef() const {
         return __builtin_bswap64(order_ref);
     }
@@ -152,6 +174,8 @@ struct AddOrderMpidMessage {
 
 // Order Executed Message (E)
 struct OrderExecutedMessage {
+    static constexpr MessageType TYPE = MessageType::OrderExecuted;
+    
     MessageType type;       // 'E'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -167,10 +191,16 @@ struct OrderExecutedMessage {
     uint32_t getExecutedShares() const {
         return __builtin_bswap32(executed_shares);
     }
+    
+    uint64_t getMatchNumber() const {
+        return __builtin_bswap64(match_number);
+    }
 };
 
 // Order Executed with Price Message (C)
 struct OrderExecutedWithPriceMessage {
+    static constexpr MessageType TYPE = MessageType::OrderExecutedWithPrice;
+    
     MessageType type;       // 'C'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -181,6 +211,18 @@ struct OrderExecutedWithPriceMessage {
     char printable;
     uint32_t execution_price;
     
+    uint64_t getOrderRef() const {
+        return __builtin_bswap64(order_ref);
+    }
+    
+    uint32_t getExecutedShares() const {
+        return __builtin_bswap32(executed_shares);
+    }
+    
+    uint64_t getMatchNumber() const {
+        return __builtin_bswap64(match_number);
+    }
+    
     uint32_t getExecutionPrice() const {
         return __builtin_bswap32(execution_price);
     }
@@ -188,6 +230,8 @@ struct OrderExecutedWithPriceMessage {
 
 // Order Cancel Message (X)
 struct OrderCancelMessage {
+    static constexpr MessageType TYPE = MessageType::OrderCancel;
+    
     MessageType type;       // 'X'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -206,6 +250,8 @@ struct OrderCancelMessage {
 
 // Order Delete Message (D)
 struct OrderDeleteMessage {
+    static constexpr MessageType TYPE = MessageType::OrderDelete;
+    
     MessageType type;       // 'D'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -219,6 +265,8 @@ struct OrderDeleteMessage {
 
 // Order Replace Message (U)
 struct OrderReplaceMessage {
+    static constexpr MessageType TYPE = MessageType::OrderReplace;
+    
     MessageType type;       // 'U'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -247,6 +295,8 @@ struct OrderReplaceMessage {
 
 // Trade Message (P) - Non-cross
 struct TradeMessage {
+    static constexpr MessageType TYPE = MessageType::Trade;
+    
     MessageType type;       // 'P'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -258,6 +308,10 @@ struct TradeMessage {
     uint32_t price;
     uint64_t match_number;
     
+    uint16_t getStockLocate() const {
+        return __builtin_bswap16(stock_locate);
+    }
+    
     uint32_t getShares() const {
         return __builtin_bswap32(shares);
     }
@@ -273,6 +327,8 @@ struct TradeMessage {
 
 // Cross Trade Message (Q)
 struct CrossTradeMessage {
+    static constexpr MessageType TYPE = MessageType::CrossTrade;
+    
     MessageType type;       // 'Q'
     uint16_t stock_locate;
     uint16_t tracking_number;
@@ -291,22 +347,55 @@ inline MessageType getMessageType(const uint8_t* data) {
     return static_cast<MessageType>(data[2]); // After 2-byte length
 }
 
-// Helper to get message size by type
-inline size_t getMessageSize(MessageType type) {
-    switch (type) {
-        case MessageType::SystemEvent: return sizeof(SystemEventMessage) + 2;
-        case MessageType::StockDirectory: return sizeof(StockDirectoryMessage) + 2;
-        case MessageType::AddOrder: return sizeof(AddOrderMessage) + 2;
-        case MessageType::AddOrderMpid: return sizeof(AddOrderMpidMessage) + 2;
-        case MessageType::OrderExecuted: return sizeof(OrderExecutedMessage) + 2;
-        case MessageType::OrderExecutedWithPrice: return sizeof(OrderExecutedWithPriceMessage) + 2;
-        case MessageType::OrderCancel: return sizeof(OrderCancelMessage) + 2;
-        case MessageType::OrderDelete: return sizeof(OrderDeleteMessage) + 2;
-        case MessageType::OrderReplace: return sizeof(OrderReplaceMessage) + 2;
-        case MessageType::Trade: return sizeof(TradeMessage) + 2;
-        case MessageType::CrossTrade: return sizeof(CrossTradeMessage) + 2;
-        default: return 0;
-    }
+// Every message carries its 6-byte timestamp (ns since midnight) at offset 5.
+// The structs above model it as the high bytes of a big-endian uint64_t.
+inline uint64_t getTimestamp(const uint8_t* msg) {
+    uint64_t raw;
+    std::memcpy(&raw, msg + 5, sizeof(raw));
+    return __builtin_bswap64(raw) >> 16;
+}
+
+inline uint64_t encodeTimestamp(uint64_t nanos_since_midnight) {
+    return __builtin_bswap64(nanos_since_midnight << 16);
+}
+
+// Every message struct above, in one list. Sizes and the decoder's jump
+// table (itch_decoder.h) are generated from it, so adding a message type
+// means adding its struct here and nothing else.
+template <typename... Msgs>
+struct MessageList {};
+
+using Messages = MessageList<
+    SystemEventMessage,
+    StockDirectoryMessage,
+    AddOrderMessage,
+    AddOrderMpidMessage,
+    OrderExecutedMessage,
+    OrderExecutedWithPriceMessage,
+    OrderCancelMessage,
+    OrderDeleteMessage,
+    OrderReplaceMessage,
+    TradeMessage,
+    CrossTradeMessage>;
+
+namespace detail {
+
+template <typename... Msgs>
+constexpr std::array<uint16_t, 256> makeSizeTable(MessageList<Msgs...>) {
+    std::array<uint16_t, 256> sizes{};
+    ((sizes[static_cast<uint8_t>(Msgs::TYPE)] = sizeof(Msgs)), ...);
+    return sizes;
+}
+
+} // namespace detail
+
+// Message size (without the 2-byte length prefix) by type byte, 0 = unknown
+inline constexpr std::array<uint16_t, 256> MESSAGE_SIZES = detail::makeSizeTable(Messages{});
+
+// Helper to get message size by type (including the length prefix), 0 if unknown
+constexpr size_t getMessageSize(MessageType type) {
+    size_t size = MESSAGE_SIZES[static_cast<uint8_t>(type)];
+    return size ? size + 2 : 0;
 }
 
 } // namespace itch
@@ -0,0 +1,378 @@
+#include "itch_shard.h"
+
+#include "tsc_clock.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace feedhandler {
+
+ItchShard::ItchShard(const FeedHandlerConfig& config, uint8_t shard_id, size_t shard_count,
+                     ConflationScheduler* scheduler, BookCacheWriter* cache)
+    : config_(config)
+    , shard_id_(shard_id)
+    , conflated_(config.mode == ProcessingMode::Conflated)
+    , output_(config, shard_id)
+    , scheduler_(scheduler)
+    , cache_(cache) {
+    size_t shards = std::max<size_t>(shard_count, 1);
+    
+    book_manager_ = std::make_unique<OrderBookManager>(config_.book_depth, config_.book_storage, config_.ladder);
+    order_index_ = std::make_unique<OrderIndex>(config_.order_index_capacity / shards);
+    pending_latency_.reserve(1024);
+}
+
+bool ItchShard::start() {
+    // Conflated output leaves through the publisher thread's own writer
+    if (!conflated_ && !output_.start()) {
+        std::cerr << "Failed to start sender for shard " << static_cast<int>(shard_id_) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ItchShard::stop() {
+    flush();
+    output_.stop();
+}
+
+// ============================================================================
+// Message processing
+// ============================================================================
+
+void ItchShard::processItchMessage(const uint8_t* data, size_t length, uint64_t rx_timestamp_ns) {
+    if (length < 1) return;
+    
+    current_type_ = data[0];
+    current_timestamp_ = length >= 13 ? itch::getTimestamp(data) : 0;
+    current_rx_ns_ = rx_timestamp_ns;
+    
+    // Jump table over the on() overloads below; other types are ignored
+    itch::Decoder<ItchShard>::dispatch(data, length, *this);
+}
+
+void ItchShard::on(const itch::StockDirectoryMessage& msg) {
+    std::string symbol = msg.getStock();
+    symbol.erase(symbol.find_last_not_of(' ') + 1);
+    book_manager_->registerLocate(msg.getStockLocate(), symbol);
+}
+
+template <typename AddMessage>
+void ItchShard::onAddOrder(const AddMessage& msg) {
+    auto& book = resolveBook(msg.getStockLocate(), msg.stock);
+    Order order{msg.getOrderRef(), msg.getPrice(), msg.getShares(), msg.side};
+    stats_.add_orders++;
+    if (!order_index_->insert(order, &book)) {
+        stats_.errors++;  // order_ref 0: could never be executed or deleted
+        return;
+    }
+    book.addOrder(order);
+    
+    if (config_.mode == ProcessingMode::TickByTick) {
+        auto quote = book.getBBO(current_timestamp_, ++sequence_);
+        sendQuote(quote);
+    }
+}
+
+void ItchShard::on(const itch::AddOrderMessage& msg) {
+    onAddOrder(msg);
+}
+
+void ItchShard::on(const itch::AddOrderMpidMessage& msg) {
+    onAddOrder(msg);
+}
+
+void ItchShard::on(const itch::OrderDeleteMessage& msg) {
+    stats_.delete_orders++;
+    
+    auto* entry = order_index_->find(msg.getOrderRef());
+    if (!entry) return;  // Order added before we joined the feed
+    
+    OrderBook* book = entry->book;
+    book->deleteOrder(entry->order);
+    order_index_->erase(entry);
+    
+    if (config_.mode == ProcessingMode::TickByTick) {
+        sendQuote(book->getBBO(current_timestamp_, ++sequence_));
+    }
+}
+
+void ItchShard::on(const itch::OrderCancelMessage& msg) {
+    stats_.delete_orders++;
+    
+    auto* entry = order_index_->find(msg.getOrderRef());
+    if (!entry) return;
+    
+    OrderBook* book = entry->book;
+    if (book->cancelOrder(entry->order, msg.getCancelledShares())) {
+        order_index_->erase(entry);
+    }
+    
+    if (config_.mode == ProcessingMode::TickByTick) {
+        sendQuote(book->getBBO(current_timestamp_, ++sequence_));
+    }
+}
+
+void ItchShard::on(const itch::OrderExecutedMessage& msg) {
+    stats_.executions++;
+    
+    auto* entry = order_index_->find(msg.getOrderRef());
+    if (!entry) return;
+    
+    onOrderExecuted(entry, msg.getExecutedShares(),
+                    entry->order.price, msg.getMatchNumber());
+}
+
+void ItchShard::on(const itch::OrderExecutedWithPriceMessage& msg) {
+    stats_.executions++;
+    
+    auto* entry = order_index_->find(msg.getOrderRef());
+    if (!entry) return;
+    
+    onOrderExecuted(entry, msg.getExecutedShares(),
+                    msg.getExecutionPrice(), msg.getMatchNumber());
+}
+
+void ItchShard::on(const itch::OrderReplaceMessage& msg) {
+    stats_.delete_orders++;
+    stats_.add_orders++;
+    
+    auto* entry = order_index_->find(msg.getOriginalOrderRef());
+    if (!entry) return;
+    
+    // Replacement keeps the side of the original order
+    OrderBook* book = entry->book;
+    Order old_order = entry->order;
+    Order new_order{msg.getNewOrderRef(), msg.getPrice(), msg.getShares(), old_order.side};
+    order_index_->erase(entry);
+    if (order_index_->insert(new_order, book)) {
+        book->replaceOrder(old_order, new_order);
+    } else {
+        book->deleteOrder(old_order);  // Unusable new_order_ref 0
+        stats_.errors++;
+    }
+    
+    if (config_.mode == ProcessingMode::TickByTick) {
+        sendQuote(book->getBBO(current_timestamp_, ++sequence_));
+    }
+}
+
+void ItchShard::on(const itch::TradeMessage& msg) {
+    TradeTick trade{};
+    std::memcpy(trade.symbol, msg.stock, 8);
+    trade.timestamp = current_timestamp_;
+    trade.sequence = ++sequence_;
+    trade.price = msg.getPrice();
+    trade.quantity = msg.getShares();
+    trade.side = static_cast<char>(msg.side);
+    
+    stats_.trades++;
+    
+    if (config_.mode == ProcessingMode::TickByTick) {
+        sendTrade(trade);
+    }
+}
+
+OrderBook& ItchShard::resolveBook(uint16_t stock_locate, const char* stock) {
+    if (OrderBook* book = book_manager_->getBookByLocate(stock_locate)) {
+        return *book;
+    }
+    
+    // Directory not seen yet (e.g. joined mid-session): resolve by symbol
+    // once and bind the locate so later messages take the fast path
+    std::string symbol(stock, 8);
+    symbol.erase(symbol.find_last_not_of(' ') + 1);
+    if (stock_locate == 0) {
+        return book_manager_->getBook(symbol);  // 0 is never a valid locate
+    }
+    return book_manager_->registerLocate(stock_locate, symbol);
+}
+
+void ItchShard::onOrderExecuted(OrderIndex::Entry* entry, uint32_t qty,
+                                uint32_t price, uint64_t match_number) {
+    OrderBook* book = entry->book;
+    itch::Side resting_side = entry->order.side;
+    uint32_t exec_qty = std::min(qty, entry->order.remaining_qty);
+    
+    if (book->executeOrder(entry->order, qty, price)) {
+        order_index_->erase(entry);
+    }
+    
+    if (config_.mode == ProcessingMode::TickByTick) {
+        TradeTick trade{};
+        std::strncpy(trade.symbol, book->getSymbol().c_str(), sizeof(trade.symbol));
+        trade.timestamp = current_timestamp_;
+        trade.sequence = ++sequence_;
+        trade.price = price;
+        trade.quantity = exec_qty;
+        // Aggressor is the opposite of the resting order
+        trade.side = resting_side == itch::Side::Buy ? 'S' : 'B';
+        trade.match_number = match_number;
+        sendTrade(trade);
+        
+        sendQuote(book->getBBO(current_timestamp_, ++sequence_));
+    }
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+void ItchShard::sendQuote(const QuoteUpdate& quote) {
+    queueOutput(OutputMessageType::QuoteUpdate, quote.timestamp, &quote, sizeof(quote));
+}
+
+void ItchShard::sendTrade(const TradeTick& trade) {
+    queueOutput(OutputMessageType::TradeTick, trade.timestamp, &trade, sizeof(trade));
+}
+
+void ItchShard::queueOutput(OutputMessageType type, uint64_t timestamp,
+                            const void* payload, size_t payload_len) {
+    output_.append(type, timestamp, payload, payload_len);
+    
+    // Attribute output produced while handling an input message to its type
+    if (current_rx_ns_ != 0) {
+        pending_latency_.push_back(PendingLatency{current_type_, current_rx_ns_});
+    }
+}
+
+void ItchShard::flush() {
+    if (conflated_) {
+        captureDirty();
+        return;
+    }
+    
+    output_.flush();
+    if (cache_) captureDirty();
+    
+    if (pending_latency_.empty()) return;
+    
+    uint64_t sent_ns = wallClockNs();
+    for (const auto& pending : pending_latency_) {
+        uint64_t latency = sent_ns > pending.rx_ns ? sent_ns - pending.rx_ns : 0;
+        latency_.record(pending.type, latency);
+    }
+    pending_latency_.clear();
+}
+
+void ItchShard::captureDirty() {
+    size_t pending = 0;
+    book_manager_->drainDirty([this, &pending](OrderBook& book) {
+        // Sequence is assigned by the publisher when the snapshot goes out
+        OrderBookSnapshot snap = book.getSnapshot(current_timestamp_, 0);
+        
+        if (cache_) {
+            if (book.getCacheSlot() == BookCacheWriter::NO_SLOT) {
+                const std::string& symbol = book.getSymbol();
+                book.setCacheSlot(cache_->addSlot(symbol.data(), symbol.size(), book.getLocate()));
+            }
+            if (book.getCacheSlot() != BookCacheWriter::NO_SLOT) {
+                cache_->update(book.getCacheSlot(), snap, current_rx_ns_);
+            }
+        }
+        
+        if (!conflated_) return;
+        uint32_t slot = book.getConflationSlot();
+        if (slot == ConflationTable::NO_SLOT) {
+            slot = conflation_.addSlot();
+            if (slot == ConflationTable::NO_SLOT) {
+                stats_.errors++;
+                return;
+            }
+            book.setConflationSlot(slot);
+        }
+        pending += conflation_.publish(slot, snap);
+    });
+    if (scheduler_) scheduler_->addPending(pending);
+}
+
+// ============================================================================
+// Stats
+// ============================================================================
+
+void ItchShard::publishStats() {
+    stats_.order_index_high_water = order_index_->highWater();
+    stats_.order_index_fallback_allocs = order_index_->growCount();
+    output_.fillStats(stats_);
+    
+    published_stats_.store(stats_);
+    published_latency_.publish(latency_);
+}
+
+void ItchShard::collectStats(FeedStats& total, LatencyRecorder& latency) const {
+    accumulateStats(total, published_stats_.load());
+    published_latency_.collect(latency);
+}
+
+// ============================================================================
+// Checkpoint
+// ============================================================================
+
+void ItchShard::saveCheckpoint(ItchCheckpointBook* books, ItchCheckpointOrder* orders, uint32_t book_base) {
+    book_manager_->forEachBook([books](const OrderBook& book) {
+        ItchCheckpointBook& saved = books[book.getIndex()];
+        saved = ItchCheckpointBook{};
+        const std::string& symbol = book.getSymbol();
+        std::memset(saved.symbol, ' ', sizeof(saved.symbol));
+        std::memcpy(saved.symbol, symbol.data(), std::min(symbol.size(), sizeof(saved.symbol)));
+        saved.total_volume = book.getTotalVolume();
+        saved.last_price = book.getLastPrice();
+        saved.last_qty = book.getLastQty();
+        saved.locate = book.getLocate();
+    });
+    
+    size_t i = 0;
+    order_index_->forEach([&](const OrderIndex::Entry& entry) {
+        ItchCheckpointOrder& saved = orders[i++];
+        saved = ItchCheckpointOrder{};
+        saved.order_ref = entry.order.order_ref;
+        saved.price = entry.order.price;
+        saved.remaining_qty = entry.order.remaining_qty;
+        saved.book = book_base + entry.book->getIndex();
+        saved.side = static_cast<uint8_t>(entry.order.side);
+    });
+}
+
+OrderBook& ItchShard::restoreBook(const ItchCheckpointBook& saved) {
+    std::string symbol(saved.symbol, sizeof(saved.symbol));
+    symbol.erase(symbol.find_last_not_of(' ') + 1);
+    
+    OrderBook& book = saved.locate != 0 ? book_manager_->registerLocate(saved.locate, symbol)
+                                        : book_manager_->getBook(symbol);
+    book.restoreTrade(saved.last_price, saved.last_qty, saved.total_volume);
+    return book;
+}
+
+void ItchShard::restoreOrder(const ItchCheckpointOrder& saved, OrderBook& book) {
+    Order order{saved.order_ref, saved.price, saved.remaining_qty, static_cast<itch::Side>(saved.side)};
+    if (order_index_->insert(order, &book)) {
+        book.addOrder(order);
+    }
+}
+
+void accumulateStats(FeedStats& total, const FeedStats& stats) {
+    total.messages_received += stats.messages_received;
+    total.messages_sent += stats.messages_sent;
+    total.datagrams_sent += stats.datagrams_sent;
+    total.bytes_received += stats.bytes_received;
+    total.recv_batches += stats.recv_batches;
+    total.recv_batch_max = std::max(total.recv_batch_max, stats.recv_batch_max);
+    total.recv_drops += stats.recv_drops;
+    total.send_batches += stats.send_batches;
+    total.send_batch_max = std::max(total.send_batch_max, stats.send_batch_max);
+    total.bytes_sent += stats.bytes_sent;
+    total.add_orders += stats.add_orders;
+    total.delete_orders += stats.delete_orders;
+    total.executions += stats.executions;
+    total.trades += stats.trades;
+    total.errors += stats.errors;
+    total.dispatch_stalls += stats.dispatch_stalls;
+    total.dispatch_drops += stats.dispatch_drops;
+    
+    // Shards hold disjoint orders, so storage peaks add up
+    total.order_index_high_water += stats.order_index_high_water;
+    total.order_index_fallback_allocs += stats.order_index_fallback_allocs;
+}
+
+} // namespace feedhandler
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "book_cache.h"
+#include "conflation.h"
+#include "conflation_scheduler.h"
+#include "feedhandler_config.h"
+#include "itch_decoder.h"
+#include "latency_histogram.h"
+#include "market_data.h"
+#include "order_book.h"
+#include "order_index.h"
+#include "output_writer.h"
+#include "seqlock.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace feedhandler {
+
+// Warm-start checkpoint records (see checkpoint_file.h): every book, then
+// every live order, which refers to its book by position in the books
+// section
+struct ItchCheckpointBook {
+    char symbol[8];             // Space-padded, as on the wire
+    uint64_t total_volume;
+    uint32_t last_price;
+    uint32_t last_qty;
+    uint16_t locate;            // 0 = never bound to one
+    uint8_t reserved[6];
+};
+
+struct ItchCheckpointOrder {
+    uint64_t order_ref;
+    uint32_t price;
+    uint32_t remaining_qty;
+    uint32_t book;              // Index into the books section
+    uint8_t side;               // itch::Side
+    uint8_t reserved[3];
+};
+
+// Books, order index and output path for a set of instruments: every
+// instrument when the handler runs single-threaded, one stock_locate shard
+// per book worker in pipelined mode.
+//
+// All processing methods run on the owning thread. In conflated mode books
+// changed by a packet are captured into conflation() on flush() for the
+// publisher thread, and with a book cache into its shared-memory slots.
+// publishStats() / collectStats() cross threads through seqlocks, so a
+// reader (the metrics thread) never holds the owner up.
+class ItchShard {
+public:
+    // shard_count splits the order index capacity across shards; scheduler
+    // (conflated mode) is told how many books each flush leaves pending;
+    // cache (shared by all shards, opened before processing starts) gets
+    // every changed book on flush()
+    ItchShard(const FeedHandlerConfig& config, uint8_t shard_id, size_t shard_count,
+              ConflationScheduler* scheduler = nullptr, BookCacheWriter* cache = nullptr);
+    
+    // Non-copyable
+    ItchShard(const ItchShard&) = delete;
+    ItchShard& operator=(const ItchShard&) = delete;
+    
+    bool start();
+    void stop();
+    
+    // Apply one ITCH message (without its length prefix)
+    void processItchMessage(const uint8_t* data, size_t length, uint64_t rx_timestamp_ns);
+    
+    // End of an input packet (or worker batch): send everything queued and
+    // record its latency, or capture changed books in conflated mode; either
+    // way write changed books to the cache
+    void flush();
+    
+    // Latest top-of-book of every book, read by the conflation publisher
+    ConflationTable& conflation() { return conflation_; }
+    
+    // Owning thread: copy counters and latency out for the metrics thread
+    void publishStats();
+    
+    // Any thread: add the last published figures into the totals
+    void collectStats(FeedStats& total, LatencyRecorder& latency) const;
+    
+    // Checkpointing, on the owning thread or while it is parked: books and
+    // live orders held, then both written into this shard's part of each
+    // section (bookCount() and orderCount() records), its first book being
+    // book_base in the whole books section
+    size_t bookCount() const { return book_manager_->bookCount(); }
+    size_t orderCount() const { return order_index_->size(); }
+    void saveCheckpoint(ItchCheckpointBook* books, ItchCheckpointOrder* orders, uint32_t book_base);
+    
+    // Before processing starts: recreate a checkpointed book or order here
+    // (the caller routes books by locate, as dispatch does)
+    OrderBook& restoreBook(const ItchCheckpointBook& saved);
+    void restoreOrder(const ItchCheckpointOrder& saved, OrderBook& book);
+
+private:
+    // ITCH handlers, dispatched by itch::Decoder (message length already checked)
+    friend class itch::Decoder<ItchShard>;
+    void on(const itch::StockDirectoryMessage& msg);
+    void on(const itch::AddOrderMessage& msg);
+    void on(const itch::AddOrderMpidMessage& msg);
+    void on(const itch::OrderDeleteMessage& msg);
+    void on(const itch::OrderCancelMessage& msg);
+    void on(const itch::OrderExecutedMessage& msg);
+    void on(const itch::OrderExecutedWithPriceMessage& msg);
+    void on(const itch::OrderReplaceMessage& msg);
+    void on(const itch::TradeMessage& msg);
+    
+    template <typename AddMessage>
+    void onAddOrder(const AddMessage& msg);
+    
+    OrderBook& resolveBook(uint16_t stock_locate, const char* stock);
+    void onOrderExecuted(OrderIndex::Entry* entry, uint32_t qty,
+                         uint32_t price, uint64_t match_number);
+    
+    // Output
+    void sendQuote(const QuoteUpdate& quote);
+    void sendTrade(const TradeTick& trade);
+    void queueOutput(OutputMessageType type, uint64_t timestamp,
+                     const void* payload, size_t payload_len);
+    
+    // Copy books changed since the last flush into conflation_ (conflated
+    // mode) and cache_
+    void captureDirty();
+    
+    const FeedHandlerConfig& config_;
+    uint8_t shard_id_;
+    bool conflated_;
+    
+    OutputWriter output_;
+    std::unique_ptr<OrderBookManager> book_manager_;
+    std::unique_ptr<OrderIndex> order_index_;
+    
+    FeedStats stats_;
+    uint64_t sequence_ = 0;             // Per-shard output sequence
+    
+    ConflationTable conflation_;
+    ConflationScheduler* scheduler_;
+    BookCacheWriter* cache_;
+    
+    // Message being processed
+    uint8_t current_type_ = 0;          // ITCH message type
+    uint64_t current_timestamp_ = 0;    // Exchange timestamp (ns since midnight)
+    uint64_t current_rx_ns_ = 0;        // Arrival of its packet
+    
+    // Wire-to-send latency per ITCH message type (tick-by-tick output),
+    // cumulative since start
+    struct PendingLatency {
+        uint8_t type;
+        uint64_t rx_ns;
+    };
+    std::vector<PendingLatency> pending_latency_;
+    LatencyRecorder latency_;
+    
+    // Published for the metrics thread
+    SeqLock<FeedStats> published_stats_;
+    PublishedLatency published_latency_;
+};
+
+// Sum counters into total, keeping the largest of the per-call batch maxima
+void accumulateStats(FeedStats& total, const FeedStats& stats);
+
+} // namespace feedhandler
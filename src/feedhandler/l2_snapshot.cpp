@@ -0,0 +1,99 @@
+#include "l2_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace feedhandler {
+
+namespace {
+
+uint8_t levelCount(const BookSide& side) {
+    return static_cast<uint8_t>(std::min<size_t>(side.count, l2md::MAX_LEVELS));
+}
+
+uint8_t* encodeSide(const BookSide& side, uint8_t count, uint8_t* out) {
+    auto* group = reinterpret_cast<l2md::GroupHeader*>(out);
+    group->blockLength = sizeof(l2md::PriceLevelEntry);
+    group->numInGroup = count;
+    out += sizeof(l2md::GroupHeader);
+    
+    auto* entries = reinterpret_cast<l2md::PriceLevelEntry*>(out);
+    for (uint8_t i = 0; i < count; ++i) {
+        const PriceLevel& level = side.levels[i];
+        entries[i].level = i + 1;  // 1-based
+        entries[i].price = l2md::priceToSbe(level.price);
+        entries[i].quantity = level.quantity;
+        entries[i].numOrders = static_cast<uint16_t>(level.order_count);
+    }
+    return out + count * sizeof(l2md::PriceLevelEntry);
+}
+
+void decodeSide(const l2md::L2SnapshotDecoder& decoder, bool bids, BookSide& side) {
+    uint8_t count = bids ? decoder.numBids() : decoder.numAsks();
+    count = static_cast<uint8_t>(std::min<size_t>(count, MAX_DEPTH));
+    for (uint8_t i = 0; i < count; ++i) {
+        const l2md::PriceLevelEntry* entry = bids ? decoder.getBid(i) : decoder.getAsk(i);
+        side.levels[i] = PriceLevel{l2md::priceFromSbe(entry->price), entry->quantity,
+                                    entry->numOrders};
+    }
+    side.count = count;
+}
+
+} // namespace
+
+size_t l2SnapshotSize(const OrderBookSnapshot& snap) {
+    return l2md::calcL2SnapshotSize(levelCount(snap.bids), levelCount(snap.asks));
+}
+
+size_t encodeL2Snapshot(const OrderBookSnapshot& snap, uint8_t* buffer, size_t size) {
+    uint8_t bids = levelCount(snap.bids);
+    uint8_t asks = levelCount(snap.asks);
+    size_t length = l2md::calcL2SnapshotSize(bids, asks);
+    if (size < length) return 0;
+    
+    // Written straight into the output buffer, no intermediate entry arrays
+    auto* header = reinterpret_cast<l2md::MessageHeader*>(buffer);
+    header->blockLength = sizeof(l2md::L2SnapshotRoot);
+    header->templateId = l2md::TEMPLATE_L2_SNAPSHOT;
+    header->schemaId = l2md::SCHEMA_ID;
+    header->version = l2md::SCHEMA_VERSION;
+    
+    auto* root = reinterpret_cast<l2md::L2SnapshotRoot*>(buffer + sizeof(l2md::MessageHeader));
+    std::memcpy(root->symbol, snap.symbol, sizeof(root->symbol));
+    root->timestamp = snap.timestamp;
+    root->sequenceNumber = snap.sequence;
+    root->lastTradePrice = l2md::priceToSbe(snap.last_price);
+    root->lastTradeQty = snap.last_quantity;
+    root->totalVolume = snap.total_volume;
+    root->bidCount = bids;
+    root->askCount = asks;
+    
+    uint8_t* out = buffer + sizeof(l2md::MessageHeader) + sizeof(l2md::L2SnapshotRoot);
+    out = encodeSide(snap.bids, bids, out);
+    encodeSide(snap.asks, asks, out);
+    return length;
+}
+
+bool decodeL2Snapshot(const uint8_t* data, size_t length, OrderBookSnapshot& out) {
+    l2md::L2SnapshotDecoder decoder(data, length);
+    if (!decoder.isValid()) return false;
+    
+    // The decoder leaves a group's entries null when they run past the end
+    if ((decoder.numBids() > 0 && !decoder.getBid(0)) ||
+        (decoder.numAsks() > 0 && !decoder.getAsk(0))) {
+        return false;
+    }
+    
+    out = OrderBookSnapshot{};
+    std::memcpy(out.symbol, decoder.symbolRaw(), sizeof(out.symbol));
+    out.timestamp = decoder.timestamp();
+    out.sequence = decoder.sequenceNumber();
+    out.last_price = l2md::priceFromSbe(decoder.lastTradePrice());
+    out.last_quantity = decoder.lastTradeQty();
+    out.total_volume = decoder.totalVolume();
+    decodeSide(decoder, true, out.bids);
+    decodeSide(decoder, false, out.asks);
+    return true;
+}
+
+} // namespace feedhandler
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "market_data.h"
+#include "src/cme/l2_sbe_messages.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace feedhandler {
+
+// OrderBookSnapshot <-> SBE L2Snapshot (src/cme/sbe_schema.xml).
+//
+// The SBE form carries only the populated levels as repeating groups, so a
+// thin book costs a fraction of the fixed-size struct. Shared by the ITCH
+// publisher, the CME publisher and the receivers.
+
+// Largest encoded L2Snapshot
+constexpr size_t MAX_L2_SNAPSHOT_BYTES = l2md::MAX_L2_SNAPSHOT_SIZE;
+
+// Encoded size of snap (levels beyond l2md::MAX_LEVELS are not sent)
+size_t l2SnapshotSize(const OrderBookSnapshot& snap);
+
+// Encode snap into buffer. Returns the encoded length, 0 if it does not fit.
+size_t encodeL2Snapshot(const OrderBookSnapshot& snap, uint8_t* buffer, size_t size);
+
+// Decode an L2Snapshot message into out. Returns false if malformed.
+bool decodeL2Snapshot(const uint8_t* data, size_t length, OrderBookSnapshot& out);
+
+} // namespace feedhandler
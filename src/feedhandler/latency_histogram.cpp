@@ -0,0 +1,165 @@
+#include "latency_histogram.h"
+
+#include <iomanip>
+
+namespace feedhandler {
+
+namespace {
+
+constexpr uint64_t SUB_COUNT = uint64_t{1} << LatencyHistogram::SUB_BITS;
+constexpr uint64_t HALF_COUNT = SUB_COUNT >> 1;
+
+void printMicros(std::ostream& out, const char* label, uint64_t ns) {
+    out << " " << label << "=" << std::fixed << std::setprecision(1) << (ns / 1000.0) << "us";
+}
+
+} // namespace
+
+// ============================================================================
+// LatencyHistogram
+// ============================================================================
+
+size_t LatencyHistogram::bucketFor(uint64_t v) {
+    if (v < SUB_COUNT) return static_cast<size_t>(v);
+    
+    unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(v));
+    if (msb >= MAX_BITS) return BUCKETS - 1;
+    
+    // Keep the top SUB_BITS bits: sub lands in [HALF_COUNT, SUB_COUNT)
+    unsigned shift = msb - SUB_BITS + 1;
+    uint64_t sub = v >> shift;
+    return static_cast<size_t>((static_cast<uint64_t>(shift) << (SUB_BITS - 1)) + sub);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < SUB_COUNT) return index;
+    
+    uint64_t shift = (index >> (SUB_BITS - 1)) - 1;
+    uint64_t sub = index - (shift << (SUB_BITS - 1));
+    return ((sub + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    if (count_ == 0) return 0;
+    
+    uint64_t target = static_cast<uint64_t>(q * static_cast<double>(count_) + 0.5);
+    if (target < 1) target = 1;
+    if (target > count_) target = count_;
+    
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts_[i];
+        if (seen >= target) {
+            uint64_t bound = bucketUpperBound(i);
+            return bound < max_ ? bound : max_;
+        }
+    }
+    return max_;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.min_ < min_) min_ = other.min_;
+    if (other.max_ > max_) max_ = other.max_;
+}
+
+void LatencyHistogram::reset() {
+    counts_.fill(0);
+    count_ = 0;
+    sum_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+}
+
+// ============================================================================
+// LatencyRecorder
+// ============================================================================
+
+void LatencyRecorder::print(std::ostream& out) const {
+    for (size_t type = 0; type < histograms_.size(); ++type) {
+        const auto& hist = histograms_[type];
+        if (!hist || hist->count() == 0) continue;
+        
+        out << "  " << static_cast<char>(type) << "  n=" << hist->count();
+        printMicros(out, "p50", hist->percentile(0.50));
+        printMicros(out, "p99", hist->percentile(0.99));
+        printMicros(out, "p99.9", hist->percentile(0.999));
+        printMicros(out, "max", hist->max());
+        out << std::endl;
+    }
+}
+
+void LatencyRecorder::writeCsv(std::ostream& out, uint64_t now_ns) const {
+    for (size_t type = 0; type < histograms_.size(); ++type) {
+        const auto& hist = histograms_[type];
+        if (!hist || hist->count() == 0) continue;
+        
+        out << now_ns << "," << static_cast<char>(type) << "," << hist->count() << ","
+            << hist->percentile(0.50) << "," << hist->percentile(0.99) << ","
+            << hist->percentile(0.999) << "," << hist->max() << "\n";
+    }
+    out.flush();
+}
+
+void LatencyRecorder::merge(const LatencyRecorder& other) {
+    for (size_t type = 0; type < histograms_.size(); ++type) {
+        const auto& src = other.histograms_[type];
+        if (!src || src->count() == 0) continue;
+        
+        auto& hist = histograms_[type];
+        if (!hist) hist = std::make_unique<LatencyHistogram>();
+        hist->merge(*src);
+    }
+}
+
+void LatencyRecorder::merge(uint8_t type, const LatencyHistogram& other) {
+    auto& hist = histograms_[type];
+    if (!hist) hist = std::make_unique<LatencyHistogram>();
+    hist->merge(other);
+}
+
+void LatencyRecorder::reset() {
+    for (auto& hist : histograms_) {
+        if (hist) hist->reset();
+    }
+}
+
+// ============================================================================
+// PublishedLatency
+// ============================================================================
+
+PublishedLatency::~PublishedLatency() {
+    for (auto& slot : slots_) {
+        delete slot.load(std::memory_order_relaxed);
+    }
+}
+
+void PublishedLatency::publish(const LatencyRecorder& recorder) {
+    for (size_t type = 0; type < slots_.size(); ++type) {
+        const LatencyHistogram* hist = recorder.get(static_cast<uint8_t>(type));
+        if (!hist || hist->count() == 0) continue;
+        
+        SeqLock<LatencyHistogram>* slot = slots_[type].load(std::memory_order_relaxed);
+        if (!slot) {
+            slot = new SeqLock<LatencyHistogram>();
+            slot->store(*hist);
+            slots_[type].store(slot, std::memory_order_release);
+            continue;
+        }
+        slot->store(*hist);
+    }
+}
+
+void PublishedLatency::collect(LatencyRecorder& out) const {
+    for (size_t type = 0; type < slots_.size(); ++type) {
+        const SeqLock<LatencyHistogram>* slot = slots_[type].load(std::memory_order_acquire);
+        if (!slot) continue;
+        out.merge(static_cast<uint8_t>(type), slot->load());
+    }
+}
+
+} // namespace feedhandler
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "seqlock.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+namespace feedhandler {
+
+// Fixed-size log-linear latency histogram (HdrHistogram-style).
+//
+// Values below 32ns are recorded exactly; above that each power of two is
+// split into 16 linear sub-buckets, so any reported percentile is within ~6%
+// of the true value. Recording is a count-leading-zeros, a shift and an
+// increment: no allocation, safe on the hot path. Values are nanoseconds and
+// saturate at ~18 minutes.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr unsigned MAX_BITS = 40;
+    static constexpr size_t BUCKETS = ((MAX_BITS - SUB_BITS + 2) << (SUB_BITS - 1));
+    
+    void record(uint64_t value_ns) {
+        counts_[bucketFor(value_ns)]++;
+        count_++;
+        sum_ += value_ns;
+        if (value_ns < min_) min_ = value_ns;
+        if (value_ns > max_) max_ = value_ns;
+    }
+    
+    // Upper bound of the bucket holding the q-th quantile (q in [0, 1])
+    uint64_t percentile(double q) const;
+    
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    uint64_t mean() const { return count_ ? sum_ / count_ : 0; }
+    uint64_t sum() const { return sum_; }
+    
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+private:
+    static size_t bucketFor(uint64_t v);
+    static uint64_t bucketUpperBound(size_t index);
+    
+    std::array<uint64_t, BUCKETS> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+// One histogram per message type, keyed by the type byte. Histograms are
+// created on first use.
+class LatencyRecorder {
+public:
+    void record(uint8_t type, uint64_t value_ns) {
+        auto& hist = histograms_[type];
+        if (!hist) hist = std::make_unique<LatencyHistogram>();
+        hist->record(value_ns);
+    }
+    
+    const LatencyHistogram* get(uint8_t type) const { return histograms_[type].get(); }
+    
+    // "  A  n=... p50=...us p99=...us p99.9=...us max=...us" per non-empty type
+    void print(std::ostream& out) const;
+    
+    // CSV rows: <now_ns>,<type>,<count>,<p50>,<p99>,<p999>,<max> (nanoseconds)
+    void writeCsv(std::ostream& out, uint64_t now_ns) const;
+    
+    // Add every histogram of other (or one histogram for type) into this one
+    void merge(const LatencyRecorder& other);
+    void merge(uint8_t type, const LatencyHistogram& hist);
+    
+    void reset();
+
+private:
+    std::array<std::unique_ptr<LatencyHistogram>, 256> histograms_;
+};
+
+// A LatencyRecorder as last published by the thread recording into it,
+// readable from any other thread. One SeqLock per message type, created by
+// the publishing thread on first use, so publishing never waits on a reader.
+class PublishedLatency {
+public:
+    PublishedLatency() = default;
+    ~PublishedLatency();
+    
+    // Non-copyable
+    PublishedLatency(const PublishedLatency&) = delete;
+    PublishedLatency& operator=(const PublishedLatency&) = delete;
+    
+    // Publishing thread: copy out every histogram that has samples
+    void publish(const LatencyRecorder& recorder);
+    
+    // Any thread: merge the published histograms into out
+    void collect(LatencyRecorder& out) const;
+
+private:
+    std::array<std::atomic<SeqLock<LatencyHistogram>*>, 256> slots_{};
+};
+
+} // namespace feedhandler
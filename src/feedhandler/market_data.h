@@ -74,29 +74,67 @@ enum class OutputMessageType : uint8_t {
     OrderBookSnapshot = 1,
     TradeTick = 2,
     QuoteUpdate = 3,
+    BookDelta = 4,
+    L2Snapshot = 5,         // SBE L2Snapshot (src/cme/sbe_schema.xml)
 };
 
 // Output message header
 struct OutputHeader {
     uint16_t length;
     OutputMessageType type;
-    uint8_t flags;
+    uint8_t flags;          // Publishing shard with --workers, 0 otherwise
     uint64_t timestamp;
 };
 
+// Conflated delta: price levels of one book that changed since the previous
+// conflated message for that symbol. Followed by update_count LevelUpdates.
+struct BookDelta {
+    char symbol[8];
+    uint64_t timestamp;
+    uint64_t sequence;
+    uint64_t prev_sequence;     // Previous snapshot / delta for this symbol
+    uint32_t last_price;
+    uint32_t last_quantity;
+    uint64_t total_volume;
+    uint8_t update_count;
+};
+
+// One changed price level; quantity 0 removes the level (it emptied, or
+// fell out of the published depth)
+struct LevelUpdate {
+    uint32_t price;
+    uint32_t quantity;
+    uint32_t order_count;
+    char side;              // 'B' or 'S'
+};
+
 #pragma pack(pop)
 
 // Statistics
 struct FeedStats {
     uint64_t messages_received = 0;
     uint64_t messages_sent = 0;
+    uint64_t datagrams_sent = 0;
     uint64_t bytes_received = 0;
+    uint64_t recv_batches = 0;      // recvmmsg calls that returned data
+    uint64_t recv_batch_max = 0;    // Largest batch drained in one call
+    uint64_t recv_drops = 0;        // Lost before the handler (ring overrun / truncation)
+    uint64_t send_batches = 0;      // sendmmsg calls
+    uint64_t send_batch_max = 0;    // Most datagrams sent in one call
     uint64_t bytes_sent = 0;
     uint64_t add_orders = 0;
     uint64_t delete_orders = 0;
     uint64_t executions = 0;
     uint64_t trades = 0;
     uint64_t errors = 0;
+    
+    // Pipelined mode: receive thread handing messages to book workers
+    uint64_t dispatch_stalls = 0;   // Waits for a full worker ring
+    uint64_t dispatch_drops = 0;    // Messages too large for a ring slot
+    
+    // Order storage (refreshed when stats are printed)
+    uint64_t order_index_high_water = 0;
+    uint64_t order_index_fallback_allocs = 0;
 };
 
 } // namespace feedhandler
@@ -0,0 +1,336 @@
+#include "metrics.h"
+
+#include "thread_tuning.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace feedhandler {
+
+namespace {
+
+// The thread wakes at least this often to write out event lines
+constexpr int EVENT_POLL_MS = 100;
+
+// A scraper gets this long to send its request, and as long again to take
+// the response, so stop() never waits on a stalled client for longer
+constexpr int REQUEST_TIMEOUT_MS = 1000;
+constexpr int RESPONSE_TIMEOUT_MS = 1000;
+constexpr size_t MAX_REQUEST_BYTES = 4096;
+
+constexpr double QUANTILES[] = {0.5, 0.99, 0.999};
+constexpr const char* QUANTILE_LABELS[] = {"0.5", "0.99", "0.999"};
+
+uint64_t steadyMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void appendLabels(std::string& out, const std::string& labels, const char* extra = nullptr) {
+    if (labels.empty() && !extra) return;
+    out += '{';
+    out += labels;
+    if (extra) {
+        if (!labels.empty()) out += ',';
+        out += extra;
+    }
+    out += '}';
+}
+
+void appendDouble(std::string& out, double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", value);
+    out += text;
+}
+
+// Non-blocking sends, waiting for buffer space until timeout_ms has passed
+bool sendAll(int fd, const char* data, size_t length, int timeout_ms) {
+    uint64_t deadline = steadyMs() + static_cast<uint64_t>(timeout_ms);
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            
+            uint64_t now = steadyMs();
+            if (now >= deadline) return false;
+            struct pollfd pfd{};
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            if (::poll(&pfd, 1, static_cast<int>(deadline - now)) < 0 && errno != EINTR) return false;
+            continue;
+        }
+        data += sent;
+        length -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+} // namespace
+
+// ============================================================================
+// MetricsWriter
+// ============================================================================
+
+void MetricsWriter::family(const char* name, const char* type, const char* help) {
+    out_ += "# HELP ";
+    out_ += name;
+    out_ += ' ';
+    out_ += help;
+    out_ += "\n# TYPE ";
+    out_ += name;
+    out_ += ' ';
+    out_ += type;
+    out_ += '\n';
+}
+
+void MetricsWriter::sample(const char* name, const std::string& labels, uint64_t value) {
+    out_ += name;
+    appendLabels(out_, labels);
+    out_ += ' ';
+    out_ += std::to_string(value);
+    out_ += '\n';
+}
+
+void MetricsWriter::sample(const char* name, const std::string& labels, double value) {
+    out_ += name;
+    appendLabels(out_, labels);
+    out_ += ' ';
+    appendDouble(out_, value);
+    out_ += '\n';
+}
+
+void MetricsWriter::counter(const char* name, const char* help, uint64_t value) {
+    family(name, "counter", help);
+    sample(name, std::string(), value);
+}
+
+void MetricsWriter::gauge(const char* name, const char* help, double value) {
+    family(name, "gauge", help);
+    sample(name, std::string(), value);
+}
+
+void MetricsWriter::summary(const char* name, const std::string& labels, const LatencyHistogram& hist) {
+    for (size_t i = 0; i < sizeof(QUANTILES) / sizeof(QUANTILES[0]); ++i) {
+        std::string quantile = std::string("quantile=\"") + QUANTILE_LABELS[i] + "\"";
+        out_ += name;
+        appendLabels(out_, labels, quantile.c_str());
+        out_ += ' ';
+        appendDouble(out_, static_cast<double>(hist.percentile(QUANTILES[i])) / 1e9);
+        out_ += '\n';
+    }
+    std::string base(name);
+    sample((base + "_sum").c_str(), labels, static_cast<double>(hist.sum()) / 1e9);
+    sample((base + "_count").c_str(), labels, hist.count());
+}
+
+// ============================================================================
+// EventLog
+// ============================================================================
+
+EventLog::EventLog(size_t capacity)
+    : ring_(capacity) {
+}
+
+void EventLog::post(const char* format, ...) {
+    Line* line = ring_.claim();
+    if (!line) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    va_list args;
+    va_start(args, format);
+    int n = std::vsnprintf(line->text, LINE_SIZE, format, args);
+    va_end(args);
+    line->length = static_cast<uint16_t>(std::clamp(n, 0, static_cast<int>(LINE_SIZE) - 1));
+    ring_.publish();
+}
+
+size_t EventLog::drain(std::ostream& out) {
+    size_t lines = 0;
+    while (const Line* line = ring_.peek()) {
+        out.write(line->text, line->length);
+        out << '\n';
+        ring_.release();
+        lines++;
+    }
+    if (lines > 0) out.flush();
+    return lines;
+}
+
+// ============================================================================
+// MetricsServer
+// ============================================================================
+
+MetricsServer::MetricsServer(const MetricsConfig& config)
+    : config_(config) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+void MetricsServer::addCollector(Collector collector) {
+    collectors_.push_back(std::move(collector));
+}
+
+void MetricsServer::addEventLog(EventLog* log) {
+    event_logs_.push_back(log);
+}
+
+void MetricsServer::setReport(uint64_t interval_ms, Report report) {
+    report_interval_ms_ = interval_ms;
+    report_ = std::move(report);
+}
+
+bool MetricsServer::start() {
+    if (isRunning()) return true;
+    
+    if (config_.port != 0) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (listen_fd_ < 0) {
+            std::cerr << "Failed to create metrics socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+        
+        int reuse = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config_.port);
+        if (inet_pton(AF_INET, config_.bind_address.c_str(), &addr.sin_addr) != 1) {
+            std::cerr << "Bad metrics bind address " << config_.bind_address << std::endl;
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            listen(listen_fd_, 16) < 0) {
+            std::cerr << "Failed to listen for metrics on " << config_.bind_address << ":" << config_.port
+                      << ": " << strerror(errno) << std::endl;
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        std::cout << "  Metrics: http://" << config_.bind_address << ":" << config_.port << "/metrics" << std::endl;
+    }
+    
+    running_ = true;
+    thread_ = startThread(&MetricsServer::run, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+    drainEvents();
+}
+
+std::string MetricsServer::render() const {
+    MetricsWriter writer;
+    for (const auto& collector : collectors_) {
+        collector(writer);
+    }
+    
+    uint64_t dropped = 0;
+    for (const auto* log : event_logs_) dropped += log->dropped();
+    writer.counter("metrics_scrapes_total", "Scrapes of this endpoint served",
+                   scrapes_.load(std::memory_order_relaxed));
+    writer.counter("metrics_event_lines_dropped_total", "Event log lines lost to a full log ring", dropped);
+    return writer.text();
+}
+
+void MetricsServer::run() {
+    uint64_t next_report = steadyMs() + report_interval_ms_;
+    
+    while (running_.load(std::memory_order_acquire)) {
+        uint64_t now = steadyMs();
+        int timeout = EVENT_POLL_MS;
+        if (report_ && report_interval_ms_ > 0) {
+            timeout = static_cast<int>(std::min<uint64_t>(timeout, next_report > now ? next_report - now : 0));
+        }
+        
+        if (listen_fd_ >= 0) {
+            struct pollfd pfd{};
+            pfd.fd = listen_fd_;
+            pfd.events = POLLIN;
+            if (::poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN)) {
+                int client = accept(listen_fd_, nullptr, nullptr);
+                if (client >= 0) {
+                    serveClient(client);
+                    close(client);
+                }
+            }
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+        }
+        
+        drainEvents();
+        
+        now = steadyMs();
+        if (report_ && report_interval_ms_ > 0 && now >= next_report) {
+            report_();
+            next_report = now + report_interval_ms_;
+        }
+    }
+}
+
+void MetricsServer::drainEvents() {
+    for (auto* log : event_logs_) {
+        log->drain(std::cout);
+    }
+}
+
+void MetricsServer::serveClient(int fd) {
+    // One request per connection: read up to the end of the headers
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_BYTES) {
+        struct pollfd pfd{};
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (::poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0) return;
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) return;
+        request.append(buffer, static_cast<size_t>(n));
+    }
+    
+    // GET /metrics[?...] HTTP/1.x
+    bool found = request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0;
+    std::string body;
+    const char* status = "404 Not Found";
+    const char* type = "text/plain";
+    if (found) {
+        scrapes_.fetch_add(1, std::memory_order_relaxed);
+        body = render();
+        status = "200 OK";
+        type = "text/plain; version=0.0.4";
+    } else {
+        body = "Try /metrics\n";
+    }
+    
+    std::string response = std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + type +
+                           "\r\nContent-Length: " + std::to_string(body.size()) +
+                           "\r\nConnection: close\r\n\r\n" + body;
+    sendAll(fd, response.data(), response.size(), RESPONSE_TIMEOUT_MS);
+}
+
+} // namespace feedhandler
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "latency_histogram.h"
+#include "spsc_ring.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace feedhandler {
+
+// Live metrics, read off the hot path.
+//
+// Hot threads never format, lock or write to a stream for monitoring: they
+// keep plain counters and now and then hand a copy to a SeqLock (see
+// ItchShard::publishStats()). A MetricsServer thread reads those copies and
+// serves them as Prometheus text on /metrics, prints the periodic stats
+// report and writes out EventLog lines, so a scrape or a slow terminal can
+// never hold up a packet.
+
+struct MetricsConfig {
+    uint16_t port = 0;                  // HTTP listener for /metrics (0 = off)
+    std::string bind_address = "0.0.0.0";
+};
+
+// Prometheus text exposition format (version 0.0.4)
+class MetricsWriter {
+public:
+    // # HELP / # TYPE lines; the family's samples follow
+    void family(const char* name, const char* type, const char* help);
+    
+    // name{labels} value; labels already formatted (key="value",...) or empty
+    void sample(const char* name, const std::string& labels, uint64_t value);
+    void sample(const char* name, const std::string& labels, double value);
+    
+    // A family with one unlabelled sample
+    void counter(const char* name, const char* help, uint64_t value);
+    void gauge(const char* name, const char* help, double value);
+    
+    // Summary samples (quantiles, _sum, _count) from a nanosecond histogram,
+    // in seconds. Write the family header first.
+    void summary(const char* name, const std::string& labels, const LatencyHistogram& hist);
+    
+    const std::string& text() const { return out_; }
+
+private:
+    std::string out_;
+};
+
+// Log lines from a hot thread, written out by the metrics thread.
+//
+// post() formats into a ring slot and returns: no stream, no lock, no
+// syscall. A full ring drops the line and counts it. One posting thread.
+class EventLog {
+public:
+    static constexpr size_t LINE_SIZE = 192;
+    
+    explicit EventLog(size_t capacity = 1024);
+    
+    // Posting thread: printf-style, truncated to LINE_SIZE
+    void post(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    
+    // Reading thread: write out and release every queued line
+    size_t drain(std::ostream& out);
+    
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Line {
+        uint16_t length;
+        char text[LINE_SIZE];
+    };
+    
+    SpscRing<Line> ring_;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+class MetricsServer {
+public:
+    // Called on the metrics thread for every scrape
+    using Collector = std::function<void(MetricsWriter&)>;
+    using Report = std::function<void()>;
+    
+    explicit MetricsServer(const MetricsConfig& config);
+    ~MetricsServer();
+    
+    // Non-copyable
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+    
+    // Before start()
+    void addCollector(Collector collector);
+    void addEventLog(EventLog* log);
+    void setReport(uint64_t interval_ms, Report report);   // interval 0 = never
+    
+    // Open the listener (if configured) and start the thread. False if the
+    // port could not be bound.
+    bool start();
+    
+    // Join the thread after writing out the last event lines. The report is
+    // not run; callers print their final one themselves.
+    void stop();
+    
+    bool isRunning() const { return thread_.joinable(); }
+    
+    // Every collector's samples, as served on /metrics
+    std::string render() const;
+
+private:
+    void run();
+    void drainEvents();
+    void serveClient(int fd);
+    
+    MetricsConfig config_;
+    std::vector<Collector> collectors_;
+    std::vector<EventLog*> event_logs_;
+    uint64_t report_interval_ms_ = 0;
+    Report report_;
+    
+    int listen_fd_ = -1;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> scrapes_{0};
+};
+
+} // namespace feedhandler
@@ -1,10 +1,13 @@
 #include "multicast.h"
 
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 #include <unistd.h>
 #include <poll.h>
 #include <fcntl.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 
 namespace feedhandler {
 
@@ -15,7 +18,7 @@ namespace feedhandler {
 MulticastReceiver::MulticastReceiver(const std::string& group, uint16_t port,
                                      const std::string& interface, size_t buffer_size)
     : group_(group), port_(port), interface_(interface), buffer_size_(buffer_size) {
-    buffer_.resize(buffer_size_);
+    buffer_.resize(MAX_DATAGRAM_SIZE);
 }
 
 MulticastReceiver::~MulticastReceiver() {
@@ -37,6 +40,7 @@ bool MulticastReceiver::start() {
     if (setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
         std::cerr << "Failed to set SO_REUSEADDR: " << strerror(errno) << std::endl;
         close(socket_fd_);
+        socket_fd_ = -1;
         return false;
     }
     
@@ -44,6 +48,12 @@ bool MulticastReceiver::start() {
     int rcvbuf = static_cast<int>(buffer_size_);
     setsockopt(socket_fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
     
+    // Kernel drop count with received datagrams, for dropCount()
+    int ovfl = 1;
+    if (setsockopt(socket_fd_, SOL_SOCKET, SO_RXQ_OVFL, &ovfl, sizeof(ovfl)) < 0) {
+        std::cerr << "Failed to set SO_RXQ_OVFL: " << strerror(errno) << std::endl;
+    }
+    
     // Bind to port
     struct sockaddr_in addr{};
     addr.sin_family = AF_INET;
@@ -53,17 +63,15 @@ bool MulticastReceiver::start() {
     if (bind(socket_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
         std::cerr << "Failed to bind: " << strerror(errno) << std::endl;
         close(socket_fd_);
+        socket_fd_ = -1;
         return false;
     }
     
-    // Join multicast group
-    struct ip_mreq mreq{};
-    mreq.imr_multiaddr.s_addr = inet_addr(group_.c_str());
-    mreq.imr_interface.s_addr = inet_addr(interface_.c_str());
-    
-    if (setsockopt(socket_fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-        std::cerr << "Failed to join multicast group: " << strerror(errno) << std::endl;
+    // Join multicast group; a new socket holds no membership yet
+    joined_ = false;
+    if (!joinGroup()) {
         close(socket_fd_);
+        socket_fd_ = -1;
         return false;
     }
     
@@ -78,15 +86,47 @@ void MulticastReceiver::stop() {
     running_ = false;
     
     if (socket_fd_ >= 0) {
-        // Leave multicast group
-        struct ip_mreq mreq{};
-        mreq.imr_multiaddr.s_addr = inet_addr(group_.c_str());
-        mreq.imr_interface.s_addr = inet_addr(interface_.c_str());
-        setsockopt(socket_fd_, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
-        
-        close(socket_fd_);
+        leaveGroup();
+        close(socket_fd_);      // Drops the membership even if the leave failed
         socket_fd_ = -1;
     }
+    joined_ = false;
+}
+
+bool MulticastReceiver::joinGroup() {
+    if (joined_) return true;
+    
+    struct ip_mreq mreq{};
+    mreq.imr_multiaddr.s_addr = inet_addr(group_.c_str());
+    mreq.imr_interface.s_addr = inet_addr(interface_.c_str());
+    
+    if (setsockopt(socket_fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        std::cerr << "Failed to join multicast group: " << strerror(errno) << std::endl;
+        return false;
+    }
+    joined_ = true;
+    return true;
+}
+
+bool MulticastReceiver::leaveGroup() {
+    if (!joined_) return true;
+    
+    struct ip_mreq mreq{};
+    mreq.imr_multiaddr.s_addr = inet_addr(group_.c_str());
+    mreq.imr_interface.s_addr = inet_addr(interface_.c_str());
+    
+    if (setsockopt(socket_fd_, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        int err = errno;
+        std::cerr << "Failed to leave multicast group: " << strerror(err) << std::endl;
+        // EADDRNOTAVAIL: the socket is not a member, so it has left anyway
+        if (err != EADDRNOTAVAIL) return false;
+    }
+    joined_ = false;
+    
+    // Whatever is still queued predates the next join
+    while (recv(socket_fd_, buffer_.data(), buffer_.size(), MSG_DONTWAIT) > 0) {
+    }
+    return true;
 }
 
 bool MulticastReceiver::receive(MessageCallback callback) {
@@ -122,6 +162,112 @@ ssize_t MulticastReceiver::read(uint8_t* buffer, size_t max_size) {
     return recv(socket_fd_, buffer, max_size, 0);
 }
 
+bool MulticastReceiver::setBusyPoll(int usec) {
+    if (socket_fd_ < 0) return false;
+    
+    if (setsockopt(socket_fd_, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0) {
+        std::cerr << "Failed to set SO_BUSY_POLL: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void MulticastReceiver::setBatchSize(size_t max_batch, size_t max_datagram) {
+    if (max_batch == 0) max_batch = 1;
+    
+    batch_datagram_size_ = max_datagram;
+    batch_buffers_.assign(max_batch * max_datagram, 0);
+    batch_iovecs_.resize(max_batch);
+    batch_msgs_.resize(max_batch);
+    batch_.resize(max_batch);
+    batch_control_.assign(max_batch * CONTROL_SIZE, 0);
+    
+    for (size_t i = 0; i < max_batch; ++i) {
+        batch_iovecs_[i].iov_base = batch_buffers_.data() + i * max_datagram;
+        batch_iovecs_[i].iov_len = max_datagram;
+        
+        std::memset(&batch_msgs_[i], 0, sizeof(batch_msgs_[i]));
+        batch_msgs_[i].msg_hdr.msg_iov = &batch_iovecs_[i];
+        batch_msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+bool MulticastReceiver::enableRxTimestamps() {
+    if (socket_fd_ < 0) return false;
+    
+    // Hardware when the NIC stamps RX, software otherwise; both are reported
+    int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(socket_fd_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        std::cerr << "Failed to enable SO_TIMESTAMPING: " << strerror(errno) << std::endl;
+        return false;
+    }
+    rx_timestamps_ = true;
+    return true;
+}
+
+DatagramBatch MulticastReceiver::readBatch() {
+    if (batch_msgs_.empty()) {
+        setBatchSize(64);
+    }
+    
+    // The kernel overwrites msg_controllen with what it used
+    for (size_t i = 0; i < batch_msgs_.size(); ++i) {
+        batch_msgs_[i].msg_hdr.msg_control = batch_control_.data() + i * CONTROL_SIZE;
+        batch_msgs_[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+    }
+    
+    int n = recvmmsg(socket_fd_, batch_msgs_.data(), static_cast<unsigned int>(batch_msgs_.size()),
+                     MSG_DONTWAIT, nullptr);
+    if (n <= 0) {
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            std::cerr << "Receive error: " << strerror(errno) << std::endl;
+        }
+        return DatagramBatch{};
+    }
+    
+    size_t count = 0;
+    for (int i = 0; i < n; ++i) {
+        struct msghdr* hdr = &batch_msgs_[i].msg_hdr;
+        Datagram& dgram = batch_[count];
+        dgram.data = static_cast<const uint8_t*>(batch_iovecs_[i].iov_base);
+        dgram.length = batch_msgs_[i].msg_len;
+        dgram.rx_timestamp_ns = 0;
+        
+        // Longer than its slot: only a prefix arrived, so it is dropped and
+        // counted with the kernel's drops
+        if (hdr->msg_flags & MSG_TRUNC) {
+            truncated_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            count++;
+        }
+        
+        // The drop count is a running total (sent only once non-zero), so
+        // without timestamps the last datagram's control data is enough
+        if (!rx_timestamps_ && i + 1 < n) continue;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET) continue;
+            if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t dropped;
+                std::memcpy(&dropped, CMSG_DATA(cmsg), sizeof(dropped));
+                rxq_drops_.store(dropped, std::memory_order_relaxed);
+                continue;
+            }
+            if (!rx_timestamps_ || cmsg->cmsg_type != SCM_TIMESTAMPING) continue;
+            
+            // ts[0] = software, ts[2] = raw hardware
+            struct scm_timestamping stamps;
+            std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            const struct timespec& ts = (stamps.ts[2].tv_sec || stamps.ts[2].tv_nsec)
+                                            ? stamps.ts[2] : stamps.ts[0];
+            dgram.rx_timestamp_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+                                    static_cast<uint64_t>(ts.tv_nsec);
+        }
+    }
+    
+    return DatagramBatch{batch_.data(), count};
+}
+
 // ============================================================================
 // MulticastSender
 // ============================================================================
@@ -175,6 +321,7 @@ bool MulticastSender::start() {
 void MulticastSender::stop() {
     if (!running_) return;
     
+    flush();
     running_ = false;
     
     if (socket_fd_ >= 0) {
@@ -202,4 +349,72 @@ bool MulticastSender::send(const std::vector<uint8_t>& data) {
     return send(data.data(), data.size());
 }
 
+void MulticastSender::setBatchSize(size_t max_batch, size_t max_datagram) {
+    flush();
+    if (max_batch == 0) max_batch = 1;
+    
+    batch_datagram_size_ = max_datagram;
+    batch_buffers_.assign(max_batch * max_datagram, 0);
+    batch_iovecs_.resize(max_batch);
+    batch_msgs_.resize(max_batch);
+    
+    for (size_t i = 0; i < max_batch; ++i) {
+        batch_iovecs_[i].iov_base = batch_buffers_.data() + i * max_datagram;
+        batch_iovecs_[i].iov_len = 0;
+        
+        std::memset(&batch_msgs_[i], 0, sizeof(batch_msgs_[i]));
+        batch_msgs_[i].msg_hdr.msg_name = &dest_addr_;
+        batch_msgs_[i].msg_hdr.msg_namelen = sizeof(dest_addr_);
+        batch_msgs_[i].msg_hdr.msg_iov = &batch_iovecs_[i];
+        batch_msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+bool MulticastSender::queue(const uint8_t* data, size_t length) {
+    if (!running_) return false;
+    
+    if (batch_msgs_.empty()) {
+        setBatchSize(64);
+    }
+    
+    // Oversized datagrams bypass the queue, after whatever is already queued
+    if (length > batch_datagram_size_) {
+        flush();
+        return send(data, length);
+    }
+    
+    if (queued_ == batch_msgs_.size()) {
+        flush();
+    }
+    
+    struct iovec& iov = batch_iovecs_[queued_++];
+    std::memcpy(iov.iov_base, data, length);
+    iov.iov_len = length;
+    return true;
+}
+
+size_t MulticastSender::flush() {
+    if (queued_ == 0) return 0;
+    
+    size_t sent = 0;
+    while (sent < queued_ && running_) {
+        int n = sendmmsg(socket_fd_, batch_msgs_.data() + sent,
+                         static_cast<unsigned int>(queued_ - sent), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Send error: " << strerror(errno) << std::endl;
+            break;
+        }
+        sent += static_cast<size_t>(n);
+        batch_stats_.flushes++;
+    }
+    
+    batch_stats_.datagrams += sent;
+    batch_stats_.errors += queued_ - sent;
+    if (sent > batch_stats_.max_batch) batch_stats_.max_batch = sent;
+    
+    queued_ = 0;
+    return sent;
+}
+
 } // namespace feedhandler
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "packet_source.h"
+
+#include <atomic>
 #include <functional>
 #include <string>
+#include <vector>
 #include <cstdint>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -9,42 +13,82 @@
 
 namespace feedhandler {
 
-class MulticastReceiver {
+class MulticastReceiver : public PacketSource {
 public:
     using MessageCallback = std::function<void(const uint8_t*, size_t)>;
     
     MulticastReceiver(const std::string& group, uint16_t port, 
                       const std::string& interface = "0.0.0.0",
                       size_t buffer_size = 65536);
-    ~MulticastReceiver();
+    ~MulticastReceiver() override;
     
     // Non-copyable
     MulticastReceiver(const MulticastReceiver&) = delete;
     MulticastReceiver& operator=(const MulticastReceiver&) = delete;
     
-    bool start();
-    void stop();
+    bool start() override;
+    void stop() override;
     
     // Blocking receive - returns false on error/stop
     bool receive(MessageCallback callback);
     
     // Poll with timeout (ms), returns bytes received or -1
-    int poll(int timeout_ms);
+    int poll(int timeout_ms) override;
     
     // Read data after poll
     ssize_t read(uint8_t* buffer, size_t max_size);
     
-    int getFd() const { return socket_fd_; }
-    bool isRunning() const { return running_; }
+    // SO_BUSY_POLL: let the kernel busy-poll the NIC queue for up to usec on
+    // an empty socket before sleeping. Call after start().
+    bool setBusyPoll(int usec) override;
+    
+    // SO_TIMESTAMPING; readBatch() then fills Datagram::rx_timestamp_ns
+    bool enableRxTimestamps() override;
     
+    // Datagrams the kernel dropped on a full socket buffer (SO_RXQ_OVFL,
+    // as of the last readBatch()) plus those readBatch() dropped for not
+    // fitting a batch slot. Any thread.
+    uint64_t dropCount() override {
+        return rxq_drops_.load(std::memory_order_relaxed) + truncated_.load(std::memory_order_relaxed);
+    }
+    
+    // Size the batch buffers: up to max_batch datagrams of max_datagram bytes
+    void setBatchSize(size_t max_batch, size_t max_datagram = MAX_DATAGRAM_SIZE) override;
+    
+    // Non-blocking batched read (recvmmsg): drains up to max_batch queued
+    // datagrams in one syscall. Empty batch when nothing is pending.
+    DatagramBatch readBatch() override;
+    
+    bool joinGroup() override;
+    bool leaveGroup() override;
+    bool isJoined() const override { return joined_; }
+    
+    int getFd() const override { return socket_fd_; }
+    bool isRunning() const override { return running_; }
+
 private:
     std::string group_;
     uint16_t port_;
     std::string interface_;
-    size_t buffer_size_;
+    size_t buffer_size_;                // SO_RCVBUF
     int socket_fd_ = -1;
     bool running_ = false;
+    bool joined_ = false;
     std::vector<uint8_t> buffer_;
+    
+    // Batched receive: one preallocated buffer per batch slot
+    size_t batch_datagram_size_ = 0;
+    std::vector<uint8_t> batch_buffers_;
+    std::vector<struct iovec> batch_iovecs_;
+    std::vector<struct mmsghdr> batch_msgs_;
+    std::vector<Datagram> batch_;
+    
+    // Per-slot control buffers for SCM_TIMESTAMPING and SO_RXQ_OVFL
+    static constexpr size_t CONTROL_SIZE = 128;
+    bool rx_timestamps_ = false;
+    std::vector<uint8_t> batch_control_;
+    std::atomic<uint64_t> rxq_drops_{0};
+    std::atomic<uint64_t> truncated_{0};    // MSG_TRUNC datagrams dropped
 };
 
 class MulticastSender {
@@ -65,9 +109,29 @@ public:
     bool send(const uint8_t* data, size_t length);
     bool send(const std::vector<uint8_t>& data);
     
+    struct BatchStats {
+        uint64_t flushes = 0;       // sendmmsg calls
+        uint64_t datagrams = 0;
+        uint64_t max_batch = 0;     // Most datagrams sent by one flush
+        uint64_t errors = 0;        // Datagrams dropped on send failure
+    };
+    
+    // Size the send queue: up to max_batch datagrams of max_datagram bytes
+    void setBatchSize(size_t max_batch, size_t max_datagram = 1500);
+    
+    // Batched send: copy a datagram into the queue; it goes out on the next
+    // flush(), or immediately when the queue is full. Order is preserved.
+    bool queue(const uint8_t* data, size_t length);
+    
+    // Send everything queued with sendmmsg, returns datagrams sent
+    size_t flush();
+    
+    size_t queued() const { return queued_; }
+    const BatchStats& getBatchStats() const { return batch_stats_; }
+    
     int getFd() const { return socket_fd_; }
     bool isRunning() const { return running_; }
-    
+
 private:
     std::string group_;
     uint16_t port_;
@@ -76,6 +140,14 @@ private:
     int socket_fd_ = -1;
     bool running_ = false;
     struct sockaddr_in dest_addr_;
+    
+    // Send queue: one preallocated buffer per slot
+    size_t queued_ = 0;
+    size_t batch_datagram_size_ = 0;
+    std::vector<uint8_t> batch_buffers_;
+    std::vector<struct iovec> batch_iovecs_;
+    std::vector<struct mmsghdr> batch_msgs_;
+    BatchStats batch_stats_;
 };
 
 } // namespace feedhandler
@@ -9,101 +9,64 @@ namespace feedhandler {
 // OrderBook
 // ============================================================================
 
-OrderBook::OrderBook(const std::string& symbol, size_t depth)
-    : symbol_(symbol), depth_(depth) {
+OrderBook::OrderBook(const std::string& symbol, size_t depth,
+                     LevelStorage storage, const LadderConfig& ladder)
+    : symbol_(symbol)
+    , depth_(std::min(depth, MAX_DEPTH))
+    , storage_(storage)
+    , bid_ladder_(true, ladder)
+    , ask_ladder_(false, ladder) {
 }
 
-void OrderBook::addOrder(uint64_t order_ref, itch::Side side, uint32_t price, uint32_t qty) {
-    Order order{order_ref, price, qty, side};
-    orders_[order_ref] = order;
-    
-    if (side == itch::Side::Buy) {
-        addToLevel(bids_, price, qty);
+void OrderBook::addOrder(const Order& order) {
+    if (storage_ == LevelStorage::Ladder) {
+        auto& ladder = order.side == itch::Side::Buy ? bid_ladder_ : ask_ladder_;
+        ladder.add(order.price, order.remaining_qty);
+    } else if (order.side == itch::Side::Buy) {
+        addToLevel(bids_, order.price, order.remaining_qty);
     } else {
-        addToLevel(asks_, price, qty);
+        addToLevel(asks_, order.price, order.remaining_qty);
     }
     
-    dirty_ = true;
+    markDirty();
 }
 
-void OrderBook::deleteOrder(uint64_t order_ref) {
-    auto it = orders_.find(order_ref);
-    if (it == orders_.end()) return;
-    
-    const Order& order = it->second;
-    
-    if (order.side == itch::Side::Buy) {
-        removeFromLevel(bids_, order.price, order.remaining_qty);
-    } else {
-        removeFromLevel(asks_, order.price, order.remaining_qty);
-    }
-    
-    orders_.erase(it);
-    dirty_ = true;
+void OrderBook::deleteOrder(const Order& order) {
+    removeFromSide(order, order.remaining_qty, 1);
+    markDirty();
 }
 
-void OrderBook::cancelOrder(uint64_t order_ref, uint32_t cancel_qty) {
-    auto it = orders_.find(order_ref);
-    if (it == orders_.end()) return;
-    
-    Order& order = it->second;
+bool OrderBook::cancelOrder(Order& order, uint32_t cancel_qty) {
     uint32_t actual_cancel = std::min(cancel_qty, order.remaining_qty);
-    
-    if (order.side == itch::Side::Buy) {
-        removeFromLevel(bids_, order.price, actual_cancel);
-    } else {
-        removeFromLevel(asks_, order.price, actual_cancel);
-    }
-    
     order.remaining_qty -= actual_cancel;
-    if (order.remaining_qty == 0) {
-        orders_.erase(it);
-    }
     
-    dirty_ = true;
+    removeFromSide(order, actual_cancel, order.remaining_qty == 0 ? 1 : 0);
+    markDirty();
+    
+    return order.remaining_qty == 0;
 }
 
-void OrderBook::executeOrder(uint64_t order_ref, uint32_t exec_qty) {
-    auto it = orders_.find(order_ref);
-    if (it == orders_.end()) return;
-    
-    Order& order = it->second;
+bool OrderBook::executeOrder(Order& order, uint32_t exec_qty) {
+    return executeOrder(order, exec_qty, order.price);
+}
+
+bool OrderBook::executeOrder(Order& order, uint32_t exec_qty, uint32_t exec_price) {
     uint32_t actual_exec = std::min(exec_qty, order.remaining_qty);
+    order.remaining_qty -= actual_exec;
     
-    if (order.side == itch::Side::Buy) {
-        removeFromLevel(bids_, order.price, actual_exec);
-    } else {
-        removeFromLevel(asks_, order.price, actual_exec);
-    }
+    removeFromSide(order, actual_exec, order.remaining_qty == 0 ? 1 : 0);
     
     // Record as trade
-    recordTrade(order.price, actual_exec, 
+    recordTrade(exec_price, actual_exec,
                 order.side == itch::Side::Buy ? itch::Side::Sell : itch::Side::Buy);
     
-    order.remaining_qty -= actual_exec;
-    if (order.remaining_qty == 0) {
-        orders_.erase(it);
-    }
-    
-    dirty_ = true;
+    markDirty();
+    return order.remaining_qty == 0;
 }
 
-void OrderBook::replaceOrder(uint64_t old_ref, uint64_t new_ref, uint32_t price, uint32_t qty) {
-    auto it = orders_.find(old_ref);
-    if (it == orders_.end()) return;
-    
-    Order old_order = it->second;
-    
-    // Remove old order
-    if (old_order.side == itch::Side::Buy) {
-        removeFromLevel(bids_, old_order.price, old_order.remaining_qty);
-    } else {
-        removeFromLevel(asks_, old_order.price, old_order.remaining_qty);
-    }
-    orders_.erase(it);
-    
-    // Add new order
-    addOrder(new_ref, old_order.side, price, qty);
+void OrderBook::replaceOrder(const Order& old_order, const Order& new_order) {
+    deleteOrder(old_order);
+    addOrder(new_order);
 }
 
 void OrderBook::recordTrade(uint32_t price, uint32_t qty, itch::Side aggressor_side) {
@@ -111,7 +74,14 @@ void OrderBook::recordTrade(uint32_t price, uint32_t qty, itch::Side aggressor_s
     last_price_ = price;
     last_qty_ = qty;
     total_volume_ += qty;
-    dirty_ = true;
+    markDirty();
+}
+
+void OrderBook::restoreTrade(uint32_t last_price, uint32_t last_qty, uint64_t total_volume) {
+    last_price_ = last_price;
+    last_qty_ = last_qty;
+    total_volume_ = total_volume;
+    markDirty();
 }
 
 OrderBookSnapshot OrderBook::getSnapshot(uint64_t timestamp, uint64_t sequence) const {
@@ -121,6 +91,16 @@ OrderBookSnapshot OrderBook::getSnapshot(uint64_t timestamp, uint64_t sequence)
     snap.timestamp = timestamp;
     snap.sequence = sequence;
     
+    snap.last_price = last_price_;
+    snap.last_quantity = last_qty_;
+    snap.total_volume = total_volume_;
+    
+    if (storage_ == LevelStorage::Ladder) {
+        snap.bids.count = static_cast<uint8_t>(bid_ladder_.fill(snap.bids.levels.data(), depth_));
+        snap.asks.count = static_cast<uint8_t>(ask_ladder_.fill(snap.asks.levels.data(), depth_));
+        return snap;
+    }
+    
     // Fill bids
     snap.bids.count = 0;
     for (const auto& [price, level] : bids_) {
@@ -141,10 +121,6 @@ OrderBookSnapshot OrderBook::getSnapshot(uint64_t timestamp, uint64_t sequence)
         snap.asks.count++;
     }
     
-    snap.last_price = last_price_;
-    snap.last_quantity = last_qty_;
-    snap.total_volume = total_volume_;
-    
     return snap;
 }
 
@@ -155,6 +131,12 @@ QuoteUpdate OrderBook::getBBO(uint64_t timestamp, uint64_t sequence) const {
     quote.timestamp = timestamp;
     quote.sequence = sequence;
     
+    if (storage_ == LevelStorage::Ladder) {
+        bid_ladder_.best(quote.bid_price, quote.bid_quantity);
+        ask_ladder_.best(quote.ask_price, quote.ask_quantity);
+        return quote;
+    }
+    
     if (!bids_.empty()) {
         const auto& best_bid = *bids_.begin();
         quote.bid_price = best_bid.first;
@@ -185,13 +167,13 @@ void OrderBook::addToLevel(std::map<uint32_t, std::pair<uint32_t, uint32_t>>& le
 }
 
 void OrderBook::removeFromLevel(std::map<uint32_t, std::pair<uint32_t, uint32_t>, std::greater<uint32_t>>& levels,
-                                uint32_t price, uint32_t qty) {
+                                uint32_t price, uint32_t qty, uint32_t orders) {
     auto it = levels.find(price);
     if (it == levels.end()) return;
     
     auto& level = it->second;
     level.first = (level.first > qty) ? level.first - qty : 0;
-    level.second = (level.second > 0) ? level.second - 1 : 0;
+    level.second = (level.second > orders) ? level.second - orders : 0;
     
     if (level.first == 0) {
         levels.erase(it);
@@ -199,59 +181,65 @@ void OrderBook::removeFromLevel(std::map<uint32_t, std::pair<uint32_t, uint32_t>
 }
 
 void OrderBook::removeFromLevel(std::map<uint32_t, std::pair<uint32_t, uint32_t>>& levels,
-                                uint32_t price, uint32_t qty) {
+                                uint32_t price, uint32_t qty, uint32_t orders) {
     auto it = levels.find(price);
     if (it == levels.end()) return;
     
     auto& level = it->second;
     level.first = (level.first > qty) ? level.first - qty : 0;
-    level.second = (level.second > 0) ? level.second - 1 : 0;
+    level.second = (level.second > orders) ? level.second - orders : 0;
     
     if (level.first == 0) {
         levels.erase(it);
     }
 }
 
+void OrderBook::removeFromSide(const Order& order, uint32_t qty, uint32_t orders) {
+    if (storage_ == LevelStorage::Ladder) {
+        auto& ladder = order.side == itch::Side::Buy ? bid_ladder_ : ask_ladder_;
+        ladder.remove(order.price, qty, orders);
+    } else if (order.side == itch::Side::Buy) {
+        removeFromLevel(bids_, order.price, qty, orders);
+    } else {
+        removeFromLevel(asks_, order.price, qty, orders);
+    }
+}
+
 // ============================================================================
 // OrderBookManager
 // ============================================================================
 
-OrderBookManager::OrderBookManager(size_t depth) : depth_(depth) {}
+OrderBookManager::OrderBookManager(size_t depth, LevelStorage storage,
+                                   const LadderConfig& ladder)
+    : depth_(depth)
+    , storage_(storage)
+    , ladder_(ladder)
+    , locate_books_(65536, nullptr) {}
 
 OrderBook& OrderBookManager::getBook(const std::string& symbol) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     auto it = books_.find(symbol);
     if (it == books_.end()) {
-        auto [inserted, _] = books_.emplace(symbol, OrderBook(symbol, depth_));
-        return inserted->second;
+        auto [inserted, _] = books_.emplace(symbol, OrderBook(symbol, depth_, storage_, ladder_));
+        OrderBook& book = inserted->second;
+        book.attachDirtySet(&dirty_, static_cast<uint32_t>(books_by_index_.size()));
+        books_by_index_.push_back(&book);
+        return book;
     }
     return it->second;
 }
 
-bool OrderBookManager::hasBook(const std::string& symbol) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return books_.find(symbol) != books_.end();
-}
-
-std::vector<std::string> OrderBookManager::getDirtySymbols() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    std::vector<std::string> dirty;
-    
-    for (const auto& [symbol, book] : books_) {
-        if (book.isDirty()) {
-            dirty.push_back(symbol);
-        }
-    }
-    
-    return dirty;
+OrderBook& OrderBookManager::registerLocate(uint16_t stock_locate, const std::string& symbol) {
+    OrderBook& book = getBook(symbol);
+    locate_books_[stock_locate] = &book;
+    book.setLocate(stock_locate);
+    return book;
 }
 
-void OrderBookManager::clearAllDirty() {
+bool OrderBookManager::hasBook(const std::string& symbol) const {
     std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& [symbol, book] : books_) {
-        book.clearDirty();
-    }
+    return books_.find(symbol) != books_.end();
 }
 
 OrderBookSnapshot OrderBookManager::getSnapshot(const std::string& symbol, 
@@ -1,12 +1,15 @@
 #pragma once
 
+#include "dirty_set.h"
 #include "market_data.h"
 #include "itch_protocol.h"
+#include "price_ladder.h"
 
 #include <map>
 #include <unordered_map>
 #include <string>
 #include <mutex>
+#include <vector>
 
 namespace feedhandler {
 
@@ -18,20 +21,37 @@ struct Order {
     itch::Side side;
 };
 
+// Price level container used by a book
+enum class LevelStorage {
+    Map,        // std::map per side
+    Ladder,     // Tick-indexed PriceLadder around the touch
+};
+
 // Order book for a single symbol
 class OrderBook {
 public:
-    explicit OrderBook(const std::string& symbol, size_t depth = MAX_DEPTH);
-    
-    // Order operations
-    void addOrder(uint64_t order_ref, itch::Side side, uint32_t price, uint32_t qty);
-    void deleteOrder(uint64_t order_ref);
-    void cancelOrder(uint64_t order_ref, uint32_t cancel_qty);
-    void executeOrder(uint64_t order_ref, uint32_t exec_qty);
-    void replaceOrder(uint64_t old_ref, uint64_t new_ref, uint32_t price, uint32_t qty);
+    explicit OrderBook(const std::string& symbol, size_t depth = MAX_DEPTH,
+                       LevelStorage storage = LevelStorage::Map,
+                       const LadderConfig& ladder = LadderConfig{});
+    
+    // Order operations. Orders are owned by an external store (see
+    // OrderIndex); these update price levels and trade state only.
+    // cancelOrder/executeOrder return true once the order is fully consumed.
+    void addOrder(const Order& order);
+    void deleteOrder(const Order& order);
+    bool cancelOrder(Order& order, uint32_t cancel_qty);
+    bool executeOrder(Order& order, uint32_t exec_qty);
+    bool executeOrder(Order& order, uint32_t exec_qty, uint32_t exec_price);
+    void replaceOrder(const Order& old_order, const Order& new_order);
     
     // Trade handling
     void recordTrade(uint32_t price, uint32_t qty, itch::Side aggressor_side);
+    uint32_t getLastPrice() const { return last_price_; }
+    uint32_t getLastQty() const { return last_qty_; }
+    uint64_t getTotalVolume() const { return total_volume_; }
+    
+    // Warm start: trade state as of a checkpoint
+    void restoreTrade(uint32_t last_price, uint32_t last_qty, uint64_t total_volume);
     
     // Snapshot
     OrderBookSnapshot getSnapshot(uint64_t timestamp, uint64_t sequence) const;
@@ -41,22 +61,55 @@ public:
     
     // Stats
     const std::string& getSymbol() const { return symbol_; }
+    LevelStorage getLevelStorage() const { return storage_; }
     bool isDirty() const { return dirty_; }
     void clearDirty() { dirty_ = false; }
     
+    // Report the first change after each clearDirty() to the owner's set
+    void attachDirtySet(DirtySet* set, uint32_t index) {
+        dirty_set_ = set;
+        index_ = index;
+    }
+    uint32_t getIndex() const { return index_; }
+    
+    // ITCH stock_locate bound to this book (0 = none yet)
+    uint16_t getLocate() const { return locate_; }
+    void setLocate(uint16_t locate) { locate_ = locate; }
+    
+    // ConflationTable slot the owner captures this book into (UINT32_MAX = none)
+    uint32_t getConflationSlot() const { return conflation_slot_; }
+    void setConflationSlot(uint32_t slot) { conflation_slot_ = slot; }
+    
+    // BookCacheWriter slot (UINT32_MAX = none yet)
+    uint32_t getCacheSlot() const { return cache_slot_; }
+    void setCacheSlot(uint32_t slot) { cache_slot_ = slot; }
+
 private:
     std::string symbol_;
     size_t depth_;
+    LevelStorage storage_;
     bool dirty_ = false;
-    
-    // Orders by reference
-    std::unordered_map<uint64_t, Order> orders_;
+    DirtySet* dirty_set_ = nullptr;
+    uint32_t index_ = 0;                // Dense index within the manager
+    uint16_t locate_ = 0;
+    uint32_t conflation_slot_ = UINT32_MAX;
+    uint32_t cache_slot_ = UINT32_MAX;
+    
+    void markDirty() {
+        if (dirty_) return;
+        dirty_ = true;
+        if (dirty_set_) dirty_set_->mark(index_);
+    }
     
     // Price levels: price -> {total_qty, order_count}
     // For bids: use reverse order (descending)
     std::map<uint32_t, std::pair<uint32_t, uint32_t>, std::greater<uint32_t>> bids_;
     std::map<uint32_t, std::pair<uint32_t, uint32_t>> asks_;
     
+    // Price levels when storage_ == LevelStorage::Ladder
+    PriceLadder bid_ladder_;
+    PriceLadder ask_ladder_;
+    
     // Last trade
     uint32_t last_price_ = 0;
     uint32_t last_qty_ = 0;
@@ -67,35 +120,71 @@ private:
     void addToLevel(std::map<uint32_t, std::pair<uint32_t, uint32_t>>& levels,
                     uint32_t price, uint32_t qty);
     void removeFromLevel(std::map<uint32_t, std::pair<uint32_t, uint32_t>, std::greater<uint32_t>>& levels,
-                         uint32_t price, uint32_t qty);
+                         uint32_t price, uint32_t qty, uint32_t orders);
     void removeFromLevel(std::map<uint32_t, std::pair<uint32_t, uint32_t>>& levels,
-                         uint32_t price, uint32_t qty);
+                         uint32_t price, uint32_t qty, uint32_t orders);
+    
+    // Remove qty from the order's level; orders = 1 when the order leaves it
+    void removeFromSide(const Order& order, uint32_t qty, uint32_t orders);
 };
 
 // Order book manager for all symbols
 class OrderBookManager {
 public:
-    explicit OrderBookManager(size_t depth = MAX_DEPTH);
+    explicit OrderBookManager(size_t depth = MAX_DEPTH,
+                              LevelStorage storage = LevelStorage::Map,
+                              const LadderConfig& ladder = LadderConfig{});
     
-    // Get or create book for symbol
+    // Get or create book for symbol (directory/admin path, takes the lock)
     OrderBook& getBook(const std::string& symbol);
     
+    // Bind an ITCH stock_locate to a symbol's book (from StockDirectory 'R')
+    OrderBook& registerLocate(uint16_t stock_locate, const std::string& symbol);
+    
+    // Hot-path lookup by stock_locate, nullptr if the locate is unbound.
+    // Lock-free: the table is only written by the ingest thread.
+    OrderBook* getBookByLocate(uint16_t stock_locate) const {
+        return locate_books_[stock_locate];
+    }
+    
     // Check if symbol exists
     bool hasBook(const std::string& symbol) const;
     
-    // Get all dirty books
-    std::vector<std::string> getDirtySymbols() const;
-    
-    // Clear all dirty flags
-    void clearAllDirty();
+    // fn(OrderBook&) for every book changed since the last drain, clearing
+    // its dirty flag first. O(dirty books); ingest thread only.
+    template <typename Fn>
+    void drainDirty(Fn&& fn) {
+        dirty_.drain([&](uint32_t index) {
+            OrderBook& book = *books_by_index_[index];
+            book.clearDirty();
+            fn(book);
+        });
+    }
+    
+    size_t bookCount() const { return books_by_index_.size(); }
+    
+    // fn(OrderBook&) for every book in index order; ingest thread only
+    template <typename Fn>
+    void forEachBook(Fn&& fn) {
+        for (OrderBook* book : books_by_index_) fn(*book);
+    }
     
     // Get snapshot for symbol
     OrderBookSnapshot getSnapshot(const std::string& symbol, uint64_t timestamp, uint64_t sequence);
-    
+
 private:
     size_t depth_;
+    LevelStorage storage_;
+    LadderConfig ladder_;
     mutable std::mutex mutex_;
     std::unordered_map<std::string, OrderBook> books_;
+    
+    // stock_locate -> book (books_ nodes are stable, so raw pointers are safe)
+    std::vector<OrderBook*> locate_books_;
+    
+    // Dense book index -> book, and the books changed since the last drain
+    std::vector<OrderBook*> books_by_index_;
+    DirtySet dirty_;
 };
 
 } // namespace feedhandler
@@ -0,0 +1,113 @@
+#include "order_index.h"
+
+namespace feedhandler {
+
+namespace {
+
+size_t roundUpPow2(size_t n) {
+    size_t p = 16;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+unsigned log2Pow2(size_t n) {
+    unsigned bits = 0;
+    while ((size_t{1} << bits) < n) bits++;
+    return bits;
+}
+
+} // namespace
+
+OrderIndex::OrderIndex(size_t capacity) {
+    size_t slots = roundUpPow2(capacity);
+    slots_.assign(slots, Entry{});
+    mask_ = slots - 1;
+    shift_ = 64 - log2Pow2(slots);
+    max_size_ = slots - slots / 8;
+}
+
+OrderIndex::Entry* OrderIndex::insert(const Order& order, OrderBook* book) {
+    if (order.order_ref == 0) return nullptr;
+
+    if (size_ >= max_size_) {
+        grow();
+    }
+
+    size_t i = slotFor(order.order_ref);
+    while (true) {
+        Entry& slot = slots_[i];
+        if (slot.order.order_ref == 0) {
+            slot.order = order;
+            slot.book = book;
+            if (++size_ > high_water_) high_water_ = size_;
+            return &slot;
+        }
+        if (slot.order.order_ref == order.order_ref) {
+            slot.order = order;
+            slot.book = book;
+            return &slot;
+        }
+        i = (i + 1) & mask_;
+    }
+}
+
+OrderIndex::Entry* OrderIndex::find(uint64_t order_ref) {
+    if (order_ref == 0) return nullptr;
+
+    size_t i = slotFor(order_ref);
+    while (true) {
+        Entry& slot = slots_[i];
+        if (slot.order.order_ref == order_ref) return &slot;
+        if (slot.order.order_ref == 0) return nullptr;
+        i = (i + 1) & mask_;
+    }
+}
+
+void OrderIndex::erase(Entry* entry) {
+    size_t hole = static_cast<size_t>(entry - slots_.data());
+    size_t i = hole;
+
+    // Backward-shift: pull later entries of the probe run into the hole so
+    // lookups never need tombstones
+    while (true) {
+        i = (i + 1) & mask_;
+        Entry& slot = slots_[i];
+        if (slot.order.order_ref == 0) break;
+
+        size_t home = slotFor(slot.order.order_ref);
+        // Move only if the hole lies cyclically within [home, i)
+        if (((i - home) & mask_) >= ((i - hole) & mask_)) {
+            slots_[hole] = slot;
+            hole = i;
+        }
+    }
+
+    slots_[hole] = Entry{};
+    size_--;
+}
+
+void OrderIndex::clear() {
+    slots_.assign(slots_.size(), Entry{});
+    size_ = 0;
+}
+
+void OrderIndex::grow() {
+    std::vector<Entry> old;
+    old.swap(slots_);
+
+    size_t slots = old.size() * 2;
+    slots_.assign(slots, Entry{});
+    mask_ = slots - 1;
+    shift_ = 64 - log2Pow2(slots);
+    max_size_ = slots - slots / 8;
+    size_ = 0;
+    grow_count_++;
+
+    for (const auto& entry : old) {
+        if (entry.order.order_ref != 0) {
+            insert(entry.order, entry.book);
+        }
+    }
+}
+
+} // namespace feedhandler
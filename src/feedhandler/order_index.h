@@ -0,0 +1,77 @@
+#pragma once
+
+#include "order_book.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace feedhandler {
+
+// Feed-wide order store keyed by ITCH order reference number.
+//
+// Order-level messages (E, C, X, D, U) carry only the order_ref, so the
+// handler needs the order and its owning book without knowing the symbol.
+// Orders live inline in a preallocated open-addressing table (linear probing,
+// backward-shift deletion, no tombstones), so a lookup is one multiply and
+// usually a single cache line.
+//
+// Slots are released on delete / full execution, so capacity has to cover the
+// peak number of *live* orders, not every ref issued during the day.
+// order_ref 0 is reserved as the empty-slot marker; insert() refuses it.
+class OrderIndex {
+public:
+    struct Entry {
+        Order order;
+        OrderBook* book;
+    };
+
+    // Full-depth NASDAQ peaks at a few million live orders
+    static constexpr size_t DEFAULT_CAPACITY = size_t{1} << 22;
+
+    // Capacity is rounded up to a power of two
+    explicit OrderIndex(size_t capacity = DEFAULT_CAPACITY);
+
+    // Insert (or overwrite) an order, returns its slot. nullptr for
+    // order_ref 0, which cannot be stored.
+    Entry* insert(const Order& order, OrderBook* book);
+
+    // Find order by reference, nullptr if unknown
+    Entry* find(uint64_t order_ref);
+
+    // Erase a slot returned by insert()/find(). Invalidates other Entry pointers.
+    void erase(Entry* entry);
+
+    void clear();
+
+    // fn(const Entry&) for every live order, in table order
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const auto& slot : slots_) {
+            if (slot.order.order_ref != 0) fn(slot);
+        }
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+    size_t highWater() const { return high_water_; }
+    uint64_t growCount() const { return grow_count_; }  // Heap reallocations
+
+private:
+    size_t slotFor(uint64_t order_ref) const {
+        // Fibonacci hashing: order refs are near-sequential, so spread them
+        return static_cast<size_t>((order_ref * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+
+    void grow();
+
+    std::vector<Entry> slots_;
+    size_t mask_ = 0;
+    unsigned shift_ = 0;
+    size_t size_ = 0;
+    size_t max_size_ = 0;   // Grow threshold (7/8 load)
+    size_t high_water_ = 0;
+    uint64_t grow_count_ = 0;
+};
+
+} // namespace feedhandler
@@ -0,0 +1,97 @@
+#include "order_index.h"
+
+#include <gtest/gtest.h>
+
+namespace feedhandler {
+namespace {
+
+Order makeOrder(uint64_t order_ref, uint32_t price = 1000000, uint32_t qty = 100) {
+    return Order{order_ref, price, qty, itch::Side::Buy};
+}
+
+TEST(OrderIndexTest, InsertAndFind) {
+    OrderIndex index(64);
+
+    OrderIndex::Entry* entry = index.insert(makeOrder(42), nullptr);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->order.order_ref, 42u);
+    EXPECT_EQ(index.size(), 1u);
+
+    EXPECT_EQ(index.find(42), entry);
+    EXPECT_EQ(index.find(43), nullptr);
+}
+
+TEST(OrderIndexTest, InsertOverwritesSameRef) {
+    OrderIndex index(64);
+
+    index.insert(makeOrder(7, 1000000, 100), nullptr);
+    OrderIndex::Entry* entry = index.insert(makeOrder(7, 1000100, 50), nullptr);
+
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_EQ(index.find(7)->order.price, 1000100u);
+    EXPECT_EQ(index.find(7)->order.remaining_qty, 50u);
+}
+
+TEST(OrderIndexTest, RejectsReservedRefZero) {
+    OrderIndex index(64);
+
+    EXPECT_EQ(index.insert(makeOrder(0), nullptr), nullptr);
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_EQ(index.highWater(), 0u);
+    EXPECT_EQ(index.find(0), nullptr);
+
+    // The table is unaffected: real orders still go in and come out
+    ASSERT_NE(index.insert(makeOrder(1), nullptr), nullptr);
+    EXPECT_EQ(index.size(), 1u);
+
+    size_t visited = 0;
+    index.forEach([&visited](const OrderIndex::Entry&) { visited++; });
+    EXPECT_EQ(visited, 1u);
+}
+
+TEST(OrderIndexTest, EraseKeepsProbeRunsReachable) {
+    OrderIndex index(16);
+
+    // Enough near-sequential refs that some share a probe run
+    for (uint64_t ref = 1; ref <= 12; ++ref) {
+        ASSERT_NE(index.insert(makeOrder(ref), nullptr), nullptr);
+    }
+    for (uint64_t ref = 1; ref <= 12; ref += 2) {
+        OrderIndex::Entry* entry = index.find(ref);
+        ASSERT_NE(entry, nullptr);
+        index.erase(entry);
+    }
+
+    EXPECT_EQ(index.size(), 6u);
+    for (uint64_t ref = 1; ref <= 12; ++ref) {
+        OrderIndex::Entry* entry = index.find(ref);
+        if (ref % 2 == 1) {
+            EXPECT_EQ(entry, nullptr) << "ref " << ref;
+        } else {
+            ASSERT_NE(entry, nullptr) << "ref " << ref;
+            EXPECT_EQ(entry->order.order_ref, ref);
+        }
+    }
+}
+
+TEST(OrderIndexTest, GrowKeepsEveryOrder) {
+    OrderIndex index(16);
+    size_t initial_capacity = index.capacity();
+
+    for (uint64_t ref = 1; ref <= 1000; ++ref) {
+        ASSERT_NE(index.insert(makeOrder(ref, static_cast<uint32_t>(ref)), nullptr), nullptr);
+    }
+
+    EXPECT_EQ(index.size(), 1000u);
+    EXPECT_GT(index.capacity(), initial_capacity);
+    EXPECT_GT(index.growCount(), 0u);
+    for (uint64_t ref = 1; ref <= 1000; ++ref) {
+        OrderIndex::Entry* entry = index.find(ref);
+        ASSERT_NE(entry, nullptr) << "ref " << ref;
+        EXPECT_EQ(entry->order.price, static_cast<uint32_t>(ref));
+    }
+}
+
+} // namespace
+} // namespace feedhandler
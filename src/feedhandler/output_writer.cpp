@@ -0,0 +1,83 @@
+#include "output_writer.h"
+
+#include "l2_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace feedhandler {
+
+OutputWriter::OutputWriter(const FeedHandlerConfig& config, uint8_t flags)
+    : pack_(config.output_mtu != 0)
+    , flags_(flags) {
+    sender_ = std::make_unique<MulticastSender>(
+        config.output_group, config.output_port,
+        config.output_interface, config.output_ttl);
+    
+    // Output buffer holds at least one message of the largest type
+    size_t max_message = sizeof(OutputHeader) +
+                         std::max(sizeof(OrderBookSnapshot), MAX_L2_SNAPSHOT_BYTES);
+    limit_ = std::max(config.output_mtu, max_message);
+    buffer_.resize(limit_);
+    sender_->setBatchSize(config.send_batch_size, limit_);
+}
+
+bool OutputWriter::start() {
+    return sender_->start();
+}
+
+void OutputWriter::stop() {
+    flush();
+    sender_->stop();
+}
+
+void OutputWriter::append(OutputMessageType type, uint64_t timestamp,
+                          const void* payload, size_t payload_len) {
+    size_t length = sizeof(OutputHeader) + payload_len;
+    if (offset_ + length > limit_) {
+        closeDatagram();
+    }
+    
+    auto* header = reinterpret_cast<OutputHeader*>(buffer_.data() + offset_);
+    header->length = static_cast<uint16_t>(length);
+    header->type = type;
+    header->flags = flags_;
+    header->timestamp = timestamp;
+    std::memcpy(buffer_.data() + offset_ + sizeof(OutputHeader), payload, payload_len);
+    
+    offset_ += length;
+    pending_++;
+    
+    if (!pack_) {
+        closeDatagram();
+    }
+}
+
+void OutputWriter::closeDatagram() {
+    if (offset_ == 0) return;
+    
+    if (sender_->queue(buffer_.data(), offset_)) {
+        messages_sent_ += pending_;
+        bytes_sent_ += offset_;
+        datagrams_sent_++;
+    }
+    
+    offset_ = 0;
+    pending_ = 0;
+}
+
+void OutputWriter::flush() {
+    closeDatagram();
+    sender_->flush();
+}
+
+void OutputWriter::fillStats(FeedStats& stats) const {
+    stats.messages_sent = messages_sent_;
+    stats.bytes_sent = bytes_sent_;
+    stats.datagrams_sent = datagrams_sent_;
+    const auto& send_stats = sender_->getBatchStats();
+    stats.send_batches = send_stats.flushes;
+    stats.send_batch_max = send_stats.max_batch;
+}
+
+} // namespace feedhandler
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "feedhandler_config.h"
+#include "market_data.h"
+#include "multicast.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace feedhandler {
+
+// Output path of one publishing thread: encodes OutputHeader-framed messages
+// in place into a reusable datagram, packs consecutive messages up to
+// output_mtu and queues finished datagrams for sendmmsg.
+class OutputWriter {
+public:
+    // flags is stamped into every OutputHeader written
+    OutputWriter(const FeedHandlerConfig& config, uint8_t flags);
+    
+    // Non-copyable
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+    
+    bool start();
+    void stop();
+    
+    void append(OutputMessageType type, uint64_t timestamp,
+                const void* payload, size_t payload_len);
+    
+    // Queue the datagram being built
+    void closeDatagram();
+    
+    // Close the datagram and send everything queued
+    void flush();
+    
+    // Fill the send-side FeedStats fields
+    void fillStats(FeedStats& stats) const;
+    
+private:
+    std::unique_ptr<MulticastSender> sender_;
+    bool pack_;
+    uint8_t flags_;
+    
+    std::vector<uint8_t> buffer_;
+    size_t limit_ = 0;
+    size_t offset_ = 0;
+    uint64_t pending_ = 0;
+    
+    uint64_t messages_sent_ = 0;
+    uint64_t bytes_sent_ = 0;
+    uint64_t datagrams_sent_ = 0;
+};
+
+} // namespace feedhandler
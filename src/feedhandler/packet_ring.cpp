@@ -0,0 +1,350 @@
+#include "packet_ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/net_tstamp.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace feedhandler {
+
+namespace {
+
+constexpr size_t RING_BLOCK_SIZE = size_t{1} << 16;
+
+size_t roundUpPow2(size_t n) {
+    size_t p = TPACKET_ALIGNMENT;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Interface index owning an IPv4 address, 0 (all interfaces) for INADDR_ANY
+unsigned interfaceIndexFor(const std::string& address) {
+    in_addr_t addr = inet_addr(address.c_str());
+    if (addr == htonl(INADDR_ANY)) return 0;
+    
+    struct ifaddrs* ifas = nullptr;
+    if (getifaddrs(&ifas) < 0) return 0;
+    
+    unsigned index = 0;
+    for (struct ifaddrs* ifa = ifas; ifa; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != AF_INET) continue;
+        auto* sin = reinterpret_cast<struct sockaddr_in*>(ifa->ifa_addr);
+        if (sin->sin_addr.s_addr == addr) {
+            index = if_nametoindex(ifa->ifa_name);
+            break;
+        }
+    }
+    freeifaddrs(ifas);
+    return index;
+}
+
+} // namespace
+
+// ============================================================================
+// PacketRingReceiver
+// ============================================================================
+
+PacketRingReceiver::PacketRingReceiver(const std::string& group, uint16_t port,
+                                       const std::string& interface,
+                                       size_t ring_bytes, size_t frame_size)
+    : group_(group), port_(port), interface_(interface)
+    , ring_bytes_(ring_bytes)
+    , frame_size_(std::min(roundUpPow2(frame_size), RING_BLOCK_SIZE)) {
+    batch_.resize(64);
+}
+
+PacketRingReceiver::~PacketRingReceiver() {
+    stop();
+    closeRing();
+}
+
+bool PacketRingReceiver::start() {
+    if (running_) return true;
+    
+    closeRing();    // Left mapped by an earlier stop()
+    if (!setupSocket() || !joinGroup()) {
+        closeRing();
+        return false;
+    }
+    
+    running_ = true;
+    std::cout << "Packet ring receiver started on " << group_ << ":" << port_
+              << " (" << frame_count_ << " frames x " << frame_size_ << " bytes)" << std::endl;
+    return true;
+}
+
+void PacketRingReceiver::stop() {
+    // Only stops handing out frames: the caller may still hold the last
+    // batch, so the ring stays mapped until start() or destruction. The
+    // group is left now.
+    running_ = false;
+    if (membership_fd_ >= 0) {
+        close(membership_fd_);
+        membership_fd_ = -1;
+    }
+}
+
+void PacketRingReceiver::closeRing() {
+    if (membership_fd_ >= 0) {
+        close(membership_fd_);      // Drops the membership
+        membership_fd_ = -1;
+    }
+    if (ring_) {
+        munmap(ring_, ring_size_);
+        ring_ = nullptr;
+    }
+    if (socket_fd_ >= 0) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+    }
+    cursor_ = 0;
+    held_ = 0;
+}
+
+bool PacketRingReceiver::setupSocket() {
+    // Protocol 0: nothing is queued until bind(), after the filter is in place
+    socket_fd_ = socket(AF_PACKET, SOCK_DGRAM, 0);
+    if (socket_fd_ < 0) {
+        std::cerr << "Failed to create packet socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    if (!attachFilter()) return false;
+    
+    int version = TPACKET_V2;
+    if (setsockopt(socket_fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        std::cerr << "Failed to set TPACKET_V2: " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    // Frames never straddle blocks: block size is a multiple of frame size
+    struct tpacket_req req{};
+    req.tp_block_size = static_cast<unsigned>(RING_BLOCK_SIZE);
+    req.tp_block_nr = static_cast<unsigned>(std::max<size_t>(ring_bytes_ / RING_BLOCK_SIZE, 1));
+    req.tp_frame_size = static_cast<unsigned>(frame_size_);
+    req.tp_frame_nr = req.tp_block_nr * (req.tp_block_size / req.tp_frame_size);
+    if (setsockopt(socket_fd_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        std::cerr << "Failed to create RX ring: " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    ring_size_ = static_cast<size_t>(req.tp_block_size) * req.tp_block_nr;
+    frame_count_ = req.tp_frame_nr;
+    void* ring = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
+                      socket_fd_, 0);
+    if (ring == MAP_FAILED) {
+        // MAP_LOCKED needs RLIMIT_MEMLOCK headroom; retry unlocked
+        ring = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED, socket_fd_, 0);
+    }
+    if (ring == MAP_FAILED) {
+        std::cerr << "Failed to map RX ring: " << strerror(errno) << std::endl;
+        return false;
+    }
+    ring_ = static_cast<uint8_t*>(ring);
+    
+    struct sockaddr_ll addr{};
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_IP);
+    addr.sll_ifindex = static_cast<int>(interfaceIndexFor(interface_));
+    if (bind(socket_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "Failed to bind packet socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    return true;
+}
+
+bool PacketRingReceiver::attachFilter() {
+    // SOCK_DGRAM packet sockets see the frame from the IP header onwards
+    const uint32_t group = ntohl(inet_addr(group_.c_str()));
+    struct sock_filter code[] = {
+        // Skip our own transmissions (seen again on loopback)
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_PKTTYPE)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING, 13, 0),
+        // IPv4
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+        BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x40, 0, 10),
+        // UDP
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 8),
+        // Destination group
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 16),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, group, 0, 6),
+        // Not a fragment: offset or more-fragments set
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6),
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3fff, 4, 0),
+        // Destination port (X = IP header length)
+        BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+        BPF_STMT(BPF_LD | BPF_H | BPF_IND, 2),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, port_, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    
+    struct sock_fprog prog{};
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (setsockopt(socket_fd_, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+        std::cerr << "Failed to attach packet filter: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool PacketRingReceiver::joinGroup() {
+    if (membership_fd_ >= 0) return true;
+    
+    membership_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (membership_fd_ < 0) {
+        std::cerr << "Failed to create membership socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    struct ip_mreq mreq{};
+    mreq.imr_multiaddr.s_addr = inet_addr(group_.c_str());
+    mreq.imr_interface.s_addr = inet_addr(interface_.c_str());
+    if (setsockopt(membership_fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        std::cerr << "Failed to join multicast group: " << strerror(errno) << std::endl;
+        close(membership_fd_);
+        membership_fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+bool PacketRingReceiver::leaveGroup() {
+    if (membership_fd_ < 0) return true;
+    
+    close(membership_fd_);      // Drops the membership
+    membership_fd_ = -1;
+    
+    // Hand back frames that arrived before the leave
+    releaseBatch();
+    while (frame_count_ > 0 && frameReady(cursor_)) {
+        __atomic_store_n(&frameAt(cursor_)->tp_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        cursor_ = (cursor_ + 1) % frame_count_;
+    }
+    return true;
+}
+
+bool PacketRingReceiver::frameReady(size_t index) const {
+    return (__atomic_load_n(&frameAt(index)->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) != 0;
+}
+
+int PacketRingReceiver::poll(int timeout_ms) {
+    releaseBatch();
+    if (!running_) return -1;
+    if (frameReady(cursor_)) return 1;
+    
+    struct pollfd pfd{};
+    pfd.fd = socket_fd_;
+    pfd.events = POLLIN;
+    int ret = ::poll(&pfd, 1, timeout_ms);
+    if (ret > 0 && (pfd.revents & POLLIN)) {
+        return 1;
+    }
+    return ret;
+}
+
+void PacketRingReceiver::releaseBatch() {
+    if (!ring_) return;
+    
+    size_t index = (cursor_ + frame_count_ - held_) % (frame_count_ ? frame_count_ : 1);
+    for (; held_ > 0; --held_) {
+        __atomic_store_n(&frameAt(index)->tp_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        index = (index + 1) % frame_count_;
+    }
+}
+
+DatagramBatch PacketRingReceiver::readBatch() {
+    releaseBatch();
+    if (!running_) return DatagramBatch{};
+    
+    size_t count = 0;
+    while (count < batch_.size() && frameReady(cursor_)) {
+        const tpacket2_hdr* hdr = frameAt(cursor_);
+        cursor_ = (cursor_ + 1) % frame_count_;
+        held_++;
+        
+        // Captured bytes from the IP header on
+        const uint8_t* ip = reinterpret_cast<const uint8_t*>(hdr) + hdr->tp_net;
+        size_t captured = hdr->tp_snaplen - (hdr->tp_net - hdr->tp_mac);
+        if (hdr->tp_snaplen < hdr->tp_len || captured < 20) {
+            truncated_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        
+        size_t ihl = static_cast<size_t>(ip[0] & 0x0f) * 4;
+        if (captured < ihl + 8) {
+            truncated_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        const uint8_t* udp = ip + ihl;
+        size_t udp_len = (static_cast<size_t>(udp[4]) << 8) | udp[5];
+        if (udp_len < 8 || ihl + udp_len > captured) {
+            truncated_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        
+        uint64_t rx_ns = rx_timestamps_
+            ? static_cast<uint64_t>(hdr->tp_sec) * 1000000000ULL + hdr->tp_nsec : 0;
+        batch_[count++] = Datagram{udp + 8, udp_len - 8, rx_ns};
+    }
+    
+    return DatagramBatch{batch_.data(), count};
+}
+
+void PacketRingReceiver::setBatchSize(size_t max_batch, size_t max_datagram) {
+    (void)max_datagram;
+    releaseBatch();
+    batch_.resize(max_batch > 0 ? max_batch : 1);
+}
+
+bool PacketRingReceiver::setBusyPoll(int usec) {
+    if (socket_fd_ < 0) return false;
+    
+    if (setsockopt(socket_fd_, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0) {
+        std::cerr << "Failed to set SO_BUSY_POLL: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool PacketRingReceiver::enableRxTimestamps() {
+    if (socket_fd_ < 0) return false;
+    
+    int flags = SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (setsockopt(socket_fd_, SOL_PACKET, PACKET_TIMESTAMP, &flags, sizeof(flags)) < 0) {
+        // Software timestamps are still filled in
+        std::cerr << "Failed to request hardware ring timestamps: " << strerror(errno) << std::endl;
+    }
+    rx_timestamps_ = true;
+    return true;
+}
+
+uint64_t PacketRingReceiver::dropCount() {
+    if (socket_fd_ >= 0) {
+        // Counters reset on every read
+        struct tpacket_stats stats{};
+        socklen_t len = sizeof(stats);
+        if (getsockopt(socket_fd_, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0) {
+            kernel_drops_.fetch_add(stats.tp_drops, std::memory_order_relaxed);
+        }
+    }
+    return kernel_drops_.load(std::memory_order_relaxed) + truncated_.load(std::memory_order_relaxed);
+}
+
+} // namespace feedhandler
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "packet_source.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct tpacket2_hdr;
+
+namespace feedhandler {
+
+// Zero-copy receive from an mmap'd AF_PACKET RX ring (TPACKET_V2).
+//
+// The kernel writes matching frames straight into a ring shared with user
+// space; readBatch() hands out pointers to the UDP payloads inside the ring
+// and the frames go back to the kernel on the next readBatch() / poll() /
+// releaseBatch(). No per-packet syscall, no copy into a socket buffer, and no
+// UDP socket lookup. A classic BPF filter keeps only the feed's group:port
+// (unfragmented IPv4/UDP) so the ring never sees unrelated traffic.
+//
+// A UDP socket is kept only to hold the IGMP membership so switches and the
+// NIC keep forwarding the group; it is never bound, so nothing is queued on it.
+// Needs CAP_NET_RAW.
+class PacketRingReceiver : public PacketSource {
+public:
+    static constexpr size_t DEFAULT_RING_BYTES = size_t{16} << 20;
+    static constexpr size_t DEFAULT_FRAME_SIZE = 2048;     // 1500 MTU + headers
+    
+    PacketRingReceiver(const std::string& group, uint16_t port,
+                       const std::string& interface = "0.0.0.0",
+                       size_t ring_bytes = DEFAULT_RING_BYTES,
+                       size_t frame_size = DEFAULT_FRAME_SIZE);
+    ~PacketRingReceiver() override;
+    
+    // Non-copyable
+    PacketRingReceiver(const PacketRingReceiver&) = delete;
+    PacketRingReceiver& operator=(const PacketRingReceiver&) = delete;
+    
+    bool start() override;
+    
+    // Stops handing out frames. The ring (and the batch last read from it)
+    // stays mapped until the next start() or destruction.
+    void stop() override;
+    bool isRunning() const override { return running_; }
+    
+    int getFd() const override { return socket_fd_; }
+    int poll(int timeout_ms) override;
+    
+    DatagramBatch readBatch() override;
+    void releaseBatch() override;
+    
+    // Frame size is fixed at construction; max_datagram is ignored
+    void setBatchSize(size_t max_batch, size_t max_datagram) override;
+    bool setBusyPoll(int usec) override;
+    
+    // Ring frames always carry a kernel timestamp; this asks for the NIC's
+    // raw hardware stamp instead where available
+    bool enableRxTimestamps() override;
+    
+    // Kernel ring drops + frames truncated by the frame size
+    uint64_t dropCount() override;
+    
+    // Membership lives on a separate unbound socket; the BPF filter is unchanged
+    bool joinGroup() override;
+    bool leaveGroup() override;
+    bool isJoined() const override { return membership_fd_ >= 0; }
+    
+private:
+    bool setupSocket();
+    bool attachFilter();
+    void closeRing();
+    
+    tpacket2_hdr* frameAt(size_t index) const {
+        return reinterpret_cast<tpacket2_hdr*>(ring_ + index * frame_size_);
+    }
+    bool frameReady(size_t index) const;
+    
+    std::string group_;
+    uint16_t port_;
+    std::string interface_;
+    size_t ring_bytes_;
+    size_t frame_size_;
+    
+    int socket_fd_ = -1;        // AF_PACKET, owns the ring
+    int membership_fd_ = -1;    // Unbound UDP socket holding the group join
+    bool running_ = false;
+    
+    uint8_t* ring_ = nullptr;
+    size_t ring_size_ = 0;
+    size_t frame_count_ = 0;
+    size_t cursor_ = 0;         // Next frame to read
+    size_t held_ = 0;           // Frames lent out, ending just before cursor_
+    
+    std::vector<Datagram> batch_;
+    bool rx_timestamps_ = false;
+    std::atomic<uint64_t> kernel_drops_{0};    // Accumulated by dropCount()
+    std::atomic<uint64_t> truncated_{0};
+};
+
+} // namespace feedhandler
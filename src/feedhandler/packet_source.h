@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace feedhandler {
+
+// Receive buffer per datagram that fits any UDP payload (65507 bytes over
+// IPv4), the default slot size for batched reads
+constexpr size_t MAX_DATAGRAM_SIZE = 65536;
+
+// One received datagram (UDP payload), pointing into the source's buffers
+struct Datagram {
+    const uint8_t* data;
+    size_t length;
+    uint64_t rx_timestamp_ns;   // CLOCK_REALTIME arrival (NIC or kernel), 0 if unavailable
+};
+
+// Datagrams returned by a batched read, valid until the source's next
+// readBatch() / poll() / releaseBatch()
+struct DatagramBatch {
+    const Datagram* datagrams = nullptr;
+    size_t count = 0;
+    
+    const Datagram* begin() const { return datagrams; }
+    const Datagram* end() const { return datagrams + count; }
+    bool empty() const { return count == 0; }
+};
+
+// Where the feed handlers' run loops get multicast datagrams from.
+//
+// Implemented by MulticastReceiver (kernel UDP socket, recvmmsg) and
+// PacketRingReceiver (mmap'd AF_PACKET ring, zero-copy). Handlers only see
+// UDP payloads, so their packet processing is identical for every backend.
+class PacketSource {
+public:
+    virtual ~PacketSource() = default;
+    
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+    virtual bool isRunning() const = 0;
+    
+    // Pollable descriptor, readable when readBatch() has data
+    virtual int getFd() const = 0;
+    
+    // Wait up to timeout_ms for data: >0 ready, 0 timeout, <0 error
+    virtual int poll(int timeout_ms) = 0;
+    
+    // Non-blocking: up to the batch size of pending datagrams, empty if none
+    virtual DatagramBatch readBatch() = 0;
+    
+    // Hand the last batch's buffers back (no-op for copying backends);
+    // readBatch() and poll() do this implicitly
+    virtual void releaseBatch() {}
+    
+    // Size batches: up to max_batch datagrams of max_datagram bytes
+    virtual void setBatchSize(size_t max_batch, size_t max_datagram) = 0;
+    
+    // SO_BUSY_POLL budget in microseconds. Call after start().
+    virtual bool setBusyPoll(int usec) = 0;
+    
+    // Stamp datagrams with their arrival time: NIC hardware timestamps when
+    // the NIC has RX timestamping enabled (hwstamp_ctl / SIOCSHWTSTAMP, PHC
+    // synced to system time), kernel software timestamps otherwise.
+    // Call after start().
+    virtual bool enableRxTimestamps() { return false; }
+    
+    // Datagrams lost before reaching the handler (socket buffer overflows,
+    // ring overruns, truncation). Safe to call from a monitoring thread.
+    virtual uint64_t dropCount() { return 0; }
+    
+    // Drop / retake the multicast membership while staying open, so a feed
+    // read only now and then costs no NIC or socket-buffer traffic in
+    // between. start() joins. Leaving discards anything already queued.
+    virtual bool joinGroup() = 0;
+    virtual bool leaveGroup() = 0;
+    virtual bool isJoined() const = 0;
+};
+
+} // namespace feedhandler
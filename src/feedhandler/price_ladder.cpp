@@ -0,0 +1,247 @@
+#include "price_ladder.h"
+
+#include <algorithm>
+
+namespace feedhandler {
+
+namespace {
+
+inline bool isLive(uint32_t qty, uint32_t count) {
+    return qty != 0 || count != 0;
+}
+
+} // namespace
+
+PriceLadder::PriceLadder(bool descending, const LadderConfig& config)
+    : descending_(descending)
+    , tick_(config.tick_size > 0 ? config.tick_size : 1)
+    , window_(config.window > 0 ? config.window : 1) {
+}
+
+size_t PriceLadder::slotFor(uint32_t price) const {
+    if (slots_.empty() || price < base_) return NPOS;
+
+    uint32_t offset = price - base_;
+    if (offset % tick_ != 0) return NPOS;
+
+    size_t slot = offset / tick_;
+    return slot < window_ ? slot : NPOS;
+}
+
+void PriceLadder::add(uint32_t price, uint32_t qty) {
+    // Follow the touch: a new best outside the window moves the window to it
+    if (window_levels_ == 0 || (better(price, priceAt(best_)) && slotFor(price) == NPOS)) {
+        recenter(price);
+    }
+
+    size_t slot = slotFor(price);
+    if (slot == NPOS) {
+        auto& level = overflow_[price];
+        level.qty += qty;
+        level.count++;
+        return;
+    }
+
+    Level& level = slots_[slot];
+    if (!isLive(level.qty, level.count)) {
+        window_levels_++;
+        if (best_ == NPOS || better(price, priceAt(best_))) {
+            best_ = slot;
+        }
+    }
+    level.qty += qty;
+    level.count++;
+}
+
+void PriceLadder::remove(uint32_t price, uint32_t qty, uint32_t orders) {
+    size_t slot = slotFor(price);
+    if (slot == NPOS) {
+        auto it = overflow_.find(price);
+        if (it == overflow_.end()) return;
+
+        auto& level = it->second;
+        level.qty = (level.qty > qty) ? level.qty - qty : 0;
+        level.count = (level.count > orders) ? level.count - orders : 0;
+        if (level.qty == 0) {
+            overflow_.erase(it);
+        }
+        return;
+    }
+
+    Level& level = slots_[slot];
+    if (!isLive(level.qty, level.count)) return;
+
+    level.qty = (level.qty > qty) ? level.qty - qty : 0;
+    level.count = (level.count > orders) ? level.count - orders : 0;
+
+    if (level.qty == 0) {
+        level = Level{};
+        window_levels_--;
+        if (slot == best_) {
+            findNextBest();
+            followOverflowBest();
+        }
+    }
+}
+
+bool PriceLadder::best(uint32_t& price, uint32_t& qty) const {
+    bool found = false;
+
+    if (best_ != NPOS) {
+        price = priceAt(best_);
+        qty = slots_[best_].qty;
+        found = true;
+    }
+
+    if (!overflow_.empty()) {
+        const auto& candidate = descending_ ? *overflow_.rbegin() : *overflow_.begin();
+        if (!found || better(candidate.first, price)) {
+            price = candidate.first;
+            qty = candidate.second.qty;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+size_t PriceLadder::fill(PriceLevel* out, size_t max_levels) const {
+    size_t count = 0;
+    size_t slot = best_;
+
+    auto nextSlot = [this](size_t from) -> size_t {
+        if (descending_) {
+            while (from > 0) {
+                --from;
+                if (isLive(slots_[from].qty, slots_[from].count)) return from;
+            }
+            return NPOS;
+        }
+        while (++from < window_) {
+            if (isLive(slots_[from].qty, slots_[from].count)) return from;
+        }
+        return NPOS;
+    };
+
+    // Merge window slots with the overflow map, both already in priority order
+    auto merge = [&](auto it, auto end) {
+        while (count < max_levels && (slot != NPOS || it != end)) {
+            bool take_slot = slot != NPOS &&
+                             (it == end || better(priceAt(slot), it->first));
+            if (take_slot) {
+                out[count++] = PriceLevel{priceAt(slot), slots_[slot].qty, slots_[slot].count};
+                slot = nextSlot(slot);
+            } else {
+                out[count++] = PriceLevel{it->first, it->second.qty, it->second.count};
+                ++it;
+            }
+        }
+    };
+
+    if (descending_) {
+        merge(overflow_.rbegin(), overflow_.rend());
+    } else {
+        merge(overflow_.begin(), overflow_.end());
+    }
+
+    return count;
+}
+
+void PriceLadder::followOverflowBest() {
+    // The window's best is gone and the touch is an overflow level
+    if (overflow_.empty()) return;
+
+    uint32_t price = descending_ ? overflow_.rbegin()->first : overflow_.begin()->first;
+    if (best_ == NPOS || better(price, priceAt(best_))) {
+        recenter(price);
+    }
+}
+
+void PriceLadder::recenter(uint32_t price) {
+    // Only tick-aligned prices can anchor the window
+    if (price % tick_ != 0) return;
+    if (!slots_.empty() && slotFor(price) != NPOS) return;
+
+    if (slots_.empty()) {
+        slots_.resize(window_);
+    }
+
+    uint64_t half = static_cast<uint64_t>(window_ / 2) * tick_;
+    uint32_t base = price > half ? static_cast<uint32_t>(price - half) : 0;
+
+    // Live levels the new window does not cover move to the overflow, the
+    // rest shift to their new slots. Both bases are tick-aligned.
+    if (window_levels_ > 0) {
+        int64_t shift = (static_cast<int64_t>(base) - static_cast<int64_t>(base_)) / tick_;
+        for (size_t slot = 0; slot < window_; ++slot) {
+            Level& level = slots_[slot];
+            if (!isLive(level.qty, level.count)) continue;
+
+            int64_t moved = static_cast<int64_t>(slot) - shift;
+            if (moved < 0 || moved >= static_cast<int64_t>(window_)) {
+                overflow_[priceAt(slot)] = level;
+                level = Level{};
+                window_levels_--;
+            }
+        }
+
+        if (shift > 0 && shift < static_cast<int64_t>(window_)) {
+            std::copy(slots_.begin() + shift, slots_.end(), slots_.begin());
+            std::fill(slots_.end() - shift, slots_.end(), Level{});
+        } else if (shift < 0 && -shift < static_cast<int64_t>(window_)) {
+            std::copy_backward(slots_.begin(), slots_.end() + shift, slots_.end());
+            std::fill(slots_.begin(), slots_.begin() - shift, Level{});
+        }
+    }
+
+    base_ = base;
+    best_ = NPOS;
+    for (size_t i = 0; i < window_ && window_levels_ > 0; ++i) {
+        size_t slot = descending_ ? window_ - 1 - i : i;
+        if (isLive(slots_[slot].qty, slots_[slot].count)) {
+            best_ = slot;
+            break;
+        }
+    }
+
+    // Pull overflow levels that now fall inside the window into slots
+    uint64_t window_end = base_ + static_cast<uint64_t>(window_) * tick_;
+    auto it = overflow_.lower_bound(base_);
+    while (it != overflow_.end() && it->first < window_end) {
+        size_t slot = slotFor(it->first);
+        if (slot == NPOS) {
+            ++it;  // Off-tick price stays in overflow
+            continue;
+        }
+
+        slots_[slot] = Level{it->second.qty, it->second.count};
+        window_levels_++;
+        if (best_ == NPOS || better(it->first, priceAt(best_))) {
+            best_ = slot;
+        }
+        it = overflow_.erase(it);
+    }
+}
+
+void PriceLadder::findNextBest() {
+    if (window_levels_ == 0) {
+        best_ = NPOS;
+        return;
+    }
+
+    size_t slot = best_;
+    if (descending_) {
+        while (slot > 0) {
+            --slot;
+            if (isLive(slots_[slot].qty, slots_[slot].count)) break;
+        }
+    } else {
+        while (slot + 1 < window_) {
+            ++slot;
+            if (isLive(slots_[slot].qty, slots_[slot].count)) break;
+        }
+    }
+    best_ = slot;
+}
+
+} // namespace feedhandler
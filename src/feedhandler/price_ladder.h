@@ -0,0 +1,79 @@
+#pragma once
+
+#include "market_data.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace feedhandler {
+
+struct LadderConfig {
+    uint32_t tick_size = 100;   // Price units per slot ($0.01 at 4 decimals)
+    uint32_t window = 1024;     // Contiguous slots kept around the touch
+};
+
+// One side of a book as a tick-indexed contiguous array around the touch.
+//
+// Prices inside the window map to a slot by (price - base) / tick, so add and
+// remove are an index computation and a store, and a depth walk is a linear
+// scan. Prices outside the window, or not on a tick boundary, go to a small
+// std::map overflow. When the touch leaves the window (a better add outside
+// it, or the best slot emptying with the next best in the overflow) the
+// window recenters on it: live levels it no longer covers move to the
+// overflow and overflow levels that now fit move into slots, so a stale
+// level far from the market cannot hold the window in place.
+//
+// Level semantics match the std::map representation in OrderBook exactly: a
+// level exists from its first add until its quantity drops to zero.
+class PriceLadder {
+public:
+    // descending = true for bids (best is the highest price)
+    explicit PriceLadder(bool descending, const LadderConfig& config = LadderConfig{});
+
+    // Add one order's quantity at price
+    void add(uint32_t price, uint32_t qty);
+
+    // Remove qty (and `orders` orders) from price; level goes away at zero qty
+    void remove(uint32_t price, uint32_t qty, uint32_t orders);
+
+    // Best level, false if the side is empty
+    bool best(uint32_t& price, uint32_t& qty) const;
+
+    // Fill up to max_levels levels in priority order, returns count
+    size_t fill(PriceLevel* out, size_t max_levels) const;
+
+    size_t levelCount() const { return window_levels_ + overflow_.size(); }
+    bool empty() const { return levelCount() == 0; }
+
+private:
+    struct Level {
+        uint32_t qty = 0;
+        uint32_t count = 0;
+    };
+
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+
+    // Slot for price, or NPOS if it belongs in the overflow map
+    size_t slotFor(uint32_t price) const;
+    uint32_t priceAt(size_t slot) const { return base_ + static_cast<uint32_t>(slot) * tick_; }
+    bool better(uint32_t a, uint32_t b) const { return descending_ ? a > b : a < b; }
+
+    void recenter(uint32_t price);
+    void followOverflowBest();
+    void findNextBest();
+
+    bool descending_;
+    uint32_t tick_;
+    size_t window_;
+
+    std::vector<Level> slots_;          // Allocated on first add
+    uint32_t base_ = 0;                 // Price of slot 0
+    size_t best_ = NPOS;                // Best live slot
+    size_t window_levels_ = 0;          // Live slots
+
+    std::map<uint32_t, Level> overflow_;  // Ascending by price
+};
+
+} // namespace feedhandler
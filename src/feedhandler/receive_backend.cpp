@@ -0,0 +1,41 @@
+#include "receive_backend.h"
+#include "multicast.h"
+#include "packet_ring.h"
+
+namespace feedhandler {
+
+std::unique_ptr<PacketSource> makePacketSource(const ReceiveBackendConfig& config,
+                                               const std::string& group, uint16_t port,
+                                               const std::string& interface,
+                                               size_t buffer_size) {
+    switch (config.type) {
+        case ReceiveBackend::PacketRing:
+            return std::make_unique<PacketRingReceiver>(
+                group, port, interface, config.ring_bytes, config.ring_frame_size);
+        case ReceiveBackend::Socket:
+        default:
+            return std::make_unique<MulticastReceiver>(group, port, interface, buffer_size);
+    }
+}
+
+bool parseReceiveBackend(const std::string& name, ReceiveBackend& backend) {
+    if (name == "socket") {
+        backend = ReceiveBackend::Socket;
+        return true;
+    }
+    if (name == "ring") {
+        backend = ReceiveBackend::PacketRing;
+        return true;
+    }
+    return false;
+}
+
+const char* receiveBackendName(ReceiveBackend backend) {
+    switch (backend) {
+        case ReceiveBackend::PacketRing: return "ring";
+        case ReceiveBackend::Socket:
+        default: return "socket";
+    }
+}
+
+} // namespace feedhandler
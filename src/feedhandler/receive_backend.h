@@ -0,0 +1,35 @@
+#pragma once
+
+#include "packet_source.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace feedhandler {
+
+enum class ReceiveBackend {
+    Socket,         // Kernel UDP socket, recvmmsg (MulticastReceiver)
+    PacketRing,     // mmap'd AF_PACKET RX ring, zero-copy (PacketRingReceiver)
+};
+
+struct ReceiveBackendConfig {
+    ReceiveBackend type = ReceiveBackend::Socket;
+    size_t ring_bytes = size_t{16} << 20;   // PacketRing: RX ring size
+    size_t ring_frame_size = 2048;          // PacketRing: slot per frame (headers + datagram)
+};
+
+// Build the input source for one multicast feed.
+// buffer_size is the socket backend's SO_RCVBUF; datagram slots are sized
+// separately by PacketSource::setBatchSize().
+std::unique_ptr<PacketSource> makePacketSource(const ReceiveBackendConfig& config,
+                                               const std::string& group, uint16_t port,
+                                               const std::string& interface,
+                                               size_t buffer_size = 65536);
+
+// "socket" / "ring"
+bool parseReceiveBackend(const std::string& name, ReceiveBackend& backend);
+const char* receiveBackendName(ReceiveBackend backend);
+
+} // namespace feedhandler
@@ -0,0 +1,56 @@
+#include "replay.h"
+
+#include <iomanip>
+
+namespace feedhandler {
+
+namespace {
+
+// Below this much lead the pacer spins instead of sleeping
+constexpr auto SPIN_WINDOW = std::chrono::microseconds(200);
+
+} // namespace
+
+void ReplayPacer::wait(uint64_t timestamp_ns) {
+    if (speed_ <= 0) return;
+    
+    if (!started_) {
+        started_ = true;
+        first_ts_ = timestamp_ns;
+        first_wall_ = Clock::now();
+        return;
+    }
+    if (timestamp_ns <= first_ts_) return;
+    
+    auto offset = std::chrono::nanoseconds(static_cast<int64_t>((timestamp_ns - first_ts_) / speed_));
+    auto due = first_wall_ + std::chrono::duration_cast<Clock::duration>(offset);
+    auto now = Clock::now();
+    if (due <= now) return;     // Behind: catch up without waiting
+    
+    if (due - now > SPIN_WINDOW) {
+        std::this_thread::sleep_until(due - SPIN_WINDOW);
+    }
+    while (Clock::now() < due) {
+    }
+}
+
+void ReplayStats::print(std::ostream& out) const {
+    double seconds = elapsed_ns / 1e9;
+    double rate = seconds > 0 ? 1.0 / seconds : 0.0;
+    
+    out << "\n=== Replay ===" << std::endl;
+    out << "Records:       " << records << " (" << messages << " messages, "
+        << skipped << " skipped)" << std::endl;
+    if (resumed > 0) {
+        out << "Resumed after: " << resumed << " records (from checkpoint)" << std::endl;
+    }
+    out << "Bytes:         " << bytes << std::endl;
+    out << std::fixed << std::setprecision(3);
+    out << "Elapsed:       " << seconds << "s (capture spans " << capture_span_ns / 1e9 << "s)" << std::endl;
+    out << std::setprecision(0);
+    out << "Throughput:    " << records * rate << " records/s, " << messages * rate << " messages/s, "
+        << std::setprecision(1) << bytes * rate / (1024 * 1024) << " MB/s" << std::endl;
+    out << std::defaultfloat << "==============\n" << std::endl;
+}
+
+} // namespace feedhandler
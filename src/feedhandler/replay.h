@@ -0,0 +1,123 @@
+#pragma once
+
+#include "capture_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace feedhandler {
+
+struct ReplayConfig {
+    std::string file;               // pcap or NASDAQ binary ITCH (see CaptureReader)
+    double speed = 0.0;             // 1 = original pace, 10 = ten times faster, 0 = as fast as possible
+    bool moldudp64 = false;         // ITCH pcap payloads start with a 20-byte MoldUDP64 header
+    uint64_t skip_records = 0;      // Pass over this many records unprocessed (resuming from a checkpoint)
+};
+
+// Outcome of a replay, printed after the handler's own stats
+struct ReplayStats {
+    uint64_t records = 0;           // Datagrams (pcap) or message runs (binary ITCH) fed in
+    uint64_t messages = 0;          // ITCH messages for binary ITCH, datagrams for pcap
+    uint64_t bytes = 0;
+    uint64_t skipped = 0;           // Not IPv4/UDP, fragments, other ports
+    uint64_t resumed = 0;           // Passed over for skip_records, not paced
+    uint64_t capture_span_ns = 0;   // Last record's timestamp minus the first's
+    uint64_t elapsed_ns = 0;        // Wall time the replay took
+    
+    void print(std::ostream& out) const;
+};
+
+// Holds each record back until its capture timestamp, relative to the
+// first record, scaled by 1/speed has passed. Speed 0 never waits.
+// Long waits sleep; the last stretch spins so pacing stays accurate to a
+// few microseconds. A record timestamped before its predecessor (merged
+// captures) goes out immediately.
+class ReplayPacer {
+public:
+    explicit ReplayPacer(double speed) : speed_(speed) {}
+    
+    void wait(uint64_t timestamp_ns);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    double speed_;
+    bool started_ = false;
+    uint64_t first_ts_ = 0;
+    Clock::time_point first_wall_;
+};
+
+// Drive fn(const CaptureRecord&) with every record of the capture, paced by
+// config.speed, until the file ends or running turns false. pcap records
+// not addressed to accept(dst_port) are counted as skipped. MoldUDP64
+// headers are stripped when config.moldudp64 is set (ITCH). The first
+// config.skip_records records fn would have seen are passed over without
+// pacing. False if the capture could not be opened.
+template <typename Accept, typename Fn>
+bool replayCapture(const ReplayConfig& config, const std::atomic<bool>& running,
+                   ReplayStats& stats, Accept&& accept, Fn&& fn) {
+    CaptureReader reader;
+    if (!reader.open(config.file)) return false;
+    
+    std::cout << "Replaying " << config.file << " (" << reader.formatName() << ", "
+              << reader.fileSize() / (1024 * 1024) << " MB) at ";
+    if (config.speed > 0) {
+        std::cout << config.speed << "x capture pace" << std::endl;
+    } else {
+        std::cout << "full speed" << std::endl;
+    }
+    
+    ReplayPacer pacer(config.speed);
+    bool pcap = reader.format() == CaptureReader::Format::Pcap;
+    bool have_first = false;
+    uint64_t first_ts = 0;
+    uint64_t last_ts = 0;
+    auto started = std::chrono::steady_clock::now();
+    
+    CaptureRecord record;
+    while (running.load(std::memory_order_relaxed) && reader.next(record)) {
+        if (pcap && !accept(record.dst_port)) {
+            stats.skipped++;
+            continue;
+        }
+        if (config.moldudp64 && pcap) {
+            // session(10) sequence(8) count(2); heartbeats carry no messages
+            constexpr size_t MOLD_HEADER = 20;
+            if (record.length <= MOLD_HEADER) {
+                stats.skipped++;
+                continue;
+            }
+            record.data += MOLD_HEADER;
+            record.length -= MOLD_HEADER;
+        }
+        if (stats.resumed < config.skip_records) {
+            stats.resumed++;
+            continue;
+        }
+        
+        if (!have_first) {
+            first_ts = record.timestamp_ns;
+            have_first = true;
+        }
+        last_ts = std::max(last_ts, record.timestamp_ns);
+        pacer.wait(record.timestamp_ns);
+        
+        fn(record);
+        stats.records++;
+        stats.messages += record.messages;
+        stats.bytes += record.length;
+    }
+    
+    stats.skipped += reader.getStats().skipped;
+    stats.capture_span_ns = have_first ? last_ts - first_ts : 0;
+    stats.elapsed_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - started).count());
+    return true;
+}
+
+} // namespace feedhandler
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace feedhandler {
+
+// Single-writer sequence lock around a trivially copyable value.
+//
+// The writer never waits: it bumps the sequence to odd, copies the value in
+// and bumps it back to even. Readers copy the value out and retry if the
+// sequence was odd or changed underneath them, so a reader can never stall
+// the writer (the opposite trade-off to a mutex).
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable T");
+
+public:
+    // Writer thread only
+    void store(const T& value) {
+        write([&value](T& out) { std::memcpy(&out, &value, sizeof(T)); });
+    }
+    
+    // Writer thread only: fn(T&) updates the value in place
+    template <typename Fn>
+    void write(Fn&& fn) {
+        uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        fn(value_);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+    
+    // Any thread: a consistent copy of the last stored value
+    T load() const {
+        T out;
+        uint64_t before, after;
+        do {
+            before = seq_.load(std::memory_order_acquire);
+            std::memcpy(&out, &value_, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq_.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+        return out;
+    }
+    
+    // Any thread: load() giving up after attempts overlapped writes, for
+    // readers that must not hang on a writer that died mid-store (another
+    // process sharing the memory)
+    bool tryLoad(T& out, unsigned attempts) const {
+        for (unsigned i = 0; i < attempts; ++i) {
+            uint64_t before = seq_.load(std::memory_order_acquire);
+            if ((before & 1) != 0) continue;
+            std::memcpy(&out, &value_, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) return true;
+        }
+        return false;
+    }
+    
+    // Number of stores so far
+    uint64_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint64_t> seq_{0};
+    T value_{};
+};
+
+} // namespace feedhandler
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace feedhandler {
+
+// Bounded lock-free single-producer / single-consumer ring.
+//
+// The producer claims a slot, fills it in place and publishes it; the
+// consumer peeks and releases in FIFO order. Each side keeps a cached copy of
+// the other side's index so the shared cache lines are only touched when the
+// ring looks full (producer) or empty (consumer).
+template <typename T>
+class SpscRing {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t slots = 2;
+        while (slots < capacity) slots <<= 1;
+        slots_.resize(slots);
+        mask_ = slots - 1;
+    }
+    
+    // Non-copyable
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    
+    // Producer: next free slot, nullptr if the ring is full
+    T* claim() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) return nullptr;
+        }
+        return &slots_[tail & mask_];
+    }
+    
+    // Producer: make the claimed slot visible to the consumer
+    void publish() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    // Consumer: oldest published slot, nullptr if the ring is empty
+    const T* peek() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+    
+    // Consumer: hand the peeked slot back to the producer
+    void release() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    size_t capacity() const { return slots_.size(); }
+    
+    // Any thread: slots published and not yet released (a snapshot, for monitoring)
+    size_t size() const {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    
+    alignas(64) std::atomic<size_t> head_{0};   // Written by the consumer
+    size_t cached_tail_ = 0;                    // Consumer's view of tail_
+    alignas(64) std::atomic<size_t> tail_{0};   // Written by the producer
+    size_t cached_head_ = 0;                    // Producer's view of head_
+};
+
+} // namespace feedhandler
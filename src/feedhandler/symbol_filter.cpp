@@ -0,0 +1,91 @@
+#include "symbol_filter.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace feedhandler {
+
+namespace {
+
+// Decoder handler picking the symbol out of any message that has one
+struct SymbolField {
+    const char* stock = nullptr;
+    
+    template <typename Msg>
+    auto on(const Msg& msg) -> decltype(void(msg.stock)) {
+        stock = msg.stock;
+    }
+};
+
+} // namespace
+
+SymbolFilter::SymbolFilter(const std::vector<std::string>& symbols)
+    : active_(!symbols.empty()) {
+    for (const auto& symbol : symbols) {
+        if (symbol.empty()) continue;
+        if (symbol.size() > 8) {
+            std::cerr << "Symbol filter: ignoring " << symbol << " (ITCH symbols are at most 8 characters)" << std::endl;
+            continue;
+        }
+        char padded[8];
+        std::memset(padded, ' ', sizeof(padded));
+        std::memcpy(padded, symbol.data(), symbol.size());
+        symbols_.insert(symbolKey(padded));
+    }
+}
+
+uint64_t SymbolFilter::symbolKey(const char* stock) {
+    uint64_t key;
+    std::memcpy(&key, stock, sizeof(key));
+    return key;
+}
+
+bool SymbolFilter::restoreLocate(uint16_t locate, const char* stock) {
+    if (!active_) return true;
+    
+    bool subscribed = symbols_.count(symbolKey(stock)) != 0;
+    if (locate != 0 && !test(known_, locate)) {
+        assign(known_, locate, true);
+        assign(subscribed_, locate, subscribed);
+        subscribed ? stats_.locates_subscribed++ : stats_.locates_rejected++;
+    }
+    return subscribed;
+}
+
+bool SymbolFilter::classify(const uint8_t* data, size_t length, uint16_t locate) {
+    SymbolField field;
+    if (!itch::Decoder<SymbolField>::dispatch(data, length, field)) {
+        // Nothing to classify by: fall back on what is known about the locate
+        if (locate == 0) {
+            stats_.admitted++;
+            return true;
+        }
+        if (test(known_, locate)) {
+            bool subscribed = test(subscribed_, locate);
+            stats_.admitted += subscribed;
+            stats_.dropped += !subscribed;
+            return subscribed;
+        }
+        stats_.unresolved++;
+        return false;
+    }
+    
+    bool subscribed = symbols_.count(symbolKey(field.stock)) != 0;
+    
+    // Locate 0 is never a valid instrument, so it is decided per message
+    if (locate != 0) {
+        if (test(known_, locate)) {
+            // Directory re-sent: undo the previous classification
+            test(subscribed_, locate) ? stats_.locates_subscribed-- : stats_.locates_rejected--;
+        }
+        assign(known_, locate, true);
+        assign(subscribed_, locate, subscribed);
+        subscribed ? stats_.locates_subscribed++ : stats_.locates_rejected++;
+    }
+    
+    stats_.admitted += subscribed;
+    stats_.dropped += !subscribed;
+    return subscribed;
+}
+
+} // namespace feedhandler
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "itch_decoder.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace feedhandler {
+
+// Symbol subscription filter keyed by stock_locate, applied on the receive
+// thread before a message reaches a book or a worker ring.
+//
+// Two bitmaps over the 65536 locates (8KB each) record which locates have
+// been classified and which of those are subscribed, so most messages are
+// admitted or dropped from the 3-byte header (type, locate) with one bit
+// test. A locate is classified from its StockDirectory message or, when the
+// handler joined after the directory went out, from the first message that
+// carries the symbol (Add Order, Trade, Cross Trade). Order messages for a
+// locate not classified yet are dropped: none of its orders can be in the
+// order index, since admitting an add classifies the locate first. Locate 0
+// (system-wide messages) always passes.
+class SymbolFilter {
+public:
+    struct Stats {
+        uint64_t admitted = 0;
+        uint64_t dropped = 0;           // Unsubscribed symbol
+        uint64_t unresolved = 0;        // Locate not classified yet and no symbol to classify it
+        uint64_t locates_subscribed = 0;
+        uint64_t locates_rejected = 0;
+    };
+    
+    // Empty = every symbol (admit() always passes)
+    explicit SymbolFilter(const std::vector<std::string>& symbols);
+    
+    bool active() const { return active_; }
+    size_t symbolCount() const { return symbols_.size(); }
+    
+    // Whether a message (without its length prefix) should be processed
+    bool admit(const uint8_t* data, size_t length) {
+        if (!active_ || length < 3) return true;
+        
+        uint16_t locate = static_cast<uint16_t>((data[1] << 8) | data[2]);
+        if (data[0] != static_cast<uint8_t>(itch::MessageType::StockDirectory) && test(known_, locate)) {
+            bool subscribed = test(subscribed_, locate);
+            stats_.admitted += subscribed;
+            stats_.dropped += !subscribed;
+            return subscribed;
+        }
+        return classify(data, length, locate);
+    }
+    
+    // Warm start: classify a locate whose directory went out before a
+    // checkpoint, from its restored book (stock is space-padded to 8).
+    // Returns whether the symbol is subscribed.
+    bool restoreLocate(uint16_t locate, const char* stock);
+    
+    const Stats& getStats() const { return stats_; }
+
+private:
+    static constexpr size_t WORDS = 65536 / 64;
+    using Bitmap = std::array<uint64_t, WORDS>;
+    
+    static bool test(const Bitmap& bits, uint16_t locate) {
+        return (bits[locate >> 6] >> (locate & 63)) & 1;
+    }
+    static void assign(Bitmap& bits, uint16_t locate, bool value) {
+        uint64_t mask = uint64_t{1} << (locate & 63);
+        bits[locate >> 6] = value ? (bits[locate >> 6] | mask) : (bits[locate >> 6] & ~mask);
+    }
+    
+    // The 8 space-padded symbol bytes as one integer
+    static uint64_t symbolKey(const char* stock);
+    
+    // Slow path: directory messages and locates not classified yet
+    bool classify(const uint8_t* data, size_t length, uint16_t locate);
+    
+    bool active_;
+    std::unordered_set<uint64_t> symbols_;
+    Bitmap known_{};
+    Bitmap subscribed_{};
+    Stats stats_;
+};
+
+} // namespace feedhandler
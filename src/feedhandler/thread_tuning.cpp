@@ -0,0 +1,56 @@
+#include "thread_tuning.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+
+namespace feedhandler {
+
+bool tuneCurrentThread(const RunLoopConfig& config) {
+    bool ok = true;
+    
+    if (config.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config.cpu, &cpus);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0) {
+            std::cerr << "Failed to pin thread to CPU " << config.cpu << ": "
+                      << strerror(err) << std::endl;
+            ok = false;
+        } else {
+            std::cout << "  Pinned to CPU " << config.cpu << std::endl;
+        }
+    }
+    
+    if (config.fifo_priority > 0) {
+        struct sched_param param{};
+        param.sched_priority = config.fifo_priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            std::cerr << "Failed to set SCHED_FIFO priority " << config.fifo_priority << ": "
+                      << strerror(err) << std::endl;
+            ok = false;
+        } else {
+            std::cout << "  SCHED_FIFO priority " << config.fifo_priority << std::endl;
+        }
+    }
+    
+    return ok;
+}
+
+void blockStopSignals(sigset_t& previous) {
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &previous);
+}
+
+void restoreSignals(const sigset_t& previous) {
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+} // namespace feedhandler
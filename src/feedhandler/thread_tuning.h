@@ -0,0 +1,36 @@
+#pragma once
+
+#include <signal.h>
+#include <thread>
+#include <utility>
+
+namespace feedhandler {
+
+// Receive-loop tuning shared by the ITCH and CME handlers
+struct RunLoopConfig {
+    bool spin = false;          // Spin on non-blocking recv instead of blocking in poll()
+    int busy_poll_us = 0;       // SO_BUSY_POLL budget on input sockets (0 = off)
+    int cpu = -1;               // Pin the run() thread to this CPU (-1 = off)
+    int fifo_priority = 0;      // SCHED_FIFO priority for the run() thread (0 = off)
+};
+
+// Apply CPU affinity and SCHED_FIFO to the calling thread. Failures (bad CPU,
+// missing CAP_SYS_NICE) are reported and leave the thread as it was.
+bool tuneCurrentThread(const RunLoopConfig& config);
+
+// Block SIGINT / SIGTERM on the calling thread, saving the old mask in previous
+void blockStopSignals(sigset_t& previous);
+void restoreSignals(const sigset_t& previous);
+
+// std::thread(args...) started with SIGINT / SIGTERM blocked, so the process's
+// stop handler only ever runs on the thread that installed it (main)
+template <typename... Args>
+std::thread startThread(Args&&... args) {
+    sigset_t previous;
+    blockStopSignals(previous);
+    std::thread thread(std::forward<Args>(args)...);
+    restoreSignals(previous);
+    return thread;
+}
+
+} // namespace feedhandler
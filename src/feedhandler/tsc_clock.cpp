@@ -0,0 +1,25 @@
+#include "tsc_clock.h"
+
+#include <thread>
+
+namespace feedhandler {
+
+TscClock::TscClock() {
+#if defined(__x86_64__) || defined(__i386__)
+    using clock = std::chrono::steady_clock;
+    
+    auto start = clock::now();
+    uint64_t start_ticks = ticks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    uint64_t end_ticks = ticks();
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock::now() - start).count();
+    
+    if (elapsed_ns > 0 && end_ticks > start_ticks) {
+        ticks_per_ms_ = (end_ticks - start_ticks) * 1000000 / static_cast<uint64_t>(elapsed_ns);
+    }
+    if (ticks_per_ms_ == 0) ticks_per_ms_ = 1;
+#endif
+}
+
+} // namespace feedhandler
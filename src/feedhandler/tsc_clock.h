@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace feedhandler {
+
+// CLOCK_REALTIME in ns: the domain of kernel / PHC-synced RX timestamps
+inline uint64_t wallClockNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Cheap monotonic clock for run-loop timers.
+//
+// On x86 this reads the TSC directly (a few ns, no vDSO call), which matters
+// when the receive loop spins and checks its timers on every iteration.
+// Assumes an invariant TSC (constant_tsc / nonstop_tsc, true of any server CPU
+// from the last decade). Elsewhere it falls back to steady_clock nanoseconds.
+class TscClock {
+public:
+    // Calibrates ticks against steady_clock (blocks for ~10ms on x86)
+    TscClock();
+    
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+    
+    uint64_t fromMillis(uint64_t ms) const { return ms * ticks_per_ms_; }
+    uint64_t toNanos(uint64_t ticks) const { return ticks * 1000000 / ticks_per_ms_; }
+    uint64_t ticksPerMs() const { return ticks_per_ms_; }
+    
+private:
+    uint64_t ticks_per_ms_ = 1000000;
+};
+
+} // namespace feedhandler
@@ -1,3 +1,4 @@
+#include "feedhandler/config_loader.h"
 #include "feedhandler/feedhandler.h"
 
 #include <csignal>
@@ -5,14 +6,19 @@
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <unistd.h>
 
 namespace {
     feedhandler::FeedHandler* g_handler = nullptr;
     
-    void signalHandler(int sig) {
-        std::cout << "\nReceived signal " << sig << ", shutting down..." << std::endl;
+    // Async-signal-safe only: the run loop notices and shuts down on the main
+    // thread (every other thread has SIGINT / SIGTERM blocked)
+    void signalHandler(int) {
+        static const char message[] = "\nReceived signal, shutting down...\n";
+        ssize_t written = write(STDOUT_FILENO, message, sizeof(message) - 1);
+        (void)written;
         if (g_handler) {
-            g_handler->stop();
+            g_handler->requestStop();
         }
     }
 }
@@ -20,21 +26,63 @@ namespace {
 void printUsage(const char* program) {
     std::cout << "Usage: " << program << " [options]\n"
               << "\nOptions:\n"
+              << "  --config <file>             YAML config (layout of config/feedhandler.yaml); flags override it\n"
               << "  --mode <tick|conflated>     Processing mode (default: tick)\n"
               << "  --interval-ms <ms>          Conflation interval in ms (default: 100)\n"
+              << "  --max-pending <n>           Conflation: drain early once n books are waiting (default: 10000, 0 = off)\n"
+              << "  --max-staleness-ms <ms>     Conflation: drain early once an update has waited this long (default: 0 = off)\n"
+              << "  --conflation-output <snapshot|delta>\n"
+              << "                              Full snapshots or changed levels per tick (default: snapshot)\n"
+              << "  --refresh-ms <ms>           Delta output: full refresh period per book (default: 1000)\n"
+              << "  --snapshot-format <sbe|raw> Conflated snapshot encoding (default: sbe)\n"
               << "  --input-group <ip>          Input multicast group (default: 239.1.1.1)\n"
               << "  --input-port <port>         Input port (default: 30001)\n"
               << "  --output-group <ip>         Output multicast group (default: 239.1.1.2)\n"
               << "  --output-port <port>        Output port (default: 30002)\n"
               << "  --interface <ip>            Network interface (default: 0.0.0.0)\n"
+              << "  --output-mtu <bytes>        Pack output messages per datagram (default: 0 = off)\n"
+              << "  --recv-batch <n>            Datagrams drained per recvmmsg (default: 64)\n"
+              << "  --send-batch <n>            Datagrams per sendmmsg (default: 64)\n"
+              << "  --rx-backend <socket|ring>  Input path: UDP socket or zero-copy packet ring (default: socket)\n"
+              << "  --spin                      Spin on non-blocking receive instead of poll()\n"
+              << "  --busy-poll <us>            SO_BUSY_POLL budget on the input socket (default: 0 = off)\n"
+              << "  --cpu <n>                   Pin the receive thread to CPU n\n"
+              << "  --fifo-priority <n>         Run the receive thread SCHED_FIFO at priority n\n"
+              << "  --workers <n>               Book worker threads sharded by stock_locate (default: 0 = inline)\n"
+              << "  --worker-ring <n>           Messages buffered per worker (default: 65536)\n"
               << "  --depth <n>                 Order book depth (default: 10)\n"
-              << "  --stats-interval <sec>      Stats print interval (default: 10)\n"
+              << "  --symbols <list>            Comma-separated symbols to build books for (default: all)\n"
+              << "  --book-storage <map|ladder> Price level container (default: map)\n"
+              << "  --ladder-tick <n>           Ladder tick in price units (default: 100)\n"
+              << "  --stats-interval <sec>      Stats report interval, 0 = off (default: 10)\n"
+              << "  --metrics-port <port>       Serve Prometheus metrics on :port/metrics (default: 0 = off)\n"
+              << "  --book-cache <name>         Publish latest books to shared memory segment <name> (e.g. /itch_books)\n"
+              << "  --checkpoint <file>         Save books and live orders to <file> on stop (warm start)\n"
+              << "  --checkpoint-interval <sec> Also save a checkpoint every <sec> seconds (default: 0 = on stop only)\n"
+              << "  --restore                   Load the checkpoint on startup; a replay resumes after it\n"
+              << "  --no-rx-timestamps          Disable SO_TIMESTAMPING on the input socket\n"
+              << "  --latency-log <file>        Append latency percentiles as CSV each stats interval\n"
+              << "  --capture <file>            Record received datagrams to a pcap file\n"
+              << "  --replay <file>             Process a pcap or NASDAQ binary ITCH file instead of the socket\n"
+              << "  --replay-speed <x>          Replay pace: 1 = as captured, 10 = 10x faster (default: 0 = max speed)\n"
+              << "  --moldudp64                 Replayed pcap payloads carry a MoldUDP64 header\n"
               << "  --help                      Show this help\n"
               << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     feedhandler::FeedHandlerConfig config;
+    feedhandler::ReplayConfig replay;
+    
+    // A config file is applied first, so flags override it wherever they appear
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--config") {
+            if (!feedhandler::loadConfigFile(argv[i + 1], config)) {
+                std::cerr << "Failed to load config " << argv[i + 1] << std::endl;
+                return 1;
+            }
+        }
+    }
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -44,6 +92,9 @@ int main(int argc, char* argv[]) {
             printUsage(argv[0]);
             return 0;
         }
+        else if (arg == "--config" && i + 1 < argc) {
+            ++i;  // Loaded above
+        }
         else if (arg == "--mode" && i + 1 < argc) {
             std::string mode = argv[++i];
             if (mode == "tick") {
@@ -58,6 +109,37 @@ int main(int argc, char* argv[]) {
         else if (arg == "--interval-ms" && i + 1 < argc) {
             config.conflation_interval_ms = std::atoi(argv[++i]);
         }
+        else if (arg == "--max-pending" && i + 1 < argc) {
+            config.conflation_max_pending = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--max-staleness-ms" && i + 1 < argc) {
+            config.conflation_max_staleness_ms = std::atoi(argv[++i]);
+        }
+        else if (arg == "--conflation-output" && i + 1 < argc) {
+            std::string output = argv[++i];
+            if (output == "snapshot") {
+                config.conflation_output = feedhandler::ConflationOutput::Snapshot;
+            } else if (output == "delta") {
+                config.conflation_output = feedhandler::ConflationOutput::Delta;
+            } else {
+                std::cerr << "Unknown conflation output: " << output << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--refresh-ms" && i + 1 < argc) {
+            config.snapshot_refresh_ms = std::atoi(argv[++i]);
+        }
+        else if (arg == "--snapshot-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "sbe") {
+                config.snapshot_encoding = feedhandler::SnapshotEncoding::Sbe;
+            } else if (format == "raw") {
+                config.snapshot_encoding = feedhandler::SnapshotEncoding::Raw;
+            } else {
+                std::cerr << "Unknown snapshot format: " << format << std::endl;
+                return 1;
+            }
+        }
         else if (arg == "--input-group" && i + 1 < argc) {
             config.input_group = argv[++i];
         }
@@ -74,12 +156,103 @@ int main(int argc, char* argv[]) {
             config.input_interface = argv[++i];
             config.output_interface = config.input_interface;
         }
+        else if (arg == "--output-mtu" && i + 1 < argc) {
+            config.output_mtu = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--recv-batch" && i + 1 < argc) {
+            config.recv_batch_size = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--send-batch" && i + 1 < argc) {
+            config.send_batch_size = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--rx-backend" && i + 1 < argc) {
+            std::string backend = argv[++i];
+            if (!feedhandler::parseReceiveBackend(backend, config.input_backend.type)) {
+                std::cerr << "Unknown receive backend: " << backend << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--spin") {
+            config.run_loop.spin = true;
+        }
+        else if (arg == "--busy-poll" && i + 1 < argc) {
+            config.run_loop.busy_poll_us = std::atoi(argv[++i]);
+        }
+        else if (arg == "--cpu" && i + 1 < argc) {
+            config.run_loop.cpu = std::atoi(argv[++i]);
+        }
+        else if (arg == "--fifo-priority" && i + 1 < argc) {
+            config.run_loop.fifo_priority = std::atoi(argv[++i]);
+        }
+        else if (arg == "--workers" && i + 1 < argc) {
+            config.worker_threads = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--worker-ring" && i + 1 < argc) {
+            config.worker_ring_size = static_cast<size_t>(std::atoi(argv[++i]));
+        }
         else if (arg == "--depth" && i + 1 < argc) {
             config.book_depth = static_cast<size_t>(std::atoi(argv[++i]));
         }
+        else if (arg == "--symbols" && i + 1 < argc) {
+            std::string list = argv[++i];
+            size_t start = 0;
+            while (start <= list.size()) {
+                size_t comma = list.find(',', start);
+                if (comma == std::string::npos) comma = list.size();
+                if (comma > start) config.symbols.push_back(list.substr(start, comma - start));
+                start = comma + 1;
+            }
+        }
+        else if (arg == "--book-storage" && i + 1 < argc) {
+            std::string storage = argv[++i];
+            if (storage == "map") {
+                config.book_storage = feedhandler::LevelStorage::Map;
+            } else if (storage == "ladder") {
+                config.book_storage = feedhandler::LevelStorage::Ladder;
+            } else {
+                std::cerr << "Unknown book storage: " << storage << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--ladder-tick" && i + 1 < argc) {
+            config.ladder.tick_size = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
         else if (arg == "--stats-interval" && i + 1 < argc) {
             config.stats_interval_sec = std::atoi(argv[++i]);
         }
+        else if (arg == "--metrics-port" && i + 1 < argc) {
+            config.metrics.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--book-cache" && i + 1 < argc) {
+            config.book_cache.name = argv[++i];
+        }
+        else if (arg == "--checkpoint" && i + 1 < argc) {
+            config.checkpoint.file = argv[++i];
+        }
+        else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            config.checkpoint.interval_sec = std::atoi(argv[++i]);
+        }
+        else if (arg == "--restore") {
+            config.checkpoint.restore = true;
+        }
+        else if (arg == "--no-rx-timestamps") {
+            config.rx_timestamps = false;
+        }
+        else if (arg == "--latency-log" && i + 1 < argc) {
+            config.latency_log = argv[++i];
+        }
+        else if (arg == "--capture" && i + 1 < argc) {
+            config.capture_file = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc) {
+            replay.file = argv[++i];
+        }
+        else if (arg == "--replay-speed" && i + 1 < argc) {
+            replay.speed = std::atof(argv[++i]);
+        }
+        else if (arg == "--moldudp64") {
+            replay.moldudp64 = true;
+        }
         else {
             std::cerr << "Unknown option: " << arg << std::endl;
             printUsage(argv[0]);
@@ -95,6 +268,12 @@ int main(int argc, char* argv[]) {
     feedhandler::FeedHandler handler(config);
     g_handler = &handler;
     
+    if (!replay.file.empty()) {
+        bool ok = handler.replay(replay);
+        g_handler = nullptr;
+        return ok ? 0 : 1;
+    }
+    
     std::cout << "Starting market data feed handler..." << std::endl;
     std::cout << "Input:  " << config.input_group << ":" << config.input_port << std::endl;
     std::cout << "Output: " << config.output_group << ":" << config.output_port << std::endl;
@@ -1,9 +1,18 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <iomanip>
 #include <cstring>
 #include <csignal>
 #include <getopt.h>
-
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../feedhandler/book_cache.h"
+#include "../feedhandler/book_delta.h"
+#include "../feedhandler/l2_snapshot.h"
 #include "../feedhandler/multicast.h"
 #include "../feedhandler/market_data.h"
 
@@ -11,6 +20,14 @@ using namespace feedhandler;
 
 static volatile bool running = true;
 
+// Books rebuilt from conflated snapshots and deltas
+struct ReceivedBook {
+    OrderBookSnapshot book{};
+    bool valid = false;     // False until a snapshot arrives, or after a missed delta
+};
+static std::unordered_map<std::string, ReceivedBook> books;
+static uint64_t stale_deltas = 0;
+
 void signalHandler(int) {
     running = false;
 }
@@ -42,11 +59,11 @@ void printTrade(const TradeTick& trade) {
               << std::endl;
 }
 
-void printSnapshot(const OrderBookSnapshot& snap) {
+void printSnapshot(const OrderBookSnapshot& snap, const char* label = "SNAPSHOT") {
     std::string symbol(snap.symbol, 8);
     symbol.erase(symbol.find_last_not_of(' ') + 1);
 
-    std::cout << "\n[SNAPSHOT] " << symbol << " (seq=" << snap.sequence << ")\n";
+    std::cout << "\n[" << label << "] " << symbol << " (seq=" << snap.sequence << ")\n";
     std::cout << std::string(60, '-') << "\n";
     std::cout << std::setw(30) << "BIDS" << " | " << std::setw(28) << "ASKS" << "\n";
     std::cout << std::string(60, '-') << "\n";
@@ -88,6 +105,43 @@ void printSnapshot(const OrderBookSnapshot& snap) {
     std::cout << std::string(60, '-') << "\n\n";
 }
 
+void onSnapshot(const OrderBookSnapshot& snap) {
+    auto& state = books[std::string(snap.symbol, 8)];
+    state.book = snap;
+    state.valid = true;
+    printSnapshot(snap);
+}
+
+void onBookDelta(const uint8_t* payload, size_t payload_len) {
+    BookDelta delta;
+    std::memcpy(&delta, payload, sizeof(delta));
+    if (payload_len < sizeof(BookDelta) + delta.update_count * sizeof(LevelUpdate)) {
+        std::cerr << "Truncated book delta\n";
+        return;
+    }
+
+    LevelUpdate updates[MAX_LEVEL_UPDATES];
+    size_t count = std::min<size_t>(delta.update_count, MAX_LEVEL_UPDATES);
+    std::memcpy(updates, payload + sizeof(BookDelta), count * sizeof(LevelUpdate));
+    delta.update_count = static_cast<uint8_t>(count);
+
+    // A delta only applies on top of the message it was diffed against
+    auto& state = books[std::string(delta.symbol, 8)];
+    if (!state.valid || state.book.sequence != delta.prev_sequence) {
+        if (state.valid) {
+            std::cout << "[STALE] " << std::string(delta.symbol, 8) << " expected base seq="
+                      << state.book.sequence << ", delta based on " << delta.prev_sequence
+                      << " - waiting for refresh" << std::endl;
+        }
+        state.valid = false;
+        stale_deltas++;
+        return;
+    }
+
+    applyBookDelta(state.book, delta, updates);
+    printSnapshot(state.book, "DELTA");
+}
+
 void processMessage(const uint8_t* data, size_t length) {
     if (length < sizeof(OutputHeader)) {
         std::cerr << "Message too short: " << length << " bytes\n";
@@ -119,7 +173,23 @@ void processMessage(const uint8_t* data, size_t length) {
             if (payload_len >= sizeof(OrderBookSnapshot)) {
                 OrderBookSnapshot snap;
                 std::memcpy(&snap, payload, sizeof(snap));
-                printSnapshot(snap);
+                onSnapshot(snap);
+            }
+            break;
+
+        case OutputMessageType::L2Snapshot: {
+            OrderBookSnapshot snap;
+            if (decodeL2Snapshot(payload, payload_len, snap)) {
+                onSnapshot(snap);
+            } else {
+                std::cerr << "Malformed L2 snapshot\n";
+            }
+            break;
+        }
+
+        case OutputMessageType::BookDelta:
+            if (payload_len >= sizeof(BookDelta)) {
+                onBookDelta(payload, payload_len);
             }
             break;
 
@@ -134,12 +204,87 @@ void processMessage(const uint8_t* data, size_t length) {
     }
 }
 
+// A datagram may carry several OutputHeader-framed messages
+size_t processDatagram(const uint8_t* data, size_t length) {
+    size_t offset = 0;
+    size_t count = 0;
+
+    while (offset + sizeof(OutputHeader) <= length) {
+        const auto* header = reinterpret_cast<const OutputHeader*>(data + offset);
+        if (header->length < sizeof(OutputHeader) || offset + header->length > length) {
+            std::cerr << "Malformed message at offset " << offset << "\n";
+            break;
+        }
+
+        processMessage(data + offset, header->length);
+        offset += header->length;
+        count++;
+    }
+
+    return count;
+}
+
+// Read the feed handler's shared-memory book cache instead of the feed:
+// once a second, the top of book of every instrument that changed
+int watchCache(const std::string& name) {
+    BookCacheReader cache(name);
+    while (running && !cache.open()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!running) return 0;
+
+    std::cout << "Reading book cache " << name << "\n\n";
+
+    std::vector<uint64_t> seen;
+    uint64_t reads = 0;
+    uint64_t read_ns = 0;
+    while (running) {
+        cache.refresh();
+        seen.resize(cache.size(), 0);
+        for (uint32_t slot = 0; slot < cache.size(); ++slot) {
+            if (cache.version(slot) == seen[slot]) continue;
+
+            CachedQuote quote;
+            auto start = std::chrono::steady_clock::now();
+            bool ok = cache.readQuote(slot, quote);
+            read_ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            reads++;
+            if (!ok) continue;
+            seen[slot] = quote.updates;
+
+            std::cout << "[CACHE] " << std::setw(8) << std::left << cache.symbol(slot)
+                      << " | Bid: " << std::fixed << std::setprecision(2)
+                      << std::setw(10) << std::right << cache.toDouble(quote.bid_price)
+                      << " x " << std::setw(6) << quote.bid_quantity
+                      << " | Ask: " << std::setw(10) << cache.toDouble(quote.ask_price)
+                      << " x " << std::setw(6) << quote.ask_quantity
+                      << " | updates=" << quote.updates
+                      << std::endl;
+        }
+
+        if (!cache.writerRunning()) {
+            std::cout << "Feed handler closed the cache\n";
+            break;
+        }
+        for (int i = 0; i < 10 && running; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+    std::cout << "\nInstruments: " << cache.size() << ", quote reads: " << reads;
+    if (reads > 0) std::cout << " (" << read_ns / reads << " ns avg, timer included)";
+    std::cout << "\n";
+    return 0;
+}
+
 void printUsage(const char* prog) {
     std::cout << "Usage: " << prog << " [options]\n"
               << "Options:\n"
               << "  -g, --group <ip>     Multicast group (default: 239.1.1.2)\n"
               << "  -p, --port <port>    Port number (default: 30002)\n"
               << "  -i, --interface <ip> Interface to bind (default: 0.0.0.0)\n"
+              << "  -c, --cache <name>   Read the handler's shared-memory book cache instead\n"
               << "  -h, --help           Show this help\n";
 }
 
@@ -147,17 +292,19 @@ int main(int argc, char* argv[]) {
     std::string group = "239.1.1.2";
     uint16_t port = 30002;
     std::string interface = "0.0.0.0";
+    std::string cache_name;
 
     static struct option long_options[] = {
         {"group", required_argument, nullptr, 'g'},
         {"port", required_argument, nullptr, 'p'},
         {"interface", required_argument, nullptr, 'i'},
+        {"cache", required_argument, nullptr, 'c'},
         {"help", no_argument, nullptr, 'h'},
         {nullptr, 0, nullptr, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "g:p:i:h", long_options, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "g:p:i:c:h", long_options, nullptr)) != -1) {
         switch (opt) {
             case 'g':
                 group = optarg;
@@ -168,6 +315,9 @@ int main(int argc, char* argv[]) {
             case 'i':
                 interface = optarg;
                 break;
+            case 'c':
+                cache_name = optarg;
+                break;
             case 'h':
             default:
                 printUsage(argv[0]);
@@ -178,6 +328,10 @@ int main(int argc, char* argv[]) {
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
 
+    if (!cache_name.empty()) {
+        return watchCache(cache_name);
+    }
+
     std::cout << "Market Data Receiver\n"
               << "====================\n"
               << "Multicast group: " << group << "\n"
@@ -203,13 +357,15 @@ int main(int argc, char* argv[]) {
         if (ret > 0) {
             ssize_t len = receiver.read(buffer.data(), buffer.size());
             if (len > 0) {
-                processMessage(buffer.data(), static_cast<size_t>(len));
-                msg_count++;
+                msg_count += processDatagram(buffer.data(), static_cast<size_t>(len));
             }
         }
     }
 
     std::cout << "\nReceived " << msg_count << " messages\n";
+    if (stale_deltas > 0) {
+        std::cout << "Deltas skipped waiting for a refresh: " << stale_deltas << "\n";
+    }
     receiver.stop();
 
     return 0;
@@ -1,5 +1,6 @@
 #include "itch_simulator.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstring>
 #include <iostream>
@@ -61,6 +62,9 @@ void ItchSimulator::run() {
         if (!start()) return;
     }
     
+    // Stock directory first so the feed handler can bind locates to books
+    sendStockDirectory();
+    
     const auto interval = std::chrono::microseconds(1000000 / config_.messages_per_second);
     auto next_send = std::chrono::steady_clock::now();
     
@@ -81,11 +85,54 @@ void ItchSimulator::run() {
     }
 }
 
+void ItchSimulator::runLoad(const LoadConfig& load) {
+    if (!running_) {
+        if (!start()) return;
+    }
+    
+    size_t threads = std::min<size_t>(std::max<uint32_t>(load.threads, 1), config_.symbols.size());
+    std::vector<LoadStream> streams(threads, LoadStream(load.datagram_bytes));
+    
+    // Directory as each stream's preamble, then the order flow. Every order
+    // still live at the end is deleted, so the streams can loop.
+    auto gen_start = std::chrono::steady_clock::now();
+    load_streams_ = &streams;
+    sendStockDirectory();
+    for (auto& stream : streams) {
+        stream.markPreamble();
+    }
+    while (running_ && messages_sent_ < config_.symbols.size() + load.stream_messages) {
+        generateMessage();
+    }
+    while (!active_orders_.empty()) {
+        deleteOrderAt(active_orders_.size() - 1);
+    }
+    load_streams_ = nullptr;
+    
+    size_t datagrams = 0;
+    size_t bytes = 0;
+    for (const auto& stream : streams) {
+        datagrams += stream.size();
+        bytes += stream.bytes();
+    }
+    auto gen_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - gen_start).count();
+    std::cout << "Pre-generated " << messages_sent_ << " messages in " << datagrams << " datagrams ("
+              << bytes / (1024 * 1024) << " MB, " << threads << " streams) in " << gen_ms << " ms" << std::endl;
+    messages_sent_ = 0;
+    
+    LoadConfig run_config = load;
+    run_config.threads = static_cast<uint32_t>(threads);
+    LoadGenerator generator(run_config, {{config_.multicast_group, config_.port, config_.interface, config_.ttl}});
+    generator.run(streams, running_);
+    messages_sent_ = generator.getStats().messages;
+}
+
 void ItchSimulator::generateMessage() {
     int action = action_dist_(rng_);
     
     // 60% add orders, 20% executes, 15% deletes, 5% trades
-    if (action < 60) {
+    if (action < 60 && active_orders_.size() < MAX_ACTIVE_ORDERS) {
         sendAddOrder();
     } else if (action < 80 && !active_orders_.empty()) {
         sendExecuteOrder();
@@ -96,11 +143,29 @@ void ItchSimulator::generateMessage() {
     }
 }
 
+void ItchSimulator::sendStockDirectory() {
+    for (size_t i = 0; i < config_.symbols.size(); ++i) {
+        feedhandler::itch::StockDirectoryMessage msg{};
+        msg.type = feedhandler::itch::MessageType::StockDirectory;
+        msg.stock_locate = __builtin_bswap16(locateFor(i));
+        msg.tracking_number = 0;
+        msg.timestamp = feedhandler::itch::encodeTimestamp(nanosSinceMidnight());
+        std::memcpy(msg.stock, config_.symbols[i].c_str(), 8);
+        msg.market_category = 'Q';
+        msg.financial_status = 'N';
+        msg.lot_size = __builtin_bswap32(100);
+        msg.round_lots_only = 'N';
+        
+        sendMessage(reinterpret_cast<uint8_t*>(&msg), sizeof(msg));
+    }
+}
+
 void ItchSimulator::sendAddOrder() {
     feedhandler::itch::AddOrderMessage msg{};
     
     // Select random symbol and side
-    const std::string& symbol = config_.symbols[symbol_dist_(rng_)];
+    size_t symbol_index = symbol_dist_(rng_);
+    const std::string& symbol = config_.symbols[symbol_index];
     auto side = side_dist_(rng_) == 0 ? feedhandler::itch::Side::Buy 
                                        : feedhandler::itch::Side::Sell;
     
@@ -110,9 +175,9 @@ void ItchSimulator::sendAddOrder() {
     
     // Fill message (convert to big-endian where needed)
     msg.type = feedhandler::itch::MessageType::AddOrder;
-    msg.stock_locate = 0;
+    msg.stock_locate = __builtin_bswap16(locateFor(symbol_index));
     msg.tracking_number = 0;
-    msg.timestamp = 0;
+    msg.timestamp = feedhandler::itch::encodeTimestamp(nanosSinceMidnight());
     msg.order_ref = __builtin_bswap64(next_order_ref_);
     msg.side = side;
     msg.shares = __builtin_bswap32(qty);
@@ -120,14 +185,9 @@ void ItchSimulator::sendAddOrder() {
     msg.price = __builtin_bswap32(price);
     
     // Track active order
-    ActiveOrder active{next_order_ref_, symbol, price, qty, side};
+    ActiveOrder active{next_order_ref_, locateFor(symbol_index), symbol, price, qty, side};
     active_orders_.push_back(active);
     
-    // Limit active orders to prevent unbounded growth
-    if (active_orders_.size() > 10000) {
-        active_orders_.erase(active_orders_.begin());
-    }
-    
     next_order_ref_++;
     
     sendMessage(reinterpret_cast<uint8_t*>(&msg), sizeof(msg));
@@ -138,19 +198,22 @@ void ItchSimulator::sendDeleteOrder() {
     
     // Pick random active order
     std::uniform_int_distribution<size_t> order_dist(0, active_orders_.size() - 1);
-    size_t idx = order_dist(rng_);
-    
+    deleteOrderAt(order_dist(rng_));
+}
+
+void ItchSimulator::deleteOrderAt(size_t idx) {
     const auto& order = active_orders_[idx];
     
     feedhandler::itch::OrderDeleteMessage msg{};
     msg.type = feedhandler::itch::MessageType::OrderDelete;
-    msg.stock_locate = 0;
+    msg.stock_locate = __builtin_bswap16(order.stock_locate);
     msg.tracking_number = 0;
-    msg.timestamp = 0;
+    msg.timestamp = feedhandler::itch::encodeTimestamp(nanosSinceMidnight());
     msg.order_ref = __builtin_bswap64(order.order_ref);
     
-    // Remove from active orders
-    active_orders_.erase(active_orders_.begin() + static_cast<long>(idx));
+    // Remove from active orders (order is irrelevant, picks are random)
+    active_orders_[idx] = active_orders_.back();
+    active_orders_.pop_back();
     
     sendMessage(reinterpret_cast<uint8_t*>(&msg), sizeof(msg));
 }
@@ -171,9 +234,9 @@ void ItchSimulator::sendExecuteOrder() {
     
     feedhandler::itch::OrderExecutedMessage msg{};
     msg.type = feedhandler::itch::MessageType::OrderExecuted;
-    msg.stock_locate = 0;
+    msg.stock_locate = __builtin_bswap16(order.stock_locate);
     msg.tracking_number = 0;
-    msg.timestamp = 0;
+    msg.timestamp = feedhandler::itch::encodeTimestamp(nanosSinceMidnight());
     msg.order_ref = __builtin_bswap64(order.order_ref);
     msg.executed_shares = __builtin_bswap32(exec_qty);
     msg.match_number = __builtin_bswap64(messages_sent_);
@@ -182,7 +245,8 @@ void ItchSimulator::sendExecuteOrder() {
     
     // Remove if fully executed
     if (order.remaining_qty == 0) {
-        active_orders_.erase(active_orders_.begin() + static_cast<long>(idx));
+        active_orders_[idx] = active_orders_.back();
+        active_orders_.pop_back();
     }
     
     sendMessage(reinterpret_cast<uint8_t*>(&msg), sizeof(msg));
@@ -192,7 +256,8 @@ void ItchSimulator::sendTrade() {
     feedhandler::itch::TradeMessage msg{};
     
     // Select random symbol and side
-    const std::string& symbol = config_.symbols[symbol_dist_(rng_)];
+    size_t symbol_index = symbol_dist_(rng_);
+    const std::string& symbol = config_.symbols[symbol_index];
     auto side = side_dist_(rng_) == 0 ? feedhandler::itch::Side::Buy 
                                        : feedhandler::itch::Side::Sell;
     
@@ -201,9 +266,9 @@ void ItchSimulator::sendTrade() {
     uint32_t qty = roundQty(qty_dist_(rng_));
     
     msg.type = feedhandler::itch::MessageType::Trade;
-    msg.stock_locate = 0;
+    msg.stock_locate = __builtin_bswap16(locateFor(symbol_index));
     msg.tracking_number = 0;
-    msg.timestamp = 0;
+    msg.timestamp = feedhandler::itch::encodeTimestamp(nanosSinceMidnight());
     msg.order_ref = 0;  // Not associated with specific order
     msg.side = side;
     msg.shares = __builtin_bswap32(qty);
@@ -215,6 +280,18 @@ void ItchSimulator::sendTrade() {
 }
 
 void ItchSimulator::sendMessage(const uint8_t* data, size_t length) {
+    if (load_streams_) {
+        // Partition by stock_locate so each symbol's orders stay in sequence
+        uint16_t locate = static_cast<uint16_t>((data[1] << 8) | data[2]);
+        auto& stream = (*load_streams_)[(locate - 1u) % load_streams_->size()];
+        uint8_t* out = stream.append(2 + length);
+        out[0] = static_cast<uint8_t>(length >> 8);
+        out[1] = static_cast<uint8_t>(length & 0xFF);
+        std::memcpy(out + 2, data, length);
+        messages_sent_++;
+        return;
+    }
+    
     // Wrap message with length prefix (ITCH format)
     std::vector<uint8_t> packet(2 + length);
     
@@ -228,6 +305,12 @@ void ItchSimulator::sendMessage(const uint8_t* data, size_t length) {
     }
 }
 
+uint64_t ItchSimulator::nanosSinceMidnight() const {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    return ns % (86400ULL * 1000000000ULL);  // UTC midnight
+}
+
 uint32_t ItchSimulator::roundPrice(uint32_t price) const {
     return (price / config_.price_tick) * config_.price_tick;
 }
@@ -2,6 +2,7 @@
 
 #include "../feedhandler/itch_protocol.h"
 #include "../feedhandler/multicast.h"
+#include "load_generator.h"
 
 #include <atomic>
 #include <memory>
@@ -40,9 +41,14 @@ public:
     void stop();
     void run();  // Blocking run loop
     
+    // Saturating load test: pre-generate load.stream_messages messages,
+    // partitioned by symbol over load.threads streams, and send them in a
+    // loop at the load profile's rates. Blocking.
+    void runLoad(const LoadConfig& load);
+    
     bool isRunning() const { return running_; }
     uint64_t getMessagesSent() const { return messages_sent_; }
-    
+
 private:
     SimulatorConfig config_;
     std::atomic<bool> running_{false};
@@ -64,6 +70,7 @@ private:
     // Active orders for cancel/execute simulation
     struct ActiveOrder {
         uint64_t order_ref;
+        uint16_t stock_locate;
         std::string symbol;
         uint32_t price;
         uint32_t remaining_qty;
@@ -71,10 +78,20 @@ private:
     };
     std::vector<ActiveOrder> active_orders_;
     
+    // Past this many live orders adds are skipped in favour of removals
+    static constexpr size_t MAX_ACTIVE_ORDERS = 10000;
+    
+    // Set while pre-generating a load test: messages are appended to
+    // the stream of their symbol instead of being sent
+    std::vector<LoadStream>* load_streams_ = nullptr;
+    
     // Message generation
     void generateMessage();
+    uint64_t nanosSinceMidnight() const;
+    void sendStockDirectory();
     void sendAddOrder();
     void sendDeleteOrder();
+    void deleteOrderAt(size_t idx);
     void sendExecuteOrder();
     void sendTrade();
     
@@ -82,6 +99,11 @@ private:
     void sendMessage(const uint8_t* data, size_t length);
     uint32_t roundPrice(uint32_t price) const;
     uint32_t roundQty(uint32_t qty) const;
+    
+    // stock_locate for symbols[i] is i + 1 (0 is not a valid locate)
+    static uint16_t locateFor(size_t symbol_index) {
+        return static_cast<uint16_t>(symbol_index + 1);
+    }
 };
 
 } // namespace simulator
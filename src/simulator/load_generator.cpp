@@ -0,0 +1,329 @@
+#include "load_generator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+namespace simulator {
+
+namespace {
+
+// Waits shorter than this are spun out rather than slept (timer slack)
+constexpr uint64_t SPIN_NS = 50000;
+
+// Behind by more than this, the schedule restarts instead of bursting to catch up
+constexpr uint64_t MAX_LAG_NS = 10000000;
+
+// Preamble batches are spaced out so receivers can keep up
+constexpr auto PREAMBLE_PAUSE = std::chrono::milliseconds(1);
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool parseCount(const std::string& text, uint64_t& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    value = std::strtoull(text.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+} // namespace
+
+bool parseLoadProfile(const std::string& spec, uint64_t base_rate, std::vector<LoadPhase>& phases) {
+    phases.clear();
+    
+    if (spec == "max") {
+        phases.push_back({0, 0});
+        return true;
+    }
+    if (spec == "steady") {
+        phases.push_back({0, base_rate});
+        return true;
+    }
+    if (spec == "open") {
+        // Opening cross: a flat-out burst, then decaying to the steady rate
+        phases.push_back({1000, 0});
+        phases.push_back({4000, base_rate * 4});
+        phases.push_back({10000, base_rate * 2});
+        phases.push_back({0, base_rate});
+        return true;
+    }
+    
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t colon = item.find(':');
+        uint64_t duration_ms = 0;
+        uint64_t rate = 0;
+        if (colon == std::string::npos || !parseCount(item.substr(0, colon), duration_ms)) {
+            std::cerr << "Bad load phase '" << item << "' (expected <ms>:<rate>)" << std::endl;
+            return false;
+        }
+        std::string rate_text = item.substr(colon + 1);
+        if (rate_text != "max" && !parseCount(rate_text, rate)) {
+            std::cerr << "Bad load phase rate '" << rate_text << "'" << std::endl;
+            return false;
+        }
+        phases.push_back({static_cast<uint32_t>(duration_ms), rate});
+    }
+    
+    if (phases.empty()) {
+        std::cerr << "Empty load profile" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// LoadStream
+// ============================================================================
+
+LoadStream::LoadStream(size_t datagram_bytes)
+    : datagram_bytes_(datagram_bytes) {
+}
+
+uint8_t* LoadStream::append(size_t length) {
+    if (!open_ || datagrams_.back().length + length > datagram_bytes_) {
+        datagrams_.push_back({data_.size(), 0, 0});
+        open_ = true;
+    }
+    
+    Datagram& current = datagrams_.back();
+    data_.resize(data_.size() + length);
+    current.length += static_cast<uint32_t>(length);
+    current.messages++;
+    messages_++;
+    return data_.data() + data_.size() - length;
+}
+
+uint8_t* LoadStream::appendDatagram(size_t length, uint32_t messages) {
+    datagrams_.push_back({data_.size(), static_cast<uint32_t>(length), messages});
+    data_.resize(data_.size() + length);
+    messages_ += messages;
+    open_ = false;
+    return data_.data() + data_.size() - length;
+}
+
+void LoadStream::markPreamble() {
+    open_ = false;
+    preamble_ = datagrams_.size();
+}
+
+// ============================================================================
+// LoadGenerator
+// ============================================================================
+
+LoadGenerator::LoadGenerator(const LoadConfig& config, std::vector<LoadTarget> targets)
+    : config_(config), targets_(std::move(targets)) {
+    if (config_.batch == 0) config_.batch = 1;
+}
+
+LoadGenerator::~LoadGenerator() = default;
+
+bool LoadGenerator::run(std::vector<LoadStream>& streams, const std::atomic<bool>& running,
+                        const Prepare& prepare) {
+    if (streams.empty() || targets_.empty()) return false;
+    
+    // One socket per thread and line, so threads never share a send queue
+    workers_.clear();
+    for (size_t t = 0; t < streams.size(); ++t) {
+        auto worker = std::make_unique<Worker>();
+        for (const auto& target : targets_) {
+            auto sender = std::make_unique<feedhandler::MulticastSender>(
+                target.group, target.port, target.interface, target.ttl);
+            if (!sender->start()) {
+                std::cerr << "Failed to start load sender for " << target.group << ":" << target.port << std::endl;
+                return false;
+            }
+            sender->setBatchSize(config_.batch, config_.datagram_bytes);
+            worker->senders.push_back(std::move(sender));
+        }
+        workers_.push_back(std::move(worker));
+    }
+    
+    for (size_t t = 0; t < streams.size(); ++t) {
+        sendPreamble(*workers_[t], streams[t]);
+    }
+    
+    stats_ = Stats{};
+    start_ns_ = nowNs();
+    sending_ = true;
+    
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < streams.size(); ++t) {
+        threads.emplace_back([this, t, &streams, &prepare]() { sendLoop(t, streams[t], prepare); });
+    }
+    
+    // Report achieved rates until the run is over
+    const uint64_t interval_ns = static_cast<uint64_t>(config_.stats_interval_ms) * 1000000;
+    uint64_t last_report = start_ns_;
+    uint64_t last_messages = 0;
+    uint64_t last_datagrams = 0;
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        uint64_t now = nowNs();
+        uint64_t elapsed_ms = (now - start_ns_) / 1000000;
+        if (config_.duration_s > 0 && elapsed_ms >= static_cast<uint64_t>(config_.duration_s) * 1000) break;
+        if (interval_ns == 0 || now - last_report < interval_ns) continue;
+        
+        uint64_t messages = 0;
+        uint64_t datagrams = 0;
+        for (const auto& worker : workers_) {
+            messages += worker->messages.load(std::memory_order_relaxed);
+            datagrams += worker->datagrams.load(std::memory_order_relaxed);
+        }
+        double seconds = static_cast<double>(now - last_report) / 1e9;
+        std::cout << "Load: " << static_cast<uint64_t>(static_cast<double>(messages - last_messages) / seconds)
+                  << " msg/s, " << static_cast<uint64_t>(static_cast<double>(datagrams - last_datagrams) / seconds)
+                  << " datagrams/s";
+        if (config_.profile.size() > 1) {
+            size_t phase = phaseAt(elapsed_ms);
+            std::cout << " | phase " << phase + 1 << "/" << config_.profile.size() << ", target ";
+            if (phaseRate(phase) == 0) {
+                std::cout << "max";
+            } else {
+                std::cout << phaseRate(phase) << " msg/s";
+            }
+        }
+        std::cout << std::endl;
+        
+        last_report = now;
+        last_messages = messages;
+        last_datagrams = datagrams;
+    }
+    
+    sending_ = false;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    stats_.seconds = static_cast<double>(nowNs() - start_ns_) / 1e9;
+    
+    for (const auto& worker : workers_) {
+        stats_.messages += worker->messages.load();
+        stats_.datagrams += worker->datagrams.load();
+        stats_.passes += worker->passes.load();
+        for (auto& sender : worker->senders) {
+            sender->stop();
+            stats_.syscalls += sender->getBatchStats().flushes;
+            stats_.errors += sender->getBatchStats().errors;
+        }
+    }
+    
+    std::cout << "Load run: " << stats_.messages << " messages in " << stats_.datagrams << " datagrams over "
+              << stats_.seconds << "s (" << static_cast<uint64_t>(static_cast<double>(stats_.messages) / stats_.seconds)
+              << " msg/s avg), " << stats_.passes << " stream passes, " << stats_.syscalls << " sendmmsg calls, "
+              << stats_.errors << " send errors" << std::endl;
+    return true;
+}
+
+void LoadGenerator::sendPreamble(Worker& worker, LoadStream& stream) {
+    for (size_t i = 0; i < stream.preamble(); ++i) {
+        for (auto& sender : worker.senders) {
+            sender->queue(stream.datagram(i), stream.length(i));
+        }
+        if ((i + 1) % config_.batch == 0) {
+            for (auto& sender : worker.senders) sender->flush();
+            std::this_thread::sleep_for(PREAMBLE_PAUSE);
+        }
+    }
+    for (auto& sender : worker.senders) sender->flush();
+}
+
+void LoadGenerator::sendLoop(size_t thread, LoadStream& stream, const Prepare& prepare) {
+    Worker& worker = *workers_[thread];
+    const size_t begin = stream.preamble();
+    const size_t end = stream.size();
+    if (begin == end) return;
+    
+    // Messages per datagram, to size batches at low rates
+    uint64_t loop_messages = 0;
+    for (size_t i = begin; i < end; ++i) loop_messages += stream.messageCount(i);
+    const double per_datagram = std::max(1.0, static_cast<double>(loop_messages) / static_cast<double>(end - begin));
+    
+    size_t next = begin;
+    uint64_t pass = 0;
+    size_t phase = SIZE_MAX;
+    double rate = 0.0;          // This thread's share, messages per ns
+    size_t batch = config_.batch;
+    uint64_t due_ns = 0;        // When the next batch may go out
+    
+    while (sending_.load(std::memory_order_relaxed)) {
+        uint64_t now = nowNs();
+        size_t current = phaseAt((now - start_ns_) / 1000000);
+        if (current != phase) {
+            phase = current;
+            rate = static_cast<double>(phaseRate(phase)) / static_cast<double>(workers_.size()) / 1e9;
+            
+            // At most about a millisecond of traffic per batch, so low rates stay smooth
+            batch = config_.batch;
+            if (rate > 0.0) {
+                double per_ms = rate * 1e6 / per_datagram;
+                batch = std::clamp(static_cast<size_t>(per_ms), size_t{1}, config_.batch);
+            }
+            due_ns = now;
+        }
+        
+        uint64_t messages = 0;
+        for (size_t n = 0; n < batch; ++n) {
+            if (next == end) {
+                next = begin;
+                ++pass;
+                worker.passes.fetch_add(1, std::memory_order_relaxed);
+            }
+            uint8_t* data = stream.datagram(next);
+            size_t length = stream.length(next);
+            if (prepare) prepare(thread, data, length, pass);
+            for (auto& sender : worker.senders) {
+                sender->queue(data, length);
+            }
+            messages += stream.messageCount(next);
+            ++next;
+        }
+        for (auto& sender : worker.senders) {
+            sender->flush();
+        }
+        worker.messages.fetch_add(messages, std::memory_order_relaxed);
+        worker.datagrams.fetch_add(batch, std::memory_order_relaxed);
+        
+        if (rate <= 0.0) continue;
+        
+        // The batch is owed messages / rate; sleep most of it, spin the rest
+        due_ns += static_cast<uint64_t>(static_cast<double>(messages) / rate);
+        now = nowNs();
+        if (now > due_ns + MAX_LAG_NS) {
+            due_ns = now;
+            continue;
+        }
+        while (now < due_ns && sending_.load(std::memory_order_relaxed)) {
+            if (due_ns - now > SPIN_NS) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(due_ns - now - SPIN_NS));
+            }
+            now = nowNs();
+        }
+    }
+}
+
+size_t LoadGenerator::phaseAt(uint64_t elapsed_ms) const {
+    if (config_.profile.empty()) return 0;
+    
+    uint64_t phase_end = 0;
+    for (size_t i = 0; i + 1 < config_.profile.size(); ++i) {
+        phase_end += config_.profile[i].duration_ms;
+        if (elapsed_ms < phase_end) return i;
+    }
+    return config_.profile.size() - 1;
+}
+
+uint64_t LoadGenerator::phaseRate(size_t phase) const {
+    if (phase >= config_.profile.size()) return 0;
+    return config_.profile[phase].messages_per_second;
+}
+
+} // namespace simulator
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "../feedhandler/multicast.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace simulator {
+
+// Saturating load generation: message streams are encoded up front into
+// datagram-sized packets, then sent in a loop from several threads with
+// sendmmsg, paced only by a rate profile (or not at all).
+
+// One step of a rate profile
+struct LoadPhase {
+    uint32_t duration_ms = 0;           // 0: holds until the run ends
+    uint64_t messages_per_second = 0;   // 0: unthrottled
+};
+
+// Profile spec:
+//   max      unthrottled for the whole run
+//   steady   base_rate for the whole run
+//   open     1s unthrottled, 4s at 4x, 10s at 2x, then base_rate
+//   <ms>:<rate>[,<ms>:<rate>...]   explicit phases, rate "max" = unthrottled;
+//            the last phase holds until the run ends
+// False (with a message) if the spec does not parse.
+bool parseLoadProfile(const std::string& spec, uint64_t base_rate, std::vector<LoadPhase>& phases);
+
+struct LoadConfig {
+    uint32_t threads = 1;                       // Sender threads, one stream each
+    size_t stream_messages = size_t{1} << 21;   // Pre-generated, across all streams
+    size_t datagram_bytes = 1400;               // Messages packed per datagram up to this
+    size_t batch = 64;                          // Datagrams per sendmmsg
+    uint32_t duration_s = 0;                    // 0: until stopped
+    uint32_t stats_interval_ms = 1000;
+    std::vector<LoadPhase> profile;             // Empty: unthrottled
+};
+
+// Destination every datagram is sent to (one per feed line)
+struct LoadTarget {
+    std::string group;
+    uint16_t port = 0;
+    std::string interface = "0.0.0.0";
+    int ttl = 1;
+};
+
+// Pre-encoded datagrams for one sender thread. The first preamble() datagrams
+// (reference data) go out once before the run; the rest are sent in a loop.
+class LoadStream {
+public:
+    explicit LoadStream(size_t datagram_bytes = 1400);
+    
+    // Space for one message of length bytes, in the open datagram or a new
+    // one if it does not fit. Valid until the next append.
+    uint8_t* append(size_t length);
+    
+    // A whole datagram of length bytes carrying messages messages
+    uint8_t* appendDatagram(size_t length, uint32_t messages);
+    
+    // Everything appended so far is the preamble
+    void markPreamble();
+    
+    size_t size() const { return datagrams_.size(); }
+    size_t preamble() const { return preamble_; }
+    size_t bytes() const { return data_.size(); }
+    uint64_t messages() const { return messages_; }
+    
+    uint8_t* datagram(size_t i) { return data_.data() + datagrams_[i].offset; }
+    size_t length(size_t i) const { return datagrams_[i].length; }
+    uint32_t messageCount(size_t i) const { return datagrams_[i].messages; }
+
+private:
+    struct Datagram {
+        size_t offset;
+        uint32_t length;
+        uint32_t messages;
+    };
+    
+    size_t datagram_bytes_;
+    std::vector<uint8_t> data_;
+    std::vector<Datagram> datagrams_;
+    size_t preamble_ = 0;
+    uint64_t messages_ = 0;
+    bool open_ = false;
+};
+
+class LoadGenerator {
+public:
+    // Called on a sender thread just before a datagram is queued, with the
+    // number of times that thread's stream has wrapped. May rewrite the
+    // datagram in place (sequence numbers, timestamps).
+    using Prepare = std::function<void(size_t thread, uint8_t* datagram, size_t length, uint64_t pass)>;
+    
+    struct Stats {
+        uint64_t messages = 0;
+        uint64_t datagrams = 0;
+        uint64_t passes = 0;        // Stream wraps, all threads
+        uint64_t syscalls = 0;      // sendmmsg calls
+        uint64_t errors = 0;        // Datagrams the kernel refused
+        double seconds = 0.0;
+    };
+    
+    LoadGenerator(const LoadConfig& config, std::vector<LoadTarget> targets);
+    ~LoadGenerator();
+    
+    // Send the preambles, then loop over streams (one thread each) until the
+    // configured duration has passed or running goes false. Blocking.
+    bool run(std::vector<LoadStream>& streams, const std::atomic<bool>& running,
+             const Prepare& prepare = nullptr);
+    
+    const Stats& getStats() const { return stats_; }
+
+private:
+    struct alignas(64) Worker {
+        std::vector<std::unique_ptr<feedhandler::MulticastSender>> senders;
+        std::atomic<uint64_t> messages{0};
+        std::atomic<uint64_t> datagrams{0};
+        std::atomic<uint64_t> passes{0};
+    };
+    
+    void sendLoop(size_t thread, LoadStream& stream, const Prepare& prepare);
+    void sendPreamble(Worker& worker, LoadStream& stream);
+    
+    // Phase in force elapsed_ms into the run
+    size_t phaseAt(uint64_t elapsed_ms) const;
+    uint64_t phaseRate(size_t phase) const;
+    
+    LoadConfig config_;
+    std::vector<LoadTarget> targets_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> sending_{false};
+    uint64_t start_ns_ = 0;
+    Stats stats_;
+};
+
+} // namespace simulator
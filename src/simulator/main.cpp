@@ -1,6 +1,8 @@
 #include "itch_simulator.h"
 
+#include <algorithm>
 #include <csignal>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
@@ -28,6 +30,16 @@ void printUsage(const char* program) {
               << "  --symbols <list>         Comma-separated symbols (default: AAPL,GOOGL,MSFT,AMZN,META)\n"
               << "  --min-price <cents>      Min price in cents (default: 10000 = $100)\n"
               << "  --max-price <cents>      Max price in cents (default: 50000 = $500)\n"
+              << "  --symbol-count <n>       Use n synthetic symbols SIM00000.. instead of --symbols\n"
+              << "\nLoad test (pre-generated streams, many messages per datagram, sendmmsg):\n"
+              << "  --load                   Run a saturating load test instead of the paced feed\n"
+              << "  --load-profile <spec>    max | steady | open | <ms>:<rate>[,...] (default: max;\n"
+              << "                           steady/open scale from --rate, rate \"max\" = unthrottled)\n"
+              << "  --threads <n>            Sender threads, symbols split between them (default: 1)\n"
+              << "  --duration <s>           Stop after s seconds (default: until interrupted)\n"
+              << "  --load-messages <n>      Messages pre-generated before sending (default: 2097152)\n"
+              << "  --packet-bytes <n>       Pack messages into datagrams up to n bytes (default: 1400)\n"
+              << "  --batch <n>              Datagrams per sendmmsg call (default: 64)\n"
               << "  --help                   Show this help\n"
               << std::endl;
 }
@@ -51,8 +63,21 @@ std::vector<std::string> parseSymbols(const std::string& input) {
     return symbols;
 }
 
+std::vector<std::string> syntheticSymbols(int count) {
+    std::vector<std::string> symbols;
+    for (int i = 0; i < count; ++i) {
+        char symbol[16];
+        std::snprintf(symbol, sizeof(symbol), "SIM%05d", i);
+        symbols.push_back(symbol);
+    }
+    return symbols;
+}
+
 int main(int argc, char* argv[]) {
     simulator::SimulatorConfig config;
+    simulator::LoadConfig load;
+    bool load_mode = false;
+    std::string load_profile = "max";
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -83,6 +108,30 @@ int main(int argc, char* argv[]) {
         else if (arg == "--max-price" && i + 1 < argc) {
             config.max_price = static_cast<uint32_t>(std::atoi(argv[++i]));
         }
+        else if (arg == "--symbol-count" && i + 1 < argc) {
+            config.symbols = syntheticSymbols(std::atoi(argv[++i]));
+        }
+        else if (arg == "--load") {
+            load_mode = true;
+        }
+        else if (arg == "--load-profile" && i + 1 < argc) {
+            load_profile = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            load.threads = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--duration" && i + 1 < argc) {
+            load.duration_s = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--load-messages" && i + 1 < argc) {
+            load.stream_messages = static_cast<size_t>(std::atoll(argv[++i]));
+        }
+        else if (arg == "--packet-bytes" && i + 1 < argc) {
+            load.datagram_bytes = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--batch" && i + 1 < argc) {
+            load.batch = static_cast<size_t>(std::atoi(argv[++i]));
+        }
         else {
             std::cerr << "Unknown option: " << arg << std::endl;
             printUsage(argv[0]);
@@ -101,6 +150,17 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    if (load_mode) {
+        uint64_t base_rate = static_cast<uint64_t>(std::max(config.messages_per_second, 0));
+        if (!simulator::parseLoadProfile(load_profile, base_rate, load.profile)) {
+            return 1;
+        }
+    }
+    else if (config.messages_per_second <= 0) {
+        std::cerr << "rate must be positive" << std::endl;
+        return 1;
+    }
+    
     // Set up signal handlers
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
@@ -111,7 +171,12 @@ int main(int argc, char* argv[]) {
     
     std::cout << "Starting ITCH Simulator..." << std::endl;
     
-    simulator.run();
+    if (load_mode) {
+        simulator.runLoad(load);
+    }
+    else {
+        simulator.run();
+    }
     
     g_simulator = nullptr;
     return 0;